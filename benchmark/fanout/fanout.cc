@@ -0,0 +1,186 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/benchmark/fanout/fanout.h"
+
+#include <iostream>
+
+#include "apps/ledger/benchmark/lib/convert.h"
+#include "apps/ledger/benchmark/lib/data.h"
+#include "apps/ledger/benchmark/lib/get_ledger.h"
+#include "apps/ledger/benchmark/lib/logging.h"
+#include "apps/tracing/lib/trace/event.h"
+#include "apps/tracing/lib/trace/provider.h"
+#include "lib/ftl/command_line.h"
+#include "lib/ftl/logging.h"
+#include "lib/ftl/strings/string_number_conversions.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace {
+constexpr ftl::StringView kStoragePath = "/data/benchmark/ledger/fanout";
+constexpr ftl::StringView kEntryCountFlag = "entry-count";
+constexpr ftl::StringView kValueSizeFlag = "value-size";
+constexpr ftl::StringView kFanoutBitsFlag = "fanout-bits";
+constexpr ftl::StringView kUpdateCountFlag = "update-count";
+
+void PrintUsage(const char* executable_name) {
+  std::cout << "Usage: " << executable_name << " --" << kEntryCountFlag
+            << "=<int> --" << kValueSizeFlag << "=<int> --" << kFanoutBitsFlag
+            << "=<int> --" << kUpdateCountFlag << "=<int>" << std::endl;
+}
+
+bool GetPositiveIntOption(const ftl::CommandLine& command_line,
+                          ftl::StringView flag,
+                          int* value) {
+  std::string value_str;
+  return command_line.GetOptionValue(flag.ToString(), &value_str) &&
+         ftl::StringToNumberWithError(value_str, value) && *value > 0;
+}
+
+}  // namespace
+
+namespace benchmark {
+
+FanoutBenchmark::FanoutBenchmark(int entry_count,
+                                 int value_size,
+                                 int fanout_bits,
+                                 int update_count)
+    : tmp_dir_(kStoragePath),
+      application_context_(app::ApplicationContext::CreateFromStartupInfo()),
+      entry_count_(entry_count),
+      value_size_(value_size),
+      fanout_bits_(fanout_bits),
+      update_count_(update_count),
+      page_watcher_binding_(this) {
+  FTL_DCHECK(entry_count > 0);
+  FTL_DCHECK(value_size > 0);
+  FTL_DCHECK(update_count > 0 && update_count <= entry_count);
+  tracing::InitializeTracer(application_context_.get(),
+                            {"benchmark_ledger_fanout"});
+}
+
+void FanoutBenchmark::Run() {
+  ledger::LedgerPtr ledger =
+      benchmark::GetLedger(application_context_.get(), &ledger_controller_,
+                           "fanout", tmp_dir_.path(), false, "");
+  benchmark::GetPageEnsureInitialized(
+      ledger.get(), nullptr, [this](ledger::PagePtr page, auto id) {
+        page_ = std::move(page);
+        page_->SetFanout(fanout_bits_, [this](ledger::Status status) {
+          if (benchmark::QuitOnError(status, "Page::SetFanout")) {
+            return;
+          }
+          PutEntry(0);
+        });
+      });
+}
+
+void FanoutBenchmark::OnChange(ledger::PageChangePtr page_change,
+                               ledger::ResultState result_state,
+                               const OnChangeCallback& callback) {
+  FTL_DCHECK(page_change->changes.size() == 1);
+  FTL_DCHECK(result_state == ledger::ResultState::COMPLETED);
+  TRACE_ASYNC_END("benchmark", "diff", current_update_);
+  UpdateEntry(current_update_ + 1);
+  callback(nullptr);
+}
+
+void FanoutBenchmark::PutEntry(int i) {
+  if (i == entry_count_) {
+    Scan();
+    return;
+  }
+
+  fidl::Array<uint8_t> key = benchmark::MakeKey(i);
+  keys_.push_back(key.Clone());
+  fidl::Array<uint8_t> value = benchmark::MakeValue(value_size_);
+  TRACE_ASYNC_BEGIN("benchmark", "put", i);
+  page_->Put(std::move(key), std::move(value),
+             [this, i](ledger::Status status) {
+               if (benchmark::QuitOnError(status, "Page::Put")) {
+                 return;
+               }
+               TRACE_ASYNC_END("benchmark", "put", i);
+               PutEntry(i + 1);
+             });
+}
+
+void FanoutBenchmark::Scan() {
+  page_->GetSnapshot(snapshot_.NewRequest(), nullptr,
+                     page_watcher_binding_.NewBinding(),
+                     [this](ledger::Status status) {
+                       if (benchmark::QuitOnError(status, "GetSnapshot")) {
+                         return;
+                       }
+                       TRACE_ASYNC_BEGIN("benchmark", "scan", 0);
+                       ScanFrom(nullptr);
+                     });
+}
+
+void FanoutBenchmark::ScanFrom(fidl::Array<uint8_t> token) {
+  snapshot_->GetEntries(
+      nullptr, std::move(token),
+      [this](ledger::Status status, fidl::Array<ledger::EntryPtr> entries,
+             fidl::Array<uint8_t> next_token) {
+        if (status != ledger::Status::PARTIAL_RESULT &&
+            benchmark::QuitOnError(status, "PageSnapshot::GetEntries")) {
+          return;
+        }
+        if (next_token) {
+          ScanFrom(std::move(next_token));
+          return;
+        }
+        TRACE_ASYNC_END("benchmark", "scan", 0);
+        UpdateEntry(0);
+      });
+}
+
+void FanoutBenchmark::UpdateEntry(int i) {
+  if (i == update_count_) {
+    ShutDown();
+    return;
+  }
+
+  // Spread the updates over the whole page.
+  current_update_ = i;
+  fidl::Array<uint8_t> key =
+      keys_[static_cast<size_t>(i) * entry_count_ / update_count_].Clone();
+  fidl::Array<uint8_t> value = benchmark::MakeValue(value_size_);
+  TRACE_ASYNC_BEGIN("benchmark", "diff", i);
+  page_->Put(std::move(key), std::move(value),
+             benchmark::QuitOnErrorCallback("Page::Put"));
+}
+
+void FanoutBenchmark::ShutDown() {
+  // Shut down the Ledger process first as it relies on |tmp_dir_| storage.
+  ledger_controller_->Kill();
+  ledger_controller_.WaitForIncomingResponseWithTimeout(
+      ftl::TimeDelta::FromSeconds(5));
+  mtl::MessageLoop::GetCurrent()->PostQuitTask();
+}
+}  // namespace benchmark
+
+int main(int argc, const char** argv) {
+  ftl::CommandLine command_line = ftl::CommandLineFromArgcArgv(argc, argv);
+
+  int entry_count;
+  int value_size;
+  int fanout_bits;
+  int update_count;
+  if (!GetPositiveIntOption(command_line, kEntryCountFlag, &entry_count) ||
+      !GetPositiveIntOption(command_line, kValueSizeFlag, &value_size) ||
+      !GetPositiveIntOption(command_line, kFanoutBitsFlag, &fanout_bits) ||
+      !GetPositiveIntOption(command_line, kUpdateCountFlag, &update_count) ||
+      update_count > entry_count) {
+    PrintUsage(argv[0]);
+    return -1;
+  }
+
+  mtl::MessageLoop loop;
+  benchmark::FanoutBenchmark app(entry_count, value_size, fanout_bits,
+                                 update_count);
+  loop.task_runner()->PostTask([&app] { app.Run(); });
+  loop.Run();
+  return 0;
+}
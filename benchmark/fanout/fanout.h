@@ -0,0 +1,70 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_BENCHMARK_FANOUT_FANOUT_H_
+#define APPS_LEDGER_BENCHMARK_FANOUT_FANOUT_H_
+
+#include <memory>
+#include <vector>
+
+#include "application/lib/app/application_context.h"
+#include "apps/ledger/services/public/ledger.fidl.h"
+#include "lib/fidl/cpp/bindings/binding.h"
+#include "lib/ftl/files/scoped_temp_dir.h"
+
+namespace benchmark {
+
+// Benchmark that measures the impact of the fan-out of the page tree on the
+// main operations. The page is first set to the given fan-out, then filled
+// entry by entry ("put" events), fully read ("scan" event), and finally
+// updated one entry at a time, measuring the time until a watcher receives
+// the computed diff ("diff" events).
+//
+// Parameters:
+//   --entry-count=<int> the number of entries to be put
+//   --value-size=<int> the size of a single value in bytes
+//   --fanout-bits=<int> the fan-out of the page tree, see Page.SetFanout()
+//   --update-count=<int> the number of entries to be updated
+class FanoutBenchmark : public ledger::PageWatcher {
+ public:
+  FanoutBenchmark(int entry_count,
+                  int value_size,
+                  int fanout_bits,
+                  int update_count);
+
+  void Run();
+
+  // ledger::PageWatcher:
+  void OnChange(ledger::PageChangePtr page_change,
+                ledger::ResultState result_state,
+                const OnChangeCallback& callback) override;
+
+ private:
+  void PutEntry(int i);
+  void Scan();
+  void ScanFrom(fidl::Array<uint8_t> token);
+  void UpdateEntry(int i);
+
+  void ShutDown();
+
+  files::ScopedTempDir tmp_dir_;
+  std::unique_ptr<app::ApplicationContext> application_context_;
+  const int entry_count_;
+  const int value_size_;
+  const int fanout_bits_;
+  const int update_count_;
+  fidl::Binding<ledger::PageWatcher> page_watcher_binding_;
+  std::vector<fidl::Array<uint8_t>> keys_;
+  int current_update_ = 0;
+
+  app::ApplicationControllerPtr ledger_controller_;
+  ledger::PagePtr page_;
+  ledger::PageSnapshotPtr snapshot_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(FanoutBenchmark);
+};
+
+}  // namespace benchmark
+
+#endif  // APPS_LEDGER_BENCHMARK_FANOUT_FANOUT_H_
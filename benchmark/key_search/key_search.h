@@ -0,0 +1,54 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_BENCHMARK_KEY_SEARCH_KEY_SEARCH_H_
+#define APPS_LEDGER_BENCHMARK_KEY_SEARCH_KEY_SEARCH_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "application/lib/app/application_context.h"
+#include "apps/ledger/src/storage/public/types.h"
+#include "lib/ftl/macros.h"
+
+namespace benchmark {
+
+// Microbenchmark comparing the search of a key among the entries of a single
+// tree node using a plain binary search over the entries ("lower_bound"
+// events) with the search through the node's key index ("key_index" events).
+// Each event covers |search-count| searches of random keys.
+//
+// Parameters:
+//   --entry-count=<int> the number of entries in the node
+//   --prefix-size=<int> the size of the prefix shared by all keys in bytes
+//   --search-count=<int> the number of searches per measurement
+//   --round-count=<int> the number of measurements of each kind
+class KeySearchBenchmark {
+ public:
+  KeySearchBenchmark(int entry_count,
+                     int prefix_size,
+                     int search_count,
+                     int round_count);
+
+  void Run();
+
+ private:
+  void RunLowerBound();
+  void RunKeyIndex();
+
+  std::unique_ptr<app::ApplicationContext> application_context_;
+  const int search_count_;
+  const int round_count_;
+  std::vector<storage::Entry> entries_;
+  std::vector<std::string> searched_keys_;
+  // Accumulates the search results so that they are not optimized away.
+  size_t checksum_ = 0;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(KeySearchBenchmark);
+};
+
+}  // namespace benchmark
+
+#endif  // APPS_LEDGER_BENCHMARK_KEY_SEARCH_KEY_SEARCH_H_
@@ -4,35 +4,95 @@
 
 #include "apps/ledger/src/app/branch_tracker.h"
 
+#include <utility>
 #include <vector>
 
 #include "apps/ledger/src/app/diff_utils.h"
 #include "apps/ledger/src/app/fidl/serialization_size.h"
+#include "apps/ledger/src/app/page_change_cache.h"
 #include "apps/ledger/src/app/page_manager.h"
 #include "apps/ledger/src/callback/waiter.h"
-#include "lib/ftl/functional/auto_call.h"
+#include "apps/ledger/src/convert/convert.h"
 #include "lib/ftl/functional/make_copyable.h"
+#include "lib/ftl/memory/weak_ptr.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/ftl/time/time_point.h"
+#include "lib/mtl/tasks/message_loop.h"
 
 namespace ledger {
+namespace {
+
+// Returns the intersection of |range| and |bounds|, or false if it is empty.
+bool IntersectRange(const diff_utils::KeyRange& bounds,
+                    diff_utils::KeyRange* range) {
+  if (range->start < bounds.start) {
+    range->start = bounds.start;
+  }
+  if (range->end.empty() || (!bounds.end.empty() && bounds.end < range->end)) {
+    range->end = bounds.end;
+  }
+  return range->end.empty() || range->start < range->end;
+}
+
+// Returns the ranges of the keys watched by a watcher of the keys starting
+// with |key_prefix|, with the given |options|.
+std::vector<diff_utils::KeyRange> GetWatchedRanges(
+    std::string key_prefix,
+    const WatchOptions& options) {
+  diff_utils::KeyRange bounds =
+      diff_utils::GetPrefixRange(std::move(key_prefix));
+  std::vector<diff_utils::KeyRange> ranges;
+  if (!options.key_prefixes && !options.key_ranges) {
+    ranges.push_back(std::move(bounds));
+    return ranges;
+  }
+  if (options.key_prefixes) {
+    for (const auto& prefix : options.key_prefixes) {
+      diff_utils::KeyRange range =
+          diff_utils::GetPrefixRange(convert::ToString(prefix));
+      if (IntersectRange(bounds, &range)) {
+        ranges.push_back(std::move(range));
+      }
+    }
+  }
+  if (options.key_ranges) {
+    for (const auto& key_range : options.key_ranges) {
+      diff_utils::KeyRange range;
+      range.start = convert::ToString(key_range->start);
+      if (key_range->end) {
+        if (key_range->end.size() == 0) {
+          continue;
+        }
+        range.end = convert::ToString(key_range->end);
+      }
+      if (IntersectRange(bounds, &range)) {
+        ranges.push_back(std::move(range));
+      }
+    }
+  }
+  return ranges;
+}
+
+}  // namespace
+
 class BranchTracker::PageWatcherContainer {
  public:
-  PageWatcherContainer(coroutine::CoroutineService* coroutine_service,
-                       PageWatcherPtr watcher,
+  PageWatcherContainer(PageWatcherPtr watcher,
                        PageManager* page_manager,
-                       storage::PageStorage* storage,
+                       PageChangeCache* page_change_cache,
                        std::unique_ptr<const storage::Commit> base_commit,
-                       std::string key_prefix)
+                       std::string key_prefix,
+                       WatchOptionsPtr options)
       : change_in_flight_(false),
         last_commit_(std::move(base_commit)),
-        coroutine_service_(coroutine_service),
         key_prefix_(std::move(key_prefix)),
+        options_(std::move(options)),
+        key_ranges_(GetWatchedRanges(key_prefix_, *options_)),
         manager_(page_manager),
-        storage_(storage),
-        interface_(std::move(watcher)) {
+        page_change_cache_(page_change_cache),
+        interface_(std::move(watcher)),
+        weak_factory_(this) {
     interface_.set_connection_error_handler([this] {
-      if (handler_) {
-        handler_->Continue(true);
-      }
       if (on_empty_callback_) {
         on_empty_callback_();
       }
@@ -43,10 +103,6 @@ class BranchTracker::PageWatcherContainer {
     if (on_drained_) {
       on_drained_();
     }
-    if (handler_) {
-      handler_->Continue(true);
-    }
-    FTL_DCHECK(!handler_);
   }
 
   void set_on_empty(ftl::Closure on_empty_callback) {
@@ -77,6 +133,20 @@ class BranchTracker::PageWatcherContainer {
       on_drained();
       on_drained_ = nullptr;
     }
+    if (!on_drained_ || options_->max_drain_wait_ms == 0u) {
+      return;
+    }
+    // Do not block the transaction for longer than |max_drain_wait_ms|.
+    mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+        [ weak_this = weak_factory_.GetWeakPtr(), drain_id = ++drain_id_ ] {
+          if (weak_this && weak_this->on_drained_ &&
+              weak_this->drain_id_ == drain_id) {
+            ftl::Closure on_drained = std::move(weak_this->on_drained_);
+            weak_this->on_drained_ = nullptr;
+            on_drained();
+          }
+        },
+        ftl::TimeDelta::FromMilliseconds(options_->max_drain_wait_ms));
   }
 
  private:
@@ -87,51 +157,26 @@ class BranchTracker::PageWatcherContainer {
            last_commit_->GetId() == current_commit_->GetId();
   }
 
-  std::vector<PageChangePtr> PaginateChanges(PageChangePtr change) {
-    std::vector<PageChangePtr> changes;
-
-    size_t fidl_size;
-    size_t timestamp = change->timestamp;
-    auto entries = std::move(change->changes);
-    auto deletions = std::move(change->deleted_keys);
-    for (size_t i = 0, j = 0; i < entries.size() || j < deletions.size();) {
-      bool add_entry =
-          i < entries.size() && (j == deletions.size() ||
-                                 convert::ExtendedStringView(entries[i]->key) <
-                                     convert::ExtendedStringView(deletions[j]));
-      size_t entry_size =
-          add_entry ? fidl_serialization::GetEntrySize(entries[i]->key.size())
-                    : fidl_serialization::GetByteArraySize(deletions[j].size());
-
-      if (changes.empty() ||
-          fidl_size + entry_size > fidl_serialization::kMaxInlineDataSize) {
-        changes.push_back(PageChange::New());
-        changes.back()->timestamp = timestamp;
-        changes.back()->changes = fidl::Array<EntryPtr>::New(0);
-        changes.back()->deleted_keys =
-            fidl::Array<fidl::Array<uint8_t>>::New(0);
-        fidl_size = fidl_serialization::kPageChangeHeaderSize;
-      }
-      fidl_size += entry_size;
-      if (add_entry) {
-        changes.back()->changes.push_back(std::move(entries[i]));
-        ++i;
-      } else {
-        changes.back()->deleted_keys.push_back(std::move(deletions[j]));
-        ++j;
-      }
-    }
-    return changes;
+  diff_utils::ValueOptions GetValueOptions() {
+    diff_utils::ValueOptions value_options;
+    value_options.format = options_->packed_values
+                               ? diff_utils::ValueFormat::PACKED
+                               : diff_utils::ValueFormat::ENTRIES;
+    value_options.keys_only = options_->keys_only;
+    value_options.max_inline_size = options_->max_inline_value_size;
+    return value_options;
   }
 
+  // Sends |page_change|, the page of the change up to |new_commit| that ends
+  // before |next_token|, and then the following page, if any.
   void SendChange(PageChangePtr page_change,
                   ResultState state,
                   std::unique_ptr<const storage::Commit> new_commit,
-                  ftl::Closure on_done) {
+                  std::string next_token) {
     interface_->OnChange(
         std::move(page_change), state, ftl::MakeCopyable([
           this, state, new_commit = std::move(new_commit),
-          on_done = std::move(on_done)
+          next_token = std::move(next_token)
         ](fidl::InterfaceRequest<PageSnapshot> snapshot_request) mutable {
           if (snapshot_request) {
             manager_->BindPageSnapshot(
@@ -139,41 +184,36 @@ class BranchTracker::PageWatcherContainer {
           }
           if (state != ResultState::COMPLETED &&
               state != ResultState::PARTIAL_COMPLETED) {
-            on_done();
+            SendPage(std::move(new_commit), std::move(next_token), false);
             return;
           }
           change_in_flight_ = false;
           last_commit_.swap(new_commit);
-          // SendCommit will start handling the following commit, so we need to
-          // make sure on_done() is called before that.
-          on_done();
           SendCommit();
         }));
   }
 
-  // Sends a commit to the watcher if needed.
-  void SendCommit() {
-    if (change_in_flight_) {
-      return;
-    }
-
-    if (Drained()) {
-      if (on_drained_) {
-        on_drained_();
-        on_drained_ = nullptr;
-      }
-      return;
-    }
-
-    change_in_flight_ = true;
-
+  // Computes and sends the page of the change from |last_commit_| to
+  // |new_commit| starting at |min_key|. Pages are computed one at a time, when
+  // the watcher acknowledges the previous one, so that at most one page of the
+  // change is held in memory for this watcher.
+  void SendPage(std::unique_ptr<const storage::Commit> new_commit,
+                std::string min_key,
+                bool first_page) {
     // TODO(etiennej): See LE-74: clean object ownership
-    diff_utils::ComputePageChange(
-        storage_, *last_commit_, *current_commit_, key_prefix_, key_prefix_,
-        std::numeric_limits<size_t>::max(),
-        ftl::MakeCopyable([ this, new_commit = std::move(current_commit_) ](
-            Status status,
-            std::pair<PageChangePtr, std::string> page_change_ptr) mutable {
+    // The page is shared with the other watchers at the same commits.
+    const storage::Commit* commit = new_commit.get();
+    page_change_cache_->GetPageChange(
+        *last_commit_, *commit, key_ranges_, std::move(min_key),
+        fidl_serialization::kMaxInlineDataSize, GetValueOptions(),
+        ftl::MakeCopyable([
+          this, weak_this = weak_factory_.GetWeakPtr(), first_page,
+          new_commit = std::move(new_commit)
+        ](Status status, PageChangePtr page_change,
+          std::string next_token) mutable {
+          if (!weak_this) {
+            return;
+          }
           if (status != Status::OK) {
             // This change notification is abandonned. At the next commit,
             // we will try again (but not before). The next notification
@@ -183,69 +223,92 @@ class BranchTracker::PageWatcherContainer {
             return;
           }
 
-          if (!page_change_ptr.first) {
+          if (!page_change) {
+            FTL_DCHECK(first_page);
             change_in_flight_ = false;
             last_commit_.swap(new_commit);
             SendCommit();
             return;
           }
-          std::vector<PageChangePtr> paginated_changes =
-              PaginateChanges(std::move(page_change_ptr.first));
-          if (paginated_changes.size() == 1) {
-            SendChange(std::move(paginated_changes[0]), ResultState::COMPLETED,
-                       std::move(new_commit), [] {});
-            return;
+          ResultState state;
+          if (next_token.empty()) {
+            state = first_page ? ResultState::COMPLETED
+                               : ResultState::PARTIAL_COMPLETED;
+          } else {
+            state = first_page ? ResultState::PARTIAL_STARTED
+                               : ResultState::PARTIAL_CONTINUED;
           }
-          coroutine_service_->StartCoroutine(ftl::MakeCopyable([
-            this, new_commit = std::move(new_commit),
-            paginated_changes = std::move(paginated_changes)
-          ](coroutine::CoroutineHandler * handler) mutable {
-            auto guard = ftl::MakeAutoCall([this] { handler_ = nullptr; });
-            FTL_DCHECK(!handler_);
-            handler_ = handler;
-            for (size_t i = 0; i < paginated_changes.size(); ++i) {
-              ResultState state;
-              if (i == 0) {
-                state = ResultState::PARTIAL_STARTED;
-              } else if (i == paginated_changes.size() - 1) {
-                state = ResultState::PARTIAL_COMPLETED;
-              } else {
-                state = ResultState::PARTIAL_CONTINUED;
-              }
-              if (coroutine::SyncCall(
-                      handler, ftl::MakeCopyable([
-                        this, change = std::move(paginated_changes[i]), state,
-                        new_commit = new_commit->Clone()
-                      ](ftl::Closure on_done) mutable {
-                        SendChange(std::move(change), state,
-                                   std::move(new_commit), std::move(on_done));
-
-                      }))) {
-                return;
-              }
-            }
-          }));
+          SendChange(std::move(page_change), state, std::move(new_commit),
+                     std::move(next_token));
         }));
   }
 
+  // Sends a commit to the watcher if needed.
+  void SendCommit() {
+    if (change_in_flight_) {
+      return;
+    }
+
+    if (Drained()) {
+      if (on_drained_) {
+        on_drained_();
+        on_drained_ = nullptr;
+      }
+      return;
+    }
+
+    // Rate limit the changes: the commits received before the end of the
+    // interval are coalesced into the next change.
+    ftl::TimePoint now = ftl::TimePoint::Now();
+    ftl::TimeDelta min_interval =
+        ftl::TimeDelta::FromMilliseconds(options_->min_interval_ms);
+    if (last_change_time_ + min_interval > now) {
+      if (!send_scheduled_) {
+        send_scheduled_ = true;
+        mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+            [weak_this = weak_factory_.GetWeakPtr()] {
+              if (weak_this) {
+                weak_this->send_scheduled_ = false;
+                weak_this->SendCommit();
+              }
+            },
+            last_change_time_ + min_interval - now);
+      }
+      return;
+    }
+
+    change_in_flight_ = true;
+    last_change_time_ = now;
+    SendPage(std::move(current_commit_), "", true);
+  }
+
   ftl::Closure on_drained_ = nullptr;
   ftl::Closure on_empty_callback_ = nullptr;
   bool change_in_flight_;
+  // Whether a call to |SendCommit| is scheduled at the end of the minimum
+  // interval between changes.
+  bool send_scheduled_ = false;
+  // The time at which the last change started to be sent.
+  ftl::TimePoint last_change_time_;
+  // Identifies the last call to |SetOnDrainedCallback|, for its timeout.
+  uint64_t drain_id_ = 0u;
   std::unique_ptr<const storage::Commit> last_commit_;
   std::unique_ptr<const storage::Commit> current_commit_;
-  coroutine::CoroutineService* coroutine_service_;
-  coroutine::CoroutineHandler* handler_ = nullptr;
   const std::string key_prefix_;
+  const WatchOptionsPtr options_;
+  // The ranges of the keys of the changes sent to the watcher.
+  const std::vector<diff_utils::KeyRange> key_ranges_;
   PageManager* manager_;
-  storage::PageStorage* storage_;
+  PageChangeCache* page_change_cache_;
   PageWatcherPtr interface_;
+
+  // Must be the last member field.
+  ftl::WeakPtrFactory<PageWatcherContainer> weak_factory_;
 };
 
-BranchTracker::BranchTracker(coroutine::CoroutineService* coroutine_service,
-                             PageManager* manager,
+BranchTracker::BranchTracker(PageManager* manager,
                              storage::PageStorage* storage)
-    : coroutine_service_(coroutine_service),
-      manager_(manager),
+    : manager_(manager),
       storage_(storage),
       transaction_in_progress_(false) {
   watchers_.set_on_empty([this] { CheckEmpty(); });
@@ -345,9 +408,11 @@ void BranchTracker::StopTransaction(
 void BranchTracker::RegisterPageWatcher(
     PageWatcherPtr page_watcher_ptr,
     std::unique_ptr<const storage::Commit> base_commit,
-    std::string key_prefix) {
-  watchers_.emplace(coroutine_service_, std::move(page_watcher_ptr), manager_,
-                    storage_, std::move(base_commit), std::move(key_prefix));
+    std::string key_prefix,
+    WatchOptionsPtr options) {
+  watchers_.emplace(std::move(page_watcher_ptr), manager_,
+                    manager_->page_change_cache(), std::move(base_commit),
+                    std::move(key_prefix), std::move(options));
 }
 
 bool BranchTracker::IsEmpty() {
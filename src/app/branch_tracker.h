@@ -10,7 +10,6 @@
 #include "apps/ledger/services/public/ledger.fidl.h"
 #include "apps/ledger/src/app/page_snapshot_impl.h"
 #include "apps/ledger/src/callback/auto_cleanable.h"
-#include "apps/ledger/src/coroutine/coroutine.h"
 #include "apps/ledger/src/storage/public/commit_watcher.h"
 #include "apps/ledger/src/storage/public/page_storage.h"
 #include "apps/ledger/src/storage/public/types.h"
@@ -24,9 +23,7 @@ class PageManager;
 // have the same parent, the first one to be received will be followed.
 class BranchTracker : public storage::CommitWatcher {
  public:
-  BranchTracker(coroutine::CoroutineService* coroutine_service,
-                PageManager* manager,
-                storage::PageStorage* storage);
+  BranchTracker(PageManager* manager, storage::PageStorage* storage);
   ~BranchTracker();
 
   void set_on_empty(ftl::Closure on_empty_callback);
@@ -37,7 +34,8 @@ class BranchTracker : public storage::CommitWatcher {
   // Registers a new PageWatcher interface.
   void RegisterPageWatcher(PageWatcherPtr page_watcher_ptr,
                            std::unique_ptr<const storage::Commit> base_commit,
-                           std::string key_prefix);
+                           std::string key_prefix,
+                           WatchOptionsPtr options);
 
   // Informs the BranchTracker that a transaction is in progress. It first
   // drains all pending Watcher updates, then stop sending them until
@@ -66,7 +64,6 @@ class BranchTracker : public storage::CommitWatcher {
 
   void CheckEmpty();
 
-  coroutine::CoroutineService* coroutine_service_;
   PageManager* manager_;
   storage::PageStorage* storage_;
   callback::AutoCleanableSet<PageWatcherContainer> watchers_;
@@ -4,63 +4,297 @@
 
 #include "apps/ledger/src/app/diff_utils.h"
 
+#include <algorithm>
 #include <limits>
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "apps/ledger/src/app/fidl/packed_entries.h"
 #include "apps/ledger/src/app/fidl/serialization_size.h"
 #include "apps/ledger/src/app/page_utils.h"
 #include "apps/ledger/src/callback/waiter.h"
 #include "apps/ledger/src/storage/public/object.h"
+#include "apps/ledger/src/storage/public/types.h"
 #include "lib/ftl/functional/make_copyable.h"
+#include "lib/ftl/macros.h"
 #include "lib/mtl/vmo/strings.h"
 
 namespace ledger {
 namespace diff_utils {
 
-void ComputePageChange(
+namespace {
+
+// A value already read from the storage, held in memory.
+class ValueInMemory : public storage::Object {
+ public:
+  ValueInMemory(storage::ObjectId id, std::string data)
+      : id_(std::move(id)), data_(std::move(data)) {}
+  ~ValueInMemory() override {}
+
+  storage::ObjectId GetId() const override { return id_; }
+
+  storage::Status GetData(ftl::StringView* data) const override {
+    *data = data_;
+    return storage::Status::OK;
+  }
+
+  storage::Status GetSize(uint64_t* size) const override {
+    *size = data_.size();
+    return storage::Status::OK;
+  }
+
+  storage::Status ReadData(int64_t offset,
+                           int64_t max_size,
+                           std::string* data) const override {
+    uint64_t start;
+    uint64_t length;
+    storage::GetDataPart(data_.size(), offset, max_size, &start, &length);
+    *data = data_.substr(start, length);
+    return storage::Status::OK;
+  }
+
+  storage::Status GetStorageBytes(ftl::StringView* data) const override {
+    // Only the data of the value is known, not how it is stored.
+    return storage::Status::NOT_IMPLEMENTED;
+  }
+
+ private:
+  const storage::ObjectId id_;
+  const std::string data_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ValueInMemory);
+};
+
+Priority GetPriority(const storage::Entry& entry) {
+  return entry.priority == storage::KeyPriority::EAGER ? Priority::EAGER
+                                                       : Priority::LAZY;
+}
+
+// Sets the values of the new and modified entries of |page_change|, in the
+// format given by |value_format|, from |entries| and their |values|. A null
+// value is not available locally.
+Status SetChangedValues(
+    ValueFormat value_format,
+    const std::vector<storage::Entry>& entries,
+    const std::vector<std::unique_ptr<const storage::Object>>& values,
+    PageChange* page_change) {
+  FTL_DCHECK(entries.size() == values.size());
+  PackedEntriesBuilder builder;
+  for (size_t i = 0; i < entries.size(); i++) {
+    ftl::StringView data;
+    if (values[i]) {
+      storage::Status status = values[i]->GetData(&data);
+      if (status != storage::Status::OK) {
+        return PageUtils::ConvertStatus(status);
+      }
+    }
+    if (value_format == ValueFormat::PACKED) {
+      if (values[i]) {
+        builder.Add(entries[i].key, GetPriority(entries[i]), data);
+      } else {
+        builder.AddWithoutValue(entries[i].key, GetPriority(entries[i]));
+      }
+      continue;
+    }
+    EntryPtr entry = Entry::New();
+    entry->key = convert::ToArray(entries[i].key);
+    entry->priority = GetPriority(entries[i]);
+    if (values[i] && !mtl::VmoFromString(data, &entry->value)) {
+      return Status::INTERNAL_ERROR;
+    }
+    page_change->changes.push_back(std::move(entry));
+  }
+  if (value_format == ValueFormat::PACKED) {
+    page_change->packed_changes = builder.Build();
+    if (!page_change->packed_changes) {
+      return Status::INTERNAL_ERROR;
+    }
+  }
+  return Status::OK;
+}
+
+// Calls |callback| with the value |object_id|, or with null if it is not
+// available locally.
+void GetLocalValue(
     storage::PageStorage* storage,
-    const storage::Commit& base,
-    const storage::Commit& other,
-    std::string prefix_key,
-    std::string min_key,
-    size_t max_fidl_size,
-    std::function<void(Status, std::pair<PageChangePtr, std::string>)>
-        callback) {
-  struct Context {
-    // The PageChangePtr to be returned through the callback.
-    PageChangePtr page_change = PageChange::New();
-    // The serialization size of all entries.
-    size_t fidl_size = fidl_serialization::kPageChangeHeaderSize;
-    // The next token to be returned through the callback.
-    std::string next_token = "";
-  };
+    storage::ObjectIdView object_id,
+    std::function<void(storage::Status,
+                       std::unique_ptr<const storage::Object>)> callback) {
+  storage->GetObject(
+      object_id, storage::PageStorage::Location::LOCAL,
+      [callback = std::move(callback)](
+          storage::Status status,
+          std::unique_ptr<const storage::Object> object) {
+        if (status == storage::Status::NOT_FOUND) {
+          callback(storage::Status::OK, nullptr);
+          return;
+        }
+        callback(status, std::move(object));
+      });
+}
 
-  auto waiter = callback::Waiter<Status, mx::vmo>::Create(Status::OK);
+// Same as |GetLocalValue|, but calls |callback| with null if the value is
+// larger than |max_size| bytes. Only the first |max_size| + 1 bytes of larger
+// values are read, and smaller values are read only once.
+void GetLocalValueUpTo(
+    storage::PageStorage* storage,
+    storage::ObjectIdView object_id,
+    uint64_t max_size,
+    std::function<void(storage::Status,
+                       std::unique_ptr<const storage::Object>)> callback) {
+  if (max_size >= static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+    GetLocalValue(storage, object_id, std::move(callback));
+    return;
+  }
+  storage->GetObjectPart(
+      object_id, 0, static_cast<int64_t>(max_size) + 1,
+      storage::PageStorage::Location::LOCAL,
+      [ object_id = object_id.ToString(), max_size,
+        callback = std::move(callback) ](storage::Status status,
+                                         std::string data) mutable {
+        if (status == storage::Status::NOT_FOUND ||
+            (status == storage::Status::OK && data.size() > max_size)) {
+          callback(storage::Status::OK, nullptr);
+          return;
+        }
+        if (status != storage::Status::OK) {
+          callback(status, nullptr);
+          return;
+        }
+        callback(storage::Status::OK,
+                 std::make_unique<ValueInMemory>(std::move(object_id),
+                                                 std::move(data)));
+      });
+}
 
-  auto context = std::make_unique<Context>();
-  context->page_change->timestamp = other.GetTimestamp();
-  context->page_change->changes = fidl::Array<EntryPtr>::New(0);
-  context->page_change->deleted_keys =
-      fidl::Array<fidl::Array<uint8_t>>::New(0);
+// State of the computation of a PageChange.
+struct PageChangeContext {
+  storage::PageStorage* storage;
+  std::unique_ptr<const storage::Commit> base;
+  std::unique_ptr<const storage::Commit> other;
+  // The sorted and disjoint ranges of the keys of the change.
+  std::vector<KeyRange> ranges;
+  // The next range to diff.
+  size_t next_range = 0u;
+  std::string min_key;
+  size_t max_fidl_size;
+  ValueOptions value_options;
+  std::function<void(Status, std::pair<PageChangePtr, std::string>)> callback;
+  // Collates the reads of the values of |changed_entries|.
+  ftl::RefPtr<
+      callback::Waiter<storage::Status, std::unique_ptr<const storage::Object>>>
+      waiter;
+  // The PageChangePtr to be returned through the callback.
+  PageChangePtr page_change = PageChange::New();
+  // The new and modified entries.
+  std::vector<storage::Entry> changed_entries;
+  // The serialization size of all entries.
+  size_t fidl_size = fidl_serialization::kPageChangeHeaderSize;
+  // The next token to be returned through the callback.
+  std::string next_token = "";
+};
 
-  if (min_key < prefix_key) {
-    min_key = prefix_key;
+// Sorts |ranges| and merges the overlapping ones.
+std::vector<KeyRange> NormalizeRanges(std::vector<KeyRange> ranges) {
+  std::sort(ranges.begin(), ranges.end(),
+            [](const KeyRange& a, const KeyRange& b) {
+              return a.start < b.start;
+            });
+  std::vector<KeyRange> result;
+  for (auto& range : ranges) {
+    if (!range.end.empty() && range.end <= range.start) {
+      continue;
+    }
+    if (!result.empty() &&
+        (result.back().end.empty() || range.start <= result.back().end)) {
+      if (!result.back().end.empty() &&
+          (range.end.empty() || range.end > result.back().end)) {
+        result.back().end = std::move(range.end);
+      }
+      continue;
+    }
+    result.push_back(std::move(range));
   }
+  return result;
+}
+
+// Reads the changed values and calls the callback of |context|.
+void FinishPageChange(std::unique_ptr<PageChangeContext> context) {
+  if (context->changed_entries.empty()) {
+    std::string next_token = std::move(context->next_token);
+    if (context->page_change->deleted_keys.size() == 0) {
+      context->callback(Status::OK, std::make_pair(nullptr, ""));
+    } else {
+      context->callback(Status::OK,
+                        std::make_pair(std::move(context->page_change),
+                                       std::move(next_token)));
+    }
+    return;
+  }
+
+  // We need to retrieve the values for each changed key/value pair in order
+  // to send it inside the PageChange object. |waiter| collates these
+  // asynchronous calls and |result_callback| processes them.
+  auto waiter = context->waiter;
+  auto result_callback = ftl::MakeCopyable([context = std::move(context)](
+      storage::Status storage_status,
+      std::vector<std::unique_ptr<const storage::Object>> results) mutable {
+    Status status = PageUtils::ConvertStatus(storage_status);
+    if (status == Status::OK) {
+      status = SetChangedValues(context->value_options.format,
+                                context->changed_entries, results,
+                                context->page_change.get());
+    }
+    if (status != Status::OK) {
+      FTL_LOG(ERROR)
+          << "Error while reading changed values when computing PageChange: "
+          << status;
+      context->callback(status, std::make_pair(nullptr, ""));
+      return;
+    }
+    context->callback(Status::OK,
+                      std::make_pair(std::move(context->page_change),
+                                     std::move(context->next_token)));
+  });
+  waiter->Finalize(std::move(result_callback));
+}
+
+// Adds the changes of the next range of |context| to its PageChange, then the
+// ones of the following ranges. Each range is diffed from its start, so that
+// the parts of the trees between the ranges are skipped.
+void DiffNextRange(std::unique_ptr<PageChangeContext> context) {
+  auto& ranges = context->ranges;
+  while (context->next_range < ranges.size() &&
+         !ranges[context->next_range].end.empty() &&
+         ranges[context->next_range].end <= context->min_key) {
+    ++context->next_range;
+  }
+  if (context->next_range == ranges.size()) {
+    FinishPageChange(std::move(context));
+    return;
+  }
+  const KeyRange& range = ranges[context->next_range++];
+  std::string start = std::max(range.start, context->min_key);
 
   // |on_next| is called for each change on the diff
-  auto on_next = [
-    storage, waiter, prefix_key = std::move(prefix_key),
-    context = context.get(), max_fidl_size
-  ](storage::EntryChange change) {
-    if (!PageUtils::MatchesPrefix(change.entry.key, prefix_key)) {
+  auto on_next = [ context = context.get(), end = range.end ](
+      storage::EntryChange change) {
+    if (!end.empty() && change.entry.key >= end) {
       return false;
     }
-    size_t entry_size =
-        change.deleted
-            ? fidl_serialization::GetByteArraySize(change.entry.key.size())
-            : fidl_serialization::GetEntrySize(change.entry.key.size());
-    if (context->fidl_size + entry_size > max_fidl_size) {
+    size_t entry_size;
+    if (change.deleted) {
+      entry_size =
+          fidl_serialization::GetByteArraySize(change.entry.key.size());
+    } else if (context->value_options.format == ValueFormat::PACKED) {
+      entry_size =
+          fidl_serialization::GetPackedEntrySize(change.entry.key.size());
+    } else {
+      entry_size = fidl_serialization::GetEntrySize(change.entry.key.size());
+    }
+    if (context->fidl_size + entry_size > context->max_fidl_size) {
       context->next_token = change.entry.key;
       return false;
     }
@@ -71,64 +305,99 @@ void ComputePageChange(
       return true;
     }
 
-    EntryPtr entry = Entry::New();
-    entry->key = convert::ToArray(change.entry.key);
-    entry->priority = change.entry.priority == storage::KeyPriority::EAGER
-                          ? Priority::EAGER
-                          : Priority::LAZY;
-    context->page_change->changes.push_back(std::move(entry));
-    PageUtils::GetPartialReferenceAsBuffer(
-        storage, change.entry.object_id, 0u,
-        std::numeric_limits<int64_t>::max(),
-        storage::PageStorage::Location::LOCAL, Status::OK,
-        waiter->NewCallback());
+    // Values not available locally, or not requested, are left out.
+    const ValueOptions& value_options = context->value_options;
+    if (value_options.keys_only) {
+      context->waiter->NewCallback()(storage::Status::OK, nullptr);
+    } else if (value_options.max_inline_size == 0u) {
+      GetLocalValue(context->storage, change.entry.object_id,
+                    context->waiter->NewCallback());
+    } else {
+      GetLocalValueUpTo(context->storage, change.entry.object_id,
+                        value_options.max_inline_size,
+                        context->waiter->NewCallback());
+    }
+    context->changed_entries.push_back(std::move(change.entry));
     return true;
   };
 
-  // |on_done| is called when the full diff is computed.
-  auto on_done = ftl::MakeCopyable([
-    waiter = std::move(waiter), context = std::move(context),
-    callback = std::move(callback)
-  ](storage::Status status) mutable {
+  // |on_done| is called when the diff of the range is computed.
+  PageChangeContext* context_ptr = context.get();
+  auto on_done = ftl::MakeCopyable([context = std::move(context)](
+      storage::Status status) mutable {
     if (status != storage::Status::OK) {
       FTL_LOG(ERROR) << "Unable to compute diff for PageChange: " << status;
-      callback(PageUtils::ConvertStatus(status), std::make_pair(nullptr, ""));
+      context->callback(PageUtils::ConvertStatus(status),
+                        std::make_pair(nullptr, ""));
       return;
     }
-    if (context->page_change->changes.size() == 0) {
-      if (context->page_change->deleted_keys.size() == 0) {
-        callback(Status::OK, std::make_pair(nullptr, ""));
-      } else {
-        callback(Status::OK,
-                 std::make_pair(std::move(context->page_change), ""));
-      }
+    if (!context->next_token.empty()) {
+      FinishPageChange(std::move(context));
       return;
     }
-
-    // We need to retrieve the values for each changed key/value pair in order
-    // to send it inside the PageChange object. |waiter| collates these
-    // asynchronous calls and |result_callback| processes them.
-    auto result_callback = ftl::MakeCopyable([
-      context = std::move(context), callback = std::move(callback)
-    ](Status status, std::vector<mx::vmo> results) mutable {
-      if (status != Status::OK) {
-        FTL_LOG(ERROR)
-            << "Error while reading changed values when computing PageChange: "
-            << status;
-        callback(status, std::make_pair(nullptr, ""));
-        return;
-      }
-      FTL_DCHECK(results.size() == context->page_change->changes.size());
-      for (size_t i = 0; i < results.size(); i++) {
-        context->page_change->changes[i]->value = std::move(results[i]);
-      }
-      callback(Status::OK, std::make_pair(std::move(context->page_change),
-                                          std::move(context->next_token)));
-    });
-    waiter->Finalize(std::move(result_callback));
+    DiffNextRange(std::move(context));
   });
-  storage->GetCommitContentsDiff(base, other, std::move(min_key),
-                                 std::move(on_next), std::move(on_done));
+  context_ptr->storage->GetCommitContentsDiff(
+      *context_ptr->base, *context_ptr->other, std::move(start),
+      std::move(on_next), std::move(on_done));
+}
+
+}  // namespace
+
+KeyRange GetPrefixRange(std::string prefix) {
+  KeyRange range;
+  range.end = PageUtils::GetPrefixEnd(prefix);
+  range.start = std::move(prefix);
+  return range;
+}
+
+void ComputePageChange(
+    storage::PageStorage* storage,
+    const storage::Commit& base,
+    const storage::Commit& other,
+    std::string prefix_key,
+    std::string min_key,
+    size_t max_fidl_size,
+    const ValueOptions& value_options,
+    std::function<void(Status, std::pair<PageChangePtr, std::string>)>
+        callback) {
+  std::vector<KeyRange> ranges;
+  ranges.push_back(GetPrefixRange(std::move(prefix_key)));
+  ComputePageChangeInRanges(storage, base, other, std::move(ranges),
+                            std::move(min_key), max_fidl_size, value_options,
+                            std::move(callback));
+}
+
+void ComputePageChangeInRanges(
+    storage::PageStorage* storage,
+    const storage::Commit& base,
+    const storage::Commit& other,
+    std::vector<KeyRange> ranges,
+    std::string min_key,
+    size_t max_fidl_size,
+    const ValueOptions& value_options,
+    std::function<void(Status, std::pair<PageChangePtr, std::string>)>
+        callback) {
+  auto context = std::make_unique<PageChangeContext>();
+  context->storage = storage;
+  context->base = base.Clone();
+  context->other = other.Clone();
+  context->ranges = NormalizeRanges(std::move(ranges));
+  context->min_key = std::move(min_key);
+  context->max_fidl_size = max_fidl_size;
+  context->value_options = value_options;
+  context->callback = std::move(callback);
+  context->waiter = callback::
+      Waiter<storage::Status, std::unique_ptr<const storage::Object>>::Create(
+          storage::Status::OK);
+  context->page_change->timestamp = other.GetTimestamp();
+  context->page_change->changes = fidl::Array<EntryPtr>::New(0);
+  context->page_change->deleted_keys =
+      fidl::Array<fidl::Array<uint8_t>>::New(0);
+  if (value_options.format == ValueFormat::PACKED) {
+    context->fidl_size += fidl_serialization::kPackedEntriesHeaderSize;
+  }
+  DiffNextRange(std::move(context));
 }
 
 }  // namespace diff_utils
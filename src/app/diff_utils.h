@@ -5,7 +5,12 @@
 #ifndef APPS_LEDGER_SRC_APP_DIFF_UTILS_H_
 #define APPS_LEDGER_SRC_APP_DIFF_UTILS_H_
 
+#include <stdint.h>
+
 #include <functional>
+#include <string>
+#include <tuple>
+#include <vector>
 
 #include "apps/ledger/services/public/ledger.fidl.h"
 #include "apps/ledger/src/storage/public/page_storage.h"
@@ -13,6 +18,45 @@
 
 namespace ledger {
 namespace diff_utils {
+
+// How the values of the new and modified entries of a PageChange are returned.
+enum class ValueFormat {
+  // In |PageChange.changes|, with a VMO per value.
+  ENTRIES,
+  // In |PageChange.packed_changes|, with all values in a single VMO.
+  PACKED,
+};
+
+// Which values of the new and modified entries of a PageChange are returned,
+// and how.
+struct ValueOptions {
+  ValueFormat format = ValueFormat::ENTRIES;
+  // If true, no value is read and only the keys of the entries are returned.
+  bool keys_only = false;
+  // If not 0, the values larger than |max_inline_size| bytes are left out, as
+  // the values not available locally. Only the first |max_inline_size| + 1
+  // bytes of a value are read to check its size.
+  uint64_t max_inline_size = 0u;
+};
+
+// A range of keys, from |start| included to |end| excluded. An empty |end|
+// leaves the range unbounded.
+struct KeyRange {
+  std::string start;
+  std::string end;
+};
+
+inline bool operator==(const KeyRange& lhs, const KeyRange& rhs) {
+  return std::tie(lhs.start, lhs.end) == std::tie(rhs.start, rhs.end);
+}
+
+inline bool operator<(const KeyRange& lhs, const KeyRange& rhs) {
+  return std::tie(lhs.start, lhs.end) < std::tie(rhs.start, rhs.end);
+}
+
+// Returns the range of the keys starting with |prefix|.
+KeyRange GetPrefixRange(std::string prefix);
+
 // Asynchronously creates a PageChange representing the diff of the two provided
 // commits, starting from the given |min_key| and providing as many results as
 // possible, given the |max_fidl_size| constraint. The result, or an error, will
@@ -20,7 +64,8 @@ namespace diff_utils {
 // pair of the PageChangePtr, containing the diff result, and the string
 // representation of the next token, if the result is paginated, or empty, if
 // there are no more results to return. Note that the PageChangePtr in the
-// callback will be NULL if the diff is empty.
+// callback will be NULL if the diff is empty. |value_options| defines which
+// values of the new and modified entries are returned, and how.
 void ComputePageChange(
     storage::PageStorage* storage,
     const storage::Commit& base,
@@ -28,6 +73,21 @@ void ComputePageChange(
     std::string prefix_key,
     std::string min_key,
     size_t max_fidl_size,
+    const ValueOptions& value_options,
+    std::function<void(Status, std::pair<PageChangePtr, std::string>)>
+        callback);
+
+// Same as |ComputePageChange|, but the PageChange only contains the keys in
+// the union of |ranges|. The parts of the commits between the ranges are not
+// diffed.
+void ComputePageChangeInRanges(
+    storage::PageStorage* storage,
+    const storage::Commit& base,
+    const storage::Commit& other,
+    std::vector<KeyRange> ranges,
+    std::string min_key,
+    size_t max_fidl_size,
+    const ValueOptions& value_options,
     std::function<void(Status, std::pair<PageChangePtr, std::string>)>
         callback);
 
@@ -0,0 +1,105 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/app/fidl/packed_entries.h"
+
+#include <utility>
+
+#include "lib/ftl/logging.h"
+#include "lib/mtl/vmo/strings.h"
+
+namespace ledger {
+
+PackedEntriesBuilder::PackedEntriesBuilder()
+    : entries_(fidl::Array<PackedEntryPtr>::New(0)) {}
+
+PackedEntriesBuilder::~PackedEntriesBuilder() {}
+
+void PackedEntriesBuilder::Add(convert::ExtendedStringView key,
+                               Priority priority,
+                               convert::ExtendedStringView value) {
+  PackedEntryPtr entry = PackedEntry::New();
+  entry->key = convert::ToArray(key);
+  entry->has_value = true;
+  entry->value_offset = values_.size();
+  entry->value_size = value.size();
+  entry->priority = priority;
+  entries_.push_back(std::move(entry));
+  values_.append(value.data(), value.size());
+}
+
+void PackedEntriesBuilder::AddWithoutValue(convert::ExtendedStringView key,
+                                           Priority priority) {
+  PackedEntryPtr entry = PackedEntry::New();
+  entry->key = convert::ToArray(key);
+  entry->has_value = false;
+  entry->value_offset = 0u;
+  entry->value_size = 0u;
+  entry->priority = priority;
+  entries_.push_back(std::move(entry));
+}
+
+PackedEntriesPtr PackedEntriesBuilder::Build() {
+  PackedEntriesPtr packed_entries = PackedEntries::New();
+  packed_entries->entries = std::move(entries_);
+  bool has_values = false;
+  for (const auto& entry : packed_entries->entries) {
+    has_values |= entry->has_value;
+  }
+  if (has_values && !mtl::VmoFromString(values_, &packed_entries->values)) {
+    return nullptr;
+  }
+  return packed_entries;
+}
+
+PackedEntriesPtr SlicePackedEntries(const PackedEntries& packed_entries,
+                                    size_t begin,
+                                    size_t end) {
+  FTL_DCHECK(begin <= end && end <= packed_entries.entries.size());
+  PackedEntriesPtr slice = PackedEntries::New();
+  slice->entries = fidl::Array<PackedEntryPtr>::New(0);
+  for (size_t i = begin; i < end; ++i) {
+    slice->entries.push_back(packed_entries.entries[i].Clone());
+  }
+  if (packed_entries.values &&
+      packed_entries.values.duplicate(
+          MX_RIGHT_DUPLICATE | MX_RIGHT_TRANSFER | MX_RIGHT_READ,
+          &slice->values) != NO_ERROR) {
+    return nullptr;
+  }
+  return slice;
+}
+
+bool UnpackEntries(const PackedEntries& packed_entries,
+                   fidl::Array<EntryPtr>* entries) {
+  std::string values;
+  if (packed_entries.values &&
+      !mtl::StringFromVmo(packed_entries.values, &values)) {
+    return false;
+  }
+  fidl::Array<EntryPtr> result = fidl::Array<EntryPtr>::New(0);
+  for (const auto& packed_entry : packed_entries.entries) {
+    EntryPtr entry = Entry::New();
+    entry->key = packed_entry->key.Clone();
+    entry->priority = packed_entry->priority;
+    if (packed_entry->has_value) {
+      if (packed_entry->value_offset > values.size() ||
+          packed_entry->value_size >
+              values.size() - packed_entry->value_offset) {
+        return false;
+      }
+      if (!mtl::VmoFromString(
+              ftl::StringView(values).substr(packed_entry->value_offset,
+                                             packed_entry->value_size),
+              &entry->value)) {
+        return false;
+      }
+    }
+    result.push_back(std::move(entry));
+  }
+  *entries = std::move(result);
+  return true;
+}
+
+}  // namespace ledger
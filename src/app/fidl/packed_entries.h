@@ -0,0 +1,60 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_APP_FIDL_PACKED_ENTRIES_H_
+#define APPS_LEDGER_SRC_APP_FIDL_PACKED_ENTRIES_H_
+
+#include <string>
+
+#include "apps/ledger/services/public/ledger.fidl.h"
+#include "apps/ledger/src/convert/convert.h"
+#include "lib/ftl/macros.h"
+
+namespace ledger {
+
+// Builds a |PackedEntries| by appending the values of the added entries to a
+// single buffer.
+class PackedEntriesBuilder {
+ public:
+  PackedEntriesBuilder();
+  ~PackedEntriesBuilder();
+
+  // Adds an entry with the value |value|.
+  void Add(convert::ExtendedStringView key,
+           Priority priority,
+           convert::ExtendedStringView value);
+
+  // Adds an entry whose value is not present.
+  void AddWithoutValue(convert::ExtendedStringView key, Priority priority);
+
+  // Returns the number of entries added.
+  size_t size() const { return entries_.size(); }
+
+  // Returns the built |PackedEntries|, or nullptr if the buffer of the values
+  // cannot be created. The builder must not be used afterwards.
+  PackedEntriesPtr Build();
+
+ private:
+  fidl::Array<PackedEntryPtr> entries_;
+  std::string values_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(PackedEntriesBuilder);
+};
+
+// Returns a |PackedEntries| with the entries of |packed_entries| in
+// [|begin|, |end|), sharing its buffer of values. Returns nullptr if the buffer
+// cannot be shared.
+PackedEntriesPtr SlicePackedEntries(const PackedEntries& packed_entries,
+                                    size_t begin,
+                                    size_t end);
+
+// Converts |packed_entries| to a list of |Entry|, with a VMO per value, for
+// clients using the same code for packed and unpacked results. Returns false
+// if the buffer of the values cannot be read.
+bool UnpackEntries(const PackedEntries& packed_entries,
+                   fidl::Array<EntryPtr>* entries);
+
+}  // namespace ledger
+
+#endif  // APPS_LEDGER_SRC_APP_FIDL_PACKED_ENTRIES_H_
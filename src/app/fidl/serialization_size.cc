@@ -17,5 +17,16 @@ size_t GetEntrySize(size_t key_length) {
   return kPointerSize + key_size + object_size + kPrioritySize;
 }
 
+size_t GetPackedEntrySize(size_t key_length) {
+  size_t key_size = key_length + kArrayHeaderSize;
+  // |value_offset| and |value_size|.
+  size_t value_location_size = 2 * sizeof(uint64_t);
+  // |has_value| shares an 8-byte slot with |priority|: it is padded to 4
+  // bytes so that |priority| stays aligned.
+  size_t has_value_size = sizeof(int32_t);
+  return kPointerSize + key_size + value_location_size + has_value_size +
+         kPrioritySize;
+}
+
 }  // namespace fidl_serialization
 }  //  namespace ledger
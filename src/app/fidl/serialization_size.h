@@ -20,10 +20,12 @@ const size_t kPointerSize = sizeof(uint64_t);
 const size_t kPrioritySize = sizeof(int32_t);
 const size_t kHandleSize = sizeof(int32_t);
 
-// The overhead for storing the pointer, the timestamp (int64) and the two
-// arrays
+// The overhead for storing the pointers to the struct and to
+// |packed_changes|, the timestamp (int64) and the two arrays.
 constexpr size_t kPageChangeHeaderSize =
-    kPointerSize + sizeof(int64_t) + 2 * kArrayHeaderSize;
+    2 * kPointerSize + sizeof(int64_t) + 2 * kArrayHeaderSize;
+constexpr size_t kPackedEntriesHeaderSize =
+    kPointerSize + kArrayHeaderSize + kHandleSize;
 
 // Returns the fidl size of a byte array with the given length.
 size_t GetByteArraySize(size_t array_length);
@@ -31,6 +33,10 @@ size_t GetByteArraySize(size_t array_length);
 // Returns the fidl size of an Entry holding a key with the given length.
 size_t GetEntrySize(size_t key_length);
 
+// Returns the fidl size of a PackedEntry holding a key with the given length.
+// The size of its value is accounted for in the |values| buffer.
+size_t GetPackedEntrySize(size_t key_length);
+
 }  // namespace fidl_serialization
 }  //  namespace ledger
 
@@ -0,0 +1,144 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/app/group_committer.h"
+
+#include <utility>
+
+#include "apps/ledger/src/app/page_utils.h"
+#include "lib/ftl/logging.h"
+
+namespace ledger {
+namespace {
+
+// The maximal number of group commits remembered to rebase the changes made
+// on their base commits.
+constexpr size_t kMaxRebasedCommitIds = 64;
+
+}  // namespace
+
+GroupCommitter::GroupCommitter(storage::PageStorage* storage)
+    : storage_(storage), weak_factory_(this) {}
+
+GroupCommitter::~GroupCommitter() {}
+
+void GroupCommitter::AddChange(storage::CommitId base_commit_id,
+                               std::function<Status(storage::Journal*)> change,
+                               CommitCallback callback) {
+  pending_changes_.push_back(PendingChange{
+      std::move(base_commit_id), std::move(change), std::move(callback)});
+  if (!journal_) {
+    CommitPendingChanges();
+  }
+}
+
+void GroupCommitter::CommitPendingChanges() {
+  FTL_DCHECK(!journal_);
+  if (pending_changes_.empty()) {
+    return;
+  }
+  // Changes based on the base of a previous group commit were added before it
+  // was created: base them on it instead.
+  for (auto& change : pending_changes_) {
+    change.base_commit_id = GetRebasedCommitId(change.base_commit_id);
+  }
+  storage::CommitId base_commit_id = pending_changes_.front().base_commit_id;
+  std::vector<PendingChange> changes;
+  std::vector<PendingChange> other_changes;
+  for (auto& change : pending_changes_) {
+    if (change.base_commit_id == base_commit_id) {
+      changes.push_back(std::move(change));
+    } else {
+      other_changes.push_back(std::move(change));
+    }
+  }
+  pending_changes_.swap(other_changes);
+
+  std::unique_ptr<storage::Journal> journal;
+  storage::Status status = storage_->StartCommit(
+      base_commit_id, storage::JournalType::IMPLICIT, &journal);
+  auto weak_this = weak_factory_.GetWeakPtr();
+  if (status != storage::Status::OK) {
+    for (auto& change : changes) {
+      change.callback(PageUtils::ConvertStatus(status), nullptr);
+    }
+    if (weak_this) {
+      weak_this->CommitPendingChanges();
+    }
+    return;
+  }
+
+  std::vector<CommitCallback> callbacks;
+  for (auto& change : changes) {
+    Status change_status = change.change(journal.get());
+    if (change_status != Status::OK) {
+      change.callback(change_status, nullptr);
+      continue;
+    }
+    callbacks.push_back(std::move(change.callback));
+  }
+  if (callbacks.empty()) {
+    journal->Rollback();
+    if (weak_this) {
+      weak_this->CommitPendingChanges();
+    }
+    return;
+  }
+
+  journal_ = std::move(journal);
+  journal_->Commit([
+    this, base_commit_id = std::move(base_commit_id),
+    callbacks = std::move(callbacks)
+  ](storage::Status status,
+    std::unique_ptr<const storage::Commit> commit) mutable {
+    // A commit that changes nothing is its base commit itself: there is
+    // nothing to rebase on.
+    if (status == storage::Status::OK && commit->GetId() != base_commit_id) {
+      AddRebasedCommitId(std::move(base_commit_id), commit->GetId());
+    }
+    // Deleting the journal might delete this callback, and the callbacks of the
+    // changes might delete this object: only use local variables below.
+    std::vector<CommitCallback> committed_callbacks = std::move(callbacks);
+    auto weak_this = weak_factory_.GetWeakPtr();
+    journal_.reset();
+    for (auto& callback : committed_callbacks) {
+      callback(PageUtils::ConvertStatus(status),
+               commit ? commit->Clone() : nullptr);
+    }
+    if (weak_this) {
+      weak_this->CommitPendingChanges();
+    }
+  });
+}
+
+storage::CommitId GroupCommitter::GetRebasedCommitId(
+    storage::CommitId commit_id) const {
+  // Commit ids depend on their parents, so following group commits cannot
+  // come back to an earlier one, except for a commit recorded as its own
+  // rebase: stop there.
+  auto it = rebased_commit_ids_.find(commit_id);
+  while (it != rebased_commit_ids_.end() && it->second != commit_id) {
+    commit_id = it->second;
+    it = rebased_commit_ids_.find(commit_id);
+  }
+  return commit_id;
+}
+
+void GroupCommitter::AddRebasedCommitId(storage::CommitId base_commit_id,
+                                        storage::CommitId commit_id) {
+  FTL_DCHECK(base_commit_id != commit_id);
+  auto it = rebased_commit_ids_.find(base_commit_id);
+  if (it != rebased_commit_ids_.end()) {
+    it->second = std::move(commit_id);
+    return;
+  }
+  if (rebased_commit_ids_order_.size() == kMaxRebasedCommitIds) {
+    rebased_commit_ids_.erase(rebased_commit_ids_order_.front());
+    rebased_commit_ids_order_.pop_front();
+  }
+  rebased_commit_ids_order_.push_back(base_commit_id);
+  rebased_commit_ids_.emplace(std::move(base_commit_id), std::move(commit_id));
+}
+
+}  // namespace ledger
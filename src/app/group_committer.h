@@ -0,0 +1,88 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_APP_GROUP_COMMITTER_H_
+#define APPS_LEDGER_SRC_APP_GROUP_COMMITTER_H_
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "apps/ledger/services/public/ledger.fidl.h"
+#include "apps/ledger/src/storage/public/commit.h"
+#include "apps/ledger/src/storage/public/journal.h"
+#include "apps/ledger/src/storage/public/page_storage.h"
+#include "apps/ledger/src/storage/public/types.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
+
+namespace ledger {
+
+// Groups the changes made outside of transactions on all the connections to a
+// page into shared implicit commits.
+//
+// A change added while no commit is in progress is committed right away. The
+// changes added while a commit is in progress are applied together in the next
+// commit, based on the commit in progress, so that concurrent writers produce
+// a linear history instead of divergent commits to be merged.
+//
+// A change is rebased on the group commits created, directly or indirectly,
+// from its base commit. Changes that still have different base commits after
+// that are committed in separate groups, in the order they were added.
+class GroupCommitter {
+ public:
+  using CommitCallback =
+      std::function<void(Status, std::unique_ptr<const storage::Commit>)>;
+
+  explicit GroupCommitter(storage::PageStorage* storage);
+  ~GroupCommitter();
+
+  // Applies |change| to the journal of the next group commit and calls
+  // |callback| with the result. If |change| fails, |callback| is called with
+  // its status and no commit. Otherwise, it is called once the group commit is
+  // created, with the commit.
+  void AddChange(storage::CommitId base_commit_id,
+                 std::function<Status(storage::Journal*)> change,
+                 CommitCallback callback);
+
+ private:
+  struct PendingChange {
+    storage::CommitId base_commit_id;
+    std::function<Status(storage::Journal*)> change;
+    CommitCallback callback;
+  };
+
+  // Starts a commit with the first pending change and all the following ones
+  // with the same base commit, if any.
+  void CommitPendingChanges();
+
+  // Returns the last group commit created from |commit_id|, following the
+  // group commits based on it, or |commit_id| if there is none.
+  storage::CommitId GetRebasedCommitId(storage::CommitId commit_id) const;
+
+  // Records that the group commit |commit_id| was created from
+  // |base_commit_id|.
+  void AddRebasedCommitId(storage::CommitId base_commit_id,
+                          storage::CommitId commit_id);
+
+  storage::PageStorage* const storage_;
+  std::vector<PendingChange> pending_changes_;
+  // The journal of the commit in progress, if any.
+  std::unique_ptr<storage::Journal> journal_;
+  // The ids of the last group commits, keyed by their base commit id.
+  std::map<storage::CommitId, storage::CommitId> rebased_commit_ids_;
+  // The keys of |rebased_commit_ids_|, from the oldest to the newest.
+  std::deque<storage::CommitId> rebased_commit_ids_order_;
+
+  // Must be the last member field.
+  ftl::WeakPtrFactory<GroupCommitter> weak_factory_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(GroupCommitter);
+};
+
+}  // namespace ledger
+
+#endif  // APPS_LEDGER_SRC_APP_GROUP_COMMITTER_H_
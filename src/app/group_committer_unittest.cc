@@ -0,0 +1,207 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/app/group_committer.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "apps/ledger/src/app/constants.h"
+#include "apps/ledger/src/app/page_utils.h"
+#include "apps/ledger/src/callback/capture.h"
+#include "apps/ledger/src/coroutine/coroutine_impl.h"
+#include "apps/ledger/src/storage/fake/fake_journal_delegate.h"
+#include "apps/ledger/src/storage/fake/fake_page_storage.h"
+#include "apps/ledger/src/storage/impl/page_storage_impl.h"
+#include "apps/ledger/src/storage/public/constants.h"
+#include "apps/ledger/src/test/test_with_message_loop.h"
+#include "gtest/gtest.h"
+#include "lib/ftl/files/scoped_temp_dir.h"
+#include "lib/ftl/macros.h"
+
+namespace ledger {
+namespace {
+
+class GroupCommitterTest : public ::testing::Test {
+ public:
+  GroupCommitterTest() : storage_("page_id"), committer_(&storage_) {
+    storage_.set_autocommit(false);
+  }
+  ~GroupCommitterTest() override {}
+
+ protected:
+  // Adds a change putting |key|, based on |base_commit_id|, and stores the id
+  // of its commit in |commit_ids| once created.
+  void AddPut(storage::CommitId base_commit_id, std::string key) {
+    committer_.AddChange(
+        std::move(base_commit_id),
+        [key](storage::Journal* journal) {
+          return PageUtils::ConvertStatus(
+              journal->Put(key, "value", storage::KeyPriority::EAGER));
+        },
+        [this](Status status, std::unique_ptr<const storage::Commit> commit) {
+          EXPECT_EQ(Status::OK, status);
+          commit_ids.push_back(commit->GetId());
+        });
+  }
+
+  // Returns the journal waiting to be committed, if any.
+  storage::fake::FakeJournalDelegate* GetPendingJournal() {
+    storage::fake::FakeJournalDelegate* result = nullptr;
+    for (const auto& journal : storage_.GetJournals()) {
+      if (!journal.second->IsCommitted() && !journal.second->IsRolledBack()) {
+        EXPECT_FALSE(result);
+        result = journal.second.get();
+      }
+    }
+    return result;
+  }
+
+  storage::fake::FakePageStorage storage_;
+  GroupCommitter committer_;
+  std::vector<storage::CommitId> commit_ids;
+
+ private:
+  FTL_DISALLOW_COPY_AND_ASSIGN(GroupCommitterTest);
+};
+
+TEST_F(GroupCommitterTest, GroupChangesOnTheCommitInProgress) {
+  AddPut("base", "key1");
+  AddPut("base", "key2");
+  AddPut("base", "key3");
+
+  storage::fake::FakeJournalDelegate* journal = GetPendingJournal();
+  ASSERT_TRUE(journal);
+  EXPECT_EQ("base", journal->GetParentId());
+  EXPECT_EQ(1u, journal->GetData().size());
+  storage::CommitId first_commit_id = journal->GetId();
+  journal->ResolvePendingCommit(storage::Status::OK);
+  EXPECT_EQ(std::vector<storage::CommitId>({first_commit_id}), commit_ids);
+
+  // The two other changes are rebased on the first commit.
+  journal = GetPendingJournal();
+  ASSERT_TRUE(journal);
+  EXPECT_EQ(first_commit_id, journal->GetParentId());
+  EXPECT_EQ(2u, journal->GetData().size());
+  storage::CommitId second_commit_id = journal->GetId();
+  journal->ResolvePendingCommit(storage::Status::OK);
+  EXPECT_EQ(std::vector<storage::CommitId>(
+                {first_commit_id, second_commit_id, second_commit_id}),
+            commit_ids);
+  EXPECT_FALSE(GetPendingJournal());
+
+  // A change based on the first base commit is rebased on the last group
+  // commit made from it.
+  AddPut("base", "key4");
+  journal = GetPendingJournal();
+  ASSERT_TRUE(journal);
+  EXPECT_EQ(second_commit_id, journal->GetParentId());
+  journal->ResolvePendingCommit(storage::Status::OK);
+  EXPECT_EQ(4u, commit_ids.size());
+}
+
+TEST_F(GroupCommitterTest, MixedBaseCommits) {
+  AddPut("base1", "key1");
+  AddPut("base2", "key2");
+  AddPut("base1", "key3");
+  AddPut("base2", "key4");
+
+  storage::fake::FakeJournalDelegate* journal = GetPendingJournal();
+  ASSERT_TRUE(journal);
+  EXPECT_EQ("base1", journal->GetParentId());
+  storage::CommitId first_commit_id = journal->GetId();
+  journal->ResolvePendingCommit(storage::Status::OK);
+
+  // The changes based on "base2" are committed together, before the one
+  // rebased on the first commit, as they were added first.
+  journal = GetPendingJournal();
+  ASSERT_TRUE(journal);
+  EXPECT_EQ("base2", journal->GetParentId());
+  EXPECT_EQ(2u, journal->GetData().size());
+  EXPECT_EQ(1u, journal->GetData().count("key2"));
+  EXPECT_EQ(1u, journal->GetData().count("key4"));
+  journal->ResolvePendingCommit(storage::Status::OK);
+
+  journal = GetPendingJournal();
+  ASSERT_TRUE(journal);
+  EXPECT_EQ(first_commit_id, journal->GetParentId());
+  EXPECT_EQ(1u, journal->GetData().size());
+  EXPECT_EQ(1u, journal->GetData().count("key3"));
+  journal->ResolvePendingCommit(storage::Status::OK);
+
+  EXPECT_EQ(4u, commit_ids.size());
+  EXPECT_FALSE(GetPendingJournal());
+}
+
+// Tests the group committer on top of the real storage, which does not create
+// a new commit for a change that leaves the contents unchanged.
+class GroupCommitterStorageTest : public test::TestWithMessageLoop {
+ public:
+  GroupCommitterStorageTest() {}
+  ~GroupCommitterStorageTest() override {}
+
+ protected:
+  void SetUp() override {
+    ::testing::Test::SetUp();
+    storage_ = std::make_unique<storage::PageStorageImpl>(
+        message_loop_.task_runner(), message_loop_.task_runner(),
+        &coroutine_service_, tmp_dir_.path(), kRootPageId.ToString());
+    storage::Status status;
+    storage_->Init(
+        callback::Capture([this] { message_loop_.PostQuitTask(); }, &status));
+    EXPECT_FALSE(RunLoopWithTimeout());
+    EXPECT_EQ(storage::Status::OK, status);
+    committer_ = std::make_unique<GroupCommitter>(storage_.get());
+  }
+
+  // Puts |value| under "key" on top of |base_commit_id| and returns the id of
+  // the resulting commit.
+  storage::CommitId Put(const storage::CommitId& base_commit_id,
+                        std::string value) {
+    value.resize(storage::kObjectIdSize, '_');
+    Status status;
+    std::unique_ptr<const storage::Commit> commit;
+    committer_->AddChange(
+        base_commit_id,
+        [value](storage::Journal* journal) {
+          return PageUtils::ConvertStatus(
+              journal->Put("key", value, storage::KeyPriority::EAGER));
+        },
+        callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                          &commit));
+    EXPECT_FALSE(RunLoopWithTimeout());
+    EXPECT_EQ(Status::OK, status);
+    return commit ? commit->GetId() : "";
+  }
+
+  coroutine::CoroutineServiceImpl coroutine_service_;
+  files::ScopedTempDir tmp_dir_;
+  std::unique_ptr<storage::PageStorageImpl> storage_;
+  std::unique_ptr<GroupCommitter> committer_;
+
+ private:
+  FTL_DISALLOW_COPY_AND_ASSIGN(GroupCommitterStorageTest);
+};
+
+TEST_F(GroupCommitterStorageTest, NoOpCommit) {
+  std::vector<storage::CommitId> heads;
+  ASSERT_EQ(storage::Status::OK, storage_->GetHeadCommitIds(&heads));
+  ASSERT_EQ(1u, heads.size());
+
+  storage::CommitId first_commit_id = Put(heads[0], "value1");
+  EXPECT_NE(heads[0], first_commit_id);
+
+  // Putting the same value again leaves the page unchanged: the resulting
+  // commit is the base commit.
+  EXPECT_EQ(first_commit_id, Put(first_commit_id, "value1"));
+
+  // The following changes on that commit are still committed.
+  storage::CommitId second_commit_id = Put(first_commit_id, "value2");
+  EXPECT_NE(first_commit_id, second_commit_id);
+  EXPECT_FALSE(second_commit_id.empty());
+}
+
+}  // namespace
+}  // namespace ledger
@@ -0,0 +1,87 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/app/idle_page_pool.h"
+
+#include <utility>
+
+#include "lib/ftl/logging.h"
+
+namespace ledger {
+
+constexpr size_t IdlePagePool::kDefaultMaxPages;
+constexpr ftl::TimeDelta IdlePagePool::kDefaultIdleTimeout;
+
+IdlePagePool::IdlePagePool(ftl::RefPtr<ftl::TaskRunner> task_runner,
+                           size_t max_pages,
+                           ftl::TimeDelta idle_timeout)
+    : task_runner_(std::move(task_runner)),
+      max_pages_(max_pages),
+      idle_timeout_(idle_timeout),
+      weak_factory_(this) {}
+
+IdlePagePool::~IdlePagePool() {}
+
+void IdlePagePool::Add(storage::PageId page_id,
+                       std::unique_ptr<PageManager> page_manager) {
+  FTL_DCHECK(page_manager);
+  FTL_DCHECK(pages_by_id_.find(page_id) == pages_by_id_.end());
+  if (max_pages_ == 0u) {
+    return;
+  }
+  if (pages_.size() == max_pages_) {
+    FTL_VLOG(1) << "Idle page pool full, closing the least recent page.";
+    ++stats_.capacity_evictions;
+    pages_by_id_.erase(pages_.front().page_id);
+    pages_.pop_front();
+  }
+
+  uint64_t id = next_id_++;
+  task_runner_->PostDelayedTask(
+      [ weak_this = weak_factory_.GetWeakPtr(), page_id, id ] {
+        if (weak_this) {
+          weak_this->Expire(page_id, id);
+        }
+      },
+      idle_timeout_);
+  auto it = pages_.insert(pages_.end(),
+                          IdlePage{page_id, std::move(page_manager), id});
+  pages_by_id_.emplace(std::move(page_id), it);
+}
+
+std::unique_ptr<PageManager> IdlePagePool::Take(
+    convert::ExtendedStringView page_id) {
+  auto it = pages_by_id_.find(page_id);
+  if (it == pages_by_id_.end()) {
+    ++stats_.misses;
+    return nullptr;
+  }
+  ++stats_.hits;
+  std::unique_ptr<PageManager> page_manager =
+      std::move(it->second->page_manager);
+  pages_.erase(it->second);
+  pages_by_id_.erase(it);
+  return page_manager;
+}
+
+void IdlePagePool::Remove(convert::ExtendedStringView page_id) {
+  auto it = pages_by_id_.find(page_id);
+  if (it == pages_by_id_.end()) {
+    return;
+  }
+  pages_.erase(it->second);
+  pages_by_id_.erase(it);
+}
+
+void IdlePagePool::Expire(const storage::PageId& page_id, uint64_t id) {
+  auto it = pages_by_id_.find(page_id);
+  if (it == pages_by_id_.end() || it->second->id != id) {
+    return;
+  }
+  ++stats_.timeout_evictions;
+  pages_.erase(it->second);
+  pages_by_id_.erase(it);
+}
+
+}  // namespace ledger
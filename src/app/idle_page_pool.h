@@ -0,0 +1,107 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_APP_IDLE_PAGE_POOL_H_
+#define APPS_LEDGER_SRC_APP_IDLE_PAGE_POOL_H_
+
+#include <list>
+#include <map>
+#include <memory>
+
+#include "apps/ledger/src/app/page_manager.h"
+#include "apps/ledger/src/convert/convert.h"
+#include "apps/ledger/src/storage/public/types.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
+#include "lib/ftl/tasks/task_runner.h"
+#include "lib/ftl/time/time_delta.h"
+
+namespace ledger {
+
+// Keeps the PageManagers of the pages without connections open for a while,
+// so that reopening a recently closed page does not initialize its storage
+// again.
+//
+// The pool holds at most |max_pages| pages, each keeping its storage, and thus
+// its database, open. When the pool is full, the least recently closed page is
+// evicted. A page is also evicted when it has been idle for |idle_timeout|.
+class IdlePagePool {
+ public:
+  // Default budget of the pool.
+  static constexpr size_t kDefaultMaxPages = 4;
+  static constexpr ftl::TimeDelta kDefaultIdleTimeout =
+      ftl::TimeDelta::FromSeconds(60);
+
+  // Counters of the pool usage.
+  struct Stats {
+    // Number of pages reopened from the pool.
+    uint64_t hits = 0u;
+    // Number of pages opened that were not in the pool.
+    uint64_t misses = 0u;
+    // Number of pages evicted to make room for more recently closed ones.
+    uint64_t capacity_evictions = 0u;
+    // Number of pages evicted after |idle_timeout|.
+    uint64_t timeout_evictions = 0u;
+  };
+
+  IdlePagePool(ftl::RefPtr<ftl::TaskRunner> task_runner,
+               size_t max_pages = kDefaultMaxPages,
+               ftl::TimeDelta idle_timeout = kDefaultIdleTimeout);
+  ~IdlePagePool();
+
+  // Adds the idle |page_manager| of the page |page_id| to the pool, evicting
+  // the least recently added page if the pool is full. If |max_pages| is 0,
+  // |page_manager| is deleted right away.
+  void Add(storage::PageId page_id, std::unique_ptr<PageManager> page_manager);
+
+  // Removes the PageManager of the page |page_id| from the pool and returns it,
+  // or returns null if the page is not in the pool.
+  std::unique_ptr<PageManager> Take(convert::ExtendedStringView page_id);
+
+  // Deletes the PageManager of the page |page_id|, if it is in the pool.
+  void Remove(convert::ExtendedStringView page_id);
+
+  // Returns whether the page |page_id| is in the pool. Unlike |Take|, does not
+  // count a hit or a miss.
+  bool Contains(convert::ExtendedStringView page_id) const {
+    return pages_by_id_.find(page_id) != pages_by_id_.end();
+  }
+
+  size_t size() const { return pages_.size(); }
+  size_t max_pages() const { return max_pages_; }
+  const Stats& stats() const { return stats_; }
+
+ private:
+  struct IdlePage {
+    storage::PageId page_id;
+    std::unique_ptr<PageManager> page_manager;
+    // Identifies this addition of the page to the pool, for its expiration.
+    uint64_t id;
+  };
+
+  // Evicts the page |page_id| if it is still the addition with the given |id|.
+  void Expire(const storage::PageId& page_id, uint64_t id);
+
+  const ftl::RefPtr<ftl::TaskRunner> task_runner_;
+  const size_t max_pages_;
+  const ftl::TimeDelta idle_timeout_;
+
+  // Idle pages, from the least to the most recently added.
+  std::list<IdlePage> pages_;
+  std::map<storage::PageId,
+           std::list<IdlePage>::iterator,
+           convert::StringViewComparator>
+      pages_by_id_;
+  uint64_t next_id_ = 0u;
+  Stats stats_;
+
+  // Must be the last member field.
+  ftl::WeakPtrFactory<IdlePagePool> weak_factory_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(IdlePagePool);
+};
+
+}  // namespace ledger
+
+#endif  // APPS_LEDGER_SRC_APP_IDLE_PAGE_POOL_H_
@@ -315,6 +315,64 @@ TEST_F(PageSnapshotIntegrationTest, PageSnapshotGetEntriesMultiPart) {
   }
 }
 
+TEST_F(PageSnapshotIntegrationTest, PageSnapshotCountAndGetKeysAtOffset) {
+  PagePtr page = GetTestPage();
+
+  const size_t N = 20;
+  fidl::Array<uint8_t> keys[N];
+  for (size_t i = 0; i < N; ++i) {
+    keys[i] = RandomArray(20, {static_cast<uint8_t>(i)});
+    page->Put(keys[i].Clone(), RandomArray(10),
+              [](Status status) { EXPECT_EQ(status, Status::OK); });
+    ASSERT_TRUE(page.WaitForIncomingResponse());
+  }
+  PageSnapshotPtr snapshot = PageGetSnapshot(&page);
+
+  // Count all entries, then the ones in [keys[5], keys[15]).
+  snapshot->Count(nullptr, nullptr, [](Status status, uint64_t count) {
+    EXPECT_EQ(Status::OK, status);
+    EXPECT_EQ(N, count);
+  });
+  ASSERT_TRUE(snapshot.WaitForIncomingResponse());
+  snapshot->Count(keys[5].Clone(), keys[15].Clone(),
+                  [](Status status, uint64_t count) {
+                    EXPECT_EQ(Status::OK, status);
+                    EXPECT_EQ(10u, count);
+                  });
+  ASSERT_TRUE(snapshot.WaitForIncomingResponse());
+
+  snapshot->GetSize(nullptr, nullptr, [](Status status, uint64_t entry_count,
+                                         uint64_t value_bytes) {
+    EXPECT_EQ(Status::OK, status);
+    EXPECT_EQ(N, entry_count);
+    EXPECT_EQ(N * 10u, value_bytes);
+  });
+  ASSERT_TRUE(snapshot.WaitForIncomingResponse());
+
+  // Get the keys starting at the 12th one.
+  snapshot->GetKeysAtOffset(
+      nullptr, 12u,
+      [&keys](Status status, fidl::Array<fidl::Array<uint8_t>> result,
+              uint64_t next_offset) {
+        EXPECT_EQ(Status::OK, status);
+        ASSERT_EQ(N - 12u, result.size());
+        for (size_t i = 0; i < result.size(); ++i) {
+          EXPECT_TRUE(keys[12 + i].Equals(result[i]));
+        }
+        EXPECT_EQ(N, next_offset);
+      });
+  ASSERT_TRUE(snapshot.WaitForIncomingResponse());
+
+  // Restricting the snapshot to a prefix restricts the count.
+  snapshot = PageGetSnapshot(
+      &page, fidl::Array<uint8_t>::From(std::vector<uint8_t>{3}));
+  snapshot->Count(nullptr, nullptr, [](Status status, uint64_t count) {
+    EXPECT_EQ(Status::OK, status);
+    EXPECT_EQ(1u, count);
+  });
+  ASSERT_TRUE(snapshot.WaitForIncomingResponse());
+}
+
 TEST_F(PageSnapshotIntegrationTest, PageSnapshotGettersReturnSortedEntries) {
   PagePtr page = GetTestPage();
 
@@ -459,6 +517,115 @@ TEST_F(PageSnapshotIntegrationTest, PageGetById) {
   EXPECT_EQ("Alice", ToString(value));
 }
 
+TEST_F(PageSnapshotIntegrationTest, PageSnapshotGetDiff) {
+  PagePtr page = GetTestPage();
+  for (const std::string& key : {"a", "b"}) {
+    page->Put(convert::ToArray(key), convert::ToArray("value"),
+              [](Status status) { EXPECT_EQ(status, Status::OK); });
+    EXPECT_TRUE(page.WaitForIncomingResponse());
+  }
+  PageSnapshotPtr base_snapshot = PageGetSnapshot(&page);
+  fidl::Array<uint8_t> base_version;
+  base_snapshot->GetVersion(
+      [&base_version](Status status, fidl::Array<uint8_t> version) {
+        EXPECT_EQ(Status::OK, status);
+        base_version = std::move(version);
+      });
+  EXPECT_TRUE(base_snapshot.WaitForIncomingResponse());
+
+  page->Delete(convert::ToArray("a"),
+               [](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  page->Put(convert::ToArray("b"), convert::ToArray("new value"),
+            [](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  page->Put(convert::ToArray("c"), convert::ToArray("value"),
+            [](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+
+  PageSnapshotPtr snapshot = PageGetSnapshot(&page);
+  PageChangePtr change;
+  snapshot->GetDiff(base_version.Clone(), nullptr, [&change](
+                        Status status, PageChangePtr page_change,
+                        fidl::Array<uint8_t> next_token) {
+    EXPECT_EQ(Status::OK, status);
+    EXPECT_FALSE(next_token);
+    change = std::move(page_change);
+  });
+  EXPECT_TRUE(snapshot.WaitForIncomingResponse());
+  ASSERT_TRUE(change);
+  ASSERT_EQ(2u, change->changes.size());
+  EXPECT_EQ("b", convert::ToString(change->changes[0]->key));
+  EXPECT_EQ("new value", ToString(change->changes[0]->value));
+  EXPECT_EQ("c", convert::ToString(change->changes[1]->key));
+  ASSERT_EQ(1u, change->deleted_keys.size());
+  EXPECT_EQ("a", convert::ToString(change->deleted_keys[0]));
+
+  // There is no change from a snapshot to itself.
+  base_snapshot->GetDiff(base_version.Clone(), nullptr, [&change](
+                             Status status, PageChangePtr page_change,
+                             fidl::Array<uint8_t> next_token) {
+    EXPECT_EQ(Status::OK, status);
+    change = std::move(page_change);
+  });
+  EXPECT_TRUE(base_snapshot.WaitForIncomingResponse());
+  EXPECT_FALSE(change);
+
+  snapshot->GetDiff(convert::ToArray("unknown version"), nullptr,
+                    [](Status status, PageChangePtr page_change,
+                       fidl::Array<uint8_t> next_token) {
+                      EXPECT_EQ(Status::INVALID_ARGUMENT, status);
+                    });
+  EXPECT_TRUE(snapshot.WaitForIncomingResponse());
+}
+
+TEST_F(PageSnapshotIntegrationTest, PageSnapshotGetDiffMultiPart) {
+  PagePtr page = GetTestPage();
+  PageSnapshotPtr base_snapshot = PageGetSnapshot(&page);
+  fidl::Array<uint8_t> base_version;
+  base_snapshot->GetVersion(
+      [&base_version](Status status, fidl::Array<uint8_t> version) {
+        EXPECT_EQ(Status::OK, status);
+        base_version = std::move(version);
+      });
+  EXPECT_TRUE(base_snapshot.WaitForIncomingResponse());
+
+  const size_t key_count = 100;
+  for (size_t i = 0; i < key_count; ++i) {
+    page->Put(RandomArray(50, {static_cast<uint8_t>(i)}),
+              convert::ToArray("value"),
+              [](Status status) { EXPECT_EQ(status, Status::OK); });
+    EXPECT_TRUE(page.WaitForIncomingResponse());
+  }
+
+  PageSnapshotPtr snapshot = PageGetSnapshot(&page);
+  std::vector<std::string> keys;
+  fidl::Array<uint8_t> token;
+  int num_queries = 0;
+  Status status;
+  do {
+    snapshot->GetDiff(base_version.Clone(), std::move(token), [
+      &status, &keys, &token
+    ](Status s, PageChangePtr page_change, fidl::Array<uint8_t> next_token) {
+      status = s;
+      ASSERT_TRUE(page_change);
+      for (const auto& entry : page_change->changes) {
+        keys.push_back(convert::ToString(entry->key));
+      }
+      token = std::move(next_token);
+    });
+    EXPECT_TRUE(snapshot.WaitForIncomingResponse());
+    ++num_queries;
+  } while (status == Status::PARTIAL_RESULT);
+
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_LT(1, num_queries);
+  ASSERT_EQ(key_count, keys.size());
+  for (size_t i = 0; i < key_count; ++i) {
+    EXPECT_EQ(static_cast<uint8_t>(i), static_cast<uint8_t>(keys[i][0]));
+  }
+}
+
 }  // namespace
 }  // namespace integration_tests
 }  // namespace ledger
@@ -81,6 +81,43 @@ TEST_F(PageWatcherIntegrationTest, PageWatcherSimple) {
   EXPECT_EQ("Alice", ToString(change->changes[0]->value));
 }
 
+TEST_F(PageWatcherIntegrationTest, PageWatcherSameChangeTwoWatchers) {
+  PagePtr page = GetTestPage();
+  int pending_changes = 2;
+  auto on_change = [&pending_changes] {
+    if (--pending_changes == 0) {
+      mtl::MessageLoop::GetCurrent()->PostQuitTask();
+    }
+  };
+  PageWatcherPtr watcher1_ptr;
+  Watcher watcher1(watcher1_ptr.NewRequest(), on_change);
+  PageWatcherPtr watcher2_ptr;
+  Watcher watcher2(watcher2_ptr.NewRequest(), on_change);
+
+  PageSnapshotPtr snapshot1;
+  page->GetSnapshot(snapshot1.NewRequest(), nullptr, std::move(watcher1_ptr),
+                    [](Status status) { EXPECT_EQ(Status::OK, status); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  PageSnapshotPtr snapshot2;
+  page->GetSnapshot(snapshot2.NewRequest(), nullptr, std::move(watcher2_ptr),
+                    [](Status status) { EXPECT_EQ(Status::OK, status); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+
+  page->Put(convert::ToArray("name"), convert::ToArray("Alice"),
+            [](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  // Both watchers receive the change, computed once.
+  for (Watcher* watcher : {&watcher1, &watcher2}) {
+    EXPECT_EQ(1u, watcher->changes_seen);
+    PageChangePtr change = std::move(watcher->last_page_change_);
+    ASSERT_EQ(1u, change->changes.size());
+    EXPECT_EQ("name", convert::ToString(change->changes[0]->key));
+    EXPECT_EQ("Alice", ToString(change->changes[0]->value));
+  }
+}
+
 TEST_F(PageWatcherIntegrationTest, PageWatcherDelete) {
   PagePtr page = GetTestPage();
   page->Put(convert::ToArray("foo"), convert::ToArray("bar"),
@@ -164,6 +201,209 @@ TEST_F(PageWatcherIntegrationTest, PageWatcherBigChange) {
   }
 }
 
+TEST_F(PageWatcherIntegrationTest, PageWatcherPackedValues) {
+  size_t entry_count = 70;
+  PagePtr page = GetTestPage();
+  PageWatcherPtr watcher_ptr;
+  Watcher watcher(watcher_ptr.NewRequest(),
+                  [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
+
+  PageSnapshotPtr snapshot;
+  WatchOptionsPtr options = WatchOptions::New();
+  options->packed_values = true;
+  page->Watch(snapshot.NewRequest(), nullptr, std::move(watcher_ptr),
+              std::move(options),
+              [](Status status) { EXPECT_EQ(Status::OK, status); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+
+  page->StartTransaction([](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  for (size_t i = 0; i < entry_count; ++i) {
+    page->Put(convert::ToArray(ftl::StringPrintf("key%02" PRIuMAX, i)),
+              convert::ToArray(ftl::StringPrintf("value%02" PRIuMAX, i)),
+              [](Status status) { EXPECT_EQ(status, Status::OK); });
+    EXPECT_TRUE(page.WaitForIncomingResponse());
+  }
+  page->Commit([](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+
+  // Each call of the paginated change has its own buffer of values.
+  size_t received = 0;
+  while (received < entry_count) {
+    EXPECT_FALSE(RunLoopWithTimeout());
+    PageChangePtr change = std::move(watcher.last_page_change_);
+    EXPECT_EQ(0u, change->changes.size());
+    ASSERT_TRUE(change->packed_changes);
+    std::string values = ToString(change->packed_changes->values);
+    for (const auto& entry : change->packed_changes->entries) {
+      EXPECT_EQ(ftl::StringPrintf("key%02" PRIuMAX, received),
+                convert::ToString(entry->key));
+      ASSERT_TRUE(entry->has_value);
+      EXPECT_EQ(ftl::StringPrintf("value%02" PRIuMAX, received),
+                values.substr(entry->value_offset, entry->value_size));
+      ++received;
+    }
+  }
+  EXPECT_EQ(entry_count, received);
+  EXPECT_LT(1u, watcher.changes_seen);
+  EXPECT_EQ(ResultState::PARTIAL_COMPLETED, watcher.last_result_state_);
+}
+
+TEST_F(PageWatcherIntegrationTest, PageWatcherKeysOnly) {
+  PagePtr page = GetTestPage();
+  PageWatcherPtr watcher_ptr;
+  Watcher watcher(watcher_ptr.NewRequest(),
+                  [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
+
+  PageSnapshotPtr snapshot;
+  WatchOptionsPtr options = WatchOptions::New();
+  options->keys_only = true;
+  page->Watch(snapshot.NewRequest(), nullptr, std::move(watcher_ptr),
+              std::move(options),
+              [](Status status) { EXPECT_EQ(Status::OK, status); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+
+  page->Put(convert::ToArray("name"), convert::ToArray("Alice"),
+            [](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  EXPECT_EQ(1u, watcher.changes_seen);
+  PageChangePtr change = std::move(watcher.last_page_change_);
+  ASSERT_EQ(1u, change->changes.size());
+  EXPECT_EQ("name", convert::ToString(change->changes[0]->key));
+  EXPECT_FALSE(change->changes[0]->value);
+}
+
+TEST_F(PageWatcherIntegrationTest, PageWatcherMaxInlineValueSize) {
+  PagePtr page = GetTestPage();
+  PageWatcherPtr watcher_ptr;
+  Watcher watcher(watcher_ptr.NewRequest(),
+                  [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
+
+  PageSnapshotPtr snapshot;
+  WatchOptionsPtr options = WatchOptions::New();
+  options->max_inline_value_size = 5;
+  page->Watch(snapshot.NewRequest(), nullptr, std::move(watcher_ptr),
+              std::move(options),
+              [](Status status) { EXPECT_EQ(Status::OK, status); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+
+  page->StartTransaction([](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  page->Put(convert::ToArray("long"), convert::ToArray("Alice and Bob"),
+            [](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  page->Put(convert::ToArray("short"), convert::ToArray("Alice"),
+            [](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  page->Commit([](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  EXPECT_EQ(1u, watcher.changes_seen);
+  PageChangePtr change = std::move(watcher.last_page_change_);
+  ASSERT_EQ(2u, change->changes.size());
+  EXPECT_EQ("long", convert::ToString(change->changes[0]->key));
+  EXPECT_FALSE(change->changes[0]->value);
+  EXPECT_EQ("short", convert::ToString(change->changes[1]->key));
+  EXPECT_EQ("Alice", ToString(change->changes[1]->value));
+
+  // The value left out is available in the snapshot of the change.
+  watcher.last_snapshot_->Fetch(
+      convert::ToArray("long"), [](Status status, mx::vmo buffer) {
+        EXPECT_EQ(Status::OK, status);
+        EXPECT_EQ("Alice and Bob", ToString(buffer));
+      });
+  EXPECT_TRUE(watcher.last_snapshot_.WaitForIncomingResponse());
+}
+
+TEST_F(PageWatcherIntegrationTest, PageWatcherMinInterval) {
+  PagePtr page = GetTestPage();
+  PageWatcherPtr watcher_ptr;
+  Watcher watcher(watcher_ptr.NewRequest(),
+                  [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
+
+  PageSnapshotPtr snapshot;
+  WatchOptionsPtr options = WatchOptions::New();
+  options->min_interval_ms = 200;
+  page->Watch(snapshot.NewRequest(), nullptr, std::move(watcher_ptr),
+              std::move(options),
+              [](Status status) { EXPECT_EQ(Status::OK, status); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+
+  page->Put(convert::ToArray("key1"), convert::ToArray("value1"),
+            [](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(1u, watcher.changes_seen);
+
+  page->Put(convert::ToArray("key2"), convert::ToArray("value2"),
+            [](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  page->Put(convert::ToArray("key3"), convert::ToArray("value3"),
+            [](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+
+  // The following commits are only sent at the end of the interval, in a
+  // single change.
+  EXPECT_TRUE(RunLoopWithTimeout(ftl::TimeDelta::FromMilliseconds(100)));
+  EXPECT_EQ(1u, watcher.changes_seen);
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(2u, watcher.changes_seen);
+  PageChangePtr change = std::move(watcher.last_page_change_);
+  ASSERT_EQ(2u, change->changes.size());
+  EXPECT_EQ("key2", convert::ToString(change->changes[0]->key));
+  EXPECT_EQ("key3", convert::ToString(change->changes[1]->key));
+}
+
+TEST_F(PageWatcherIntegrationTest, PageWatcherKeyPrefixesAndRanges) {
+  PagePtr page = GetTestPage();
+  PageWatcherPtr watcher_ptr;
+  Watcher watcher(watcher_ptr.NewRequest(),
+                  [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
+
+  PageSnapshotPtr snapshot;
+  WatchOptionsPtr options = WatchOptions::New();
+  options->key_prefixes = fidl::Array<fidl::Array<uint8_t>>::New(0);
+  options->key_prefixes.push_back(convert::ToArray("a"));
+  options->key_prefixes.push_back(convert::ToArray("c"));
+  KeyRangePtr key_range = KeyRange::New();
+  key_range->start = convert::ToArray("e");
+  key_range->end = convert::ToArray("f");
+  options->key_ranges = fidl::Array<KeyRangePtr>::New(0);
+  options->key_ranges.push_back(std::move(key_range));
+  page->Watch(snapshot.NewRequest(), nullptr, std::move(watcher_ptr),
+              std::move(options),
+              [](Status status) { EXPECT_EQ(Status::OK, status); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+
+  page->StartTransaction([](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  for (const std::string& key : {"a1", "b1", "c1", "e1", "f1"}) {
+    page->Put(convert::ToArray(key), convert::ToArray("value"),
+              [](Status status) { EXPECT_EQ(status, Status::OK); });
+    EXPECT_TRUE(page.WaitForIncomingResponse());
+  }
+  page->Commit([](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  EXPECT_EQ(1u, watcher.changes_seen);
+  PageChangePtr change = std::move(watcher.last_page_change_);
+  ASSERT_EQ(3u, change->changes.size());
+  EXPECT_EQ("a1", convert::ToString(change->changes[0]->key));
+  EXPECT_EQ("c1", convert::ToString(change->changes[1]->key));
+  EXPECT_EQ("e1", convert::ToString(change->changes[2]->key));
+
+  // Changes outside of the watched keys are not sent.
+  page->Put(convert::ToArray("b2"), convert::ToArray("value"),
+            [](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  EXPECT_TRUE(RunLoopWithTimeout(ftl::TimeDelta::FromMilliseconds(200)));
+  EXPECT_EQ(1u, watcher.changes_seen);
+}
+
 TEST_F(PageWatcherIntegrationTest, PageWatcherSnapshot) {
   PagePtr page = GetTestPage();
   PageWatcherPtr watcher_ptr;
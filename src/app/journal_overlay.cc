@@ -0,0 +1,192 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/app/journal_overlay.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include "lib/ftl/logging.h"
+
+namespace ledger {
+namespace {
+
+bool ChangeKeyLess(const storage::EntryChange& change, ftl::StringView key) {
+  return ftl::StringView(change.entry.key) < key;
+}
+
+// Shared state of the iteration merging the base contents with the changes of
+// the overlay.
+class MergeState {
+ public:
+  MergeState(std::vector<const storage::EntryChange*> changes,
+             uint64_t offset,
+             uint64_t max_count,
+             bool reverse,
+             std::function<bool(storage::Entry)> on_next)
+      : changes_(std::move(changes)),
+        to_skip_(offset),
+        max_count_(max_count),
+        reverse_(reverse),
+        on_next_(std::move(on_next)) {}
+
+  bool done() const { return done_; }
+
+  // Emits the changes whose key comes before |key| in the iteration order.
+  // Returns false if the iteration is over.
+  bool EmitChangesBefore(const std::string& key) {
+    while (next_change_ < changes_.size() &&
+           Precedes(changes_[next_change_]->entry.key, key)) {
+      if (!EmitChange(*changes_[next_change_++])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Emits all the remaining changes.
+  void EmitRemainingChanges() {
+    while (next_change_ < changes_.size() &&
+           EmitChange(*changes_[next_change_++])) {
+    }
+  }
+
+  // If the next change is for |key|, emits it in place of the base entry and
+  // sets |overridden| to true. Returns false if the iteration is over.
+  bool EmitChangeFor(const std::string& key, bool* overridden) {
+    *overridden = next_change_ < changes_.size() &&
+                  changes_[next_change_]->entry.key == key;
+    if (!*overridden) {
+      return true;
+    }
+    return EmitChange(*changes_[next_change_++]);
+  }
+
+  // Emits |entry|. Returns false if the iteration is over.
+  bool Emit(storage::Entry entry) {
+    FTL_DCHECK(!done_);
+    if (to_skip_) {
+      --to_skip_;
+      return true;
+    }
+    ++count_;
+    if (!on_next_(std::move(entry)) || count_ == max_count_) {
+      done_ = true;
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  bool Precedes(const std::string& lhs, const std::string& rhs) const {
+    return reverse_ ? rhs < lhs : lhs < rhs;
+  }
+
+  bool EmitChange(const storage::EntryChange& change) {
+    return change.deleted || Emit(change.entry);
+  }
+
+  const std::vector<const storage::EntryChange*> changes_;
+  size_t next_change_ = 0u;
+  uint64_t to_skip_;
+  const uint64_t max_count_;
+  uint64_t count_ = 0u;
+  const bool reverse_;
+  std::function<bool(storage::Entry)> on_next_;
+  bool done_ = false;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(MergeState);
+};
+
+}  // namespace
+
+JournalOverlay::JournalOverlay(std::vector<storage::EntryChange> changes,
+                               std::vector<storage::KeyRange> deleted_ranges)
+    : changes_(std::move(changes)),
+      deleted_ranges_(std::move(deleted_ranges)) {}
+
+JournalOverlay::~JournalOverlay() {}
+
+bool JournalOverlay::GetEntry(ftl::StringView key,
+                              bool* found,
+                              storage::Entry* entry) const {
+  auto it =
+      std::lower_bound(changes_.begin(), changes_.end(), key, ChangeKeyLess);
+  if (it != changes_.end() && it->entry.key == key) {
+    *found = !it->deleted;
+    if (*found) {
+      *entry = it->entry;
+    }
+    return true;
+  }
+  if (IsDeleted(key)) {
+    *found = false;
+    return true;
+  }
+  return false;
+}
+
+JournalOverlay::ContentsGetter JournalOverlay::Merge(
+    ContentsGetter base_contents,
+    std::string min_key,
+    std::string max_key,
+    uint64_t offset,
+    uint64_t max_count,
+    bool reverse) const {
+  return [
+    this, base_contents = std::move(base_contents),
+    min_key = std::move(min_key), max_key = std::move(max_key), offset,
+    max_count, reverse
+  ](std::function<bool(storage::Entry)> on_next,
+    std::function<void(storage::Status)> on_done) {
+    auto begin = std::lower_bound(changes_.begin(), changes_.end(),
+                                  ftl::StringView(min_key), ChangeKeyLess);
+    auto end = max_key.empty()
+                   ? changes_.end()
+                   : std::lower_bound(begin, changes_.end(),
+                                      ftl::StringView(max_key), ChangeKeyLess);
+    std::vector<const storage::EntryChange*> changes;
+    for (auto it = begin; it != end; ++it) {
+      changes.push_back(&*it);
+    }
+    if (reverse) {
+      std::reverse(changes.begin(), changes.end());
+    }
+    auto state = std::make_shared<MergeState>(
+        std::move(changes), offset, max_count, reverse, std::move(on_next));
+
+    base_contents(
+        [this, state](storage::Entry entry) {
+          if (!state->EmitChangesBefore(entry.key)) {
+            return false;
+          }
+          bool overridden;
+          if (!state->EmitChangeFor(entry.key, &overridden)) {
+            return false;
+          }
+          if (overridden || IsDeleted(entry.key)) {
+            return true;
+          }
+          return state->Emit(std::move(entry));
+        },
+        [ state, on_done = std::move(on_done) ](storage::Status status) {
+          if (status == storage::Status::OK && !state->done()) {
+            state->EmitRemainingChanges();
+          }
+          on_done(status);
+        });
+  };
+}
+
+bool JournalOverlay::IsDeleted(ftl::StringView key) const {
+  for (const auto& range : deleted_ranges_) {
+    if (storage::KeyRangeContains(range, key)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace ledger
@@ -0,0 +1,63 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_APP_JOURNAL_OVERLAY_H_
+#define APPS_LEDGER_SRC_APP_JOURNAL_OVERLAY_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "apps/ledger/src/storage/public/types.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/strings/string_view.h"
+
+namespace ledger {
+
+// The changes of a journal that is not committed yet, to be read on top of the
+// contents of its base commit. See |storage::Journal::GetContents|.
+class JournalOverlay {
+ public:
+  // Iterates over entries: calls |on_next| on each entry until it returns
+  // false, then calls |on_done|.
+  using ContentsGetter =
+      std::function<void(std::function<bool(storage::Entry)> on_next,
+                         std::function<void(storage::Status)> on_done)>;
+
+  // |changes| must be sorted by key.
+  JournalOverlay(std::vector<storage::EntryChange> changes,
+                 std::vector<storage::KeyRange> deleted_ranges);
+  ~JournalOverlay();
+
+  // Returns true if the entry for |key| is defined by the overlay, in which
+  // case |found| is set to whether the entry exists and, if so, |entry| to the
+  // entry. Returns false if the entry of the base commit is kept.
+  bool GetEntry(ftl::StringView key, bool* found, storage::Entry* entry) const;
+
+  // Returns a |ContentsGetter| iterating over the entries with keys in
+  // [|min_key|, |max_key|) of the base contents given by |base_contents|
+  // modified by the overlay, in ascending key order, or in descending key order
+  // if |reverse| is true. An empty |max_key| leaves the range unbounded above.
+  // The first |offset| entries are skipped, and if |max_count| is not 0, the
+  // iteration stops after |max_count| entries. |base_contents| must iterate
+  // over all the base entries of the range, in the same order.
+  ContentsGetter Merge(ContentsGetter base_contents,
+                       std::string min_key,
+                       std::string max_key,
+                       uint64_t offset,
+                       uint64_t max_count,
+                       bool reverse) const;
+
+ private:
+  bool IsDeleted(ftl::StringView key) const;
+
+  const std::vector<storage::EntryChange> changes_;
+  const std::vector<storage::KeyRange> deleted_ranges_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(JournalOverlay);
+};
+
+}  // namespace ledger
+
+#endif  // APPS_LEDGER_SRC_APP_JOURNAL_OVERLAY_H_
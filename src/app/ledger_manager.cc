@@ -4,6 +4,7 @@
 
 #include "apps/ledger/src/app/ledger_manager.h"
 
+#include <iterator>
 #include <string>
 #include <utility>
 #include <vector>
@@ -18,8 +19,19 @@
 
 namespace ledger {
 
+namespace {
+
+// Maximum number of pages opened at the same time by |PreloadPages|.
+constexpr size_t kMaxConcurrentPreloads = 2;
+
+}  // namespace
+
 // Container for a PageManager that keeps tracks of in-flight page requests and
 // callbacks and fires them when the PageManager is available.
+//
+// The container only calls its |on_empty| callback if the PageManager can't be
+// created. The PageManager notifies the LedgerManager directly when it has no
+// more connections, see |LedgerManager::OnPageManagerEmpty|.
 class LedgerManager::PageManagerContainer {
  public:
   PageManagerContainer() : status_(Status::OK) {}
@@ -31,9 +43,6 @@ class LedgerManager::PageManagerContainer {
 
   void set_on_empty(const ftl::Closure& on_empty_callback) {
     on_empty_callback_ = on_empty_callback;
-    if (page_manager_) {
-      page_manager_->set_on_empty(on_empty_callback);
-    }
   };
 
   // Keeps track of |page| and |callback|. Binds |page| and fires |callback|
@@ -67,15 +76,19 @@ class LedgerManager::PageManagerContainer {
       it->second(status_);
     }
     requests_.clear();
-    if (on_empty_callback_) {
-      if (page_manager_) {
-        page_manager_->set_on_empty(on_empty_callback_);
-      } else {
-        on_empty_callback_();
-      }
+    if (!page_manager_ && on_empty_callback_) {
+      on_empty_callback_();
     }
   }
 
+  // Returns whether page requests are waiting for the PageManager.
+  bool HasRequests() const { return !requests_.empty(); }
+
+  // Returns the PageManager of this container, or null if it is not available.
+  std::unique_ptr<PageManager> ReleasePageManager() {
+    return std::move(page_manager_);
+  }
+
  private:
   std::unique_ptr<PageManager> page_manager_;
   Status status_;
@@ -89,12 +102,17 @@ class LedgerManager::PageManagerContainer {
 
 LedgerManager::LedgerManager(Environment* environment,
                              std::unique_ptr<storage::LedgerStorage> storage,
-                             std::unique_ptr<cloud_sync::LedgerSync> sync)
+                             std::unique_ptr<cloud_sync::LedgerSync> sync,
+                             size_t max_idle_pages,
+                             ftl::TimeDelta idle_page_timeout)
     : environment_(environment),
       storage_(std::move(storage)),
       sync_(std::move(sync)),
       ledger_impl_(this),
-      merge_manager_(environment_) {}
+      merge_manager_(environment_),
+      idle_pages_(environment_->main_runner(),
+                  max_idle_pages,
+                  idle_page_timeout) {}
 
 LedgerManager::~LedgerManager() {}
 
@@ -102,9 +120,19 @@ void LedgerManager::BindLedger(fidl::InterfaceRequest<Ledger> ledger_request) {
   bindings_.AddBinding(&ledger_impl_, std::move(ledger_request));
 }
 
+void LedgerManager::PreloadPages() {
+  std::vector<storage::PageId> page_ids =
+      storage_->GetMostAccessedPages(idle_pages_.max_pages());
+  preload_queue_.assign(std::make_move_iterator(page_ids.begin()),
+                        std::make_move_iterator(page_ids.end()));
+  PreloadNextPages();
+}
+
 void LedgerManager::GetPage(convert::ExtendedStringView page_id,
                             fidl::InterfaceRequest<Page> page_request,
                             std::function<void(Status)> callback) {
+  storage_->RecordPageAccess(page_id);
+
   // If we have the page manager ready, just ask for a new page impl.
   auto it = page_managers_.find(page_id);
   if (it != page_managers_.end()) {
@@ -115,6 +143,13 @@ void LedgerManager::GetPage(convert::ExtendedStringView page_id,
   PageManagerContainer* container = AddPageManagerContainer(page_id);
   container->BindPage(std::move(page_request), std::move(callback));
 
+  // If the page was recently closed, reuse its page manager.
+  std::unique_ptr<PageManager> idle_page_manager = idle_pages_.Take(page_id);
+  if (idle_page_manager) {
+    container->SetPageManager(Status::OK, std::move(idle_page_manager));
+    return;
+  }
+
   storage_->GetPageStorage(
       page_id.ToString(),
       [ this, page_id = page_id.ToString(), container ](
@@ -144,6 +179,7 @@ Status LedgerManager::DeletePage(convert::ExtendedStringView page_id) {
   if (it != page_managers_.end()) {
     page_managers_.erase(it);
   }
+  idle_pages_.Remove(page_id);
 
   if (storage_->DeletePageStorage(page_id)) {
     return Status::OK;
@@ -185,9 +221,77 @@ std::unique_ptr<PageManager> LedgerManager::NewPageManager(
       FTL_LOG(ERROR) << "Page Sync stopped due to unrecoverable error.";
     });
   }
-  return std::make_unique<PageManager>(
+  storage::PageId page_id = page_storage->GetId();
+  auto page_manager = std::make_unique<PageManager>(
       environment_, std::move(page_storage), std::move(page_sync_context),
       merge_manager_.GetMergeResolver(page_storage.get()));
+  // This callback is kept for the whole life of the page manager, whether it is
+  // in a container or in |idle_pages_|.
+  page_manager->set_on_empty([ this, page_id = std::move(page_id) ] {
+    OnPageManagerEmpty(page_id);
+  });
+  return page_manager;
+}
+
+void LedgerManager::OnPageManagerEmpty(const storage::PageId& page_id) {
+  auto it = page_managers_.find(page_id);
+  if (it == page_managers_.end()) {
+    // The page manager is already idle.
+    return;
+  }
+  std::unique_ptr<PageManager> page_manager = it->second.ReleasePageManager();
+  FTL_DCHECK(page_manager);
+  page_managers_.erase(it);
+  idle_pages_.Add(page_id, std::move(page_manager));
+}
+
+void LedgerManager::PreloadNextPages() {
+  while (pending_preloads_ < kMaxConcurrentPreloads &&
+         !preload_queue_.empty()) {
+    storage::PageId page_id = std::move(preload_queue_.front());
+    preload_queue_.pop_front();
+    // Skip the pages opened or reopened since the preload started.
+    if (page_managers_.find(page_id) != page_managers_.end() ||
+        idle_pages_.Contains(page_id)) {
+      continue;
+    }
+    PreloadPage(std::move(page_id));
+  }
+}
+
+void LedgerManager::PreloadPage(storage::PageId page_id) {
+  // The page is opened in a container, so that a GetPage call for it made
+  // before the end of the preload waits for it instead of opening the page a
+  // second time.
+  PageManagerContainer* container = AddPageManagerContainer(page_id);
+  ++pending_preloads_;
+  storage_->GetPageStorage(
+      page_id,
+      [ this, page_id, container ](
+          storage::Status storage_status,
+          std::unique_ptr<storage::PageStorage> page_storage) mutable {
+        --pending_preloads_;
+        Status status = PageUtils::ConvertStatus(storage_status, Status::OK);
+        if (status == Status::OK && !page_storage) {
+          if (container->HasRequests()) {
+            // The page was requested during the preload.
+            CreatePageStorage(std::move(page_id), container);
+          } else {
+            // The page was deleted: do not create it again.
+            container->SetPageManager(Status::PAGE_NOT_FOUND, nullptr);
+          }
+        } else if (status != Status::OK) {
+          container->SetPageManager(status, nullptr);
+        } else {
+          bool requested = container->HasRequests();
+          container->SetPageManager(Status::OK,
+                                    NewPageManager(std::move(page_storage)));
+          if (!requested) {
+            OnPageManagerEmpty(page_id);
+          }
+        }
+        PreloadNextPages();
+      });
 }
 
 void LedgerManager::CheckEmpty() {
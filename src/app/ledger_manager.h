@@ -5,11 +5,13 @@
 #ifndef APPS_LEDGER_SRC_APP_LEDGER_MANAGER_H_
 #define APPS_LEDGER_SRC_APP_LEDGER_MANAGER_H_
 
+#include <deque>
 #include <functional>
 #include <map>
 #include <memory>
 #include <type_traits>
 
+#include "apps/ledger/src/app/idle_page_pool.h"
 #include "apps/ledger/src/app/ledger_impl.h"
 #include "apps/ledger/src/app/merging/ledger_merge_manager.h"
 #include "apps/ledger/src/callback/auto_cleanable.h"
@@ -28,16 +30,28 @@ namespace ledger {
 // LedgerManager owns all per-ledger-instance objects: LedgerStorage and a Mojo
 // LedgerImpl. It is safe to delete it at any point - this closes all channels,
 // deletes the LedgerImpl and tears down the storage.
+//
+// The pages whose last connection is closed are kept open in an
+// |IdlePagePool| of at most |max_idle_pages| pages, for at most
+// |idle_page_timeout|.
 class LedgerManager : public LedgerImpl::Delegate {
  public:
-  LedgerManager(Environment* environment,
-                std::unique_ptr<storage::LedgerStorage> storage,
-                std::unique_ptr<cloud_sync::LedgerSync> sync);
+  LedgerManager(
+      Environment* environment,
+      std::unique_ptr<storage::LedgerStorage> storage,
+      std::unique_ptr<cloud_sync::LedgerSync> sync,
+      size_t max_idle_pages = IdlePagePool::kDefaultMaxPages,
+      ftl::TimeDelta idle_page_timeout = IdlePagePool::kDefaultIdleTimeout);
   ~LedgerManager();
 
   // Creates a new proxy for the LedgerImpl managed by this LedgerManager.
   void BindLedger(fidl::InterfaceRequest<Ledger> ledger_request);
 
+  // Opens in the background the most accessed pages of the ledger, at most
+  // |kMaxConcurrentPreloads| at a time, and adds them to the idle page pool.
+  // Only as many pages as the pool holds are preloaded.
+  void PreloadPages();
+
   // LedgerImpl::Delegate:
   void GetPage(convert::ExtendedStringView page_id,
                fidl::InterfaceRequest<Page> page_request,
@@ -50,6 +64,10 @@ class LedgerManager : public LedgerImpl::Delegate {
     on_empty_callback_ = on_empty_callback;
   }
 
+  const IdlePagePool::Stats& idle_page_stats() const {
+    return idle_pages_.stats();
+  }
+
  private:
   class PageManagerContainer;
 
@@ -66,6 +84,16 @@ class LedgerManager : public LedgerImpl::Delegate {
   std::unique_ptr<PageManager> NewPageManager(
       std::unique_ptr<storage::PageStorage> page_storage);
 
+  // Moves the page manager of |page_id|, which has no more connections, from
+  // its container to |idle_pages_|.
+  void OnPageManagerEmpty(const storage::PageId& page_id);
+
+  // Starts preloading the pages of |preload_queue_| until
+  // |kMaxConcurrentPreloads| preloads are in flight.
+  void PreloadNextPages();
+  // Preloads the page |page_id|, which is neither open nor idle.
+  void PreloadPage(storage::PageId page_id);
+
   void CheckEmpty();
 
   Environment* const environment_;
@@ -82,6 +110,12 @@ class LedgerManager : public LedgerImpl::Delegate {
                              PageManagerContainer,
                              convert::StringViewComparator>
       page_managers_;
+  // Page managers without connections. Like |page_managers_|, must be
+  // destructed before |merge_manager_|.
+  IdlePagePool idle_pages_;
+  // Pages waiting to be preloaded, from the most to the least accessed.
+  std::deque<storage::PageId> preload_queue_;
+  size_t pending_preloads_ = 0u;
   ftl::Closure on_empty_callback_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(LedgerManager);
@@ -66,16 +66,32 @@ class FakeLedgerStorage : public storage::LedgerStorage {
     return false;
   }
 
+  void RecordPageAccess(storage::PageIdView page_id) override {
+    page_accesses.push_back(page_id.ToString());
+  }
+
+  std::vector<storage::PageId> GetMostAccessedPages(
+      size_t max_count) override {
+    if (most_accessed_pages.size() <= max_count) {
+      return most_accessed_pages;
+    }
+    return std::vector<storage::PageId>(
+        most_accessed_pages.begin(), most_accessed_pages.begin() + max_count);
+  }
+
   void ClearCalls() {
     create_page_calls.clear();
     get_page_calls.clear();
     delete_page_calls.clear();
+    page_accesses.clear();
   }
 
   bool should_get_page_fail = false;
   std::vector<storage::PageId> create_page_calls;
   std::vector<storage::PageId> get_page_calls;
   std::vector<storage::PageId> delete_page_calls;
+  std::vector<storage::PageId> page_accesses;
+  std::vector<storage::PageId> most_accessed_pages;
 
  private:
   ftl::RefPtr<ftl::TaskRunner> task_runner_;
@@ -120,6 +136,17 @@ class LedgerManagerTest : public test::TestWithMessageLoop {
   // test::TestWithMessageLoop:
   void SetUp() override {
     test::TestWithMessageLoop::SetUp();
+    ResetLedgerManager(IdlePagePool::kDefaultMaxPages,
+                       IdlePagePool::kDefaultIdleTimeout);
+  }
+
+ protected:
+  // Replaces |ledger_manager_| with a new one, with the given idle page pool
+  // budget, and binds |ledger| to it.
+  void ResetLedgerManager(size_t max_idle_pages,
+                          ftl::TimeDelta idle_page_timeout) {
+    ledger.reset();
+    ledger_manager_.reset();
     std::unique_ptr<FakeLedgerStorage> storage =
         std::make_unique<FakeLedgerStorage>(message_loop_.task_runner());
     storage_ptr = storage.get();
@@ -127,11 +154,25 @@ class LedgerManagerTest : public test::TestWithMessageLoop {
         std::make_unique<FakeLedgerSync>(message_loop_.task_runner());
     sync_ptr = sync.get();
     ledger_manager_ = std::make_unique<LedgerManager>(
-        &environment_, std::move(storage), std::move(sync));
+        &environment_, std::move(storage), std::move(sync), max_idle_pages,
+        idle_page_timeout);
     ledger_manager_->BindLedger(ledger.NewRequest());
   }
 
- protected:
+  // Opens the page |id|, then closes it.
+  void OpenAndClosePage(const storage::PageId& id) {
+    PagePtr page;
+    Status status;
+    ledger->GetPage(
+        convert::ToArray(id), page.NewRequest(),
+        callback::Capture([this] { message_loop_.PostQuitTask(); }, &status));
+    EXPECT_FALSE(RunLoopWithTimeout());
+    EXPECT_EQ(Status::OK, status);
+    page.reset();
+    // Let the page manager be notified that the page is closed.
+    EXPECT_TRUE(RunLoopWithTimeout(ftl::TimeDelta::FromMilliseconds(20)));
+  }
+
   ledger::Environment environment_;
   FakeLedgerStorage* storage_ptr;
   FakeLedgerSync* sync_ptr;
@@ -229,6 +270,96 @@ TEST_F(LedgerManagerTest, CallGetPageTwice) {
   EXPECT_EQ(0u, storage_ptr->delete_page_calls.size());
 }
 
+// Verifies that a recently closed page is reopened without getting its storage
+// again.
+TEST_F(LedgerManagerTest, ReopenIdlePage) {
+  storage::PageId id = RandomId();
+  OpenAndClosePage(id);
+  OpenAndClosePage(id);
+
+  EXPECT_EQ(1u, storage_ptr->get_page_calls.size());
+  EXPECT_EQ(1u, ledger_manager_->idle_page_stats().hits);
+  EXPECT_EQ(1u, ledger_manager_->idle_page_stats().misses);
+}
+
+// Verifies that the least recently closed page is evicted when the idle page
+// pool is full.
+TEST_F(LedgerManagerTest, EvictIdlePageWhenPoolIsFull) {
+  ResetLedgerManager(1u, IdlePagePool::kDefaultIdleTimeout);
+  storage::PageId id1 = RandomId();
+  storage::PageId id2 = RandomId();
+  OpenAndClosePage(id1);
+  OpenAndClosePage(id2);
+  EXPECT_EQ(1u, ledger_manager_->idle_page_stats().capacity_evictions);
+
+  OpenAndClosePage(id2);
+  OpenAndClosePage(id1);
+  ASSERT_EQ(3u, storage_ptr->get_page_calls.size());
+  EXPECT_EQ(id1, storage_ptr->get_page_calls[2]);
+  EXPECT_EQ(1u, ledger_manager_->idle_page_stats().hits);
+}
+
+// Verifies that idle pages are evicted after the idle timeout.
+TEST_F(LedgerManagerTest, EvictIdlePageAfterTimeout) {
+  ResetLedgerManager(IdlePagePool::kDefaultMaxPages,
+                     ftl::TimeDelta::FromMilliseconds(10));
+  storage::PageId id = RandomId();
+  OpenAndClosePage(id);
+  EXPECT_EQ(1u, ledger_manager_->idle_page_stats().timeout_evictions);
+
+  OpenAndClosePage(id);
+  EXPECT_EQ(2u, storage_ptr->get_page_calls.size());
+  EXPECT_EQ(0u, ledger_manager_->idle_page_stats().hits);
+}
+
+// Verifies that the most accessed pages are preloaded in the idle page pool.
+TEST_F(LedgerManagerTest, PreloadMostAccessedPages) {
+  ResetLedgerManager(2u, IdlePagePool::kDefaultIdleTimeout);
+  storage::PageId id1 = RandomId();
+  storage::PageId id2 = RandomId();
+  storage::PageId id3 = RandomId();
+  storage_ptr->most_accessed_pages = {id1, id2, id3};
+
+  ledger_manager_->PreloadPages();
+  EXPECT_TRUE(RunLoopWithTimeout(ftl::TimeDelta::FromMilliseconds(20)));
+  // Only as many pages as the idle page pool holds are preloaded.
+  EXPECT_EQ(std::vector<storage::PageId>({id1, id2}),
+            storage_ptr->get_page_calls);
+
+  OpenAndClosePage(id2);
+  EXPECT_EQ(2u, storage_ptr->get_page_calls.size());
+  EXPECT_EQ(1u, ledger_manager_->idle_page_stats().hits);
+  EXPECT_EQ(std::vector<storage::PageId>({id2}), storage_ptr->page_accesses);
+}
+
+// Verifies that a page requested while it is preloaded is opened once.
+TEST_F(LedgerManagerTest, GetPageDuringPreload) {
+  storage::PageId id = RandomId();
+  storage_ptr->most_accessed_pages = {id};
+
+  ledger_manager_->PreloadPages();
+  OpenAndClosePage(id);
+  EXPECT_EQ(1u, storage_ptr->get_page_calls.size());
+
+  OpenAndClosePage(id);
+  EXPECT_EQ(1u, storage_ptr->get_page_calls.size());
+  EXPECT_EQ(1u, ledger_manager_->idle_page_stats().hits);
+}
+
+// Verifies that deleting a page closes it if it is idle.
+TEST_F(LedgerManagerTest, DeleteIdlePage) {
+  storage::PageId id = RandomId();
+  OpenAndClosePage(id);
+
+  ledger->DeletePage(convert::ToArray(id),
+                     [this](Status) { message_loop_.PostQuitTask(); });
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  OpenAndClosePage(id);
+  EXPECT_EQ(2u, storage_ptr->get_page_calls.size());
+  EXPECT_EQ(0u, ledger_manager_->idle_page_stats().hits);
+}
+
 // Cloud should never be queried.
 TEST_F(LedgerManagerTest, GetPageDoNotCallTheCloud) {
   storage_ptr->should_get_page_fail = true;
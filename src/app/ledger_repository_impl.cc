@@ -59,6 +59,7 @@ void LedgerRepositoryImpl::GetLedger(
                               std::move(ledger_sync)));
     FTL_DCHECK(result.second);
     it = result.first;
+    it->second.PreloadPages();
   }
 
   it->second.BindLedger(std::move(ledger_request));
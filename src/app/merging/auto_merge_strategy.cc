@@ -31,9 +31,6 @@ class AutoMergeStrategy::AutoMerger {
   void Done();
 
  private:
-  void OnRightChangeReady(
-      storage::Status status,
-      std::unique_ptr<std::vector<storage::EntryChange>> right_change);
   void OnComparisonDone(storage::Status status,
                         std::unique_ptr<std::vector<storage::EntryChange>>,
                         bool distinct);
@@ -83,61 +80,19 @@ AutoMergeStrategy::AutoMerger::~AutoMerger() {
 }
 
 void AutoMergeStrategy::AutoMerger::Start() {
-  std::unique_ptr<std::vector<storage::EntryChange>> changes(
-      new std::vector<storage::EntryChange>());
-  auto on_next =
-      [ weak_this = weak_factory_.GetWeakPtr(),
-        changes = changes.get() ](storage::EntryChange change) {
-    if (!weak_this) {
-      return false;
-    }
-
-    if (weak_this->cancelled_) {
-      return false;
-    }
-
-    changes->push_back(change);
-    return true;
-  };
-
-  auto on_done = ftl::MakeCopyable([
-    weak_this = weak_factory_.GetWeakPtr(), changes = std::move(changes)
-  ](storage::Status status) mutable {
-    if (weak_this) {
-      weak_this->OnRightChangeReady(std::move(status), std::move(changes));
-    }
-  });
-
-  storage_->GetCommitContentsDiff(*ancestor_, *right_, "", std::move(on_next),
-                                  std::move(on_done));
-}
-
-void AutoMergeStrategy::AutoMerger::OnRightChangeReady(
-    storage::Status status,
-    std::unique_ptr<std::vector<storage::EntryChange>> right_change) {
-  if (cancelled_) {
-    Done();
-    return;
-  }
-
-  if (status != storage::Status::OK) {
-    FTL_LOG(ERROR) << "Unable to compute diff due to error " << status
-                   << ", aborting.";
-    Done();
-    return;
-  }
-
-  struct PageChangeIndex {
-    size_t entry_index = 0;
+  // Represents the information that needs to be shared between on_next and
+  // on_done callbacks.
+  struct Context {
+    // The changes from the right commit that are not in the left one.
+    std::unique_ptr<std::vector<storage::EntryChange>> right_changes =
+        std::make_unique<std::vector<storage::EntryChange>>();
+    // Whether the left and right commits changed distinct keys.
     bool distinct = true;
   };
 
-  std::unique_ptr<PageChangeIndex> index(new PageChangeIndex());
-
-  auto on_next = ftl::MakeCopyable([
-    weak_this = weak_factory_.GetWeakPtr(), index = index.get(),
-    right_change = right_change.get()
-  ](storage::EntryChange change) {
+  auto context = std::make_unique<Context>();
+  auto on_next = [ weak_this = weak_factory_.GetWeakPtr(),
+                   context = context.get() ](storage::ThreeWayChange change) {
     if (!weak_this) {
       return false;
     }
@@ -146,35 +101,38 @@ void AutoMergeStrategy::AutoMerger::OnRightChangeReady(
       return false;
     }
 
-    while (change.entry.key > (*right_change)[index->entry_index].entry.key) {
-      index->entry_index++;
-      if (index->entry_index >= right_change->size()) {
-        return false;
+    if (storage::EntriesEqual(change.base, change.left)) {
+      // Only the right commit changed this key.
+      if (change.right) {
+        context->right_changes->push_back(
+            storage::EntryChange{std::move(*change.right), false});
+      } else {
+        context->right_changes->push_back(
+            storage::EntryChange{std::move(*change.base), true});
       }
+      return true;
     }
-    if (change.entry.key == (*right_change)[index->entry_index].entry.key) {
-      if (change == (*right_change)[index->entry_index]) {
-        return true;
-      }
-      index->distinct = false;
-      return false;
+    if (storage::EntriesEqual(change.base, change.right) ||
+        storage::EntriesEqual(change.left, change.right)) {
+      // The left commit already holds the result for this key.
+      return true;
     }
-    return true;
-  });
+    context->distinct = false;
+    return false;
+  };
 
   // |on_done| is called when the full diff is computed.
   auto on_done = ftl::MakeCopyable([
-    weak_this = weak_factory_.GetWeakPtr(),
-    right_change = std::move(right_change), index = std::move(index)
-  ](storage::Status status) mutable {
+    weak_this = weak_factory_.GetWeakPtr(), context = std::move(context)
+  ](storage::Status status) {
     if (weak_this) {
-      weak_this->OnComparisonDone(status, std::move(right_change),
-                                  index->distinct);
+      weak_this->OnComparisonDone(status, std::move(context->right_changes),
+                                  context->distinct);
     }
   });
 
-  storage_->GetCommitContentsDiff(*ancestor_, *left_, "", std::move(on_next),
-                                  std::move(on_done));
+  storage_->GetThreeWayContentsDiff(*ancestor_, *left_, *right_, "",
+                                    std::move(on_next), std::move(on_done));
 }
 
 void AutoMergeStrategy::AutoMerger::OnComparisonDone(
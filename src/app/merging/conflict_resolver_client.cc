@@ -168,7 +168,7 @@ void ConflictResolverClient::GetDiff(
         callback) {
   diff_utils::ComputePageChange(
       storage_, *ancestor_, commit, "", convert::ToString(token),
-      fidl_serialization::kMaxInlineDataSize,
+      fidl_serialization::kMaxInlineDataSize, diff_utils::ValueOptions(),
       [
         weak_this = weak_factory_.GetWeakPtr(), callback = std::move(callback)
       ](Status status,
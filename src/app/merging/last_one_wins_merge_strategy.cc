@@ -69,19 +69,24 @@ void LastOneWinsMergeStrategy::LastOneWinsMerger::Start() {
       storage_->StartMergeCommit(left_->GetId(), right_->GetId(), &journal_);
   FTL_DCHECK(s == storage::Status::OK);
 
-  auto on_next = [weak_this =
-                      weak_factory_.GetWeakPtr()](storage::EntryChange change) {
+  auto on_next = [weak_this = weak_factory_.GetWeakPtr()](
+      storage::ThreeWayChange change) {
     if (!weak_this || weak_this->cancelled_) {
       // No need to call Done, as it will be called in the on_done callback.
       return false;
     }
-    const std::string& key = change.entry.key;
+    // The right commit wins for each key it changed, unless the left commit
+    // already holds the same entry.
+    if (storage::EntriesEqual(change.base, change.right) ||
+        storage::EntriesEqual(change.left, change.right)) {
+      return true;
+    }
     storage::Status s;
-    if (change.deleted) {
-      s = weak_this->journal_->Delete(key);
+    if (!change.right) {
+      s = weak_this->journal_->Delete(change.base->key);
     } else {
-      s = weak_this->journal_->Put(key, change.entry.object_id,
-                                   change.entry.priority);
+      s = weak_this->journal_->Put(change.right->key, change.right->object_id,
+                                   change.right->priority);
     }
     if (s != storage::Status::OK) {
       FTL_LOG(ERROR) << "Error while merging commits: " << s;
@@ -114,8 +119,9 @@ void LastOneWinsMergeStrategy::LastOneWinsMerger::Start() {
           weak_this->Done();
         });
   };
-  storage_->GetCommitContentsDiff(*ancestor_, *right_, "", std::move(on_next),
-                                  std::move(on_diff_done));
+  storage_->GetThreeWayContentsDiff(*ancestor_, *left_, *right_, "",
+                                    std::move(on_next),
+                                    std::move(on_diff_done));
 }
 
 void LastOneWinsMergeStrategy::LastOneWinsMerger::Cancel() {
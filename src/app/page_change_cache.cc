@@ -0,0 +1,152 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/app/page_change_cache.h"
+
+#include <utility>
+
+#include "apps/ledger/src/app/fidl/packed_entries.h"
+#include "lib/ftl/logging.h"
+
+namespace ledger {
+
+namespace {
+
+// Returns a copy of |page_change| whose value buffers are read-only handles to
+// the buffers of |page_change|, or nullptr if the buffers cannot be shared.
+PageChangePtr SharePageChange(const PageChange& page_change) {
+  PageChangePtr result = PageChange::New();
+  result->timestamp = page_change.timestamp;
+  result->changes = fidl::Array<EntryPtr>::New(0);
+  for (const auto& change : page_change.changes) {
+    EntryPtr entry = Entry::New();
+    entry->key = change->key.Clone();
+    entry->priority = change->priority;
+    if (change->value &&
+        change->value.duplicate(
+            MX_RIGHT_DUPLICATE | MX_RIGHT_TRANSFER | MX_RIGHT_READ,
+            &entry->value) != NO_ERROR) {
+      return nullptr;
+    }
+    result->changes.push_back(std::move(entry));
+  }
+  result->deleted_keys = fidl::Array<fidl::Array<uint8_t>>::New(0);
+  for (const auto& key : page_change.deleted_keys) {
+    result->deleted_keys.push_back(key.Clone());
+  }
+  if (page_change.packed_changes) {
+    result->packed_changes =
+        SlicePackedEntries(*page_change.packed_changes, 0u,
+                           page_change.packed_changes->entries.size());
+    if (!result->packed_changes) {
+      return nullptr;
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+constexpr size_t PageChangeCache::kDefaultMaxCachedChanges;
+
+PageChangeCache::PageChangeCache(storage::PageStorage* storage,
+                                 size_t max_cached_changes)
+    : storage_(storage),
+      max_cached_changes_(max_cached_changes),
+      weak_factory_(this) {}
+
+PageChangeCache::~PageChangeCache() {}
+
+void PageChangeCache::GetPageChange(
+    const storage::Commit& base,
+    const storage::Commit& other,
+    std::vector<diff_utils::KeyRange> ranges,
+    std::string min_key,
+    size_t max_fidl_size,
+    const diff_utils::ValueOptions& value_options,
+    std::function<void(Status, PageChangePtr, std::string)> callback) {
+  Key key(base.GetId(), other.GetId(), ranges, min_key, max_fidl_size,
+          value_options.format, value_options.keys_only,
+          value_options.max_inline_size);
+  auto it = changes_.find(key);
+  if (it != changes_.end()) {
+    if (!it->second.ready) {
+      it->second.callbacks.push_back(std::move(callback));
+      return;
+    }
+    if (!it->second.page_change) {
+      callback(Status::OK, nullptr, "");
+      return;
+    }
+    PageChangePtr page_change = SharePageChange(*it->second.page_change);
+    if (!page_change) {
+      callback(Status::INTERNAL_ERROR, nullptr, "");
+      return;
+    }
+    callback(Status::OK, std::move(page_change), it->second.next_token);
+    return;
+  }
+
+  changes_[key].callbacks.push_back(std::move(callback));
+  ++diff_count_;
+  diff_utils::ComputePageChangeInRanges(
+      storage_, base, other, std::move(ranges), std::move(min_key),
+      max_fidl_size, value_options,
+      [ weak_this = weak_factory_.GetWeakPtr(), key = std::move(key) ](
+          Status status,
+          std::pair<PageChangePtr, std::string> page_change) {
+        if (weak_this) {
+          weak_this->OnPageChangeComputed(key, status,
+                                          std::move(page_change.first),
+                                          std::move(page_change.second));
+        }
+      });
+}
+
+void PageChangeCache::OnPageChangeComputed(const Key& key,
+                                           Status status,
+                                           PageChangePtr page_change,
+                                           std::string next_token) {
+  auto it = changes_.find(key);
+  FTL_DCHECK(it != changes_.end() && !it->second.ready);
+  std::vector<std::function<void(Status, PageChangePtr, std::string)>>
+      callbacks = std::move(it->second.callbacks);
+
+  // Share the page with all the requests before calling any of them: the
+  // callbacks can request other pages and evict this one.
+  std::vector<PageChangePtr> page_changes(callbacks.size());
+  if (status == Status::OK && page_change) {
+    for (auto& shared_change : page_changes) {
+      shared_change = SharePageChange(*page_change);
+      if (!shared_change) {
+        status = Status::INTERNAL_ERROR;
+        break;
+      }
+    }
+  }
+
+  if (status != Status::OK) {
+    // Errors are not cached: the next request computes the page again.
+    changes_.erase(it);
+  } else {
+    it->second.ready = true;
+    it->second.page_change = std::move(page_change);
+    it->second.next_token = next_token;
+    ready_keys_.push_back(key);
+    while (ready_keys_.size() > max_cached_changes_) {
+      changes_.erase(ready_keys_.front());
+      ready_keys_.pop_front();
+    }
+  }
+
+  for (size_t i = 0; i < callbacks.size(); ++i) {
+    if (status != Status::OK) {
+      callbacks[i](status, nullptr, "");
+    } else {
+      callbacks[i](Status::OK, std::move(page_changes[i]), next_token);
+    }
+  }
+}
+
+}  // namespace ledger
@@ -0,0 +1,102 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_APP_PAGE_CHANGE_CACHE_H_
+#define APPS_LEDGER_SRC_APP_PAGE_CHANGE_CACHE_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <list>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "apps/ledger/services/public/ledger.fidl.h"
+#include "apps/ledger/src/app/diff_utils.h"
+#include "apps/ledger/src/storage/public/page_storage.h"
+#include "apps/ledger/src/storage/public/types.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
+
+namespace ledger {
+
+// Computes the pages of the PageChanges sent to the watchers of a page, sharing
+// them between the watchers at the same commit. The pages are keyed by the pair
+// of commits, the key ranges, the first key, the maximum size and the value
+// options: concurrent requests for the same page wait for a single diff
+// computation, and the last |max_cached_changes| computed pages are kept for
+// the watchers that request them later.
+class PageChangeCache {
+ public:
+  static constexpr size_t kDefaultMaxCachedChanges = 4;
+
+  explicit PageChangeCache(
+      storage::PageStorage* storage,
+      size_t max_cached_changes = kDefaultMaxCachedChanges);
+  ~PageChangeCache();
+
+  // Returns in |callback| the page of the change of the entries whose keys are
+  // in |ranges| between |base| and |other|, and the key at which the next page
+  // starts, as computed by |diff_utils::ComputePageChangeInRanges|. The
+  // PageChange is null if there is no change. Each caller receives its own
+  // PageChange, whose value buffers are read-only handles to the buffers of the
+  // cached page.
+  void GetPageChange(
+      const storage::Commit& base,
+      const storage::Commit& other,
+      std::vector<diff_utils::KeyRange> ranges,
+      std::string min_key,
+      size_t max_fidl_size,
+      const diff_utils::ValueOptions& value_options,
+      std::function<void(Status, PageChangePtr, std::string)> callback);
+
+  // Returns the number of diffs computed, for tests.
+  size_t diff_count() const { return diff_count_; }
+
+ private:
+  using Key = std::tuple<storage::CommitId,
+                         storage::CommitId,
+                         std::vector<diff_utils::KeyRange>,
+                         std::string,
+                         size_t,
+                         diff_utils::ValueFormat,
+                         bool,
+                         uint64_t>;
+
+  struct CachedChange {
+    // Whether the computation of the page is done.
+    bool ready = false;
+    // The computed page. Null if there is no change.
+    PageChangePtr page_change;
+    // The first key of the next page, or empty if this is the last page.
+    std::string next_token;
+    // The requests waiting for the computation.
+    std::vector<std::function<void(Status, PageChangePtr, std::string)>>
+        callbacks;
+  };
+
+  void OnPageChangeComputed(const Key& key,
+                            Status status,
+                            PageChangePtr page_change,
+                            std::string next_token);
+
+  storage::PageStorage* const storage_;
+  const size_t max_cached_changes_;
+  std::map<Key, CachedChange> changes_;
+  // The keys of the computed pages, from the least to the most recently
+  // computed.
+  std::list<Key> ready_keys_;
+  size_t diff_count_ = 0u;
+
+  // Must be the last member field.
+  ftl::WeakPtrFactory<PageChangeCache> weak_factory_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(PageChangeCache);
+};
+
+}  // namespace ledger
+
+#endif  // APPS_LEDGER_SRC_APP_PAGE_CHANGE_CACHE_H_
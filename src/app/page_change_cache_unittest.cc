@@ -0,0 +1,242 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/app/page_change_cache.h"
+
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "apps/ledger/src/app/fidl/serialization_size.h"
+#include "apps/ledger/src/convert/convert.h"
+#include "apps/ledger/src/storage/test/commit_random_impl.h"
+#include "apps/ledger/src/storage/test/page_storage_empty_impl.h"
+#include "gtest/gtest.h"
+#include "lib/ftl/macros.h"
+
+namespace ledger {
+namespace {
+
+// PageStorage whose diffs delete the keys "a-key" and "b-key". The diffs are
+// computed when |RunPendingDiffs| is called.
+class FakeDiffPageStorage : public storage::test::PageStorageEmptyImpl {
+ public:
+  FakeDiffPageStorage() {}
+  ~FakeDiffPageStorage() override {}
+
+  void GetCommitContentsDiff(
+      const storage::Commit& /*base_commit*/,
+      const storage::Commit& /*other_commit*/,
+      std::string min_key,
+      std::function<bool(storage::EntryChange)> on_next_diff,
+      std::function<void(storage::Status)> on_done) override {
+    pending_diffs_.push_back([
+      min_key = std::move(min_key), on_next_diff = std::move(on_next_diff),
+      on_done = std::move(on_done)
+    ] {
+      for (const std::string& key : {"a-key", "b-key"}) {
+        if (key < min_key) {
+          continue;
+        }
+        storage::EntryChange change;
+        change.entry.key = key;
+        change.entry.priority = storage::KeyPriority::EAGER;
+        change.deleted = true;
+        if (!on_next_diff(std::move(change))) {
+          break;
+        }
+      }
+      on_done(storage::Status::OK);
+    });
+  }
+
+  // Runs the pending diffs, including the ones requested while running them.
+  void RunPendingDiffs() {
+    while (!pending_diffs_.empty()) {
+      std::vector<std::function<void()>> pending_diffs;
+      pending_diffs.swap(pending_diffs_);
+      for (const auto& diff : pending_diffs) {
+        diff();
+      }
+    }
+  }
+
+ private:
+  std::vector<std::function<void()>> pending_diffs_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(FakeDiffPageStorage);
+};
+
+class PageChangeCacheTest : public ::testing::Test {
+ public:
+  PageChangeCacheTest() {}
+  ~PageChangeCacheTest() override {}
+
+ protected:
+  // Requests the page of the change from |base_| to |other_| for |prefix|
+  // starting at |min_key| and appends the deleted keys of the result to
+  // |deleted_keys|. Sets |next_token| to the start of the next page, if not
+  // null.
+  void GetPageChange(PageChangeCache* cache,
+                     std::string prefix,
+                     std::vector<std::string>* deleted_keys,
+                     std::string min_key = "",
+                     size_t max_fidl_size = std::numeric_limits<size_t>::max(),
+                     std::string* next_token = nullptr) {
+    std::vector<diff_utils::KeyRange> ranges;
+    ranges.push_back(diff_utils::GetPrefixRange(std::move(prefix)));
+    GetPageChangeInRanges(cache, std::move(ranges), deleted_keys,
+                          std::move(min_key), max_fidl_size, next_token);
+  }
+
+  // Same as |GetPageChange|, for the keys in |ranges|.
+  void GetPageChangeInRanges(
+      PageChangeCache* cache,
+      std::vector<diff_utils::KeyRange> ranges,
+      std::vector<std::string>* deleted_keys,
+      std::string min_key = "",
+      size_t max_fidl_size = std::numeric_limits<size_t>::max(),
+      std::string* next_token = nullptr) {
+    cache->GetPageChange(
+        base_, other_, std::move(ranges), std::move(min_key), max_fidl_size,
+        diff_utils::ValueOptions(),
+        [deleted_keys, next_token](Status status, PageChangePtr page_change,
+                                   std::string token) {
+          EXPECT_EQ(Status::OK, status);
+          ASSERT_TRUE(page_change);
+          for (const auto& key : page_change->deleted_keys) {
+            deleted_keys->push_back(convert::ToString(key));
+          }
+          if (next_token) {
+            *next_token = std::move(token);
+          }
+        });
+  }
+
+  FakeDiffPageStorage storage_;
+  storage::test::CommitRandomImpl base_;
+  storage::test::CommitRandomImpl other_;
+
+ private:
+  FTL_DISALLOW_COPY_AND_ASSIGN(PageChangeCacheTest);
+};
+
+TEST_F(PageChangeCacheTest, ConcurrentRequestsShareDiff) {
+  PageChangeCache cache(&storage_);
+  std::vector<std::string> deleted_keys1;
+  std::vector<std::string> deleted_keys2;
+  GetPageChange(&cache, "", &deleted_keys1);
+  GetPageChange(&cache, "", &deleted_keys2);
+  storage_.RunPendingDiffs();
+
+  EXPECT_EQ(1u, cache.diff_count());
+  EXPECT_EQ(std::vector<std::string>({"a-key", "b-key"}), deleted_keys1);
+  EXPECT_EQ(deleted_keys1, deleted_keys2);
+}
+
+TEST_F(PageChangeCacheTest, LaterRequestUsesCachedChange) {
+  PageChangeCache cache(&storage_);
+  std::vector<std::string> deleted_keys1;
+  std::vector<std::string> deleted_keys2;
+  GetPageChange(&cache, "", &deleted_keys1);
+  storage_.RunPendingDiffs();
+  GetPageChange(&cache, "", &deleted_keys2);
+
+  EXPECT_EQ(1u, cache.diff_count());
+  EXPECT_EQ(deleted_keys1, deleted_keys2);
+}
+
+TEST_F(PageChangeCacheTest, DifferentPrefixes) {
+  PageChangeCache cache(&storage_);
+  std::vector<std::string> deleted_keys1;
+  std::vector<std::string> deleted_keys2;
+  GetPageChange(&cache, "a", &deleted_keys1);
+  GetPageChange(&cache, "b", &deleted_keys2);
+  storage_.RunPendingDiffs();
+
+  EXPECT_EQ(2u, cache.diff_count());
+  EXPECT_EQ(std::vector<std::string>({"a-key"}), deleted_keys1);
+  EXPECT_EQ(std::vector<std::string>({"b-key"}), deleted_keys2);
+}
+
+TEST_F(PageChangeCacheTest, EvictLeastRecentlyComputedChange) {
+  PageChangeCache cache(&storage_, 1u);
+  std::vector<std::string> deleted_keys;
+  GetPageChange(&cache, "a", &deleted_keys);
+  storage_.RunPendingDiffs();
+  GetPageChange(&cache, "b", &deleted_keys);
+  storage_.RunPendingDiffs();
+
+  // The change for "b" is cached, the one for "a" was evicted.
+  GetPageChange(&cache, "b", &deleted_keys);
+  EXPECT_EQ(2u, cache.diff_count());
+  GetPageChange(&cache, "a", &deleted_keys);
+  storage_.RunPendingDiffs();
+  EXPECT_EQ(3u, cache.diff_count());
+  EXPECT_EQ(std::vector<std::string>({"a-key", "b-key", "b-key", "a-key"}),
+            deleted_keys);
+}
+
+TEST_F(PageChangeCacheTest, Pages) {
+  PageChangeCache cache(&storage_);
+  // Pages of a single deleted key.
+  size_t max_fidl_size = fidl_serialization::kPageChangeHeaderSize +
+                         fidl_serialization::GetByteArraySize(5);
+  std::vector<std::string> deleted_keys;
+  std::string next_token;
+  GetPageChange(&cache, "", &deleted_keys, "", max_fidl_size, &next_token);
+  storage_.RunPendingDiffs();
+  EXPECT_EQ(std::vector<std::string>({"a-key"}), deleted_keys);
+  EXPECT_EQ("b-key", next_token);
+
+  GetPageChange(&cache, "", &deleted_keys, next_token, max_fidl_size,
+                &next_token);
+  storage_.RunPendingDiffs();
+  EXPECT_EQ(std::vector<std::string>({"a-key", "b-key"}), deleted_keys);
+  EXPECT_EQ("", next_token);
+  EXPECT_EQ(2u, cache.diff_count());
+}
+
+TEST_F(PageChangeCacheTest, KeyRanges) {
+  PageChangeCache cache(&storage_);
+  std::vector<std::string> deleted_keys;
+  GetPageChangeInRanges(&cache, {{"b", ""}, {"a-key", "a-kez"}},
+                        &deleted_keys);
+  storage_.RunPendingDiffs();
+  EXPECT_EQ(std::vector<std::string>({"a-key", "b-key"}), deleted_keys);
+
+  deleted_keys.clear();
+  GetPageChangeInRanges(&cache, {{"a", "a-key"}, {"b-key", "b-kez"}},
+                        &deleted_keys);
+  storage_.RunPendingDiffs();
+  EXPECT_EQ(std::vector<std::string>({"b-key"}), deleted_keys);
+  EXPECT_EQ(2u, cache.diff_count());
+}
+
+TEST_F(PageChangeCacheTest, KeyRangesPages) {
+  PageChangeCache cache(&storage_);
+  // Pages of a single deleted key.
+  size_t max_fidl_size = fidl_serialization::kPageChangeHeaderSize +
+                         fidl_serialization::GetByteArraySize(5);
+  std::vector<diff_utils::KeyRange> ranges = {{"a-", "a-kez"},
+                                              {"b-", "b-kez"}};
+  std::vector<std::string> deleted_keys;
+  std::string next_token;
+  GetPageChangeInRanges(&cache, ranges, &deleted_keys, "", max_fidl_size,
+                        &next_token);
+  storage_.RunPendingDiffs();
+  EXPECT_EQ(std::vector<std::string>({"a-key"}), deleted_keys);
+  EXPECT_EQ("b-key", next_token);
+
+  GetPageChangeInRanges(&cache, ranges, &deleted_keys, next_token,
+                        max_fidl_size, &next_token);
+  storage_.RunPendingDiffs();
+  EXPECT_EQ(std::vector<std::string>({"a-key", "b-key"}), deleted_keys);
+  EXPECT_EQ("", next_token);
+}
+
+}  // namespace
+}  // namespace ledger
@@ -4,29 +4,34 @@
 
 #include "apps/ledger/src/app/page_delegate.h"
 
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "apps/ledger/src/app/constants.h"
+#include "apps/ledger/src/app/journal_overlay.h"
 #include "apps/ledger/src/app/page_manager.h"
 #include "apps/ledger/src/app/page_snapshot_impl.h"
 #include "apps/ledger/src/app/page_utils.h"
 #include "apps/ledger/src/convert/convert.h"
+#include "apps/ledger/src/storage/public/constants.h"
 #include "apps/tracing/lib/trace/event.h"
 #include "lib/ftl/functional/make_copyable.h"
+#include "lib/ftl/logging.h"
 #include "lib/mtl/socket/strings.h"
 
 namespace ledger {
 
-PageDelegate::PageDelegate(coroutine::CoroutineService* coroutine_service,
-                           PageManager* manager,
+PageDelegate::PageDelegate(PageManager* manager,
                            storage::PageStorage* storage,
+                           GroupCommitter* group_committer,
                            fidl::InterfaceRequest<Page> request)
     : manager_(manager),
       storage_(storage),
+      group_committer_(group_committer),
       interface_(std::move(request), this),
-      branch_tracker_(coroutine_service, manager, storage) {
+      branch_tracker_(manager, storage) {
   interface_.set_on_empty([this] {
     branch_tracker_.StopTransaction(nullptr);
     CheckEmpty();
@@ -42,35 +47,70 @@ void PageDelegate::GetId(const Page::GetIdCallback& callback) {
 }
 
 // GetSnapshot(PageSnapshot& snapshot, PageWatcher& watcher) => (Status status);
+// Watch(PageSnapshot& snapshot_request, array<uint8>? key_prefix,
+//       PageWatcher watcher, WatchOptions options) => (Status status);
 void PageDelegate::GetSnapshot(
     fidl::InterfaceRequest<PageSnapshot> snapshot_request,
     fidl::Array<uint8_t> key_prefix,
     fidl::InterfaceHandle<PageWatcher> watcher,
+    WatchOptionsPtr watch_options,
     const Page::GetSnapshotCallback& callback) {
+  auto get_snapshot = ftl::MakeCopyable([
+    this, snapshot_request = std::move(snapshot_request),
+    key_prefix = std::move(key_prefix), watcher = std::move(watcher),
+    watch_options = std::move(watch_options)
+  ](StatusCallback callback) mutable {
+    // Inside a transaction, the snapshot includes its changes.
+    std::unique_ptr<const JournalOverlay> overlay;
+    if (journal_) {
+      std::vector<storage::EntryChange> changes;
+      std::vector<storage::KeyRange> deleted_ranges;
+      storage::Status status =
+          journal_->GetContents(&changes, &deleted_ranges);
+      if (status != storage::Status::OK) {
+        callback(PageUtils::ConvertStatus(status));
+        return;
+      }
+      overlay = std::make_unique<JournalOverlay>(std::move(changes),
+                                                 std::move(deleted_ranges));
+    }
+    storage_->GetCommit(
+        GetCurrentCommitId(),
+        ftl::MakeCopyable([
+          this, snapshot_request = std::move(snapshot_request),
+          key_prefix = std::move(key_prefix), watcher = std::move(watcher),
+          watch_options = std::move(watch_options),
+          overlay = std::move(overlay), callback = std::move(callback)
+        ](storage::Status status,
+          std::unique_ptr<const storage::Commit> commit) mutable {
+          if (status != storage::Status::OK) {
+            callback(PageUtils::ConvertStatus(status));
+            return;
+          }
+          std::string prefix = convert::ToString(key_prefix);
+          if (watcher) {
+            PageWatcherPtr watcher_ptr =
+                PageWatcherPtr::Create(std::move(watcher));
+            branch_tracker_.RegisterPageWatcher(
+                std::move(watcher_ptr), commit->Clone(), prefix,
+                std::move(watch_options));
+          }
+          manager_->BindPageSnapshot(
+              std::move(commit), std::move(snapshot_request),
+              std::move(prefix), std::move(overlay));
+          callback(Status::OK);
+        }));
+  });
   auto tracked_callback = TrackCallback(std::move(callback));
-  storage_->GetCommit(
-      GetCurrentCommitId(),
-      ftl::MakeCopyable([
-        this, snapshot_request = std::move(snapshot_request),
-        key_prefix = std::move(key_prefix), watcher = std::move(watcher),
-        callback = std::move(tracked_callback)
-      ](storage::Status status,
-        std::unique_ptr<const storage::Commit> commit) mutable {
-        if (status != storage::Status::OK) {
-          callback(PageUtils::ConvertStatus(status));
-          return;
-        }
-        std::string prefix = convert::ToString(key_prefix);
-        if (watcher) {
-          PageWatcherPtr watcher_ptr =
-              PageWatcherPtr::Create(std::move(watcher));
-          branch_tracker_.RegisterPageWatcher(std::move(watcher_ptr),
-                                              commit->Clone(), prefix);
-        }
-        manager_->BindPageSnapshot(
-            std::move(commit), std::move(snapshot_request), std::move(prefix));
-        callback(Status::OK);
-      }));
+  if (!background_commits_ && !journal_) {
+    get_snapshot(std::move(tracked_callback));
+    return;
+  }
+  // Some acknowledged changes are not committed yet, or changes are being
+  // added to the current transaction: wait for the operations in progress so
+  // that the snapshot includes them.
+  operation_serializer_.Serialize(std::move(tracked_callback),
+                                  std::move(get_snapshot));
 }
 
 // Put(array<uint8> key, array<uint8> value) => (Status status);
@@ -89,20 +129,25 @@ void PageDelegate::PutWithPriority(
     Priority priority,
     const Page::PutWithPriorityCallback& callback) {
   auto tracked_callback = TrackCallback(std::move(callback));
+  // The value is written while the previous operations are in progress, but
+  // the change keeps its place in the order of operations.
+  OperationSlot slot = operation_serializer_.ReserveSlot();
   // TODO(etiennej): Use asynchronous write, otherwise the run loop may block
   // until the socket is drained.
   mx::socket socket = mtl::WriteStringToSocket(convert::ToStringView(value));
   storage_->AddObjectFromLocal(
       std::move(socket), value.size(), ftl::MakeCopyable([
-        this, key = std::move(key), priority,
+        this, key = std::move(key), priority, slot = std::move(slot),
         callback = std::move(tracked_callback)
       ](storage::Status status, storage::ObjectId object_id) mutable {
         if (status != storage::Status::OK) {
-          callback(PageUtils::ConvertStatus(status));
+          slot(std::move(callback), [status](StatusCallback callback) {
+            callback(PageUtils::ConvertStatus(status));
+          });
           return;
         }
 
-        PutInCommit(std::move(key), std::move(object_id),
+        PutInCommit(std::move(slot), std::move(key), std::move(object_id),
                     priority == Priority::EAGER ? storage::KeyPriority::EAGER
                                                 : storage::KeyPriority::LAZY,
                     std::move(callback));
@@ -116,20 +161,23 @@ void PageDelegate::PutReference(fidl::Array<uint8_t> key,
                                 Priority priority,
                                 const Page::PutReferenceCallback& callback) {
   auto tracked_callback = TrackCallback(std::move(callback));
+  OperationSlot slot = operation_serializer_.ReserveSlot();
   storage::ObjectIdView object_id(reference->opaque_id);
   storage_->GetObject(
       object_id, storage::PageStorage::Location::LOCAL,
       ftl::MakeCopyable([
         this, key = std::move(key), object_id = object_id.ToString(), priority,
-        callback = std::move(tracked_callback)
+        slot = std::move(slot), callback = std::move(tracked_callback)
       ](storage::Status status,
         std::unique_ptr<const storage::Object> object) mutable {
         if (status != storage::Status::OK) {
-          callback(
-              PageUtils::ConvertStatus(status, Status::REFERENCE_NOT_FOUND));
+          slot(std::move(callback), [status](StatusCallback callback) {
+            callback(
+                PageUtils::ConvertStatus(status, Status::REFERENCE_NOT_FOUND));
+          });
           return;
         }
-        PutInCommit(std::move(key), std::move(object_id),
+        PutInCommit(std::move(slot), std::move(key), std::move(object_id),
                     priority == Priority::EAGER ? storage::KeyPriority::EAGER
                                                 : storage::KeyPriority::LAZY,
                     std::move(callback));
@@ -148,6 +196,53 @@ void PageDelegate::Delete(fidl::Array<uint8_t> key,
                    std::move(callback));
 }
 
+// DeleteRange(array<uint8>? key_start, array<uint8>? key_end)
+//   => (Status status);
+void PageDelegate::DeleteRange(fidl::Array<uint8_t> key_start,
+                               fidl::Array<uint8_t> key_end,
+                               const Page::DeleteRangeCallback& callback) {
+  std::string min_key = key_start ? convert::ToString(key_start) : "";
+  if (key_end && convert::ToString(key_end) <= min_key) {
+    callback(Status::INVALID_ARGUMENT);
+    return;
+  }
+  DeleteRangeInCommit(std::move(min_key),
+                      key_end ? convert::ToString(key_end) : "",
+                      std::move(callback));
+}
+
+// DeletePrefix(array<uint8> prefix) => (Status status);
+void PageDelegate::DeletePrefix(fidl::Array<uint8_t> prefix,
+                                const Page::DeletePrefixCallback& callback) {
+  std::string min_key = convert::ToString(prefix);
+  std::string max_key = PageUtils::GetPrefixEnd(min_key);
+  DeleteRangeInCommit(std::move(min_key), std::move(max_key),
+                      std::move(callback));
+}
+
+// SetFanout(uint8 fanout_bits) => (Status status);
+void PageDelegate::SetFanout(uint8_t fanout_bits,
+                             const Page::SetFanoutCallback& callback) {
+  if (fanout_bits < storage::kMinFanoutBits ||
+      fanout_bits > storage::kMaxFanoutBits) {
+    callback(Status::INVALID_ARGUMENT);
+    return;
+  }
+  RunInTransaction(
+      [fanout_bits](storage::Journal* journal) {
+        return PageUtils::ConvertStatus(journal->SetFanout(fanout_bits));
+      },
+      std::move(callback));
+}
+
+// SetOptimisticCommits(bool enabled) => (Status status);
+void PageDelegate::SetOptimisticCommits(
+    bool enabled,
+    const Page::SetOptimisticCommitsCallback& callback) {
+  optimistic_commits_ = enabled;
+  callback(Status::OK);
+}
+
 // CreateReference(uint64 size, handle<socket> data)
 //   => (Status status, Reference reference);
 void PageDelegate::CreateReference(
@@ -228,6 +323,8 @@ void PageDelegate::Rollback(const Page::RollbackCallback& callback) {
 
 const storage::CommitId& PageDelegate::GetCurrentCommitId() {
   // TODO(etiennej): Commit implicit transactions when we have those.
+  // Inside a transaction, snapshots add the changes of |journal_| on top of
+  // its parent commit.
   if (!journal_) {
     return branch_tracker_.GetBranchHeadId();
   } else {
@@ -235,12 +332,13 @@ const storage::CommitId& PageDelegate::GetCurrentCommitId() {
   }
 }
 
-void PageDelegate::PutInCommit(fidl::Array<uint8_t> key,
+void PageDelegate::PutInCommit(OperationSlot slot,
+                               fidl::Array<uint8_t> key,
                                storage::ObjectId object_id,
                                storage::KeyPriority priority,
                                std::function<void(Status)> callback) {
   RunInTransaction(
-      ftl::MakeCopyable([
+      std::move(slot), ftl::MakeCopyable([
         key = std::move(key), object_id = std::move(object_id), priority
       ](storage::Journal * journal) mutable {
         return PageUtils::ConvertStatus(
@@ -249,48 +347,86 @@ void PageDelegate::PutInCommit(fidl::Array<uint8_t> key,
       std::move(callback));
 }
 
+void PageDelegate::DeleteRangeInCommit(std::string min_key,
+                                       std::string max_key,
+                                       StatusCallback callback) {
+  RunInTransaction(
+      ftl::MakeCopyable([
+        min_key = std::move(min_key), max_key = std::move(max_key)
+      ](storage::Journal * journal) {
+        return PageUtils::ConvertStatus(journal->DeleteRange(min_key, max_key));
+      }),
+      std::move(callback));
+}
+
 void PageDelegate::RunInTransaction(
     std::function<Status(storage::Journal* journal)> runnable,
     std::function<void(Status)> callback) {
-  operation_serializer_.Serialize(
-      std::move(callback),
-      [ this, runnable = std::move(runnable) ](StatusCallback callback) {
+  RunInTransaction(operation_serializer_.ReserveSlot(), std::move(runnable),
+                   std::move(callback));
+}
+
+void PageDelegate::RunInTransaction(
+    OperationSlot slot,
+    std::function<Status(storage::Journal* journal)> runnable,
+    std::function<void(Status)> callback) {
+  // With optimistic commits, |callback| may be called before the operation
+  // terminates. It is then reset so that it is not called a second time.
+  auto client_callback = std::make_shared<StatusCallback>(std::move(callback));
+  slot(
+      [client_callback](Status status) {
+        if (*client_callback) {
+          (*client_callback)(status);
+        }
+      },
+      [ this, runnable = std::move(runnable),
+        client_callback ](StatusCallback callback) {
         if (journal_) {
           // A transaction is in progress; add this change to it.
           callback(runnable(journal_.get()));
           return;
         }
-        // No transaction is in progress; create one just for this change.
-        // TODO(etiennej): Add a change batching strategy for operations outside
-        // transactions. Currently, we create a commit for every change; we
-        // would like to group changes that happen "close enough" together in
-        // one commit.
+        // No transaction is in progress; the change is grouped with the ones
+        // made at the same time on the other connections to the page.
         branch_tracker_.StartTransaction([] {});
-        storage::CommitId commit_id = branch_tracker_.GetBranchHeadId();
-        std::unique_ptr<storage::Journal> journal;
-        storage::Status status = storage_->StartCommit(
-            commit_id, storage::JournalType::IMPLICIT, &journal);
-        if (status != storage::Status::OK) {
-          callback(PageUtils::ConvertStatus(status));
-          journal->Rollback();
-          branch_tracker_.StopTransaction(nullptr);
-          return;
+        if (optimistic_commits_) {
+          ++background_commits_;
+          callback = TrackCallback([
+            this, client_callback, callback = std::move(callback)
+          ](Status status) {
+            --background_commits_;
+            if (status != Status::OK && !*client_callback) {
+              FTL_LOG(ERROR) << "Unable to commit an acknowledged change: "
+                             << status;
+            }
+            callback(status);
+          });
         }
-        Status ledger_status = runnable(journal.get());
-        if (ledger_status != Status::OK) {
-          callback(ledger_status);
-          journal->Rollback();
-          branch_tracker_.StopTransaction(nullptr);
-          return;
-        }
-
-        CommitJournal(std::move(journal), [
-          this, callback = std::move(callback)
-        ](Status status, std::unique_ptr<const storage::Commit> commit) {
-          branch_tracker_.StopTransaction(
-              status == Status::OK ? std::move(commit) : nullptr);
-          callback(status);
-        });
+        group_committer_->AddChange(
+            branch_tracker_.GetBranchHeadId(),
+            [
+              optimistic_commits = optimistic_commits_,
+              runnable = std::move(runnable), client_callback
+            ](storage::Journal * journal) {
+              Status status = runnable(journal);
+              if (status == Status::OK && optimistic_commits) {
+                // The change is persisted in the implicit journal, which is
+                // committed when the page storage is next initialized if the
+                // group commit does not complete. Acknowledge it now; the
+                // operation still terminates only once the commit is created,
+                // so that the following ones see it.
+                StatusCallback on_acknowledged = std::move(*client_callback);
+                *client_callback = nullptr;
+                on_acknowledged(Status::OK);
+              }
+              return status;
+            },
+            [ this, callback = std::move(callback) ](
+                Status status, std::unique_ptr<const storage::Commit> commit) {
+              branch_tracker_.StopTransaction(
+                  status == Status::OK ? std::move(commit) : nullptr);
+              callback(status);
+            });
       });
 }
 
@@ -13,6 +13,7 @@
 #include "apps/ledger/services/public/ledger.fidl.h"
 #include "apps/ledger/src/app/branch_tracker.h"
 #include "apps/ledger/src/app/fidl/bound_interface.h"
+#include "apps/ledger/src/app/group_committer.h"
 #include "apps/ledger/src/app/page_impl.h"
 #include "apps/ledger/src/callback/operation_serializer.h"
 #include "apps/ledger/src/storage/public/journal.h"
@@ -32,9 +33,9 @@ class PageManager;
 // |set_on_empty()|).
 class PageDelegate {
  public:
-  PageDelegate(coroutine::CoroutineService* coroutine_service,
-               PageManager* manager,
+  PageDelegate(PageManager* manager,
                storage::PageStorage* storage,
+               GroupCommitter* group_committer,
                fidl::InterfaceRequest<Page> request);
   ~PageDelegate();
 
@@ -48,6 +49,7 @@ class PageDelegate {
   void GetSnapshot(fidl::InterfaceRequest<PageSnapshot> snapshot_request,
                    fidl::Array<uint8_t> key_prefix,
                    fidl::InterfaceHandle<PageWatcher> watcher,
+                   WatchOptionsPtr watch_options,
                    const Page::GetSnapshotCallback& callback);
 
   void Put(fidl::Array<uint8_t> key,
@@ -66,6 +68,19 @@ class PageDelegate {
 
   void Delete(fidl::Array<uint8_t> key, const Page::DeleteCallback& callback);
 
+  void DeleteRange(fidl::Array<uint8_t> key_start,
+                   fidl::Array<uint8_t> key_end,
+                   const Page::DeleteRangeCallback& callback);
+
+  void DeletePrefix(fidl::Array<uint8_t> prefix,
+                    const Page::DeletePrefixCallback& callback);
+
+  void SetFanout(uint8_t fanout_bits, const Page::SetFanoutCallback& callback);
+
+  void SetOptimisticCommits(
+      bool enabled,
+      const Page::SetOptimisticCommitsCallback& callback);
+
   void CreateReference(uint64_t size,
                        mx::socket data,
                        const Page::CreateReferenceCallback& callback);
@@ -78,18 +93,37 @@ class PageDelegate {
 
  private:
   using StatusCallback = std::function<void(Status)>;
+  using OperationSlot = callback::OperationSerializer<Status>::Slot;
 
   const storage::CommitId& GetCurrentCommitId();
 
-  void PutInCommit(fidl::Array<uint8_t> key,
+  // Puts |key| in a transaction, taking the place of |slot| in the order of
+  // operations.
+  void PutInCommit(OperationSlot slot,
+                   fidl::Array<uint8_t> key,
                    storage::ObjectId value,
                    storage::KeyPriority priority,
                    StatusCallback callback);
 
+  // Deletes the keys in [|min_key|, |max_key|) in a transaction. An empty
+  // |max_key| extends the range to the end of the key space.
+  void DeleteRangeInCommit(std::string min_key,
+                           std::string max_key,
+                           StatusCallback callback);
+
   // Run |runnable| in a transaction, and notifies |callback| of the result. If
-  // a transaction is currently in progress, reuses it, otherwise creates a new
-  // one and commit it before calling |callback|.
+  // a transaction is currently in progress, reuses it, otherwise runs it in the
+  // next commit of |group_committer_| before calling |callback|. If
+  // |optimistic_commits_| is set, |callback| is called as soon as |runnable|
+  // succeeds, and the group commit is created in the background.
+  void RunInTransaction(
+      std::function<Status(storage::Journal* journal)> runnable,
+      StatusCallback callback);
+
+  // Same as above, but runs |runnable| in the place of |slot| in the order of
+  // operations.
   void RunInTransaction(
+      OperationSlot slot,
       std::function<Status(storage::Journal* journal)> runnable,
       StatusCallback callback);
 
@@ -115,6 +149,7 @@ class PageDelegate {
 
   PageManager* manager_;
   storage::PageStorage* storage_;
+  GroupCommitter* group_committer_;
 
   BoundInterface<Page, PageImpl> interface_;
   BranchTracker branch_tracker_;
@@ -125,6 +160,10 @@ class PageDelegate {
   std::unique_ptr<storage::Journal> journal_;
   callback::OperationSerializer<Status> operation_serializer_;
   std::vector<std::unique_ptr<storage::Journal>> in_progress_journals_;
+  bool optimistic_commits_ = false;
+  // Number of implicit changes acknowledged to the client and still being
+  // committed. Snapshots are not taken until they are all committed.
+  int background_commits_ = 0;
   // |storage_| might outlive this PageDelegate, so asynchronous operations on
   // PageStorage that capture |this| could fail while executing the callback.
   // |in_progress_storage_operations_| keeps track of such operations that have
@@ -31,7 +31,22 @@ void PageImpl::GetSnapshot(
   auto timed_callback =
       TRACE_CALLBACK(std::move(callback), "ledger", "page_get_snapshot");
   delegate_->GetSnapshot(std::move(snapshot_request), std::move(key_prefix),
-                         std::move(watcher), std::move(timed_callback));
+                         std::move(watcher), WatchOptions::New(),
+                         std::move(timed_callback));
+}
+
+// Watch(PageSnapshot& snapshot_request, array<uint8>? key_prefix,
+//       PageWatcher watcher, WatchOptions options) => (Status status);
+void PageImpl::Watch(fidl::InterfaceRequest<PageSnapshot> snapshot_request,
+                     fidl::Array<uint8_t> key_prefix,
+                     fidl::InterfaceHandle<PageWatcher> watcher,
+                     WatchOptionsPtr options,
+                     const WatchCallback& callback) {
+  auto timed_callback =
+      TRACE_CALLBACK(std::move(callback), "ledger", "page_watch");
+  delegate_->GetSnapshot(std::move(snapshot_request), std::move(key_prefix),
+                         std::move(watcher), std::move(options),
+                         std::move(timed_callback));
 }
 
 // Put(array<uint8> key, array<uint8> value) => (Status status);
@@ -73,6 +88,42 @@ void PageImpl::Delete(fidl::Array<uint8_t> key,
   delegate_->Delete(std::move(key), std::move(timed_callback));
 }
 
+// DeleteRange(array<uint8>? key_start, array<uint8>? key_end)
+//   => (Status status);
+void PageImpl::DeleteRange(fidl::Array<uint8_t> key_start,
+                           fidl::Array<uint8_t> key_end,
+                           const DeleteRangeCallback& callback) {
+  auto timed_callback =
+      TRACE_CALLBACK(std::move(callback), "ledger", "page_delete_range");
+  delegate_->DeleteRange(std::move(key_start), std::move(key_end),
+                         std::move(timed_callback));
+}
+
+// DeletePrefix(array<uint8> prefix) => (Status status);
+void PageImpl::DeletePrefix(fidl::Array<uint8_t> prefix,
+                            const DeletePrefixCallback& callback) {
+  auto timed_callback =
+      TRACE_CALLBACK(std::move(callback), "ledger", "page_delete_prefix");
+  delegate_->DeletePrefix(std::move(prefix), std::move(timed_callback));
+}
+
+// SetFanout(uint8 fanout_bits) => (Status status);
+void PageImpl::SetFanout(uint8_t fanout_bits,
+                         const SetFanoutCallback& callback) {
+  auto timed_callback =
+      TRACE_CALLBACK(std::move(callback), "ledger", "page_set_fanout");
+  delegate_->SetFanout(fanout_bits, std::move(timed_callback));
+}
+
+// SetOptimisticCommits(bool enabled) => (Status status);
+void PageImpl::SetOptimisticCommits(
+    bool enabled,
+    const SetOptimisticCommitsCallback& callback) {
+  auto timed_callback = TRACE_CALLBACK(std::move(callback), "ledger",
+                                       "page_set_optimistic_commits");
+  delegate_->SetOptimisticCommits(enabled, std::move(timed_callback));
+}
+
 // CreateReference(uint64 size, handle<socket> data)
 //   => (Status status, Reference reference);
 void PageImpl::CreateReference(uint64_t size,
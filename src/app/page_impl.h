@@ -26,6 +26,12 @@ class PageImpl : public Page {
                    fidl::InterfaceHandle<PageWatcher> watcher,
                    const GetSnapshotCallback& callback) override;
 
+  void Watch(fidl::InterfaceRequest<PageSnapshot> snapshot_request,
+             fidl::Array<uint8_t> key_prefix,
+             fidl::InterfaceHandle<PageWatcher> watcher,
+             WatchOptionsPtr options,
+             const WatchCallback& callback) override;
+
   void Put(fidl::Array<uint8_t> key,
            fidl::Array<uint8_t> value,
            const PutCallback& callback) override;
@@ -43,6 +49,20 @@ class PageImpl : public Page {
   void Delete(fidl::Array<uint8_t> key,
               const DeleteCallback& callback) override;
 
+  void DeleteRange(fidl::Array<uint8_t> key_start,
+                   fidl::Array<uint8_t> key_end,
+                   const DeleteRangeCallback& callback) override;
+
+  void DeletePrefix(fidl::Array<uint8_t> prefix,
+                    const DeletePrefixCallback& callback) override;
+
+  void SetFanout(uint8_t fanout_bits,
+                 const SetFanoutCallback& callback) override;
+
+  void SetOptimisticCommits(
+      bool enabled,
+      const SetOptimisticCommitsCallback& callback) override;
+
   void CreateReference(uint64_t size,
                        mx::socket data,
                        const CreateReferenceCallback& callback) override;
@@ -8,6 +8,7 @@
 #include <memory>
 
 #include "apps/ledger/src/app/constants.h"
+#include "apps/ledger/src/app/fidl/packed_entries.h"
 #include "apps/ledger/src/app/fidl/serialization_size.h"
 #include "apps/ledger/src/app/merging/merge_resolver.h"
 #include "apps/ledger/src/app/page_manager.h"
@@ -597,6 +598,82 @@ TEST_F(PageImplTest, PutGetSnapshotGetEntriesWithFetch) {
   EXPECT_EQ(Priority::LAZY, actual_entries[1]->priority);
 }
 
+TEST_F(PageImplTest, PutGetSnapshotGetEntriesPacked) {
+  std::string eager_key("a_key");
+  std::string eager_value("an eager value");
+  std::string lazy_key("another_key");
+  std::string lazy_value("a lazy value");
+  std::string other_key("yet_another_key");
+  std::string other_value("another eager value");
+
+  auto callback_statusok = [this](Status status) {
+    EXPECT_EQ(Status::OK, status);
+    message_loop_.PostQuitTask();
+  };
+
+  page_ptr_->PutWithPriority(convert::ToArray(lazy_key),
+                             convert::ToArray(lazy_value), Priority::LAZY,
+                             callback_statusok);
+  EXPECT_FALSE(RunLoopWithTimeout());
+  storage::ObjectId lazy_object_id = fake_storage_->GetObjects().begin()->first;
+
+  page_ptr_->Put(convert::ToArray(eager_key), convert::ToArray(eager_value),
+                 callback_statusok);
+  EXPECT_FALSE(RunLoopWithTimeout());
+  page_ptr_->Put(convert::ToArray(other_key), convert::ToArray(other_value),
+                 callback_statusok);
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  fake_storage_->DeleteObjectFromLocal(lazy_object_id);
+
+  PageSnapshotPtr snapshot = GetSnapshot();
+
+  PackedEntriesPtr actual_entries;
+  snapshot->GetEntriesPacked(
+      nullptr, nullptr,
+      [this, &actual_entries](Status status, PackedEntriesPtr entries,
+                              fidl::Array<uint8_t> next_token) {
+        EXPECT_EQ(Status::OK, status);
+        EXPECT_TRUE(next_token.is_null());
+        actual_entries = std::move(entries);
+        message_loop_.PostQuitTask();
+      });
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  ASSERT_TRUE(actual_entries);
+  ASSERT_EQ(3u, actual_entries->entries.size());
+  std::string values = ToString(actual_entries->values);
+  EXPECT_EQ(eager_value.size() + other_value.size(), values.size());
+
+  const PackedEntryPtr& eager_entry = actual_entries->entries[0];
+  EXPECT_EQ(eager_key, convert::ExtendedStringView(eager_entry->key));
+  EXPECT_TRUE(eager_entry->has_value);
+  EXPECT_EQ(eager_value, values.substr(eager_entry->value_offset,
+                                       eager_entry->value_size));
+  EXPECT_EQ(Priority::EAGER, eager_entry->priority);
+
+  const PackedEntryPtr& lazy_entry = actual_entries->entries[1];
+  EXPECT_EQ(lazy_key, convert::ExtendedStringView(lazy_entry->key));
+  EXPECT_FALSE(lazy_entry->has_value);
+  EXPECT_EQ(Priority::LAZY, lazy_entry->priority);
+
+  const PackedEntryPtr& other_entry = actual_entries->entries[2];
+  EXPECT_EQ(other_key, convert::ExtendedStringView(other_entry->key));
+  EXPECT_TRUE(other_entry->has_value);
+  EXPECT_EQ(other_value, values.substr(other_entry->value_offset,
+                                       other_entry->value_size));
+
+  // The packed entries can be converted back to entries.
+  fidl::Array<EntryPtr> entries;
+  ASSERT_TRUE(UnpackEntries(*actual_entries, &entries));
+  ASSERT_EQ(3u, entries.size());
+  EXPECT_EQ(eager_key, convert::ExtendedStringView(entries[0]->key));
+  EXPECT_EQ(eager_value, ToString(entries[0]->value));
+  EXPECT_FALSE(entries[1]->value);
+  EXPECT_EQ(Priority::LAZY, entries[1]->priority);
+  EXPECT_EQ(other_value, ToString(entries[2]->value));
+}
+
 TEST_F(PageImplTest, PutGetSnapshotGetEntriesWithPrefix) {
   std::string eager_key("001-a_key");
   std::string eager_value("an eager value");
@@ -774,6 +851,44 @@ TEST_F(PageImplTest, PutGetSnapshotGetKeysWithToken) {
   }
 }
 
+TEST_F(PageImplTest, PutGetSnapshotGetKeysWithSameTokenTwice) {
+  AddEntries(200);
+  PageSnapshotPtr snapshot = GetSnapshot();
+
+  Status status;
+  fidl::Array<fidl::Array<uint8_t>> first_page;
+  fidl::Array<uint8_t> next_token;
+  snapshot->GetKeys(
+      nullptr, nullptr,
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &first_page, &next_token));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::PARTIAL_RESULT, status);
+  ASSERT_FALSE(next_token.is_null());
+
+  // The first call resumes the interrupted iteration, the second one looks up
+  // the token again: both return the same keys.
+  fidl::Array<fidl::Array<uint8_t>> second_pages[2];
+  for (auto& second_page : second_pages) {
+    fidl::Array<uint8_t> last_token;
+    snapshot->GetKeys(
+        nullptr, next_token.Clone(),
+        callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                          &second_page, &last_token));
+    EXPECT_FALSE(RunLoopWithTimeout());
+    EXPECT_EQ(Status::OK, status);
+    EXPECT_TRUE(last_token.is_null());
+  }
+  EXPECT_EQ(200u, first_page.size() + second_pages[0].size());
+  ASSERT_EQ(second_pages[0].size(), second_pages[1].size());
+  for (size_t i = 0; i < second_pages[0].size(); ++i) {
+    EXPECT_EQ(convert::ToString(second_pages[0][i]),
+              convert::ToString(second_pages[1][i]));
+  }
+  EXPECT_EQ(convert::ToString(next_token),
+            convert::ToString(second_pages[0][0]));
+}
+
 TEST_F(PageImplTest, PutGetSnapshotGetKeysWithPrefix) {
   std::string key1("001-some_key");
   std::string value1("a small value");
@@ -870,6 +985,58 @@ TEST_F(PageImplTest, PutGetSnapshotGetKeysWithStart) {
   EXPECT_EQ(key2, convert::ExtendedStringView(actual_keys[1]));
 }
 
+TEST_F(PageImplTest, PutGetSnapshotGetKeysInRange) {
+  std::vector<std::string> keys = {"001-key", "002-key", "003-key", "004-key"};
+
+  auto callback_statusok = [this](Status status) {
+    EXPECT_EQ(Status::OK, status);
+    message_loop_.PostQuitTask();
+  };
+  page_ptr_->StartTransaction(callback_statusok);
+  EXPECT_FALSE(RunLoopWithTimeout());
+  for (const auto& key : keys) {
+    page_ptr_->Put(convert::ToArray(key), convert::ToArray("value"),
+                   callback_statusok);
+    EXPECT_FALSE(RunLoopWithTimeout());
+  }
+  page_ptr_->Commit(callback_statusok);
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  PageSnapshotPtr snapshot = GetSnapshot();
+
+  fidl::Array<fidl::Array<uint8_t>> actual_keys;
+  auto callback_getkeys = [this, &actual_keys](
+                              Status status,
+                              fidl::Array<fidl::Array<uint8_t>> keys,
+                              fidl::Array<uint8_t> next_token) {
+    EXPECT_EQ(Status::OK, status);
+    EXPECT_TRUE(next_token.is_null());
+    actual_keys = std::move(keys);
+    message_loop_.PostQuitTask();
+  };
+  snapshot->GetKeysInRange(convert::ToArray("002"), convert::ToArray("004"),
+                           0u, false, nullptr, callback_getkeys);
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  ASSERT_EQ(2u, actual_keys.size());
+  EXPECT_EQ(keys[1], convert::ExtendedStringView(actual_keys[0]));
+  EXPECT_EQ(keys[2], convert::ExtendedStringView(actual_keys[1]));
+
+  snapshot->GetKeysInRange(nullptr, convert::ToArray("004"), 2u, true, nullptr,
+                           callback_getkeys);
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  ASSERT_EQ(2u, actual_keys.size());
+  EXPECT_EQ(keys[2], convert::ExtendedStringView(actual_keys[0]));
+  EXPECT_EQ(keys[1], convert::ExtendedStringView(actual_keys[1]));
+
+  snapshot->GetKeysInRange(convert::ToArray("003"), convert::ToArray("002"),
+                           0u, false, nullptr, callback_getkeys);
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  EXPECT_EQ(0u, actual_keys.size());
+}
+
 TEST_F(PageImplTest, SnapshotGetSmall) {
   std::string key("some_key");
   std::string value("a small value");
@@ -976,6 +1143,75 @@ TEST_F(PageImplTest, SnapshotFetchPartial) {
   EXPECT_EQ("small", content);
 }
 
+TEST_F(PageImplTest, TransactionGetSnapshotReadsOwnChanges) {
+  AddEntries(3);
+
+  auto callback_statusok = [this](Status status) {
+    EXPECT_EQ(Status::OK, status);
+    message_loop_.PostQuitTask();
+  };
+  page_ptr_->StartTransaction(callback_statusok);
+  EXPECT_FALSE(RunLoopWithTimeout());
+  page_ptr_->Delete(convert::ToArray("key 0000"), callback_statusok);
+  EXPECT_FALSE(RunLoopWithTimeout());
+  page_ptr_->Put(convert::ToArray("key 0001"), convert::ToArray("new value"),
+                 callback_statusok);
+  EXPECT_FALSE(RunLoopWithTimeout());
+  page_ptr_->Put(convert::ToArray("key 0005"), convert::ToArray("val 0005"),
+                 callback_statusok);
+  EXPECT_FALSE(RunLoopWithTimeout());
+  PageSnapshotPtr snapshot = GetSnapshot();
+
+  fidl::Array<fidl::Array<uint8_t>> actual_keys;
+  snapshot->GetKeys(
+      nullptr, nullptr,
+      [this, &actual_keys](Status status,
+                           fidl::Array<fidl::Array<uint8_t>> keys,
+                           fidl::Array<uint8_t> next_token) {
+        EXPECT_EQ(Status::OK, status);
+        EXPECT_TRUE(next_token.is_null());
+        actual_keys = std::move(keys);
+        message_loop_.PostQuitTask();
+      });
+  EXPECT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(3u, actual_keys.size());
+  EXPECT_EQ("key 0001", convert::ToString(actual_keys[0]));
+  EXPECT_EQ("key 0002", convert::ToString(actual_keys[1]));
+  EXPECT_EQ("key 0005", convert::ToString(actual_keys[2]));
+
+  std::string actual_value;
+  snapshot->Get(convert::ToArray("key 0001"),
+                [this, &actual_value](Status status, mx::vmo returned_value) {
+                  EXPECT_EQ(Status::OK, status);
+                  actual_value = ToString(returned_value);
+                  message_loop_.PostQuitTask();
+                });
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ("new value", actual_value);
+
+  Status get_status;
+  snapshot->Get(convert::ToArray("key 0000"),
+                [this, &get_status](Status status, mx::vmo returned_value) {
+                  get_status = status;
+                  message_loop_.PostQuitTask();
+                });
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::KEY_NOT_FOUND, get_status);
+
+  uint64_t count;
+  snapshot->Count(nullptr, nullptr,
+                  [this, &count](Status status, uint64_t result) {
+                    EXPECT_EQ(Status::OK, status);
+                    count = result;
+                    message_loop_.PostQuitTask();
+                  });
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(3u, count);
+
+  page_ptr_->Rollback(callback_statusok);
+  EXPECT_FALSE(RunLoopWithTimeout());
+}
+
 TEST_F(PageImplTest, ParallelPut) {
   PagePtr page_ptr2;
   manager_->BindPage(page_ptr2.NewRequest());
@@ -1096,5 +1332,99 @@ TEST_F(PageImplTest, SerializedOperations) {
   EXPECT_FALSE(RunLoopWithTimeout());
 }
 
+TEST_F(PageImplTest, GroupCommit) {
+  fake_storage_->set_autocommit(false);
+  PagePtr page_ptr2;
+  manager_->BindPage(page_ptr2.NewRequest());
+  PagePtr page_ptr3;
+  manager_->BindPage(page_ptr3.NewRequest());
+
+  int done_count = 0;
+  int expected_done_count = 1;
+  auto callback_done = [this, &done_count,
+                        &expected_done_count](Status status) {
+    EXPECT_EQ(Status::OK, status);
+    ++done_count;
+    if (done_count == expected_done_count) {
+      message_loop_.PostQuitTask();
+    }
+  };
+  page_ptr_->Put(convert::ToArray("key1"), convert::ToArray("value1"),
+                 callback_done);
+  page_ptr2->Put(convert::ToArray("key2"), convert::ToArray("value2"),
+                 callback_done);
+  page_ptr3->Put(convert::ToArray("key3"), convert::ToArray("value3"),
+                 callback_done);
+
+  // The first change is committed alone, the others wait for its commit.
+  EXPECT_TRUE(RunLoopWithTimeout(ftl::TimeDelta::FromMilliseconds(20)));
+  ASSERT_EQ(1u, fake_storage_->GetJournals().size());
+  CommitFirstPendingJournal(fake_storage_->GetJournals());
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(1, done_count);
+
+  // The two other changes are grouped in a single commit, based on the first
+  // one.
+  ASSERT_EQ(2u, fake_storage_->GetJournals().size());
+  const storage::fake::FakeJournalDelegate* first_journal = nullptr;
+  const storage::fake::FakeJournalDelegate* second_journal = nullptr;
+  for (const auto& journal : fake_storage_->GetJournals()) {
+    if (journal.second->IsCommitted()) {
+      first_journal = journal.second.get();
+    } else {
+      second_journal = journal.second.get();
+    }
+  }
+  ASSERT_TRUE(first_journal);
+  ASSERT_TRUE(second_journal);
+  EXPECT_EQ(2u, second_journal->GetData().size());
+  EXPECT_EQ(first_journal->GetId(), second_journal->GetParentId());
+
+  expected_done_count = 3;
+  CommitFirstPendingJournal(fake_storage_->GetJournals());
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(3, done_count);
+}
+
+TEST_F(PageImplTest, OptimisticCommits) {
+  fake_storage_->set_autocommit(false);
+
+  std::string key("some_key");
+  std::string value("a value");
+
+  auto callback_simple = [this](Status status) {
+    EXPECT_EQ(Status::OK, status);
+    message_loop_.PostQuitTask();
+  };
+  page_ptr_->SetOptimisticCommits(true, callback_simple);
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  // The put is acknowledged before its journal is committed.
+  page_ptr_->Put(convert::ToArray(key), convert::ToArray(value),
+                 callback_simple);
+  EXPECT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(1u, fake_storage_->GetJournals().size());
+  EXPECT_FALSE(fake_storage_->GetJournals().begin()->second->IsCommitted());
+
+  // Taking a snapshot waits for the commit.
+  PageSnapshotPtr snapshot;
+  page_ptr_->GetSnapshot(snapshot.NewRequest(), nullptr, nullptr,
+                         callback_simple);
+  EXPECT_TRUE(RunLoopWithTimeout(ftl::TimeDelta::FromMilliseconds(20)));
+
+  CommitFirstPendingJournal(fake_storage_->GetJournals());
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  std::string actual_value;
+  snapshot->Get(convert::ToArray(key),
+                [this, &actual_value](Status status, mx::vmo returned_value) {
+                  EXPECT_EQ(Status::OK, status);
+                  actual_value = ToString(returned_value);
+                  message_loop_.PostQuitTask();
+                });
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(value, actual_value);
+}
+
 }  // namespace
 }  // namespace ledger
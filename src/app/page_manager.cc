@@ -22,6 +22,9 @@ PageManager::PageManager(
       page_sync_context_(std::move(page_sync_context)),
       merge_resolver_(std::move(merge_resolver)),
       sync_timeout_(sync_timeout),
+      page_change_cache_(page_storage_.get()),
+      value_cache_(page_storage_.get()),
+      group_committer_(page_storage_.get()),
       weak_factory_(this) {
   pages_.set_on_empty([this] { CheckEmpty(); });
   snapshots_.set_on_empty([this] { CheckEmpty(); });
@@ -53,7 +56,7 @@ PageManager::~PageManager() {}
 
 void PageManager::BindPage(fidl::InterfaceRequest<Page> page_request) {
   if (sync_backlog_downloaded_) {
-    pages_.emplace(environment_->coroutine_service(), this, page_storage_.get(),
+    pages_.emplace(this, page_storage_.get(), &group_committer_,
                    std::move(page_request));
   } else {
     page_requests_.push_back(std::move(page_request));
@@ -63,9 +66,11 @@ void PageManager::BindPage(fidl::InterfaceRequest<Page> page_request) {
 void PageManager::BindPageSnapshot(
     std::unique_ptr<const storage::Commit> commit,
     fidl::InterfaceRequest<PageSnapshot> snapshot_request,
-    std::string key_prefix) {
+    std::string key_prefix,
+    std::unique_ptr<const JournalOverlay> overlay) {
   snapshots_.emplace(std::move(snapshot_request), page_storage_.get(),
-                     std::move(commit), std::move(key_prefix));
+                     &value_cache_, std::move(commit), std::move(key_prefix),
+                     std::move(overlay));
 }
 
 void PageManager::CheckEmpty() {
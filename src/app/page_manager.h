@@ -9,9 +9,13 @@
 #include <vector>
 
 #include "apps/ledger/src/app/fidl/bound_interface.h"
+#include "apps/ledger/src/app/group_committer.h"
+#include "apps/ledger/src/app/journal_overlay.h"
 #include "apps/ledger/src/app/merging/merge_resolver.h"
+#include "apps/ledger/src/app/page_change_cache.h"
 #include "apps/ledger/src/app/page_delegate.h"
 #include "apps/ledger/src/app/page_snapshot_impl.h"
+#include "apps/ledger/src/app/value_cache.h"
 #include "apps/ledger/src/callback/auto_cleanable.h"
 #include "apps/ledger/src/cloud_sync/public/ledger_sync.h"
 #include "apps/ledger/src/environment/environment.h"
@@ -48,15 +52,21 @@ class PageManager {
   void BindPage(fidl::InterfaceRequest<Page> page_request);
 
   // Creates a new PageSnapshotImpl managed by this PageManager, and binds it to
-  // the request.
-  void BindPageSnapshot(std::unique_ptr<const storage::Commit> commit,
-                        fidl::InterfaceRequest<PageSnapshot> snapshot_request,
-                        std::string key_prefix);
+  // the request. If |overlay| is not null, the snapshot contents are the ones
+  // of |commit| modified by |overlay|.
+  void BindPageSnapshot(
+      std::unique_ptr<const storage::Commit> commit,
+      fidl::InterfaceRequest<PageSnapshot> snapshot_request,
+      std::string key_prefix,
+      std::unique_ptr<const JournalOverlay> overlay = nullptr);
 
   void set_on_empty(const ftl::Closure& on_empty_callback) {
     on_empty_callback_ = on_empty_callback;
   }
 
+  // Returns the cache of the changes sent to the watchers of the page.
+  PageChangeCache* page_change_cache() { return &page_change_cache_; }
+
  private:
   void CheckEmpty();
   void OnSyncBacklogDownloaded();
@@ -66,8 +76,14 @@ class PageManager {
   std::unique_ptr<cloud_sync::PageSyncContext> page_sync_context_;
   std::unique_ptr<MergeResolver> merge_resolver_;
   const ftl::TimeDelta sync_timeout_;
+  // Shared by the watchers of all |pages_|, so it must outlive them.
+  PageChangeCache page_change_cache_;
+  // Shared by all |snapshots_|, so it must outlive them.
+  ValueCache value_cache_;
   callback::AutoCleanableSet<BoundInterface<PageSnapshot, PageSnapshotImpl>>
       snapshots_;
+  // Commits the changes made outside of transactions on all |pages_|.
+  GroupCommitter group_committer_;
   callback::AutoCleanableSet<PageDelegate> pages_;
   ftl::Closure on_empty_callback_;
 
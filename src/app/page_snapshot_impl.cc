@@ -4,12 +4,14 @@
 
 #include <algorithm>
 #include <functional>
-#include <limits>
+#include <memory>
 #include <queue>
 #include <vector>
 
 #include "apps/ledger/src/app/page_snapshot_impl.h"
 
+#include "apps/ledger/src/app/diff_utils.h"
+#include "apps/ledger/src/app/fidl/packed_entries.h"
 #include "apps/ledger/src/app/fidl/serialization_size.h"
 #include "apps/ledger/src/app/page_utils.h"
 #include "apps/ledger/src/callback/trace_callback.h"
@@ -19,75 +21,593 @@
 #include "lib/ftl/memory/ref_counted.h"
 #include "lib/ftl/memory/ref_ptr.h"
 #include "lib/ftl/tasks/task_runner.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/mtl/tasks/message_loop.h"
 #include "lib/mtl/vmo/strings.h"
 
 namespace ledger {
 namespace {
 
+// Maximum number of cursors of interrupted iterations kept by a snapshot, and
+// the delay after which they are discarded. A cursor holds the tree nodes on
+// the path to its next entry.
+constexpr size_t kMaxCursors = 4;
+constexpr ftl::TimeDelta kCursorExpiry = ftl::TimeDelta::FromSeconds(30);
+
+Priority GetPriority(const storage::Entry& entry) {
+  return entry.priority == storage::KeyPriority::EAGER ? Priority::EAGER
+                                                       : Priority::LAZY;
+}
+
 EntryPtr CreateEntry(const storage::Entry& entry) {
   EntryPtr entry_ptr = Entry::New();
   entry_ptr->key = convert::ToArray(entry.key);
-  entry_ptr->priority = entry.priority == storage::KeyPriority::EAGER
-                            ? Priority::EAGER
-                            : Priority::LAZY;
+  entry_ptr->priority = GetPriority(entry);
   return entry_ptr;
 }
 
+// Restricts the key range [|min_key|, |max_key|) to the entries that remain to
+// be returned when resuming an iteration at |token|, in ascending key order or
+// descending key order if |reverse| is true.
+void ApplyToken(const fidl::Array<uint8_t>& token,
+                bool reverse,
+                std::string* min_key,
+                std::string* max_key) {
+  if (!token) {
+    return;
+  }
+  if (reverse) {
+    // |token| is the greatest key to return, and the smallest key greater than
+    // |token| is |token| followed by a 0 byte.
+    *max_key = convert::ToString(token);
+    max_key->push_back('\0');
+  } else {
+    *min_key = convert::ToString(token);
+  }
+}
+
 }  // namespace
 
 PageSnapshotImpl::PageSnapshotImpl(
     storage::PageStorage* page_storage,
+    ValueCache* value_cache,
     std::unique_ptr<const storage::Commit> commit,
-    std::string key_prefix)
+    std::string key_prefix,
+    std::unique_ptr<const JournalOverlay> overlay)
     : page_storage_(page_storage),
+      value_cache_(value_cache),
       commit_(std::move(commit)),
-      key_prefix_(std::move(key_prefix)) {}
+      key_prefix_(std::move(key_prefix)),
+      overlay_(std::move(overlay)),
+      weak_factory_(this) {}
 
 PageSnapshotImpl::~PageSnapshotImpl() {}
 
 void PageSnapshotImpl::GetEntries(fidl::Array<uint8_t> key_start,
                                   fidl::Array<uint8_t> token,
                                   const GetEntriesCallback& callback) {
+  auto timed_callback =
+      TRACE_CALLBACK(std::move(callback), "ledger", "snapshot_get_entries");
+
   // |token| represents the first key to be returned in the list of entries.
-  // Initially, all entries starting from |token| are requested from storage.
+  std::string start = token
+                          ? convert::ToString(token)
+                          : std::max(key_prefix_, convert::ToString(key_start));
+  GetEntriesFromContents(
+      GetResumableContents(std::move(start),
+                           PageUtils::GetPrefixEnd(key_prefix_)),
+      [callback = std::move(timed_callback)](Status status,
+                                             fidl::Array<EntryPtr> entries,
+                                             std::string next_token) {
+        callback(status, std::move(entries),
+                 next_token.empty() ? nullptr : convert::ToArray(next_token));
+      });
+}
+
+void PageSnapshotImpl::GetEntriesPacked(
+    fidl::Array<uint8_t> key_start,
+    fidl::Array<uint8_t> token,
+    const GetEntriesPackedCallback& callback) {
+  auto timed_callback = TRACE_CALLBACK(std::move(callback), "ledger",
+                                       "snapshot_get_entries_packed");
+
+  std::string start = token
+                          ? convert::ToString(token)
+                          : std::max(key_prefix_, convert::ToString(key_start));
+  GetPackedEntriesFromContents(
+      GetResumableContents(std::move(start),
+                           PageUtils::GetPrefixEnd(key_prefix_)),
+      [callback = std::move(timed_callback)](Status status,
+                                             PackedEntriesPtr entries,
+                                             std::string next_token) {
+        callback(status, std::move(entries),
+                 next_token.empty() ? nullptr : convert::ToArray(next_token));
+      });
+}
+
+void PageSnapshotImpl::GetKeys(fidl::Array<uint8_t> key_start,
+                               fidl::Array<uint8_t> token,
+                               const GetKeysCallback& callback) {
+  auto timed_callback =
+      TRACE_CALLBACK(std::move(callback), "ledger", "snapshot_get_keys");
+
+  std::string start = token
+                          ? convert::ToString(token)
+                          : std::max(key_prefix_, convert::ToString(key_start));
+  GetKeysFromContents(
+      GetResumableContents(std::move(start),
+                           PageUtils::GetPrefixEnd(key_prefix_)),
+      [callback = std::move(timed_callback)](
+          Status status, fidl::Array<fidl::Array<uint8_t>> keys,
+          std::string next_token) {
+        callback(status, std::move(keys),
+                 next_token.empty() ? nullptr : convert::ToArray(next_token));
+      });
+}
+
+void PageSnapshotImpl::GetEntriesInRange(
+    fidl::Array<uint8_t> key_start,
+    fidl::Array<uint8_t> key_end,
+    uint32_t max_count,
+    bool reverse,
+    fidl::Array<uint8_t> token,
+    const GetEntriesInRangeCallback& callback) {
+  auto timed_callback = TRACE_CALLBACK(std::move(callback), "ledger",
+                                       "snapshot_get_entries_in_range");
+
+  std::string min_key;
+  std::string max_key;
+  if (!GetKeyRange(key_start, key_end, &min_key, &max_key)) {
+    timed_callback(Status::OK, fidl::Array<EntryPtr>::New(0), nullptr);
+    return;
+  }
+  ApplyToken(token, reverse, &min_key, &max_key);
+  GetEntriesFromContents(
+      GetContentsInRange(std::move(min_key), std::move(max_key), max_count,
+                         reverse),
+      [callback = std::move(timed_callback)](Status status,
+                                             fidl::Array<EntryPtr> entries,
+                                             std::string next_token) {
+        callback(status, std::move(entries),
+                 next_token.empty() ? nullptr : convert::ToArray(next_token));
+      });
+}
+
+void PageSnapshotImpl::GetKeysInRange(fidl::Array<uint8_t> key_start,
+                                      fidl::Array<uint8_t> key_end,
+                                      uint32_t max_count,
+                                      bool reverse,
+                                      fidl::Array<uint8_t> token,
+                                      const GetKeysInRangeCallback& callback) {
+  auto timed_callback = TRACE_CALLBACK(std::move(callback), "ledger",
+                                       "snapshot_get_keys_in_range");
+
+  std::string min_key;
+  std::string max_key;
+  if (!GetKeyRange(key_start, key_end, &min_key, &max_key)) {
+    timed_callback(Status::OK, fidl::Array<fidl::Array<uint8_t>>::New(0),
+                   nullptr);
+    return;
+  }
+  ApplyToken(token, reverse, &min_key, &max_key);
+  GetKeysFromContents(
+      GetContentsInRange(std::move(min_key), std::move(max_key), max_count,
+                         reverse),
+      [callback = std::move(timed_callback)](
+          Status status, fidl::Array<fidl::Array<uint8_t>> keys,
+          std::string next_token) {
+        callback(status, std::move(keys),
+                 next_token.empty() ? nullptr : convert::ToArray(next_token));
+      });
+}
+
+void PageSnapshotImpl::GetEntriesAtOffset(
+    fidl::Array<uint8_t> key_start,
+    uint64_t offset,
+    const GetEntriesAtOffsetCallback& callback) {
+  auto timed_callback = TRACE_CALLBACK(std::move(callback), "ledger",
+                                       "snapshot_get_entries_at_offset");
+
+  GetEntriesFromContents(
+      GetContentsFromOffset(std::max(key_prefix_, convert::ToString(key_start)),
+                            offset),
+      [ offset, callback = std::move(timed_callback) ](
+          Status status, fidl::Array<EntryPtr> entries, std::string next_key) {
+        uint64_t next_offset = offset + entries.size();
+        callback(status, std::move(entries), next_offset);
+      });
+}
+
+void PageSnapshotImpl::GetKeysAtOffset(
+    fidl::Array<uint8_t> key_start,
+    uint64_t offset,
+    const GetKeysAtOffsetCallback& callback) {
+  auto timed_callback = TRACE_CALLBACK(std::move(callback), "ledger",
+                                       "snapshot_get_keys_at_offset");
+
+  GetKeysFromContents(
+      GetContentsFromOffset(std::max(key_prefix_, convert::ToString(key_start)),
+                            offset),
+      [ offset, callback = std::move(timed_callback) ](
+          Status status, fidl::Array<fidl::Array<uint8_t>> keys,
+          std::string next_key) {
+        uint64_t next_offset = offset + keys.size();
+        callback(status, std::move(keys), next_offset);
+      });
+}
+
+void PageSnapshotImpl::Count(fidl::Array<uint8_t> key_start,
+                             fidl::Array<uint8_t> key_end,
+                             const CountCallback& callback) {
+  auto timed_callback =
+      TRACE_CALLBACK(std::move(callback), "ledger", "snapshot_count");
+
+  std::string min_key;
+  std::string max_key;
+  if (!GetKeyRange(key_start, key_end, &min_key, &max_key)) {
+    timed_callback(Status::OK, 0u);
+    return;
+  }
+  if (overlay_) {
+    // The entries of the overlay are not accounted for in the tree nodes:
+    // count the entries one by one.
+    auto count = std::make_shared<uint64_t>(0u);
+    GetContentsInRange(std::move(min_key), std::move(max_key), 0u, false)(
+        [count](storage::Entry entry) {
+          ++*count;
+          return true;
+        },
+        [ count, callback = std::move(timed_callback) ](
+            storage::Status status) {
+          callback(PageUtils::ConvertStatus(status), *count);
+        });
+    return;
+  }
+  page_storage_->CountCommitContents(
+      *commit_, std::move(min_key), std::move(max_key),
+      [callback = std::move(timed_callback)](storage::Status status,
+                                             uint64_t count) {
+        callback(PageUtils::ConvertStatus(status), count);
+      });
+}
+
+void PageSnapshotImpl::GetSize(fidl::Array<uint8_t> key_start,
+                               fidl::Array<uint8_t> key_end,
+                               const GetSizeCallback& callback) {
+  auto timed_callback =
+      TRACE_CALLBACK(std::move(callback), "ledger", "snapshot_get_size");
+
+  std::string min_key;
+  std::string max_key;
+  if (!GetKeyRange(key_start, key_end, &min_key, &max_key)) {
+    timed_callback(Status::OK, 0u, 0u);
+    return;
+  }
+  if (overlay_) {
+    // Read the values of the entries one by one. As for snapshots without
+    // overlay, the values not available locally are not accounted for.
+    auto object_ids = std::make_shared<std::vector<storage::ObjectId>>();
+    GetContentsInRange(std::move(min_key), std::move(max_key), 0u, false)(
+        [object_ids](storage::Entry entry) {
+          object_ids->push_back(std::move(entry.object_id));
+          return true;
+        },
+        [ this, object_ids, callback = std::move(timed_callback) ](
+            storage::Status status) {
+          if (status != storage::Status::OK) {
+            callback(PageUtils::ConvertStatus(status), 0u, 0u);
+            return;
+          }
+          auto waiter = callback::Waiter<storage::Status, uint64_t>::Create(
+              storage::Status::OK);
+          for (const auto& object_id : *object_ids) {
+            // Only the sizes are read, not the values.
+            page_storage_->GetObjectSize(
+                object_id, [waiter_callback = waiter->NewCallback()](
+                               storage::Status status, uint64_t size) {
+                  if (status == storage::Status::NOT_FOUND) {
+                    waiter_callback(storage::Status::OK, 0u);
+                    return;
+                  }
+                  waiter_callback(status, size);
+                });
+          }
+          waiter->Finalize([
+            entry_count = object_ids->size(), callback = std::move(callback)
+          ](storage::Status status, std::vector<uint64_t> sizes) {
+            uint64_t value_bytes = 0u;
+            for (uint64_t size : sizes) {
+              value_bytes += size;
+            }
+            callback(PageUtils::ConvertStatus(status), entry_count,
+                     value_bytes);
+          });
+        });
+    return;
+  }
+  page_storage_->GetCommitContentsSize(
+      *commit_, std::move(min_key), std::move(max_key),
+      [callback = std::move(timed_callback)](storage::Status status,
+                                             storage::ContentsSize size) {
+        callback(PageUtils::ConvertStatus(status), size.entry_count,
+                 size.value_bytes);
+      });
+}
+
+PageSnapshotImpl::ContentsGetter PageSnapshotImpl::GetContentsFromOffset(
+    std::string start,
+    uint64_t offset) {
+  return [ this, start = std::move(start), offset ](
+      std::function<bool(storage::Entry)> on_next,
+      std::function<void(storage::Status)> on_done) {
+    // The iteration is not bounded by the prefix of the snapshot: stop at the
+    // first entry not matching it.
+    auto on_next_in_prefix = [ this, on_next = std::move(on_next) ](
+        storage::Entry entry) {
+      return PageUtils::MatchesPrefix(entry.key, key_prefix_) &&
+             on_next(std::move(entry));
+    };
+    if (overlay_) {
+      // The offset applies to the merged contents.
+      ContentsGetter base_contents = [this, start](
+          std::function<bool(storage::Entry)> on_next,
+          std::function<void(storage::Status)> on_done) {
+        page_storage_->GetCommitContents(*commit_, start, std::move(on_next),
+                                         std::move(on_done));
+      };
+      overlay_->Merge(std::move(base_contents), start, "", offset, 0u, false)(
+          std::move(on_next_in_prefix), std::move(on_done));
+      return;
+    }
+    if (offset == 0u) {
+      page_storage_->GetCommitContents(*commit_, start,
+                                       std::move(on_next_in_prefix),
+                                       std::move(on_done));
+      return;
+    }
+    page_storage_->GetCommitContentsFromOffset(*commit_, start, offset,
+                                               std::move(on_next_in_prefix),
+                                               std::move(on_done));
+  };
+}
+
+PageSnapshotImpl::ContentsGetter PageSnapshotImpl::GetResumableContents(
+    std::string min_key,
+    std::string max_key) {
+  if (overlay_) {
+    // The merged contents are not resumable.
+    return GetContentsInRange(std::move(min_key), std::move(max_key), 0u,
+                              false);
+  }
+  return [ this, min_key = std::move(min_key), max_key = std::move(max_key) ](
+      std::function<bool(storage::Entry)> on_next,
+      std::function<void(storage::Status)> on_done) {
+    // Records the key of the last entry given to |on_next|, which is the one
+    // on which the cursor returned by storage is positioned.
+    auto last_key = std::make_shared<std::string>();
+    auto on_next_with_key = [ last_key, on_next = std::move(on_next) ](
+        storage::Entry entry) {
+      last_key->assign(entry.key);
+      return on_next(std::move(entry));
+    };
+    auto on_done_with_cursor = [
+      weak_this = weak_factory_.GetWeakPtr(), last_key,
+      on_done = std::move(on_done)
+    ](storage::Status status,
+      std::unique_ptr<storage::PageStorage::ContentsCursor> cursor) {
+      if (cursor && weak_this) {
+        weak_this->AddCursor(std::move(*last_key), std::move(cursor));
+      }
+      on_done(status);
+    };
+
+    auto it = cursors_.find(min_key);
+    if (it == cursors_.end()) {
+      page_storage_->GetCommitContentsWithCursor(
+          *commit_, min_key, max_key, std::move(on_next_with_key),
+          std::move(on_done_with_cursor));
+      return;
+    }
+    std::unique_ptr<storage::PageStorage::ContentsCursor> cursor =
+        std::move(it->second.cursor);
+    cursors_.erase(it);
+    page_storage_->ResumeCommitContents(std::move(cursor),
+                                        std::move(on_next_with_key),
+                                        std::move(on_done_with_cursor));
+  };
+}
+
+void PageSnapshotImpl::AddCursor(
+    std::string token,
+    std::unique_ptr<storage::PageStorage::ContentsCursor> cursor) {
+  if (cursors_.size() >= kMaxCursors && cursors_.count(token) == 0u) {
+    // Evict the oldest cursor.
+    auto oldest = std::min_element(
+        cursors_.begin(), cursors_.end(),
+        [](const std::pair<const std::string, CachedCursor>& a,
+           const std::pair<const std::string, CachedCursor>& b) {
+          return a.second.id < b.second.id;
+        });
+    cursors_.erase(oldest);
+  }
+  uint64_t cursor_id = next_cursor_id_++;
+  mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+      [ weak_this = weak_factory_.GetWeakPtr(), token, cursor_id ] {
+        if (weak_this) {
+          weak_this->ExpireCursor(token, cursor_id);
+        }
+      },
+      kCursorExpiry);
+  cursors_[std::move(token)] = CachedCursor{std::move(cursor), cursor_id};
+}
+
+void PageSnapshotImpl::ExpireCursor(const std::string& token,
+                                    uint64_t cursor_id) {
+  auto it = cursors_.find(token);
+  if (it != cursors_.end() && it->second.id == cursor_id) {
+    cursors_.erase(it);
+  }
+}
+
+PageSnapshotImpl::ContentsGetter PageSnapshotImpl::GetContentsInRange(
+    std::string min_key,
+    std::string max_key,
+    uint64_t max_count,
+    bool reverse) {
+  return [
+    this, min_key = std::move(min_key), max_key = std::move(max_key),
+    max_count, reverse
+  ](std::function<bool(storage::Entry)> on_next,
+    std::function<void(storage::Status)> on_done) {
+    if (overlay_) {
+      // |max_count| applies to the merged contents.
+      ContentsGetter base_contents = [this, min_key, max_key, reverse](
+          std::function<bool(storage::Entry)> on_next,
+          std::function<void(storage::Status)> on_done) {
+        page_storage_->GetCommitContentsInRange(*commit_, min_key, max_key, 0u,
+                                                reverse, std::move(on_next),
+                                                std::move(on_done));
+      };
+      overlay_->Merge(std::move(base_contents), min_key, max_key, 0u,
+                      max_count, reverse)(std::move(on_next),
+                                          std::move(on_done));
+      return;
+    }
+    page_storage_->GetCommitContentsInRange(*commit_, min_key, max_key,
+                                            max_count, reverse,
+                                            std::move(on_next),
+                                            std::move(on_done));
+  };
+}
+
+void PageSnapshotImpl::GetEntriesFromContents(
+    ContentsGetter get_contents,
+    std::function<void(Status, fidl::Array<EntryPtr>, std::string)> callback) {
+  ReadEntriesFromContents(
+      std::move(get_contents), fidl_serialization::kArrayHeaderSize,
+      &fidl_serialization::GetEntrySize,
+      [callback = std::move(callback)](
+          Status status, std::vector<storage::Entry> entries,
+          std::vector<std::unique_ptr<const storage::Object>> objects,
+          std::string next_token) {
+        if (status != Status::OK) {
+          callback(status, nullptr, "");
+          return;
+        }
+        fidl::Array<EntryPtr> entry_ptrs = fidl::Array<EntryPtr>::New(0);
+        for (size_t i = 0; i < entries.size(); i++) {
+          EntryPtr entry_ptr = CreateEntry(entries[i]);
+          if (!objects[i]) {
+            // We don't have the object locally, but we decided not to abort.
+            // This means this object is a value of a lazy key and the client
+            // should ask to retrieve it over the network if they need it.
+            // Here, we just leave the value part of the entry null.
+            entry_ptrs.push_back(std::move(entry_ptr));
+            continue;
+          }
+          ftl::StringView object_contents;
+          storage::Status read_status = objects[i]->GetData(&object_contents);
+          if (read_status != storage::Status::OK) {
+            callback(Status::IO_ERROR, nullptr, "");
+            return;
+          }
+          if (!mtl::VmoFromString(object_contents, &entry_ptr->value)) {
+            callback(Status::INTERNAL_ERROR, nullptr, "");
+            return;
+          }
+          entry_ptrs.push_back(std::move(entry_ptr));
+        }
+        if (!next_token.empty()) {
+          callback(Status::PARTIAL_RESULT, std::move(entry_ptrs),
+                   std::move(next_token));
+          return;
+        }
+        callback(Status::OK, std::move(entry_ptrs), "");
+      });
+}
+
+void PageSnapshotImpl::GetPackedEntriesFromContents(
+    ContentsGetter get_contents,
+    std::function<void(Status, PackedEntriesPtr, std::string)> callback) {
+  ReadEntriesFromContents(
+      std::move(get_contents), fidl_serialization::kPackedEntriesHeaderSize,
+      &fidl_serialization::GetPackedEntrySize,
+      [callback = std::move(callback)](
+          Status status, std::vector<storage::Entry> entries,
+          std::vector<std::unique_ptr<const storage::Object>> objects,
+          std::string next_token) {
+        if (status != Status::OK) {
+          callback(status, nullptr, "");
+          return;
+        }
+        PackedEntriesBuilder builder;
+        for (size_t i = 0; i < entries.size(); i++) {
+          Priority priority = GetPriority(entries[i]);
+          if (!objects[i]) {
+            // As for |GetEntriesFromContents|, the value of a lazy key is
+            // left out.
+            builder.AddWithoutValue(entries[i].key, priority);
+            continue;
+          }
+          ftl::StringView object_contents;
+          storage::Status read_status = objects[i]->GetData(&object_contents);
+          if (read_status != storage::Status::OK) {
+            callback(Status::IO_ERROR, nullptr, "");
+            return;
+          }
+          builder.Add(entries[i].key, priority, object_contents);
+        }
+        PackedEntriesPtr packed_entries = builder.Build();
+        if (!packed_entries) {
+          callback(Status::INTERNAL_ERROR, nullptr, "");
+          return;
+        }
+        if (!next_token.empty()) {
+          callback(Status::PARTIAL_RESULT, std::move(packed_entries),
+                   std::move(next_token));
+          return;
+        }
+        callback(Status::OK, std::move(packed_entries), "");
+      });
+}
+
+void PageSnapshotImpl::ReadEntriesFromContents(
+    ContentsGetter get_contents,
+    size_t header_size,
+    size_t (*get_entry_size)(size_t key_length),
+    std::function<void(Status,
+                       std::vector<storage::Entry>,
+                       std::vector<std::unique_ptr<const storage::Object>>,
+                       std::string)> callback) {
+  // Initially, all entries given by |get_contents| are requested from storage.
   // Iteration stops if either all entries were found, or if the serialization
-  // size of entries, including the value, exceeds
-  // fidl_serialization::kMaxInlineDataSize. In the second case callback will
-  // run with PARTIAL_RESULT status.
+  // size of entries exceeds fidl_serialization::kMaxInlineDataSize. In the
+  // second case |next_token| is set.
 
   // Represents information shared between on_next and on_done callbacks.
   struct Context {
-    fidl::Array<EntryPtr> entries;
+    std::vector<storage::Entry> entries;
     // The serialization size of all entries.
-    size_t size = fidl_serialization::kArrayHeaderSize;
+    size_t size;
     // If |entries| array size exceeds kMaxInlineDataSize, |next_token| will
     // have the value of the following entry's key.
     std::string next_token = "";
   };
-  auto timed_callback =
-      TRACE_CALLBACK(std::move(callback), "ledger", "snapshot_get_entries");
-
   auto waiter = callback::
       Waiter<storage::Status, std::unique_ptr<const storage::Object>>::Create(
           storage::Status::OK);
 
   auto context = std::make_unique<Context>();
-  // Use |token| for the first key if present.
-  std::string start = token
-                          ? convert::ToString(token)
-                          : std::max(key_prefix_, convert::ToString(key_start));
-  auto on_next = ftl::MakeCopyable([ this, context = context.get(),
-                                     waiter ](storage::Entry entry) {
-    if (!PageUtils::MatchesPrefix(entry.key, key_prefix_)) {
-      return false;
-    }
-    context->size += fidl_serialization::GetEntrySize(entry.key.size());
+  context->size = header_size;
+  auto on_next = ftl::MakeCopyable([
+    this, context = context.get(), get_entry_size, waiter
+  ](storage::Entry entry) {
+    context->size += get_entry_size(entry.key.size());
     if (context->size > fidl_serialization::kMaxInlineDataSize &&
         context->entries.size()) {
       context->next_token = std::move(entry.key);
       return false;
     }
-    context->entries.push_back(CreateEntry(entry));
     page_storage_->GetObject(
         entry.object_id, storage::PageStorage::Location::LOCAL,
         [ priority = entry.priority, waiter_callback = waiter->NewCallback() ](
@@ -100,15 +620,16 @@ void PageSnapshotImpl::GetEntries(fidl::Array<uint8_t> key_start,
             waiter_callback(status, std::move(object));
           }
         });
+    context->entries.push_back(std::move(entry));
     return true;
   });
 
   auto on_done = ftl::MakeCopyable([
-    waiter, context = std::move(context), callback = std::move(timed_callback)
+    waiter, context = std::move(context), callback = std::move(callback)
   ](storage::Status status) mutable {
     if (status != storage::Status::OK) {
       FTL_LOG(ERROR) << "Error while reading.";
-      callback(Status::IO_ERROR, nullptr, nullptr);
+      callback(Status::IO_ERROR, {}, {}, "");
       return;
     }
     std::function<void(storage::Status,
@@ -119,48 +640,22 @@ void PageSnapshotImpl::GetEntries(fidl::Array<uint8_t> key_start,
           std::vector<std::unique_ptr<const storage::Object>> results) mutable {
           if (status != storage::Status::OK) {
             FTL_LOG(ERROR) << "Error while reading.";
-            callback(Status::IO_ERROR, nullptr, nullptr);
+            callback(Status::IO_ERROR, {}, {}, "");
             return;
           }
           FTL_DCHECK(context->entries.size() == results.size());
-
-          for (size_t i = 0; i < results.size(); i++) {
-            if (!results[i]) {
-              // We don't have the object locally, but we decided not to abort.
-              // This means this object is a value of a lazy key and the client
-              // should ask to retrieve it over the network if they need it.
-              // Here, we just leave the value part of the entry null.
-              continue;
-            }
-            ftl::StringView object_contents;
-            storage::Status read_status = results[i]->GetData(&object_contents);
-            if (read_status != storage::Status::OK) {
-              callback(Status::IO_ERROR, nullptr, nullptr);
-              return;
-            }
-
-            EntryPtr& entry_ptr = context->entries[i];
-            if (!mtl::VmoFromString(object_contents, &entry_ptr->value)) {
-              callback(Status::INTERNAL_ERROR, nullptr, nullptr);
-              return;
-            }
-          }
-          if (!context->next_token.empty()) {
-            callback(Status::PARTIAL_RESULT, std::move(context->entries),
-                     convert::ToArray(context->next_token));
-            return;
-          }
-          callback(Status::OK, std::move(context->entries), nullptr);
+          callback(Status::OK, std::move(context->entries), std::move(results),
+                   std::move(context->next_token));
         });
     waiter->Finalize(result_callback);
   });
-  page_storage_->GetCommitContents(*commit_, std::move(start),
-                                   std::move(on_next), std::move(on_done));
+  get_contents(std::move(on_next), std::move(on_done));
 }
 
-void PageSnapshotImpl::GetKeys(fidl::Array<uint8_t> key_start,
-                               fidl::Array<uint8_t> token,
-                               const GetKeysCallback& callback) {
+void PageSnapshotImpl::GetKeysFromContents(
+    ContentsGetter get_contents,
+    std::function<void(Status, fidl::Array<fidl::Array<uint8_t>>, std::string)>
+        callback) {
   // Represents the information that needs to be shared between on_next and
   // on_done callbacks.
   struct Context {
@@ -174,15 +669,9 @@ void PageSnapshotImpl::GetKeys(fidl::Array<uint8_t> key_start,
     std::string next_token = "";
   };
 
-  auto timed_callback =
-      TRACE_CALLBACK(std::move(callback), "ledger", "snapshot_get_keys");
-
   auto context = std::make_unique<Context>();
   auto on_next = ftl::MakeCopyable(
-      [ this, context = context.get() ](storage::Entry entry) {
-        if (!PageUtils::MatchesPrefix(entry.key, key_prefix_)) {
-          return false;
-        }
+      [context = context.get()](storage::Entry entry) {
         context->size += fidl_serialization::GetByteArraySize(entry.key.size());
         if (context->size > fidl_serialization::kMaxInlineDataSize) {
           context->next_token = entry.key;
@@ -192,24 +681,53 @@ void PageSnapshotImpl::GetKeys(fidl::Array<uint8_t> key_start,
         return true;
       });
   auto on_done = ftl::MakeCopyable([
-    context = std::move(context), callback = std::move(timed_callback)
+    context = std::move(context), callback = std::move(callback)
   ](storage::Status s) {
     if (context->next_token.empty()) {
-      callback(Status::OK, std::move(context->keys), nullptr);
+      callback(Status::OK, std::move(context->keys), "");
     } else {
       callback(Status::PARTIAL_RESULT, std::move(context->keys),
-               convert::ToArray(context->next_token));
+               std::move(context->next_token));
     }
   });
-  if (token.is_null()) {
-    page_storage_->GetCommitContents(
-        *commit_, std::max(convert::ToString(key_start), key_prefix_),
-        std::move(on_next), std::move(on_done));
+  get_contents(std::move(on_next), std::move(on_done));
+}
 
-  } else {
-    page_storage_->GetCommitContents(*commit_, convert::ToString(token),
-                                     std::move(on_next), std::move(on_done));
+bool PageSnapshotImpl::GetKeyRange(const fidl::Array<uint8_t>& key_start,
+                                   const fidl::Array<uint8_t>& key_end,
+                                   std::string* min_key,
+                                   std::string* max_key) {
+  *min_key = std::max(key_prefix_, convert::ToString(key_start));
+  *max_key = PageUtils::GetPrefixEnd(key_prefix_);
+  if (key_end) {
+    std::string end = convert::ToString(key_end);
+    if (max_key->empty() || end < *max_key) {
+      *max_key = std::move(end);
+    }
+    if (*max_key <= *min_key) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void PageSnapshotImpl::GetEntry(
+    std::string key,
+    std::function<void(storage::Status, storage::Entry)> callback) {
+  if (overlay_) {
+    bool found;
+    storage::Entry entry;
+    if (overlay_->GetEntry(key, &found, &entry)) {
+      if (!found) {
+        callback(storage::Status::NOT_FOUND, storage::Entry());
+        return;
+      }
+      callback(storage::Status::OK, std::move(entry));
+      return;
+    }
   }
+  page_storage_->GetEntryFromCommit(*commit_, std::move(key),
+                                    std::move(callback));
 }
 
 void PageSnapshotImpl::Get(fidl::Array<uint8_t> key,
@@ -217,7 +735,7 @@ void PageSnapshotImpl::Get(fidl::Array<uint8_t> key,
   auto timed_callback =
       TRACE_CALLBACK(std::move(callback), "ledger", "snapshot_get");
 
-  page_storage_->GetEntryFromCommit(*commit_, convert::ToString(key), [
+  GetEntry(convert::ToString(key), [
     this, callback = std::move(timed_callback)
   ](storage::Status status, storage::Entry entry) {
     if (status != storage::Status::OK) {
@@ -225,10 +743,9 @@ void PageSnapshotImpl::Get(fidl::Array<uint8_t> key,
                mx::vmo());
       return;
     }
-    PageUtils::GetPartialReferenceAsBuffer(
-        page_storage_, entry.object_id, 0u, std::numeric_limits<int64_t>::max(),
-        storage::PageStorage::Location::LOCAL, Status::NEEDS_FETCH,
-        std::move(callback));
+    value_cache_->GetValue(entry.object_id,
+                           storage::PageStorage::Location::LOCAL,
+                           Status::NEEDS_FETCH, std::move(callback));
   });
 }
 
@@ -237,7 +754,7 @@ void PageSnapshotImpl::Fetch(fidl::Array<uint8_t> key,
   auto timed_callback =
       TRACE_CALLBACK(std::move(callback), "ledger", "snapshot_fetch");
 
-  page_storage_->GetEntryFromCommit(*commit_, convert::ToString(key), [
+  GetEntry(convert::ToString(key), [
     this, callback = std::move(timed_callback)
   ](storage::Status status, storage::Entry entry) {
     if (status != storage::Status::OK) {
@@ -245,10 +762,9 @@ void PageSnapshotImpl::Fetch(fidl::Array<uint8_t> key,
                mx::vmo());
       return;
     }
-    PageUtils::GetPartialReferenceAsBuffer(
-        page_storage_, entry.object_id, 0u, std::numeric_limits<int64_t>::max(),
-        storage::PageStorage::Location::NETWORK, Status::INTERNAL_ERROR,
-        std::move(callback));
+    value_cache_->GetValue(entry.object_id,
+                           storage::PageStorage::Location::NETWORK,
+                           Status::INTERNAL_ERROR, std::move(callback));
   });
 }
 
@@ -259,7 +775,7 @@ void PageSnapshotImpl::FetchPartial(fidl::Array<uint8_t> key,
   auto timed_callback =
       TRACE_CALLBACK(std::move(callback), "ledger", "snapshot_fetch_partial");
 
-  page_storage_->GetEntryFromCommit(*commit_, convert::ToString(key), [
+  GetEntry(convert::ToString(key), [
     this, offset, max_size, callback = std::move(timed_callback)
   ](storage::Status status, storage::Entry entry) {
     if (status != storage::Status::OK) {
@@ -275,4 +791,55 @@ void PageSnapshotImpl::FetchPartial(fidl::Array<uint8_t> key,
   });
 }
 
+void PageSnapshotImpl::GetVersion(const GetVersionCallback& callback) {
+  if (overlay_) {
+    callback(Status::INVALID_ARGUMENT, nullptr);
+    return;
+  }
+  callback(Status::OK, convert::ToArray(commit_->GetId()));
+}
+
+void PageSnapshotImpl::GetDiff(fidl::Array<uint8_t> base_version,
+                               fidl::Array<uint8_t> token,
+                               const GetDiffCallback& callback) {
+  auto timed_callback =
+      TRACE_CALLBACK(std::move(callback), "ledger", "snapshot_get_diff");
+
+  if (overlay_) {
+    timed_callback(Status::INVALID_ARGUMENT, nullptr, nullptr);
+    return;
+  }
+  // |token| represents the first key of the changes to be returned.
+  std::string min_key = token ? convert::ToString(token) : "";
+  page_storage_->GetCommit(convert::ToString(base_version), ftl::MakeCopyable([
+    page_storage = page_storage_, commit = commit_->Clone(),
+    key_prefix = key_prefix_, min_key = std::move(min_key),
+    callback = std::move(timed_callback)
+  ](storage::Status status,
+    std::unique_ptr<const storage::Commit> base) mutable {
+    if (status != storage::Status::OK) {
+      callback(PageUtils::ConvertStatus(status, Status::INVALID_ARGUMENT),
+               nullptr, nullptr);
+      return;
+    }
+    diff_utils::ComputePageChange(
+        page_storage, *base, *commit, std::move(key_prefix),
+        std::move(min_key), fidl_serialization::kMaxInlineDataSize,
+        diff_utils::ValueOptions(), [callback = std::move(callback)](
+            Status status,
+            std::pair<PageChangePtr, std::string> page_change) {
+          if (status != Status::OK) {
+            callback(status, nullptr, nullptr);
+            return;
+          }
+          if (page_change.second.empty()) {
+            callback(Status::OK, std::move(page_change.first), nullptr);
+            return;
+          }
+          callback(Status::PARTIAL_RESULT, std::move(page_change.first),
+                   convert::ToArray(page_change.second));
+        });
+  }));
+}
+
 }  // namespace ledger
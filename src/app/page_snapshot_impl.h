@@ -5,20 +5,33 @@
 #ifndef APPS_LEDGER_SRC_APP_PAGE_SNAPSHOT_IMPL_H_
 #define APPS_LEDGER_SRC_APP_PAGE_SNAPSHOT_IMPL_H_
 
+#include <functional>
+#include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "apps/ledger/services/public/ledger.fidl.h"
+#include "apps/ledger/src/app/journal_overlay.h"
+#include "apps/ledger/src/app/value_cache.h"
 #include "apps/ledger/src/storage/public/commit.h"
+#include "apps/ledger/src/storage/public/object.h"
 #include "apps/ledger/src/storage/public/page_storage.h"
+#include "lib/ftl/memory/weak_ptr.h"
 #include "lib/ftl/tasks/task_runner.h"
 
 namespace ledger {
 
 class PageSnapshotImpl : public PageSnapshot {
  public:
+  // If |overlay| is not null, the snapshot contains the contents of |commit|
+  // modified by |overlay|. The values of the entries are read through
+  // |value_cache|, shared with the other snapshots of the page.
   PageSnapshotImpl(storage::PageStorage* page_storage,
+                   ValueCache* value_cache,
                    std::unique_ptr<const storage::Commit> commit,
-                   std::string key_prefix);
+                   std::string key_prefix,
+                   std::unique_ptr<const JournalOverlay> overlay);
   ~PageSnapshotImpl();
 
  private:
@@ -26,19 +39,145 @@ class PageSnapshotImpl : public PageSnapshot {
   void GetEntries(fidl::Array<uint8_t> key_start,
                   fidl::Array<uint8_t> token,
                   const GetEntriesCallback& callback) override;
+  void GetEntriesPacked(fidl::Array<uint8_t> key_start,
+                        fidl::Array<uint8_t> token,
+                        const GetEntriesPackedCallback& callback) override;
   void GetKeys(fidl::Array<uint8_t> key_start,
                fidl::Array<uint8_t> token,
                const GetKeysCallback& callback) override;
+  void GetEntriesInRange(fidl::Array<uint8_t> key_start,
+                         fidl::Array<uint8_t> key_end,
+                         uint32_t max_count,
+                         bool reverse,
+                         fidl::Array<uint8_t> token,
+                         const GetEntriesInRangeCallback& callback) override;
+  void GetKeysInRange(fidl::Array<uint8_t> key_start,
+                      fidl::Array<uint8_t> key_end,
+                      uint32_t max_count,
+                      bool reverse,
+                      fidl::Array<uint8_t> token,
+                      const GetKeysInRangeCallback& callback) override;
+  void GetEntriesAtOffset(fidl::Array<uint8_t> key_start,
+                          uint64_t offset,
+                          const GetEntriesAtOffsetCallback& callback) override;
+  void GetKeysAtOffset(fidl::Array<uint8_t> key_start,
+                       uint64_t offset,
+                       const GetKeysAtOffsetCallback& callback) override;
+  void Count(fidl::Array<uint8_t> key_start,
+             fidl::Array<uint8_t> key_end,
+             const CountCallback& callback) override;
+  void GetSize(fidl::Array<uint8_t> key_start,
+               fidl::Array<uint8_t> key_end,
+               const GetSizeCallback& callback) override;
   void Get(fidl::Array<uint8_t> key, const GetCallback& callback) override;
   void Fetch(fidl::Array<uint8_t> key, const FetchCallback& callback) override;
   void FetchPartial(fidl::Array<uint8_t> key,
                     int64_t offset,
                     int64_t max_size,
                     const FetchPartialCallback& callback) override;
+  void GetVersion(const GetVersionCallback& callback) override;
+  void GetDiff(fidl::Array<uint8_t> base_version,
+               fidl::Array<uint8_t> token,
+               const GetDiffCallback& callback) override;
+
+  // Iterates over entries of the snapshot: calls |on_next| on each entry until
+  // it returns false, then calls |on_done|.
+  using ContentsGetter = JournalOverlay::ContentsGetter;
+
+  // Returns a |ContentsGetter| iterating over the entries of the snapshot,
+  // starting at the entry preceded by |offset| entries with a key equal to or
+  // greater than |start|.
+  ContentsGetter GetContentsFromOffset(std::string start, uint64_t offset);
+
+  // Returns a |ContentsGetter| iterating over the entries of the snapshot with
+  // keys in [|min_key|, |max_key|), in ascending key order. If |min_key| is a
+  // continuation token for which a cursor is cached, the iteration resumes
+  // from it. If the iteration is interrupted, the cursor on the next entry is
+  // cached, with the key of that entry, i.e. the next continuation token.
+  ContentsGetter GetResumableContents(std::string min_key, std::string max_key);
+
+  // Caches |cursor| for the continuation |token|, until it expires or is
+  // evicted by more recent cursors.
+  void AddCursor(std::string token,
+                 std::unique_ptr<storage::PageStorage::ContentsCursor> cursor);
+
+  // Removes the cursor cached for |token| if it is the one with |cursor_id|.
+  void ExpireCursor(const std::string& token, uint64_t cursor_id);
+
+  // Returns a |ContentsGetter| iterating over at most |max_count| entries of
+  // the snapshot with keys in [|min_key|, |max_key|), in descending key order
+  // if |reverse| is true. See |PageStorage::GetCommitContentsInRange|.
+  ContentsGetter GetContentsInRange(std::string min_key,
+                                    std::string max_key,
+                                    uint64_t max_count,
+                                    bool reverse);
+
+  // Retrieves the entries given by |get_contents|, up to the FIDL message size
+  // limit. |callback| is called with the status, the entries and, if the
+  // result is partial, the key of the next entry.
+  void GetEntriesFromContents(
+      ContentsGetter get_contents,
+      std::function<void(Status, fidl::Array<EntryPtr>, std::string)>
+          callback);
+
+  // Same as |GetEntriesFromContents|, but returns the values in a single
+  // buffer.
+  void GetPackedEntriesFromContents(
+      ContentsGetter get_contents,
+      std::function<void(Status, PackedEntriesPtr, std::string)> callback);
+
+  // Reads the entries given by |get_contents| and their values available
+  // locally, until the serialization size of the entries, starting at
+  // |header_size| and computed for each entry by |get_entry_size|, exceeds the
+  // FIDL message size limit. |callback| is called with the status, the entries,
+  // their values, null for values not available, and if the result is partial,
+  // the key of the next entry.
+  void ReadEntriesFromContents(
+      ContentsGetter get_contents,
+      size_t header_size,
+      size_t (*get_entry_size)(size_t key_length),
+      std::function<void(Status,
+                         std::vector<storage::Entry>,
+                         std::vector<std::unique_ptr<const storage::Object>>,
+                         std::string)> callback);
+
+  // Same as |GetEntriesFromContents|, but only retrieves the keys.
+  void GetKeysFromContents(
+      ContentsGetter get_contents,
+      std::function<void(Status,
+                         fidl::Array<fidl::Array<uint8_t>>,
+                         std::string)> callback);
+
+  // Computes the key range [|min_key|, |max_key|) of the snapshot restricted
+  // to [|key_start|, |key_end|). An empty |max_key| means no upper bound.
+  // Returns false if the range is empty.
+  bool GetKeyRange(const fidl::Array<uint8_t>& key_start,
+                   const fidl::Array<uint8_t>& key_end,
+                   std::string* min_key,
+                   std::string* max_key);
+
+  // Retrieves the entry with the given |key|, taking |overlay_| into account.
+  // See |PageStorage::GetEntryFromCommit|.
+  void GetEntry(std::string key,
+                std::function<void(storage::Status, storage::Entry)> callback);
 
   storage::PageStorage* page_storage_;
+  ValueCache* const value_cache_;
   std::unique_ptr<const storage::Commit> commit_;
   const std::string key_prefix_;
+  std::unique_ptr<const JournalOverlay> overlay_;
+
+  // A cursor on a paginated iteration, and the sequence number identifying it.
+  struct CachedCursor {
+    std::unique_ptr<storage::PageStorage::ContentsCursor> cursor;
+    uint64_t id;
+  };
+  // Cursors of the interrupted paginated iterations, by continuation token.
+  std::map<std::string, CachedCursor> cursors_;
+  uint64_t next_cursor_id_ = 0u;
+
+  // Must be the last member field.
+  ftl::WeakPtrFactory<PageSnapshotImpl> weak_factory_;
 };
 
 }  // namespace ledger
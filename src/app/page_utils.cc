@@ -4,61 +4,15 @@
 
 #include "apps/ledger/src/app/page_utils.h"
 
-#include <memory>
+#include <string>
+#include <utility>
 
 #include "apps/ledger/src/app/constants.h"
-#include "apps/ledger/src/storage/public/object.h"
 #include "apps/ledger/src/storage/public/page_storage.h"
 #include "apps/ledger/src/storage/public/types.h"
 #include "lib/mtl/vmo/strings.h"
 
 namespace ledger {
-namespace {
-Status ToBuffer(convert::ExtendedStringView value,
-                int64_t offset,
-                int64_t max_size,
-                mx::vmo* buffer) {
-  size_t start = value.size();
-  // Valid indices are between -N and N-1.
-  if (offset >= -static_cast<int64_t>(value.size()) &&
-      offset < static_cast<int64_t>(value.size())) {
-    start = offset < 0 ? value.size() + offset : offset;
-  }
-  size_t length = max_size < 0 ? value.size() : max_size;
-
-  bool result = mtl::VmoFromString(value.substr(start, length), buffer);
-  return result ? Status::OK : Status::UNKNOWN_ERROR;
-}
-
-void GetReferenceAsStringView(
-    storage::PageStorage* storage,
-    convert::ExtendedStringView opaque_id,
-    storage::PageStorage::Location location,
-    Status not_found_status,
-    std::function<void(Status, ftl::StringView)> callback) {
-  storage->GetObject(
-      opaque_id, location,
-      [not_found_status, callback](
-          storage::Status status,
-          std::unique_ptr<const storage::Object> object) {
-        if (status != storage::Status::OK) {
-          callback(PageUtils::ConvertStatus(status, not_found_status),
-                   ftl::StringView());
-          return;
-        }
-        ftl::StringView data;
-        status = object->GetData(&data);
-        if (status != storage::Status::OK) {
-          callback(PageUtils::ConvertStatus(status, not_found_status),
-                   ftl::StringView());
-          return;
-        }
-
-        callback(Status::OK, data);
-      });
-}
-
-}  // namespace
 
 Status PageUtils::ConvertStatus(storage::Status status,
                                 Status not_found_status) {
@@ -87,17 +41,17 @@ void PageUtils::GetPartialReferenceAsBuffer(
     storage::PageStorage::Location location,
     Status not_found_status,
     std::function<void(Status, mx::vmo)> callback) {
-  GetReferenceAsStringView(
-      storage, reference_id, location, not_found_status,
-      [offset, max_size, callback](Status status, ftl::StringView data) {
-        if (status != Status::OK) {
-          callback(status, mx::vmo());
+  storage->GetObjectPart(
+      reference_id, offset, max_size, location,
+      [not_found_status, callback](storage::Status status, std::string data) {
+        if (status != storage::Status::OK) {
+          callback(PageUtils::ConvertStatus(status, not_found_status),
+                   mx::vmo());
           return;
         }
         mx::vmo buffer;
-        Status buffer_status = ToBuffer(data, offset, max_size, &buffer);
-        if (buffer_status != Status::OK) {
-          callback(buffer_status, mx::vmo());
+        if (!mtl::VmoFromString(data, &buffer)) {
+          callback(Status::UNKNOWN_ERROR, mx::vmo());
           return;
         }
         callback(Status::OK, std::move(buffer));
@@ -110,4 +64,14 @@ bool PageUtils::MatchesPrefix(const std::string& key,
          convert::ExtendedStringView(prefix);
 }
 
+std::string PageUtils::GetPrefixEnd(std::string prefix) {
+  while (!prefix.empty() && static_cast<uint8_t>(prefix.back()) == 0xff) {
+    prefix.pop_back();
+  }
+  if (!prefix.empty()) {
+    prefix.back() = static_cast<char>(static_cast<uint8_t>(prefix.back()) + 1);
+  }
+  return prefix;
+}
+
 }  // namespace ledger
@@ -6,6 +6,7 @@
 #define APPS_LEDGER_SRC_APP_PAGE_UTILS_H_
 
 #include <functional>
+#include <string>
 
 #include "apps/ledger/services/public/ledger.fidl.h"
 #include "apps/ledger/src/convert/convert.h"
@@ -26,7 +27,8 @@ class PageUtils {
 
   // Returns a subset of a Reference contents as a buffer. |offset| can be
   // negative. In that case, the offset is understood as starting from the end
-  // of the contents.
+  // of the contents. If the reference is not local, only the requested part is
+  // downloaded. See |storage::PageStorage::GetObjectPart|.
   static void GetPartialReferenceAsBuffer(
       storage::PageStorage* storage,
       convert::ExtendedStringView reference_id,
@@ -39,6 +41,10 @@ class PageUtils {
   // Returns true if a key matches the provided prefix, false otherwise.
   static bool MatchesPrefix(const std::string& key, const std::string& prefix);
 
+  // Returns the smallest key greater than all keys starting with |prefix|, or
+  // an empty string if there is no such key.
+  static std::string GetPrefixEnd(std::string prefix);
+
  private:
   FTL_DISALLOW_COPY_AND_ASSIGN(PageUtils);
 };
@@ -0,0 +1,115 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/app/value_cache.h"
+
+#include <utility>
+
+#include "apps/ledger/src/app/page_utils.h"
+#include "lib/ftl/logging.h"
+#include "lib/mtl/vmo/strings.h"
+
+namespace ledger {
+
+namespace {
+
+// Returns in |result| a read-only handle to |buffer|.
+bool ShareBuffer(const mx::vmo& buffer, mx::vmo* result) {
+  return buffer.duplicate(
+             MX_RIGHT_DUPLICATE | MX_RIGHT_TRANSFER | MX_RIGHT_READ, result) ==
+         NO_ERROR;
+}
+
+}  // namespace
+
+constexpr size_t ValueCache::kDefaultMaxSize;
+constexpr size_t ValueCache::kDefaultMaxValueSize;
+
+ValueCache::ValueCache(storage::PageStorage* storage,
+                       size_t max_size,
+                       size_t max_value_size)
+    : storage_(storage),
+      max_size_(max_size),
+      max_value_size_(max_value_size),
+      weak_factory_(this) {
+  FTL_DCHECK(max_value_size_ <= max_size_);
+}
+
+ValueCache::~ValueCache() {}
+
+void ValueCache::GetValue(storage::ObjectIdView object_id,
+                          storage::PageStorage::Location location,
+                          Status not_found_status,
+                          std::function<void(Status, mx::vmo)> callback) {
+  mx::vmo buffer;
+  if (Lookup(object_id.ToString(), &buffer)) {
+    ++hit_count_;
+    callback(Status::OK, std::move(buffer));
+    return;
+  }
+  ++miss_count_;
+  storage_->GetObjectPart(
+      object_id, 0, -1, location, [
+        weak_this = weak_factory_.GetWeakPtr(),
+        object_id = object_id.ToString(), not_found_status,
+        callback = std::move(callback)
+      ](storage::Status status, std::string data) {
+        if (status != storage::Status::OK) {
+          callback(PageUtils::ConvertStatus(status, not_found_status),
+                   mx::vmo());
+          return;
+        }
+        mx::vmo buffer;
+        if (!mtl::VmoFromString(data, &buffer)) {
+          callback(Status::UNKNOWN_ERROR, mx::vmo());
+          return;
+        }
+        // The caller always receives a read-only handle, whether the buffer
+        // is cached and shared with other readers or not.
+        mx::vmo shared_buffer;
+        if (!ShareBuffer(buffer, &shared_buffer)) {
+          callback(Status::INTERNAL_ERROR, mx::vmo());
+          return;
+        }
+        if (weak_this && data.size() <= weak_this->max_value_size_) {
+          weak_this->Insert(std::move(object_id), buffer, data.size());
+        }
+        callback(Status::OK, std::move(shared_buffer));
+      });
+}
+
+bool ValueCache::Lookup(const storage::ObjectId& object_id, mx::vmo* buffer) {
+  auto it = values_.find(object_id);
+  if (it == values_.end() || !ShareBuffer(it->second.buffer, buffer)) {
+    return false;
+  }
+  lru_.splice(lru_.end(), lru_, it->second.lru_position);
+  return true;
+}
+
+void ValueCache::Insert(storage::ObjectId object_id,
+                        const mx::vmo& buffer,
+                        size_t size) {
+  if (values_.count(object_id) > 0) {
+    // The value was read concurrently by another reader.
+    return;
+  }
+  CachedValue value;
+  if (!ShareBuffer(buffer, &value.buffer)) {
+    return;
+  }
+  value.size = size;
+  value.lru_position = lru_.insert(lru_.end(), object_id);
+  values_.emplace(std::move(object_id), std::move(value));
+  size_ += size;
+  while (size_ > max_size_) {
+    auto it = values_.find(lru_.front());
+    FTL_DCHECK(it != values_.end());
+    size_ -= it->second.size;
+    values_.erase(it);
+    lru_.pop_front();
+  }
+}
+
+}  // namespace ledger
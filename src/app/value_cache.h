@@ -0,0 +1,89 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_APP_VALUE_CACHE_H_
+#define APPS_LEDGER_SRC_APP_VALUE_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <list>
+#include <map>
+
+#include "apps/ledger/services/public/ledger.fidl.h"
+#include "apps/ledger/src/storage/public/page_storage.h"
+#include "apps/ledger/src/storage/public/types.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
+#include "mx/vmo.h"
+
+namespace ledger {
+
+// Caches the values read by the snapshots of a page, keyed by object id. The
+// values are kept in buffers shared with the readers through read-only
+// handles, so that reading a cached value neither reads the object from disk
+// nor copies it. Values larger than |max_value_size| bytes are not cached, and
+// the least recently used values are evicted to keep the total size of the
+// cached values under |max_size| bytes.
+class ValueCache {
+ public:
+  static constexpr size_t kDefaultMaxSize = 1024 * 1024;
+  static constexpr size_t kDefaultMaxValueSize = 64 * 1024;
+
+  explicit ValueCache(storage::PageStorage* storage,
+                      size_t max_size = kDefaultMaxSize,
+                      size_t max_value_size = kDefaultMaxValueSize);
+  ~ValueCache();
+
+  // Returns in |callback| a read-only buffer with the value |object_id|, cached
+  // or not. Values not cached are read from |location|. If the value is not
+  // found, |not_found_status| is returned.
+  void GetValue(storage::ObjectIdView object_id,
+                storage::PageStorage::Location location,
+                Status not_found_status,
+                std::function<void(Status, mx::vmo)> callback);
+
+  // Returns the total size of the cached values, in bytes.
+  size_t size() const { return size_; }
+  // Returns the number of values returned from the cache.
+  uint64_t hit_count() const { return hit_count_; }
+  // Returns the number of values read from storage.
+  uint64_t miss_count() const { return miss_count_; }
+
+ private:
+  struct CachedValue {
+    mx::vmo buffer;
+    size_t size;
+    // The position of the value in |lru_|.
+    std::list<storage::ObjectId>::iterator lru_position;
+  };
+
+  // Sets |buffer| to a read-only handle to the cached value |object_id| and
+  // returns true, or returns false if the value is not cached.
+  bool Lookup(const storage::ObjectId& object_id, mx::vmo* buffer);
+
+  // Caches |buffer|, holding |size| bytes, as the value |object_id|, if it is
+  // small enough.
+  void Insert(storage::ObjectId object_id, const mx::vmo& buffer, size_t size);
+
+  storage::PageStorage* const storage_;
+  const size_t max_size_;
+  const size_t max_value_size_;
+  std::map<storage::ObjectId, CachedValue> values_;
+  // The ids of the cached values, from the least to the most recently used.
+  std::list<storage::ObjectId> lru_;
+  size_t size_ = 0u;
+  uint64_t hit_count_ = 0u;
+  uint64_t miss_count_ = 0u;
+
+  // Must be the last member field.
+  ftl::WeakPtrFactory<ValueCache> weak_factory_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ValueCache);
+};
+
+}  // namespace ledger
+
+#endif  // APPS_LEDGER_SRC_APP_VALUE_CACHE_H_
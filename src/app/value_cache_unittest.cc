@@ -0,0 +1,143 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/app/value_cache.h"
+
+#include <map>
+#include <string>
+
+#include "apps/ledger/src/storage/test/page_storage_empty_impl.h"
+#include "gtest/gtest.h"
+#include "lib/ftl/macros.h"
+#include "lib/mtl/vmo/strings.h"
+
+namespace ledger {
+namespace {
+
+// PageStorage whose objects are the values of |objects|, counting the reads.
+class FakeObjectPageStorage : public storage::test::PageStorageEmptyImpl {
+ public:
+  FakeObjectPageStorage() {}
+  ~FakeObjectPageStorage() override {}
+
+  void GetObjectPart(
+      storage::ObjectIdView object_id,
+      int64_t /*offset*/,
+      int64_t /*max_size*/,
+      Location /*location*/,
+      const std::function<void(storage::Status, std::string)>& callback)
+      override {
+    ++read_count;
+    auto it = objects.find(object_id.ToString());
+    if (it == objects.end()) {
+      callback(storage::Status::NOT_FOUND, "");
+      return;
+    }
+    callback(storage::Status::OK, it->second);
+  }
+
+  std::map<storage::ObjectId, std::string> objects;
+  size_t read_count = 0u;
+
+ private:
+  FTL_DISALLOW_COPY_AND_ASSIGN(FakeObjectPageStorage);
+};
+
+class ValueCacheTest : public ::testing::Test {
+ public:
+  ValueCacheTest() {}
+  ~ValueCacheTest() override {}
+
+ protected:
+  // Returns the value |object_id| read through |cache|.
+  std::string GetValue(ValueCache* cache, storage::ObjectIdView object_id) {
+    std::string result;
+    cache->GetValue(object_id, storage::PageStorage::Location::LOCAL,
+                    Status::NEEDS_FETCH,
+                    [&result](Status status, mx::vmo value) {
+                      EXPECT_EQ(Status::OK, status);
+                      EXPECT_TRUE(mtl::StringFromVmo(value, &result));
+                    });
+    return result;
+  }
+
+  FakeObjectPageStorage storage_;
+
+ private:
+  FTL_DISALLOW_COPY_AND_ASSIGN(ValueCacheTest);
+};
+
+TEST_F(ValueCacheTest, CacheSmallValues) {
+  ValueCache cache(&storage_);
+  storage_.objects["id"] = "value";
+
+  EXPECT_EQ("value", GetValue(&cache, "id"));
+  EXPECT_EQ("value", GetValue(&cache, "id"));
+  EXPECT_EQ(1u, storage_.read_count);
+  EXPECT_EQ(1u, cache.hit_count());
+  EXPECT_EQ(1u, cache.miss_count());
+  EXPECT_EQ(5u, cache.size());
+}
+
+TEST_F(ValueCacheTest, DoNotCacheLargeValues) {
+  ValueCache cache(&storage_, 16u, 4u);
+  storage_.objects["id"] = "large value";
+
+  EXPECT_EQ("large value", GetValue(&cache, "id"));
+  EXPECT_EQ("large value", GetValue(&cache, "id"));
+  EXPECT_EQ(2u, storage_.read_count);
+  EXPECT_EQ(0u, cache.hit_count());
+  EXPECT_EQ(0u, cache.size());
+}
+
+TEST_F(ValueCacheTest, EvictLeastRecentlyUsedValues) {
+  ValueCache cache(&storage_, 8u, 4u);
+  storage_.objects["a"] = "aaaa";
+  storage_.objects["b"] = "bbbb";
+  storage_.objects["c"] = "cccc";
+
+  GetValue(&cache, "a");
+  GetValue(&cache, "b");
+  GetValue(&cache, "a");
+  // Caching "c" evicts "b", the least recently used value.
+  GetValue(&cache, "c");
+  EXPECT_EQ(8u, cache.size());
+  EXPECT_EQ(3u, storage_.read_count);
+
+  GetValue(&cache, "a");
+  EXPECT_EQ(3u, storage_.read_count);
+  GetValue(&cache, "b");
+  EXPECT_EQ(4u, storage_.read_count);
+}
+
+TEST_F(ValueCacheTest, ReturnReadOnlyBuffers) {
+  ValueCache cache(&storage_, 16u, 4u);
+  storage_.objects["small"] = "a";
+  storage_.objects["large"] = "large value";
+
+  for (const char* object_id : {"small", "large"}) {
+    mx::vmo buffer;
+    cache.GetValue(object_id, storage::PageStorage::Location::LOCAL,
+                   Status::NEEDS_FETCH,
+                   [&buffer](Status status, mx::vmo value) {
+                     EXPECT_EQ(Status::OK, status);
+                     buffer = std::move(value);
+                   });
+    size_t written;
+    EXPECT_NE(NO_ERROR, buffer.write("b", 0, 1, &written)) << object_id;
+  }
+}
+
+TEST_F(ValueCacheTest, NotFound) {
+  ValueCache cache(&storage_);
+  Status status = Status::OK;
+  cache.GetValue("id", storage::PageStorage::Location::LOCAL,
+                 Status::NEEDS_FETCH,
+                 [&status](Status s, mx::vmo value) { status = s; });
+  EXPECT_EQ(Status::NEEDS_FETCH, status);
+  EXPECT_EQ(0u, cache.size());
+}
+
+}  // namespace
+}  // namespace ledger
@@ -6,9 +6,11 @@
 #define APPS_LEDGER_SRC_CALLBACK_OPERATION_SERIALIZER_H_
 
 #include <functional>
+#include <memory>
 #include <queue>
 
 #include "lib/ftl/functional/closure.h"
+#include "lib/ftl/logging.h"
 #include "lib/ftl/macros.h"
 
 namespace callback {
@@ -27,6 +29,13 @@ namespace callback {
 template <class... C>
 class OperationSerializer {
  public:
+  // Queues an operation in a place reserved by |ReserveSlot()|. Takes the same
+  // arguments as |Serialize()|.
+  using Slot =
+      std::function<void(std::function<void(C...)> callback,
+                         std::function<void(std::function<void(C...)>)>
+                             operation)>;
+
   OperationSerializer() {}
   ~OperationSerializer() {}
 
@@ -36,21 +45,35 @@ class OperationSerializer {
   // |callback| is called with the result returned by |operation|.
   void Serialize(std::function<void(C...)> callback,
                  std::function<void(std::function<void(C...)>)> operation) {
-    auto closure = [
-      this, callback = std::move(callback), operation = std::move(operation)
-    ] {
-      operation([ this, callback = std::move(callback) ](C... args) {
-        callback(args...);
-        queued_operations_.pop();
-        if (!queued_operations_.empty()) {
-          queued_operations_.front()();
-        }
-      });
+    ReserveSlot()(std::move(callback), std::move(operation));
+  }
+
+  // Reserves the next place in the queue for an operation that is not known
+  // yet, e.g. because it depends on some preparation work. This allows the
+  // preparation to run concurrently with the operations in progress while
+  // keeping the order of the operations. The operations queued after the slot
+  // are not executed until the returned |Slot| is called, which must happen
+  // exactly once.
+  Slot ReserveSlot() {
+    auto pending_operation = std::make_shared<ftl::Closure>();
+    queued_operations_.push(pending_operation);
+    return [ this, pending_operation ](
+        std::function<void(C...)> callback,
+        std::function<void(std::function<void(C...)>)> operation) {
+      FTL_DCHECK(!*pending_operation);
+      *pending_operation = [
+        this, callback = std::move(callback), operation = std::move(operation)
+      ] {
+        operation([ this, callback = std::move(callback) ](C... args) {
+          callback(args...);
+          queued_operations_.pop();
+          RunNextOperation();
+        });
+      };
+      if (queued_operations_.front() == pending_operation) {
+        RunNextOperation();
+      }
     };
-    queued_operations_.emplace(std::move(closure));
-    if (queued_operations_.size() == 1) {
-      queued_operations_.front()();
-    }
   }
 
   // Returns true if there are no more operations in the queue or false
@@ -58,7 +81,19 @@ class OperationSerializer {
   bool empty() { return queued_operations_.empty(); }
 
  private:
-  std::queue<ftl::Closure> queued_operations_;
+  // Executes the operation at the front of the queue if it is known.
+  void RunNextOperation() {
+    if (queued_operations_.empty() || !*queued_operations_.front()) {
+      return;
+    }
+    // The operation may terminate synchronously and be removed from the queue
+    // while it runs.
+    std::shared_ptr<ftl::Closure> operation = queued_operations_.front();
+    (*operation)();
+  }
+
+  // Operations in a reserved slot are null until the slot is filled.
+  std::queue<std::shared_ptr<ftl::Closure>> queued_operations_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(OperationSerializer);
 };
@@ -0,0 +1,75 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/callback/operation_serializer.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace callback {
+namespace {
+
+TEST(OperationSerializer, SerializeOperations) {
+  OperationSerializer<int> serializer;
+  std::vector<int> results;
+  std::function<void(int)> pending_callback;
+
+  serializer.Serialize([&results](int result) { results.push_back(result); },
+                       [&pending_callback](std::function<void(int)> callback) {
+                         pending_callback = std::move(callback);
+                       });
+  serializer.Serialize([&results](int result) { results.push_back(result); },
+                       [](std::function<void(int)> callback) { callback(2); });
+
+  // The second operation waits for the first one.
+  EXPECT_TRUE(results.empty());
+  EXPECT_FALSE(serializer.empty());
+  pending_callback(1);
+  EXPECT_EQ(std::vector<int>({1, 2}), results);
+  EXPECT_TRUE(serializer.empty());
+}
+
+TEST(OperationSerializer, ReserveSlot) {
+  OperationSerializer<int> serializer;
+  std::vector<int> results;
+
+  auto slot = serializer.ReserveSlot();
+  serializer.Serialize([&results](int result) { results.push_back(result); },
+                       [](std::function<void(int)> callback) { callback(2); });
+
+  // The operation queued after the slot waits for it to be filled.
+  EXPECT_TRUE(results.empty());
+  slot([&results](int result) { results.push_back(result); },
+       [](std::function<void(int)> callback) { callback(1); });
+  EXPECT_EQ(std::vector<int>({1, 2}), results);
+  EXPECT_TRUE(serializer.empty());
+}
+
+TEST(OperationSerializer, FillSlotWhileRunning) {
+  OperationSerializer<int> serializer;
+  std::vector<int> results;
+  std::function<void(int)> pending_callback;
+
+  serializer.Serialize([&results](int result) { results.push_back(result); },
+                       [&pending_callback](std::function<void(int)> callback) {
+                         pending_callback = std::move(callback);
+                       });
+  auto slot = serializer.ReserveSlot();
+  bool started = false;
+  slot([&results](int result) { results.push_back(result); },
+       [&started](std::function<void(int)> callback) {
+         started = true;
+         callback(2);
+       });
+
+  // The slot is filled but the first operation is still running.
+  EXPECT_FALSE(started);
+  pending_callback(1);
+  EXPECT_TRUE(started);
+  EXPECT_EQ(std::vector<int>({1, 2}), results);
+}
+
+}  // namespace
+}  // namespace callback
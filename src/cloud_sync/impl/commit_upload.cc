@@ -61,7 +61,7 @@ void CommitUpload::Start() {
 
 void CommitUpload::UploadObject(std::unique_ptr<const storage::Object> object) {
   ftl::StringView data_view;
-  auto status = object->GetData(&data_view);
+  auto status = object->GetStorageBytes(&data_view);
   FTL_DCHECK(status == storage::Status::OK);
 
   // TODO(ppi): get the virtual memory object directly from storage::Object,
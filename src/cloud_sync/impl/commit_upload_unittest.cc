@@ -52,6 +52,25 @@ class TestObject : public storage::Object {
     return storage::Status::OK;
   }
 
+  storage::Status GetSize(uint64_t* size) const override {
+    *size = data.size();
+    return storage::Status::OK;
+  }
+
+  storage::Status ReadData(int64_t offset,
+                           int64_t max_size,
+                           std::string* result) const override {
+    uint64_t start;
+    uint64_t length;
+    storage::GetDataPart(data.size(), offset, max_size, &start, &length);
+    *result = data.substr(start, length);
+    return storage::Status::OK;
+  }
+
+  storage::Status GetStorageBytes(ftl::StringView* result) const override {
+    return GetData(result);
+  }
+
   storage::ObjectId id;
   std::string data;
 };
@@ -23,6 +23,30 @@ Status FakeJournal::Delete(convert::ExtendedStringView key) {
   return delegate_->Delete(key);
 }
 
+Status FakeJournal::DeleteRange(convert::ExtendedStringView min_key,
+                                convert::ExtendedStringView max_key) {
+  // The fake journal only records the changes made on top of its parent.
+  return Status::NOT_IMPLEMENTED;
+}
+
+Status FakeJournal::SetFanout(uint8_t fanout_bits) {
+  // The fake storage does not store the contents in a tree.
+  return Status::OK;
+}
+
+Status FakeJournal::GetContents(std::vector<EntryChange>* changes,
+                                std::vector<KeyRange>* deleted_ranges) {
+  changes->clear();
+  for (const auto& key_entry : delegate_->GetData()) {
+    const FakeJournalDelegate::Entry& entry = key_entry.second;
+    changes->push_back(EntryChange{
+        Entry{key_entry.first, entry.value, entry.priority}, entry.deleted});
+  }
+  // |DeleteRange| is not supported.
+  deleted_ranges->clear();
+  return Status::OK;
+}
+
 void FakeJournal::Commit(
     std::function<void(Status, std::unique_ptr<const storage::Commit>)>
         callback) {
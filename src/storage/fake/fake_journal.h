@@ -27,6 +27,11 @@ class FakeJournal : public Journal {
              ObjectIdView object_id,
              KeyPriority priority) override;
   Status Delete(convert::ExtendedStringView key) override;
+  Status DeleteRange(convert::ExtendedStringView min_key,
+                     convert::ExtendedStringView max_key) override;
+  Status SetFanout(uint8_t fanout_bits) override;
+  Status GetContents(std::vector<EntryChange>* changes,
+                     std::vector<KeyRange>* deleted_ranges) override;
   void Commit(
       std::function<void(Status, std::unique_ptr<const storage::Commit>)>
           callback) override;
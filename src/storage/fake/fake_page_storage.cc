@@ -4,6 +4,7 @@
 
 #include "apps/ledger/src/storage/fake/fake_page_storage.h"
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -30,12 +31,45 @@ class FakeObject : public Object {
     *data = content_;
     return Status::OK;
   }
+  Status GetSize(uint64_t* size) const override {
+    *size = content_.size();
+    return Status::OK;
+  }
+  Status ReadData(int64_t offset,
+                  int64_t max_size,
+                  std::string* data) const override {
+    uint64_t start;
+    uint64_t length;
+    GetDataPart(content_.size(), offset, max_size, &start, &length);
+    *data = content_.substr(start, length);
+    return Status::OK;
+  }
+  Status GetStorageBytes(ftl::StringView* data) const override {
+    return GetData(data);
+  }
 
  private:
   ObjectId id_;
   std::string content_;
 };
 
+// The fake cursor only records the key of the next entry: resuming the
+// iteration looks it up again.
+class FakeContentsCursor : public PageStorage::ContentsCursor {
+ public:
+  FakeContentsCursor(std::unique_ptr<const Commit> commit,
+                     std::string next_key,
+                     std::string max_key)
+      : commit(std::move(commit)),
+        next_key(std::move(next_key)),
+        max_key(std::move(max_key)) {}
+  ~FakeContentsCursor() override {}
+
+  const std::unique_ptr<const Commit> commit;
+  const std::string next_key;
+  const std::string max_key;
+};
+
 storage::ObjectId ComputeObjectId(ftl::StringView value) {
   return glue::SHA256Hash(value.data(), value.size());
 }
@@ -136,6 +170,42 @@ void FakePageStorage::GetObject(
       [this] { SendNextObject(); }, ftl::TimeDelta::FromMilliseconds(5));
 }
 
+void FakePageStorage::GetObjectPart(
+    ObjectIdView object_id,
+    int64_t offset,
+    int64_t max_size,
+    Location location,
+    const std::function<void(Status, std::string)>& callback) {
+  object_requests_.push_back([
+    this, object_id = object_id.ToString(), offset, max_size,
+    callback = std::move(callback)
+  ] {
+    auto it = objects_.find(object_id);
+    if (it == objects_.end()) {
+      callback(Status::NOT_FOUND, "");
+      return;
+    }
+
+    uint64_t start;
+    uint64_t length;
+    GetDataPart(it->second.size(), offset, max_size, &start, &length);
+    callback(Status::OK, it->second.substr(start, length));
+  });
+  mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+      [this] { SendNextObject(); }, ftl::TimeDelta::FromMilliseconds(5));
+}
+
+void FakePageStorage::GetObjectSize(
+    ObjectIdView object_id,
+    const std::function<void(Status, uint64_t)>& callback) {
+  auto it = objects_.find(object_id.ToString());
+  if (it == objects_.end()) {
+    callback(Status::NOT_FOUND, 0u);
+    return;
+  }
+  callback(Status::OK, it->second.size());
+}
+
 void FakePageStorage::GetCommitContents(const Commit& commit,
                                         std::string min_key,
                                         std::function<bool(Entry)> on_next,
@@ -171,6 +241,81 @@ void FakePageStorage::GetCommitContents(const Commit& commit,
   on_done(Status::OK);
 }
 
+void FakePageStorage::GetCommitContentsInRange(
+    const Commit& commit,
+    std::string min_key,
+    std::string max_key,
+    uint64_t max_count,
+    bool reverse,
+    std::function<bool(Entry)> on_next,
+    std::function<void(Status)> on_done) {
+  std::vector<Entry> entries;
+  Status status;
+  GetCommitContents(commit, std::move(min_key),
+                    [&entries, &max_key](Entry entry) {
+                      if (!max_key.empty() && entry.key >= max_key) {
+                        return false;
+                      }
+                      entries.push_back(std::move(entry));
+                      return true;
+                    },
+                    [&status](Status s) { status = s; });
+  if (status != Status::OK) {
+    on_done(status);
+    return;
+  }
+  if (reverse) {
+    std::reverse(entries.begin(), entries.end());
+  }
+  uint64_t count = 0;
+  for (auto& entry : entries) {
+    if ((max_count && count == max_count) || !on_next(std::move(entry))) {
+      break;
+    }
+    ++count;
+  }
+  on_done(Status::OK);
+}
+
+void FakePageStorage::GetCommitContentsWithCursor(
+    const Commit& commit,
+    std::string min_key,
+    std::string max_key,
+    std::function<bool(Entry)> on_next,
+    std::function<void(Status, std::unique_ptr<ContentsCursor>)> on_done) {
+  bool interrupted = false;
+  std::string next_key;
+  Status status;
+  GetCommitContentsInRange(commit, std::move(min_key), max_key, 0u, false,
+                           [&on_next, &interrupted, &next_key](Entry entry) {
+                             std::string key = entry.key;
+                             if (on_next(std::move(entry))) {
+                               return true;
+                             }
+                             interrupted = true;
+                             next_key = std::move(key);
+                             return false;
+                           },
+                           [&status](Status s) { status = s; });
+  if (status != Status::OK || !interrupted) {
+    on_done(status, nullptr);
+    return;
+  }
+  on_done(Status::OK,
+          std::make_unique<FakeContentsCursor>(
+              commit.Clone(), std::move(next_key), std::move(max_key)));
+}
+
+void FakePageStorage::ResumeCommitContents(
+    std::unique_ptr<ContentsCursor> cursor,
+    std::function<bool(Entry)> on_next,
+    std::function<void(Status, std::unique_ptr<ContentsCursor>)> on_done) {
+  auto fake_cursor = static_cast<FakeContentsCursor*>(cursor.get());
+  GetCommitContentsWithCursor(*fake_cursor->commit, fake_cursor->next_key,
+                              fake_cursor->max_key, std::move(on_next),
+                              std::move(on_done));
+}
+
 void FakePageStorage::GetEntryFromCommit(
     const Commit& commit,
     std::string key,
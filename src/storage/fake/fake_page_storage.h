@@ -45,10 +45,38 @@ class FakePageStorage : public test::PageStorageEmptyImpl {
       Location location,
       const std::function<void(Status, std::unique_ptr<const Object>)>&
           callback) override;
+  void GetObjectPart(
+      ObjectIdView object_id,
+      int64_t offset,
+      int64_t max_size,
+      Location location,
+      const std::function<void(Status, std::string)>& callback) override;
+  void GetObjectSize(
+      ObjectIdView object_id,
+      const std::function<void(Status, uint64_t)>& callback) override;
   void GetCommitContents(const Commit& commit,
                          std::string min_key,
                          std::function<bool(Entry)> on_next,
                          std::function<void(Status)> on_done) override;
+  void GetCommitContentsInRange(const Commit& commit,
+                                std::string min_key,
+                                std::string max_key,
+                                uint64_t max_count,
+                                bool reverse,
+                                std::function<bool(Entry)> on_next,
+                                std::function<void(Status)> on_done) override;
+  void GetCommitContentsWithCursor(
+      const Commit& commit,
+      std::string min_key,
+      std::string max_key,
+      std::function<bool(Entry)> on_next,
+      std::function<void(Status, std::unique_ptr<ContentsCursor>)> on_done)
+      override;
+  void ResumeCommitContents(
+      std::unique_ptr<ContentsCursor> cursor,
+      std::function<bool(Entry)> on_next,
+      std::function<void(Status, std::unique_ptr<ContentsCursor>)> on_done)
+      override;
   void GetEntryFromCommit(const Commit& commit,
                           std::string key,
                           std::function<void(Status, Entry)> callback) override;
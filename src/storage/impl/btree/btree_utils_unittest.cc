@@ -6,6 +6,7 @@
 #include <stdio.h>
 
 #include <algorithm>
+#include <tuple>
 
 #include "apps/ledger/src/callback/capture.h"
 #include "apps/ledger/src/coroutine/coroutine_impl.h"
@@ -14,6 +15,7 @@
 #include "apps/ledger/src/storage/impl/btree/diff.h"
 #include "apps/ledger/src/storage/impl/btree/entry_change_iterator.h"
 #include "apps/ledger/src/storage/impl/btree/iterator.h"
+#include "apps/ledger/src/storage/impl/btree/stats.h"
 #include "apps/ledger/src/storage/impl/btree/tree_node.h"
 #include "apps/ledger/src/storage/public/constants.h"
 #include "apps/ledger/src/storage/public/types.h"
@@ -258,6 +260,118 @@ TEST_F(BTreeUtilsTest, ApplyChangesManyEntries) {
   }
 }
 
+TEST_F(BTreeUtilsTest, ApplyChangesFlushesFinishedNodes) {
+  // Enough changes for the builder to flush the nodes it has finished building
+  // while applying them.
+  const size_t kEntryCount = 3000;
+  std::vector<EntryChange> changes;
+  for (size_t i = 0; i < kEntryCount; ++i) {
+    changes.push_back(EntryChange{
+        Entry{ftl::StringPrintf("key%04" PRIuMAX, i),
+              MakeObjectId(ftl::StringPrintf("object%04" PRIuMAX, i)),
+              KeyPriority::EAGER},
+        false});
+  }
+
+  ObjectId empty_root_id;
+  ASSERT_TRUE(GetEmptyNodeId(&empty_root_id));
+  Status status;
+  ObjectId root_id;
+  std::unordered_set<ObjectId> new_nodes;
+  ApplyChanges(
+      &coroutine_service_, &fake_storage_, empty_root_id,
+      std::make_unique<EntryChangeIterator>(changes.begin(), changes.end()),
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &root_id, &new_nodes));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+
+  std::vector<Entry> entries = GetEntriesList(root_id);
+  ASSERT_EQ(kEntryCount, entries.size());
+  for (size_t i = 0; i < kEntryCount; ++i) {
+    EXPECT_EQ(changes[i].entry, entries[i]);
+  }
+
+  // Applying the same changes in batches too small to be flushed gives the
+  // same tree.
+  const size_t kBatchSize = 500;
+  ObjectId batch_root_id = empty_root_id;
+  for (size_t i = 0; i < kEntryCount; i += kBatchSize) {
+    ApplyChanges(&coroutine_service_, &fake_storage_, batch_root_id,
+                 std::make_unique<EntryChangeIterator>(
+                     changes.begin() + i, changes.begin() + i + kBatchSize),
+                 callback::Capture([this] { message_loop_.PostQuitTask(); },
+                                   &status, &batch_root_id, &new_nodes));
+    ASSERT_FALSE(RunLoopWithTimeout());
+    ASSERT_EQ(Status::OK, status);
+  }
+  EXPECT_EQ(root_id, batch_root_id);
+}
+
+TEST_F(BTreeUtilsTest, IncrementalBuilder) {
+  ObjectId empty_root_id;
+  ASSERT_TRUE(GetEmptyNodeId(&empty_root_id));
+  std::vector<EntryChange> entries;
+  ASSERT_TRUE(CreateEntryChanges(50, &entries));
+  std::vector<EntryChange> deletions;
+  ASSERT_TRUE(
+      CreateEntryChanges(std::vector<size_t>({10, 20}), &deletions, true));
+
+  // Changes do not need to be sorted, and later changes override earlier ones.
+  IncrementalBuilder builder(
+      &coroutine_service_, &fake_storage_,
+      [&empty_root_id](std::function<void(Status, ObjectId)> callback) {
+        callback(Status::OK, empty_root_id);
+      });
+  for (size_t i = entries.size(); i > 0; --i) {
+    builder.Apply(entries[i - 1]);
+  }
+  for (const auto& deletion : deletions) {
+    builder.Apply(deletion);
+  }
+  Status status;
+  ObjectId root_id;
+  std::unordered_set<ObjectId> new_nodes;
+  builder.Finish(callback::Capture([this] { message_loop_.PostQuitTask(); },
+                                   &status, &root_id, &new_nodes));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  EXPECT_EQ(48u, GetEntriesList(root_id).size());
+  EXPECT_TRUE(new_nodes.find(root_id) != new_nodes.end());
+
+  // The tree is the same as the one built from the final entries.
+  entries.erase(entries.begin() + 20);
+  entries.erase(entries.begin() + 10);
+  ObjectId expected_root_id;
+  ApplyChanges(
+      &coroutine_service_, &fake_storage_, empty_root_id,
+      std::make_unique<EntryChangeIterator>(entries.begin(), entries.end()),
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &expected_root_id, &new_nodes));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  EXPECT_EQ(expected_root_id, root_id);
+
+  // Changes cancelling each other leave the tree unchanged.
+  std::vector<EntryChange> insertions;
+  ASSERT_TRUE(CreateEntryChanges(std::vector<size_t>({10}), &insertions));
+  IncrementalBuilder no_op_builder(
+      &coroutine_service_, &fake_storage_,
+      [&root_id](std::function<void(Status, ObjectId)> callback) {
+        callback(Status::OK, root_id);
+      });
+  no_op_builder.Apply(insertions[0]);
+  no_op_builder.Apply(deletions[0]);
+  ObjectId no_op_root_id;
+  no_op_builder.Finish(
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &no_op_root_id, &new_nodes));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  EXPECT_EQ(root_id, no_op_root_id);
+  EXPECT_TRUE(new_nodes.empty());
+}
+
 TEST_F(BTreeUtilsTest, UpdateValue) {
   // Expected layout (XX is key "keyXX"):
   //                 [03, 07]
@@ -866,6 +980,93 @@ TEST_F(BTreeUtilsTest, ForEachDiff) {
   EXPECT_EQ(changes.size(), current_change);
 }
 
+TEST_F(BTreeUtilsTest, ForEachThreeWayDiff) {
+  std::unique_ptr<const Object> object;
+  ASSERT_TRUE(AddObject("change1", &object));
+  ObjectId object_id_1 = object->GetId();
+  ASSERT_TRUE(AddObject("change2", &object));
+  ObjectId object_id_2 = object->GetId();
+
+  std::vector<EntryChange> base_entries;
+  ASSERT_TRUE(CreateEntryChanges(50, &base_entries));
+  ObjectId base_root_id = CreateTree(base_entries);
+
+  auto apply_changes = [this, &base_root_id](std::vector<EntryChange> changes,
+                                             ObjectId* root_id) {
+    Status status;
+    std::unordered_set<ObjectId> new_nodes;
+    ApplyChanges(
+        &coroutine_service_, &fake_storage_, base_root_id,
+        std::make_unique<EntryChangeIterator>(changes.begin(), changes.end()),
+        callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                          root_id, &new_nodes),
+        &kTestNodeLevelCalculator);
+    EXPECT_FALSE(RunLoopWithTimeout());
+    EXPECT_EQ(Status::OK, status);
+  };
+
+  // Both sides update key01 to the same value and delete key40. Only the left
+  // side adds key255, and only the right side updates key10.
+  ObjectId left_root_id;
+  apply_changes(
+      {EntryChange{Entry{"key01", object_id_1, KeyPriority::EAGER}, false},
+       EntryChange{Entry{"key255", object_id_1, KeyPriority::EAGER}, false},
+       EntryChange{Entry{"key40", "", KeyPriority::EAGER}, true}},
+      &left_root_id);
+  ObjectId right_root_id;
+  apply_changes(
+      {EntryChange{Entry{"key01", object_id_1, KeyPriority::EAGER}, false},
+       EntryChange{Entry{"key10", object_id_2, KeyPriority::EAGER}, false},
+       EntryChange{Entry{"key40", "", KeyPriority::EAGER}, true}},
+      &right_root_id);
+
+  std::vector<ThreeWayChange> changes;
+  Status status;
+  ForEachThreeWayDiff(
+      &coroutine_service_, &fake_storage_, base_root_id, left_root_id,
+      right_root_id, "",
+      [&changes](ThreeWayChange change) {
+        changes.push_back(std::move(change));
+        return true;
+      },
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+
+  ASSERT_EQ(4u, changes.size());
+  EXPECT_EQ(base_entries[1].entry, *changes[0].base);
+  EXPECT_EQ(object_id_1, changes[0].left->object_id);
+  EXPECT_EQ(*changes[0].left, *changes[0].right);
+
+  EXPECT_EQ(base_entries[10].entry, *changes[1].base);
+  EXPECT_EQ(*changes[1].base, *changes[1].left);
+  EXPECT_EQ(object_id_2, changes[1].right->object_id);
+
+  EXPECT_FALSE(changes[2].base);
+  EXPECT_EQ("key255", changes[2].left->key);
+  EXPECT_FALSE(changes[2].right);
+
+  EXPECT_EQ(base_entries[40].entry, *changes[3].base);
+  EXPECT_FALSE(changes[3].left);
+  EXPECT_FALSE(changes[3].right);
+
+  // Starting from |min_key| skips the changes before it.
+  changes.clear();
+  ForEachThreeWayDiff(
+      &coroutine_service_, &fake_storage_, base_root_id, left_root_id,
+      right_root_id, "key2",
+      [&changes](ThreeWayChange change) {
+        changes.push_back(std::move(change));
+        return true;
+      },
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  ASSERT_EQ(2u, changes.size());
+  EXPECT_EQ("key255", changes[0].left->key);
+  EXPECT_EQ("key40", changes[1].base->key);
+}
+
 TEST_F(BTreeUtilsTest, ForEachDiffWithMinKey) {
   // Expected base tree layout (XX is key "keyXX"):
   //                     [50]
@@ -964,6 +1165,364 @@ TEST_F(BTreeUtilsTest, ForEachDiffWithMinKeySkipNodes) {
   ASSERT_EQ(Status::OK, status);
 }
 
+TEST_F(BTreeUtilsTest, BuildNodesWithStats) {
+  // Create a tree from entries with keys from 00-99.
+  std::vector<EntryChange> entries;
+  ASSERT_TRUE(CreateEntryChanges(100, &entries));
+  ObjectId root_id = CreateTree(entries);
+
+  std::unique_ptr<const TreeNode> root;
+  ASSERT_TRUE(CreateNodeFromId(root_id, &root));
+  ASSERT_TRUE(root->HasEntryCounts());
+  EXPECT_EQ(100u, root->GetSubtreeEntryCount());
+}
+
+TEST_F(BTreeUtilsTest, CountEntries) {
+  // Create a tree from entries with keys from 00-99.
+  std::vector<EntryChange> entries;
+  ASSERT_TRUE(CreateEntryChanges(100, &entries));
+  ObjectId root_id = CreateTree(entries);
+
+  std::vector<std::tuple<std::string, std::string, uint64_t>> ranges = {
+      std::make_tuple("", "", 100u),
+      std::make_tuple("key10", "key20", 10u),
+      std::make_tuple("key05", "key95", 90u),
+      std::make_tuple("key305", "key75", 44u),
+      std::make_tuple("key50", "key50", 0u),
+      std::make_tuple("key995", "", 0u),
+  };
+  for (const auto& range : ranges) {
+    Status status;
+    uint64_t count;
+    CountEntries(&coroutine_service_, &fake_storage_, root_id,
+                 std::get<0>(range), std::get<1>(range),
+                 callback::Capture([this] { message_loop_.PostQuitTask(); },
+                                   &status, &count));
+    ASSERT_FALSE(RunLoopWithTimeout());
+    ASSERT_EQ(Status::OK, status);
+    EXPECT_EQ(std::get<2>(range), count);
+  }
+}
+
+TEST_F(BTreeUtilsTest, CountEntriesWithoutStats) {
+  // Nodes created directly from entries do not hold statistics.
+  std::vector<Entry> entries;
+  ASSERT_TRUE(CreateEntries(10, &entries));
+  std::unique_ptr<const TreeNode> node;
+  ASSERT_TRUE(CreateNodeFromEntries(
+      entries, std::vector<ObjectId>(entries.size() + 1), &node));
+  EXPECT_FALSE(node->HasEntryCounts());
+
+  Status status;
+  uint64_t count;
+  CountEntries(&coroutine_service_, &fake_storage_, node->GetId(), "key03",
+               "key07", callback::Capture(
+                            [this] { message_loop_.PostQuitTask(); }, &status,
+                            &count));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  EXPECT_EQ(4u, count);
+
+  ContentsSize size;
+  GetRangeSize(&coroutine_service_, &fake_storage_, node->GetId(), "", "",
+               callback::Capture([this] { message_loop_.PostQuitTask(); },
+                                 &status, &size));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  EXPECT_EQ(10u, size.entry_count);
+  EXPECT_EQ(10u * 8u, size.value_bytes);
+}
+
+TEST_F(BTreeUtilsTest, GetRangeSize) {
+  // Create a tree from entries with keys from 00-99.
+  std::vector<EntryChange> entries;
+  ASSERT_TRUE(CreateEntryChanges(100, &entries));
+  ObjectId root_id = CreateTree(entries);
+
+  Status status;
+  ContentsSize size;
+  GetRangeSize(&coroutine_service_, &fake_storage_, root_id, "key10", "key20",
+               callback::Capture([this] { message_loop_.PostQuitTask(); },
+                                 &status, &size));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  EXPECT_EQ(10u, size.entry_count);
+  EXPECT_EQ(10u * 8u, size.value_bytes);
+}
+
+TEST_F(BTreeUtilsTest, ForEachEntryFromOffset) {
+  // Create a tree from entries with keys from 00-99.
+  std::vector<EntryChange> entries;
+  ASSERT_TRUE(CreateEntryChanges(100, &entries));
+  ObjectId root_id = CreateTree(entries);
+
+  std::vector<std::tuple<std::string, uint64_t, size_t>> queries = {
+      std::make_tuple("", 0u, 0u),          std::make_tuple("", 25u, 25u),
+      std::make_tuple("key10", 5u, 15u),    std::make_tuple("key305", 0u, 31u),
+      std::make_tuple("key50", 25u, 75u),   std::make_tuple("", 99u, 99u),
+      std::make_tuple("key60", 40u, 100u),
+  };
+  for (const auto& query : queries) {
+    size_t current_key = std::get<2>(query);
+    Status status;
+    ForEachEntryFromOffset(
+        &coroutine_service_, &fake_storage_, root_id, std::get<0>(query),
+        std::get<1>(query),
+        [&current_key](EntryAndNodeId e) {
+          EXPECT_EQ(ftl::StringPrintf("key%02zu", current_key), e.entry.key);
+          ++current_key;
+          return true;
+        },
+        callback::Capture([this] { message_loop_.PostQuitTask(); }, &status));
+    ASSERT_FALSE(RunLoopWithTimeout());
+    ASSERT_EQ(Status::OK, status);
+    EXPECT_EQ(100u, current_key);
+  }
+}
+
+TEST_F(BTreeUtilsTest, ForEachEntryInRange) {
+  // Create a tree from entries with keys from 00-99.
+  std::vector<EntryChange> entries;
+  ASSERT_TRUE(CreateEntryChanges(100, &entries));
+  ObjectId root_id = CreateTree(entries);
+
+  // Each query is given as: min_key, max_key, reverse, and the expected first
+  // and past-the-end key indices of the iteration.
+  std::vector<std::tuple<std::string, std::string, bool, int, int>> queries = {
+      std::make_tuple("", "", false, 0, 100),
+      std::make_tuple("key10", "key20", false, 10, 20),
+      std::make_tuple("key305", "key5", false, 31, 50),
+      std::make_tuple("key50", "key50", false, 50, 50),
+      std::make_tuple("", "", true, 99, -1),
+      std::make_tuple("key10", "key20", true, 19, 9),
+      std::make_tuple("key305", "key5", true, 49, 30),
+      std::make_tuple("", "key00", true, -1, -1),
+  };
+  for (const auto& query : queries) {
+    bool reverse = std::get<2>(query);
+    int current_key = std::get<3>(query);
+    Status status;
+    ForEachEntryInRange(
+        &coroutine_service_, &fake_storage_, root_id, std::get<0>(query),
+        std::get<1>(query), reverse,
+        [&current_key, reverse](EntryAndNodeId e) {
+          EXPECT_EQ(ftl::StringPrintf("key%02d", current_key), e.entry.key);
+          current_key += reverse ? -1 : 1;
+          return true;
+        },
+        callback::Capture([this] { message_loop_.PostQuitTask(); }, &status));
+    ASSERT_FALSE(RunLoopWithTimeout());
+    ASSERT_EQ(Status::OK, status);
+    EXPECT_EQ(std::get<4>(query), current_key);
+  }
+}
+
+TEST_F(BTreeUtilsTest, ForEachEntryWithIterator) {
+  // Create a tree from entries with keys from 00-99.
+  std::vector<EntryChange> entries;
+  ASSERT_TRUE(CreateEntryChanges(100, &entries));
+  ObjectId root_id = CreateTree(entries);
+
+  // Iterate over the entries in [key10, key90) by pages of 25 entries.
+  int current_key = 10;
+  std::unique_ptr<BTreeIterator> iterator;
+  for (int page_end : {35, 60, 85, 90}) {
+    auto on_next = [&current_key, page_end](EntryAndNodeId e) {
+      if (current_key == page_end) {
+        return false;
+      }
+      EXPECT_EQ(ftl::StringPrintf("key%02d", current_key), e.entry.key);
+      ++current_key;
+      return true;
+    };
+    Status status;
+    auto on_done = callback::Capture([this] { message_loop_.PostQuitTask(); },
+                                     &status, &iterator);
+    if (iterator) {
+      ResumeForEachEntry(&coroutine_service_, &fake_storage_,
+                         std::move(iterator), "key90", std::move(on_next),
+                         std::move(on_done));
+    } else {
+      ForEachEntryWithIterator(&coroutine_service_, &fake_storage_, root_id,
+                               "key10", "key90", std::move(on_next),
+                               std::move(on_done));
+    }
+    ASSERT_FALSE(RunLoopWithTimeout());
+    ASSERT_EQ(Status::OK, status);
+    EXPECT_EQ(page_end, current_key);
+    // The iterator is only returned if the iteration was interrupted.
+    EXPECT_EQ(page_end < 90, static_cast<bool>(iterator));
+  }
+}
+
+TEST_F(BTreeUtilsTest, ResumeForEachEntryDoesNotReadNodesAgain) {
+  // Create a tree from entries with keys from 00-99.
+  std::vector<EntryChange> entries;
+  ASSERT_TRUE(CreateEntryChanges(100, &entries));
+  ObjectId root_id = CreateTree(entries);
+
+  Status status;
+  std::unique_ptr<BTreeIterator> iterator;
+  ForEachEntryWithIterator(
+      &coroutine_service_, &fake_storage_, root_id, "key42", "",
+      [](EntryAndNodeId e) { return false; },
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &iterator));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  ASSERT_TRUE(iterator);
+
+  fake_storage_.object_requests.clear();
+  std::string key;
+  ResumeForEachEntry(
+      &coroutine_service_, &fake_storage_, std::move(iterator), "",
+      [&key](EntryAndNodeId e) {
+        key = e.entry.key;
+        return false;
+      },
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &iterator));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  EXPECT_TRUE(iterator);
+  EXPECT_EQ("key42", key);
+  EXPECT_TRUE(fake_storage_.object_requests.empty());
+}
+
+TEST_F(BTreeUtilsTest, ApplyChangesWithFanout) {
+  EXPECT_EQ(GetDefaultNodeLevelCalculator(),
+            GetNodeLevelCalculator(kDefaultFanoutBits));
+
+  // Create a tree from entries with keys from 00-99.
+  std::vector<EntryChange> entries;
+  ASSERT_TRUE(CreateEntryChanges(100, &entries));
+  ObjectId root_id = CreateTree(entries);
+
+  // Rebuild the tree with a smaller fan-out, deleting an entry at the same
+  // time.
+  std::vector<EntryChange> deletions;
+  ASSERT_TRUE(CreateEntryChanges(std::vector<size_t>({10}), &deletions, true));
+  Status status;
+  ObjectId small_root_id;
+  std::unordered_set<ObjectId> new_nodes;
+  ApplyChangesWithFanout(
+      &coroutine_service_, &fake_storage_, root_id, 2,
+      std::make_unique<EntryChangeIterator>(deletions.begin(),
+                                            deletions.end()),
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &small_root_id, &new_nodes));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  EXPECT_EQ(99u, GetEntriesList(small_root_id).size());
+
+  std::unique_ptr<const TreeNode> root;
+  ASSERT_TRUE(CreateNodeFromId(small_root_id, &root));
+  EXPECT_EQ(2u, root->fanout_bits());
+  EXPECT_EQ(99u, root->GetSubtreeEntryCount());
+
+  // Further changes keep the fan-out of the tree.
+  std::vector<EntryChange> insertions;
+  ASSERT_TRUE(CreateEntryChanges(std::vector<size_t>({10}), &insertions));
+  ObjectId updated_root_id;
+  ApplyChanges(&coroutine_service_, &fake_storage_, small_root_id,
+               std::make_unique<EntryChangeIterator>(insertions.begin(),
+                                                     insertions.end()),
+               callback::Capture([this] { message_loop_.PostQuitTask(); },
+                                 &status, &updated_root_id, &new_nodes));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  ASSERT_TRUE(CreateNodeFromId(updated_root_id, &root));
+  EXPECT_EQ(2u, root->fanout_bits());
+  EXPECT_EQ(100u, root->GetSubtreeEntryCount());
+
+  // The shape of the tree only depends on its contents and fan-out.
+  std::vector<EntryChange> no_changes;
+  ObjectId rebuilt_root_id;
+  ApplyChangesWithFanout(
+      &coroutine_service_, &fake_storage_, root_id, 2,
+      std::make_unique<EntryChangeIterator>(no_changes.begin(),
+                                            no_changes.end()),
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &rebuilt_root_id, &new_nodes));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  EXPECT_EQ(updated_root_id, rebuilt_root_id);
+}
+
+TEST_F(BTreeUtilsTest, ApplyChangesWithDeletedRanges) {
+  // Expected layout (XX is key "keyXX"):
+  //                              [50, 75]
+  //                  /              |               \
+  //       [03, 07, 30]            [60]              [89]
+  //     /    |    |    \        /      \           /     \
+  // [00-02] [04-06] [08-29] [31-49] [51-59] [61-74] [76-88] [90-99]
+  std::vector<EntryChange> entries;
+  ASSERT_TRUE(CreateEntryChanges(100, &entries));
+  ObjectId root_id = CreateTree(entries);
+
+  std::unique_ptr<const TreeNode> root;
+  ASSERT_TRUE(CreateNodeFromId(root_id, &root));
+  std::unique_ptr<const TreeNode> left_child;
+  ASSERT_TRUE(CreateNodeFromId(root->children_ids()[0], &left_child));
+  ObjectId covered_leaf_id = left_child->children_ids()[2];
+
+  // Expected layout (XX is key "keyXX"):
+  //               [75]
+  //             /      \
+  //         [03]        [89]
+  //        /    \       /    \
+  // [00-02] [04, 70-74] [76-88] [90-99]
+  std::vector<size_t> remaining_keys({0, 1, 2, 3, 4});
+  for (size_t i = 70; i < 100; ++i) {
+    remaining_keys.push_back(i);
+  }
+  std::vector<EntryChange> expected_entries;
+  ASSERT_TRUE(CreateEntryChanges(remaining_keys, &expected_entries));
+  ObjectId expected_root_id = CreateTree(expected_entries);
+
+  std::vector<EntryChange> no_changes;
+  fake_storage_.object_requests.clear();
+  Status status;
+  ObjectId new_root_id;
+  std::unordered_set<ObjectId> new_nodes;
+  ApplyChangesWithDeletedRanges(
+      &coroutine_service_, &fake_storage_, root_id, kKeepFanout,
+      {KeyRange{"key05", "key70"}},
+      std::make_unique<EntryChangeIterator>(no_changes.begin(),
+                                            no_changes.end()),
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &new_root_id, &new_nodes));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  // The tree is the same as the one built from the remaining entries.
+  EXPECT_EQ(expected_root_id, new_root_id);
+  // The leaf only containing deleted keys has not been read.
+  EXPECT_EQ(0u, fake_storage_.object_requests.count(covered_leaf_id));
+
+  // Changes are applied after the deleted ranges, and a range without an end
+  // extends to the end of the key space. Rebuilding the tree with another
+  // fan-out gives the same contents.
+  std::vector<EntryChange> insertions;
+  ASSERT_TRUE(CreateEntryChanges(std::vector<size_t>({10, 95}), &insertions));
+  ApplyChangesWithDeletedRanges(
+      &coroutine_service_, &fake_storage_, root_id, 2,
+      {KeyRange{"key05", "key70"}, KeyRange{"key90", ""}},
+      std::make_unique<EntryChangeIterator>(insertions.begin(),
+                                            insertions.end()),
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &new_root_id, &new_nodes));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+
+  std::vector<Entry> result = GetEntriesList(new_root_id);
+  ASSERT_EQ(27u, result.size());
+  EXPECT_EQ("key04", result[4].key);
+  EXPECT_EQ("key10", result[5].key);
+  EXPECT_EQ("key70", result[6].key);
+  EXPECT_EQ("key89", result[25].key);
+  EXPECT_EQ("key95", result[26].key);
+}
+
 }  // namespace
 }  // namespace btree
 }  // namespace storage
@@ -4,10 +4,14 @@
 
 #include "apps/ledger/src/storage/impl/btree/builder.h"
 
+#include <deque>
+
 #include "apps/ledger/src/callback/asynchronous_callback.h"
 #include "apps/ledger/src/callback/waiter.h"
 #include "apps/ledger/src/storage/impl/btree/internal_helper.h"
+#include "apps/ledger/src/storage/impl/btree/iterator.h"
 #include "apps/ledger/src/storage/impl/btree/synchronous_storage.h"
+#include "lib/ftl/arraysize.h"
 #include "lib/ftl/functional/closure.h"
 #include "lib/ftl/functional/make_copyable.h"
 #include "third_party/murmurhash/murmurhash.h"
@@ -18,37 +22,55 @@ namespace {
 
 constexpr uint32_t kMurmurHashSeed = 0xbeef;
 
-using HashResultType = decltype(murmurhash(nullptr, 0, 0));
-using HashSliceType = uint8_t;
+// Number of changes applied to a tree between two flushes of the nodes that
+// will not be modified anymore. See |NodeBuilder::FlushBefore|.
+constexpr size_t kChangesPerFlush = 1024;
 
-union Hash {
-  HashResultType hash;
-  HashSliceType slices[sizeof(HashResultType) / sizeof(HashSliceType)];
-};
+using HashResultType = decltype(murmurhash(nullptr, 0, 0));
 
-static_assert(sizeof(Hash::slices) == sizeof(Hash::hash),
-              "Hash size is incorrect.");
-static_assert(sizeof(HashSliceType) < std::numeric_limits<uint8_t>::max(),
-              "Hash size is too big.");
+static_assert(kMaxFanoutBits < sizeof(HashResultType) * 8,
+              "Hash size is too small.");
 
-Hash FastHash(convert::ExtendedStringView value) {
-  return {.hash = murmurhash(value.data(), value.size(), kMurmurHashSeed)};
+HashResultType FastHash(convert::ExtendedStringView value) {
+  return murmurhash(value.data(), value.size(), kMurmurHashSeed);
 }
 
+template <uint8_t kFanoutBits>
 uint8_t GetNodeLevel(convert::ExtendedStringView key) {
   // Compute the level of a key by computing the hash of the key.
-  // A key is at level k if the first k bytes of the hash of |key| are 0s. This
-  // constructs a tree with an expected node size of |255|.
-  Hash hash = FastHash(key);
-  for (size_t l = 0; l < sizeof(Hash); ++l) {
-    if (hash.slices[l]) {
+  // A key is at level k if the first k slices of |kFanoutBits| bits of the
+  // hash of |key| are 0s. This constructs a tree with an expected node size of
+  // |2^kFanoutBits - 1|. With 8 bits slices, this is the first k bytes of the
+  // hash.
+  constexpr HashResultType kSliceMask = (1u << kFanoutBits) - 1;
+  constexpr size_t kSliceCount = sizeof(HashResultType) * 8 / kFanoutBits;
+  HashResultType hash = FastHash(key);
+  for (size_t l = 0; l < kSliceCount; ++l) {
+    if ((hash >> (l * kFanoutBits)) & kSliceMask) {
       return l;
     }
   }
   return std::numeric_limits<uint8_t>::max();
 }
 
-constexpr NodeLevelCalculator kDefaultNodeLevelCalculator = {&GetNodeLevel};
+constexpr NodeLevelCalculator kNodeLevelCalculators[] = {
+    {&GetNodeLevel<2>},  {&GetNodeLevel<3>},  {&GetNodeLevel<4>},
+    {&GetNodeLevel<5>},  {&GetNodeLevel<6>},  {&GetNodeLevel<7>},
+    {&GetNodeLevel<8>},  {&GetNodeLevel<9>},  {&GetNodeLevel<10>},
+    {&GetNodeLevel<11>}, {&GetNodeLevel<12>}, {&GetNodeLevel<13>},
+    {&GetNodeLevel<14>}, {&GetNodeLevel<15>}, {&GetNodeLevel<16>},
+};
+
+static_assert(arraysize(kNodeLevelCalculators) ==
+                  kMaxFanoutBits - kMinFanoutBits + 1,
+              "A calculator is needed for each supported fan-out.");
+
+// Statistics on the subtree rooted at a built node. |entry_count| is only
+// meaningful if |has_entry_count| is true.
+struct SubtreeStats {
+  bool has_entry_count = false;
+  uint64_t entry_count = 0;
+};
 
 // Base class for tree nodes during construction. To apply mutations on a tree
 // node, one starts by creating an instance of NodeBuilder from the id of an
@@ -56,13 +78,19 @@ constexpr NodeLevelCalculator kDefaultNodeLevelCalculator = {&GetNodeLevel};
 // applied, a call to Build will build a TreeNode in the storage.
 class NodeBuilder {
  public:
-  // Creates a NodeBuilder from the id of a tree node.
+  // Creates a NodeBuilder from the id of a tree node. |fanout_bits| is updated
+  // with the fan-out of the tree the node belongs to.
   static Status FromId(SynchronousStorage* page_storage,
                        ObjectId object_id,
-                       NodeBuilder* node_builder);
+                       NodeBuilder* node_builder,
+                       uint8_t* fanout_bits);
 
   // Creates a null builder.
-  NodeBuilder() : type_(BuilderType::NULL_NODE) { FTL_DCHECK(Validate()); }
+  NodeBuilder() : type_(BuilderType::NULL_NODE) {
+    // An empty tree has known statistics.
+    stats_.has_entry_count = true;
+    FTL_DCHECK(Validate());
+  }
 
   NodeBuilder(NodeBuilder&&) = default;
 
@@ -78,11 +106,22 @@ class NodeBuilder {
                bool* did_mutate);
 
   // Build the tree node represented by the builder |node_builder| in the
-  // storage.
+  // storage. All new nodes are built with the given |fanout_bits|.
   Status Build(SynchronousStorage* page_storage,
+               uint8_t fanout_bits,
                ObjectId* object_id,
                std::unordered_set<ObjectId>* new_ids);
 
+  // Builds in the storage the subtrees of this builder that only contain keys
+  // lower or equal than |key|, and releases their content from memory. As
+  // changes are applied in key order, these subtrees cannot be modified by the
+  // next changes: this keeps the memory used by the builder proportional to
+  // the depth of the tree.
+  Status FlushBefore(SynchronousStorage* page_storage,
+                     uint8_t fanout_bits,
+                     ftl::StringView key,
+                     std::unordered_set<ObjectId>* new_ids);
+
  private:
   enum class BuilderType {
     EXISTING_NODE,
@@ -90,9 +129,13 @@ class NodeBuilder {
     NULL_NODE,
   };
 
-  static NodeBuilder CreateExistingBuilder(uint8_t level, ObjectId object_id) {
-    return NodeBuilder(BuilderType::EXISTING_NODE, level, std::move(object_id),
+  static NodeBuilder CreateExistingBuilder(uint8_t level,
+                                           ObjectId object_id,
+                                           SubtreeStats stats) {
+    NodeBuilder result(BuilderType::EXISTING_NODE, level, std::move(object_id),
                        {}, {});
+    result.stats_ = stats;
+    return result;
   }
 
   static NodeBuilder CreateNewBuilder(uint8_t level,
@@ -121,6 +164,11 @@ class NodeBuilder {
   // Ensures that the entries and children of this builder are computed.
   Status ComputeContent(SynchronousStorage* page_storage);
 
+  // Computes the statistics to store in the node built from this builder. All
+  // children of this builder must already be built. Statistics that cannot be
+  // computed are left empty in |stats|.
+  void ComputeNodeStats(NodeStats* stats);
+
   // Delete the value with the given |key| from the builder. |key_level| must be
   // greater or equal then the node level.
   Status Delete(SynchronousStorage* page_storage,
@@ -128,6 +176,13 @@ class NodeBuilder {
                 std::string key,
                 bool* did_mutate);
 
+  // Delete all the entries in |range| from the builder. Subtrees whose keys
+  // are all in |range| are dropped without being read: only the nodes on the
+  // paths to the bounds of |range| are rewritten.
+  Status DeleteRange(SynchronousStorage* page_storage,
+                     const KeyRange& range,
+                     bool* did_mutate);
+
   // Update the tree by adding |entry| (or modifying the value associated to
   // |entry.key| with |entry.value| if |key| is already in the tree).
   // |change_level| must be greater or equal than the node level.
@@ -152,6 +207,11 @@ class NodeBuilder {
                              std::vector<Entry>* entries,
                              std::vector<NodeBuilder>* children);
 
+  // Returns the statistics of the subtree rooted at a node with |entry_count|
+  // entries and the given |stats|.
+  static SubtreeStats ToSubtreeStats(size_t entry_count,
+                                     const NodeStats& stats);
+
   // Validate that the content of this builder follows the expected constraints.
   bool Validate() {
     if (type_ == BuilderType::NULL_NODE && !object_id_.empty()) {
@@ -188,6 +248,44 @@ class NodeBuilder {
     return *this;
   }
 
+  // Collects the children of the builders on the path to |key| that only
+  // contain keys lower or equal than |key|. New children are added to
+  // |output|; the content of existing ones is released.
+  void CollectFinishedNodes(ftl::StringView key,
+                            std::vector<NodeBuilder*>* output) {
+    if (children_.empty()) {
+      return;
+    }
+    size_t index = GetEntryOrChildIndex(entries_, key);
+    bool found = index < entries_.size() && entries_[index].key == key;
+    size_t finished_count = found ? index + 1 : index;
+    for (size_t i = 0; i < finished_count; ++i) {
+      NodeBuilder& child = children_[i];
+      if (child.type_ == BuilderType::NEW_NODE) {
+        output->push_back(&child);
+      } else {
+        child.ReleaseContent();
+      }
+    }
+    if (!found) {
+      children_[index].CollectFinishedNodes(key, output);
+    }
+  }
+
+  // Releases the entries and children of a built node. They are read again
+  // from the storage if needed.
+  void ReleaseContent() {
+    FTL_DCHECK(type_ != BuilderType::NEW_NODE);
+    std::vector<Entry>().swap(entries_);
+    std::vector<NodeBuilder>().swap(children_);
+  }
+
+  // Builds the nodes of the trees rooted at |roots| in the storage.
+  static Status BuildNodes(SynchronousStorage* page_storage,
+                           uint8_t fanout_bits,
+                           const std::vector<NodeBuilder*>& roots,
+                           std::unordered_set<ObjectId>* new_ids);
+
   // Collect the maximal set of nodes in the tree root at this builder than can
   // currently be built. A node can be built if and only if all its children are
   // already built. Add the buildable nodes to |output|. Return if at least a
@@ -211,13 +309,17 @@ class NodeBuilder {
   ObjectId object_id_;
   std::vector<Entry> entries_;
   std::vector<NodeBuilder> children_;
+  // Statistics of the subtree. Only valid for |EXISTING_NODE| and |NULL_NODE|
+  // builders.
+  SubtreeStats stats_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(NodeBuilder);
 };
 
 Status NodeBuilder::FromId(SynchronousStorage* page_storage,
                            ObjectId object_id,
-                           NodeBuilder* result) {
+                           NodeBuilder* result,
+                           uint8_t* fanout_bits) {
   std::unique_ptr<const TreeNode> node;
   RETURN_ON_ERROR(page_storage->TreeNodeFromId(object_id, &node));
   FTL_DCHECK(node);
@@ -228,6 +330,8 @@ Status NodeBuilder::FromId(SynchronousStorage* page_storage,
   *result = NodeBuilder(BuilderType::EXISTING_NODE, node->level(),
                         std::move(object_id), std::move(entries),
                         std::move(children));
+  result->stats_ = ToSubtreeStats(node->entries().size(), node->stats());
+  *fanout_bits = node->fanout_bits();
   return Status::OK;
 }
 
@@ -290,11 +394,14 @@ Status NodeBuilder::Apply(const NodeLevelCalculator* node_level_calculator,
 }
 
 Status NodeBuilder::Build(SynchronousStorage* page_storage,
+                          uint8_t fanout_bits,
                           ObjectId* object_id,
                           std::unordered_set<ObjectId>* new_ids) {
   if (!*this) {
-    RETURN_ON_ERROR(
-        page_storage->TreeNodeFromEntries(0, {}, {""}, &object_id_));
+    NodeStats stats;
+    stats.children_entry_counts.push_back(0u);
+    RETURN_ON_ERROR(page_storage->TreeNodeFromEntries(0, {}, {""}, &object_id_,
+                                                      stats, fanout_bits));
 
     *object_id = object_id_;
     new_ids->insert(object_id_);
@@ -306,26 +413,70 @@ Status NodeBuilder::Build(SynchronousStorage* page_storage,
     return Status::OK;
   }
 
+  RETURN_ON_ERROR(BuildNodes(page_storage, fanout_bits, {this}, new_ids));
+
+  FTL_DCHECK(type_ == BuilderType::EXISTING_NODE);
+  *object_id = object_id_;
+
+  return Status::OK;
+}
+
+Status NodeBuilder::FlushBefore(SynchronousStorage* page_storage,
+                                uint8_t fanout_bits,
+                                ftl::StringView key,
+                                std::unordered_set<ObjectId>* new_ids) {
+  if (!*this) {
+    return Status::OK;
+  }
+  std::vector<NodeBuilder*> finished_nodes;
+  CollectFinishedNodes(key, &finished_nodes);
+  RETURN_ON_ERROR(
+      BuildNodes(page_storage, fanout_bits, finished_nodes, new_ids));
+  for (NodeBuilder* node : finished_nodes) {
+    node->ReleaseContent();
+  }
+  return Status::OK;
+}
+
+Status NodeBuilder::BuildNodes(SynchronousStorage* page_storage,
+                               uint8_t fanout_bits,
+                               const std::vector<NodeBuilder*>& roots,
+                               std::unordered_set<ObjectId>* new_ids) {
   std::vector<NodeBuilder*> to_build;
-  while (CollectNodesToBuild(&to_build)) {
+  for (NodeBuilder* root : roots) {
+    root->CollectNodesToBuild(&to_build);
+  }
+  while (!to_build.empty()) {
+    std::vector<NodeStats> stats(to_build.size());
+    for (size_t i = 0; i < to_build.size(); ++i) {
+      to_build[i]->ComputeNodeStats(&stats[i]);
+    }
+
     auto waiter = callback::StatusWaiter<Status>::Create(Status::OK);
-    for (NodeBuilder* child : to_build) {
+    for (size_t i = 0; i < to_build.size(); ++i) {
+      NodeBuilder* child = to_build[i];
       std::vector<ObjectId> children;
       for (const auto& sub_child : child->children_) {
         FTL_DCHECK(sub_child.type_ != BuilderType::NEW_NODE);
         children.push_back(sub_child.object_id_);
       }
-      TreeNode::FromEntries(page_storage->page_storage(), child->level_,
-                            child->entries_, std::move(children), [
-                              new_ids, child, callback = waiter->NewCallback()
-                            ](Status status, ObjectId object_id) {
-                              if (status == Status::OK) {
-                                child->type_ = BuilderType::EXISTING_NODE;
-                                child->object_id_ = std::move(object_id);
-                                new_ids->insert(child->object_id_);
-                              }
-                              callback(status);
-                            });
+      TreeNode::FromEntries(
+          page_storage->page_storage(), child->level_, child->entries_,
+          std::move(children),
+          [
+            new_ids, child,
+            subtree_stats = ToSubtreeStats(child->entries_.size(), stats[i]),
+            callback = waiter->NewCallback()
+          ](Status status, ObjectId object_id) {
+            if (status == Status::OK) {
+              child->type_ = BuilderType::EXISTING_NODE;
+              child->object_id_ = std::move(object_id);
+              child->stats_ = subtree_stats;
+              new_ids->insert(child->object_id_);
+            }
+            callback(status);
+          },
+          stats[i], fanout_bits);
     }
     Status status;
     if (coroutine::SyncCall(page_storage->handler(),
@@ -339,11 +490,10 @@ Status NodeBuilder::Build(SynchronousStorage* page_storage,
       return status;
     }
     to_build.clear();
+    for (NodeBuilder* root : roots) {
+      root->CollectNodesToBuild(&to_build);
+    }
   }
-
-  FTL_DCHECK(type_ == BuilderType::EXISTING_NODE);
-  *object_id = object_id_;
-
   return Status::OK;
 }
 
@@ -364,6 +514,20 @@ Status NodeBuilder::ComputeContent(SynchronousStorage* page_storage) {
   return Status::OK;
 }
 
+void NodeBuilder::ComputeNodeStats(NodeStats* stats) {
+  FTL_DCHECK(type_ == BuilderType::NEW_NODE);
+
+  for (const auto& child : children_) {
+    FTL_DCHECK(child.type_ != BuilderType::NEW_NODE);
+    if (!child.stats_.has_entry_count) {
+      return;
+    }
+  }
+  for (const auto& child : children_) {
+    stats->children_entry_counts.push_back(child.stats_.entry_count);
+  }
+}
+
 Status NodeBuilder::Delete(SynchronousStorage* page_storage,
                            uint8_t key_level,
                            std::string key,
@@ -404,6 +568,64 @@ Status NodeBuilder::Delete(SynchronousStorage* page_storage,
   return Status::OK;
 }
 
+Status NodeBuilder::DeleteRange(SynchronousStorage* page_storage,
+                                const KeyRange& range,
+                                bool* did_mutate) {
+  if (!*this) {
+    *did_mutate = false;
+    return Status::OK;
+  }
+
+  RETURN_ON_ERROR(ComputeContent(page_storage));
+
+  // Entries in [begin, end) are in |range|. Children in [begin + 1, end) only
+  // contain keys in |range|, while children at |begin| and |end| may contain
+  // keys on both sides of a bound.
+  size_t begin = GetEntryOrChildIndex(entries_, range.min_key);
+  size_t end = range.max_key.empty()
+                   ? entries_.size()
+                   : GetEntryOrChildIndex(entries_, range.max_key);
+  if (end < begin) {
+    // The range is empty.
+    *did_mutate = false;
+    return Status::OK;
+  }
+
+  if (begin == end) {
+    // No entry of this node is in |range|, which is entirely contained in a
+    // single child.
+    RETURN_ON_ERROR(
+        children_[begin].DeleteRange(page_storage, range, did_mutate));
+    if (!*did_mutate) {
+      return Status::OK;
+    }
+    type_ = BuilderType::NEW_NODE;
+    if (entries_.empty() && !children_[0]) {
+      *this = NodeBuilder();
+    }
+    return Status::OK;
+  }
+
+  bool child_did_mutate;
+  RETURN_ON_ERROR(
+      children_[begin].DeleteRange(page_storage, range, &child_did_mutate));
+  RETURN_ON_ERROR(
+      children_[end].DeleteRange(page_storage, range, &child_did_mutate));
+  RETURN_ON_ERROR(
+      children_[begin].Merge(page_storage, std::move(children_[end])));
+
+  type_ = BuilderType::NEW_NODE;
+  *did_mutate = true;
+  entries_.erase(entries_.begin() + begin, entries_.begin() + end);
+  children_.erase(children_.begin() + begin + 1, children_.begin() + end + 1);
+
+  if (entries_.empty() && !children_[0]) {
+    *this = NodeBuilder();
+  }
+
+  return Status::OK;
+}
+
 Status NodeBuilder::Update(SynchronousStorage* page_storage,
                            uint8_t change_level,
                            Entry entry,
@@ -575,91 +797,371 @@ void NodeBuilder::ExtractContent(const TreeNode& node,
   FTL_DCHECK(children);
   *entries = std::vector<Entry>(node.entries().begin(), node.entries().end());
   children->clear();
-  for (const auto& child_id : node.children_ids()) {
+  const NodeStats& stats = node.stats();
+  for (size_t i = 0; i < node.children_ids().size(); ++i) {
+    const auto& child_id = node.children_ids()[i];
     if (child_id.empty()) {
       children->push_back(NodeBuilder());
-    } else {
-      children->push_back(
-          NodeBuilder::CreateExistingBuilder(node.level() - 1, child_id));
+      continue;
+    }
+    SubtreeStats child_stats;
+    if (node.HasEntryCounts()) {
+      child_stats.has_entry_count = true;
+      child_stats.entry_count = stats.children_entry_counts[i];
     }
+    children->push_back(NodeBuilder::CreateExistingBuilder(
+        node.level() - 1, child_id, child_stats));
   }
 }
 
-// Apply |changes| on |root|. This is called recursively until |changes| is not
-// valid anymore. At this point, build is called on |root|.
+SubtreeStats NodeBuilder::ToSubtreeStats(size_t entry_count,
+                                         const NodeStats& stats) {
+  SubtreeStats result;
+  if (!stats.children_entry_counts.empty()) {
+    result.has_entry_count = true;
+    result.entry_count = entry_count;
+    for (uint64_t count : stats.children_entry_counts) {
+      result.entry_count += count;
+    }
+  }
+  return result;
+}
+
+// Delete |deleted_ranges| from |root|, then apply |changes| on it. This is
+// called recursively until |changes| is not valid anymore. At this point,
+// build is called on |root|.
 Status ApplyChangesOnRoot(const NodeLevelCalculator* node_level_calculator,
+                          uint8_t fanout_bits,
                           SynchronousStorage* page_storage,
                           NodeBuilder root,
+                          const std::vector<KeyRange>& deleted_ranges,
                           std::unique_ptr<Iterator<const EntryChange>> changes,
                           ObjectId* object_id,
                           std::unordered_set<ObjectId>* new_ids) {
+  for (const auto& range : deleted_ranges) {
+    bool did_mutate;
+    RETURN_ON_ERROR(root.DeleteRange(page_storage, range, &did_mutate));
+  }
+
   Status status;
+  size_t change_count = 0;
   while (changes->Valid()) {
     EntryChange change = std::move(**changes);
     changes->Next();
 
+    // The key of the change must be kept to flush after applying it.
+    bool flush = ++change_count % kChangesPerFlush == 0;
+    std::string flush_key = flush ? change.entry.key : "";
     bool did_mutate;
     status = root.Apply(node_level_calculator, page_storage, std::move(change),
                         &did_mutate);
     if (status != Status::OK) {
       return status;
     }
+    if (flush) {
+      RETURN_ON_ERROR(
+          root.FlushBefore(page_storage, fanout_bits, flush_key, new_ids));
+    }
   }
 
   if (changes->GetStatus() != Status::OK) {
     return changes->GetStatus();
   }
-  return root.Build(page_storage, object_id, new_ids);
+  return root.Build(page_storage, fanout_bits, object_id, new_ids);
 }
 
-}  // namespace
+// Returns whether |key| is in one of |ranges|.
+bool IsInRanges(const std::vector<KeyRange>& ranges, ftl::StringView key) {
+  for (const auto& range : ranges) {
+    if (KeyRangeContains(range, key)) {
+      return true;
+    }
+  }
+  return false;
+}
 
-const NodeLevelCalculator* GetDefaultNodeLevelCalculator() {
-  return &kDefaultNodeLevelCalculator;
+// Builds a new tree with the given |fanout_bits| from the entries of the tree
+// at |root_id| that are not in |deleted_ranges| and |changes|. Both are
+// iterated in key order, and inserted in an initially null tree.
+Status RebuildWithChanges(SynchronousStorage* page_storage,
+                          ObjectIdView root_id,
+                          uint8_t fanout_bits,
+                          const std::vector<KeyRange>& deleted_ranges,
+                          std::unique_ptr<Iterator<const EntryChange>> changes,
+                          ObjectId* object_id,
+                          std::unordered_set<ObjectId>* new_ids) {
+  const NodeLevelCalculator* node_level_calculator =
+      GetNodeLevelCalculator(fanout_bits);
+  BTreeIterator iterator(page_storage);
+  RETURN_ON_ERROR(iterator.Init(root_id));
+  RETURN_ON_ERROR(iterator.AdvanceToValue());
+
+  NodeBuilder root;
+  size_t change_count = 0;
+  while (!iterator.Finished() || changes->Valid()) {
+    EntryChange change;
+    if (changes->Valid() &&
+        (iterator.Finished() ||
+         (*changes)->entry.key <= iterator.CurrentEntry().key)) {
+      // The change overrides the existing entry with the same key, if any.
+      if (!iterator.Finished() &&
+          (*changes)->entry.key == iterator.CurrentEntry().key) {
+        RETURN_ON_ERROR(iterator.Advance());
+        RETURN_ON_ERROR(iterator.AdvanceToValue());
+      }
+      change = std::move(**changes);
+      changes->Next();
+      if (change.deleted) {
+        continue;
+      }
+    } else {
+      change.entry = iterator.CurrentEntry();
+      change.deleted = false;
+      RETURN_ON_ERROR(iterator.Advance());
+      RETURN_ON_ERROR(iterator.AdvanceToValue());
+      if (IsInRanges(deleted_ranges, change.entry.key)) {
+        continue;
+      }
+    }
+
+    // The key of the change must be kept to flush after applying it.
+    bool flush = ++change_count % kChangesPerFlush == 0;
+    std::string flush_key = flush ? change.entry.key : "";
+    bool did_mutate;
+    RETURN_ON_ERROR(root.Apply(node_level_calculator, page_storage,
+                               std::move(change), &did_mutate));
+    if (flush) {
+      RETURN_ON_ERROR(
+          root.FlushBefore(page_storage, fanout_bits, flush_key, new_ids));
+    }
+  }
+
+  RETURN_ON_ERROR(changes->GetStatus());
+  return root.Build(page_storage, fanout_bits, object_id, new_ids);
 }
 
-void ApplyChanges(
+// Deletes |deleted_ranges| from the tree at |root_id| and applies |changes| on
+// it. If |target_fanout_bits| is not |kKeepFanout| and differs from the
+// fan-out of the tree, the tree is rebuilt with the new fan-out. Otherwise,
+// the fan-out of the tree is kept, and |node_level_calculator|, if null,
+// defaults to the one matching it.
+void ApplyChangesInternal(
     coroutine::CoroutineService* coroutine_service,
     PageStorage* page_storage,
     ObjectIdView root_id,
+    std::vector<KeyRange> deleted_ranges,
     std::unique_ptr<Iterator<const EntryChange>> changes,
     std::function<void(Status, ObjectId, std::unordered_set<ObjectId>)>
         callback,
-    const NodeLevelCalculator* node_level_calculator) {
+    const NodeLevelCalculator* node_level_calculator,
+    uint8_t target_fanout_bits) {
   coroutine_service->StartCoroutine(ftl::MakeCopyable([
-    page_storage, root_id = root_id.ToString(), changes = std::move(changes),
-    callback = std::move(callback), node_level_calculator
+    page_storage, root_id = root_id.ToString(),
+    deleted_ranges = std::move(deleted_ranges), changes = std::move(changes),
+    callback = std::move(callback), node_level_calculator, target_fanout_bits
   ](coroutine::CoroutineHandler * handler) mutable {
     SynchronousStorage storage(page_storage, handler);
 
     NodeBuilder root;
-    Status status = NodeBuilder::FromId(&storage, std::move(root_id), &root);
+    uint8_t fanout_bits;
+    Status status = NodeBuilder::FromId(&storage, root_id, &root, &fanout_bits);
     if (status != Status::OK) {
       callback(status, "", {});
       return;
     }
     ObjectId object_id;
     std::unordered_set<ObjectId> new_ids;
-    status =
-        ApplyChangesOnRoot(node_level_calculator, &storage, std::move(root),
-                           std::move(changes), &object_id, &new_ids);
+    if (target_fanout_bits != kKeepFanout &&
+        target_fanout_bits != fanout_bits) {
+      status = RebuildWithChanges(&storage, root_id, target_fanout_bits,
+                                  deleted_ranges, std::move(changes),
+                                  &object_id, &new_ids);
+    } else {
+      if (!node_level_calculator) {
+        node_level_calculator = GetNodeLevelCalculator(fanout_bits);
+      }
+      status = ApplyChangesOnRoot(node_level_calculator, fanout_bits, &storage,
+                                  std::move(root), deleted_ranges,
+                                  std::move(changes), &object_id, &new_ids);
+    }
     if (status != Status::OK) {
       callback(status, "", {});
       return;
     }
 
-    if (object_id != "") {
-      callback(Status::OK, std::move(object_id), std::move(new_ids));
-      return;
-    }
-
-    TreeNode::Empty(page_storage, [callback = std::move(callback)](
-                                      Status status, ObjectId object_id) {
-      std::unordered_set<ObjectId> new_ids({object_id});
-      callback(status, std::move(object_id), std::move(new_ids));
-    });
+    callback(Status::OK, std::move(object_id), std::move(new_ids));
   }));
 }
 
+}  // namespace
+
+const NodeLevelCalculator* GetDefaultNodeLevelCalculator() {
+  return GetNodeLevelCalculator(kDefaultFanoutBits);
+}
+
+const NodeLevelCalculator* GetNodeLevelCalculator(uint8_t fanout_bits) {
+  FTL_DCHECK(fanout_bits >= kMinFanoutBits && fanout_bits <= kMaxFanoutBits);
+  return &kNodeLevelCalculators[fanout_bits - kMinFanoutBits];
+}
+
+void ApplyChanges(
+    coroutine::CoroutineService* coroutine_service,
+    PageStorage* page_storage,
+    ObjectIdView root_id,
+    std::unique_ptr<Iterator<const EntryChange>> changes,
+    std::function<void(Status, ObjectId, std::unordered_set<ObjectId>)>
+        callback,
+    const NodeLevelCalculator* node_level_calculator) {
+  ApplyChangesInternal(coroutine_service, page_storage, root_id, {},
+                       std::move(changes), std::move(callback),
+                       node_level_calculator, kKeepFanout);
+}
+
+void ApplyChangesWithFanout(
+    coroutine::CoroutineService* coroutine_service,
+    PageStorage* page_storage,
+    ObjectIdView root_id,
+    uint8_t fanout_bits,
+    std::unique_ptr<Iterator<const EntryChange>> changes,
+    std::function<void(Status, ObjectId, std::unordered_set<ObjectId>)>
+        callback) {
+  ApplyChangesInternal(coroutine_service, page_storage, root_id, {},
+                       std::move(changes), std::move(callback), nullptr,
+                       fanout_bits);
+}
+
+void ApplyChangesWithDeletedRanges(
+    coroutine::CoroutineService* coroutine_service,
+    PageStorage* page_storage,
+    ObjectIdView root_id,
+    uint8_t fanout_bits,
+    std::vector<KeyRange> deleted_ranges,
+    std::unique_ptr<Iterator<const EntryChange>> changes,
+    std::function<void(Status, ObjectId, std::unordered_set<ObjectId>)>
+        callback) {
+  ApplyChangesInternal(coroutine_service, page_storage, root_id,
+                       std::move(deleted_ranges), std::move(changes),
+                       std::move(callback), nullptr, fanout_bits);
+}
+
+struct IncrementalBuilder::State {
+  PageStorage* page_storage;
+  std::function<void(std::function<void(Status, ObjectId)>)> get_root_id;
+
+  // Whether a coroutine is currently applying changes.
+  bool running = false;
+  // Whether the builder has been deleted.
+  bool cancelled = false;
+  // The first error encountered, if any. Once set, changes are ignored.
+  Status status = Status::OK;
+
+  bool root_loaded = false;
+  ObjectId root_id;
+  NodeBuilder root;
+  uint8_t fanout_bits = kDefaultFanoutBits;
+
+  std::deque<EntryChange> pending_changes;
+  std::function<void(Status, ObjectId, std::unordered_set<ObjectId>)>
+      finish_callback;
+};
+
+IncrementalBuilder::IncrementalBuilder(
+    coroutine::CoroutineService* coroutine_service,
+    PageStorage* page_storage,
+    std::function<void(std::function<void(Status, ObjectId)>)> get_root_id)
+    : coroutine_service_(coroutine_service), state_(std::make_shared<State>()) {
+  state_->page_storage = page_storage;
+  state_->get_root_id = std::move(get_root_id);
+}
+
+IncrementalBuilder::~IncrementalBuilder() {
+  // A running coroutine stops after the change it is applying.
+  state_->cancelled = true;
+}
+
+void IncrementalBuilder::Apply(EntryChange change) {
+  FTL_DCHECK(!state_->finish_callback);
+  if (state_->status != Status::OK) {
+    return;
+  }
+  state_->pending_changes.push_back(std::move(change));
+  Run();
+}
+
+void IncrementalBuilder::Finish(
+    std::function<void(Status, ObjectId, std::unordered_set<ObjectId>)>
+        callback) {
+  FTL_DCHECK(!state_->finish_callback);
+  state_->finish_callback = std::move(callback);
+  Run();
+}
+
+void IncrementalBuilder::Run() {
+  if (state_->running) {
+    return;
+  }
+  state_->running = true;
+  coroutine_service_->StartCoroutine(
+      [state = state_](coroutine::CoroutineHandler * handler) {
+        SynchronousStorage storage(state->page_storage, handler);
+        if (!state->root_loaded && state->status == Status::OK) {
+          if (coroutine::SyncCall(
+                  handler,
+                  [&state](std::function<void(Status, ObjectId)> callback) {
+                    state->get_root_id(std::move(callback));
+                  },
+                  &state->status, &state->root_id)) {
+            state->status = Status::ILLEGAL_STATE;
+          }
+          if (state->status == Status::OK) {
+            state->status = NodeBuilder::FromId(
+                &storage, state->root_id, &state->root, &state->fanout_bits);
+          }
+          state->root_loaded = true;
+        }
+
+        const NodeLevelCalculator* node_level_calculator =
+            GetNodeLevelCalculator(state->fanout_bits);
+        while (!state->cancelled && state->status == Status::OK &&
+               !state->pending_changes.empty()) {
+          EntryChange change = std::move(state->pending_changes.front());
+          state->pending_changes.pop_front();
+          bool did_mutate;
+          state->status = state->root.Apply(node_level_calculator, &storage,
+                                            std::move(change), &did_mutate);
+        }
+        state->pending_changes.clear();
+
+        if (state->cancelled || !state->finish_callback) {
+          state->running = false;
+          return;
+        }
+
+        ObjectId object_id;
+        std::unordered_set<ObjectId> new_ids;
+        Status status = state->status;
+        if (status == Status::OK) {
+          status = state->root.Build(&storage, state->fanout_bits, &object_id,
+                                     &new_ids);
+        }
+        state->running = false;
+        if (state->cancelled) {
+          return;
+        }
+        auto callback = std::move(state->finish_callback);
+        state->finish_callback = nullptr;
+        if (status != Status::OK) {
+          callback(status, "", {});
+          return;
+        }
+        if (object_id == state->root_id) {
+          // Changes cancelled each other: nodes rebuilt in the process are
+          // identical to existing ones.
+          new_ids.clear();
+        }
+        callback(Status::OK, std::move(object_id), std::move(new_ids));
+      });
+}
+
 }  // namespace btree
 }  // namespace storage
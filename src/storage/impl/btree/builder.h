@@ -5,13 +5,17 @@
 #ifndef APPS_LEDGER_SRC_STORAGE_IMPL_BTREE_BUILDER_H_
 #define APPS_LEDGER_SRC_STORAGE_IMPL_BTREE_BUILDER_H_
 
+#include <functional>
 #include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include "apps/ledger/src/coroutine/coroutine.h"
+#include "apps/ledger/src/storage/public/constants.h"
 #include "apps/ledger/src/storage/public/iterator.h"
 #include "apps/ledger/src/storage/public/page_storage.h"
 #include "apps/ledger/src/storage/public/types.h"
+#include "lib/ftl/macros.h"
 
 namespace storage {
 namespace btree {
@@ -22,13 +26,25 @@ struct NodeLevelCalculator {
   uint8_t (*GetNodeLevel)(convert::ExtendedStringView key);
 };
 
-// Default algorithm to compute the node level.
+// Default algorithm to compute the node level. This is the algorithm for the
+// |kDefaultFanoutBits| fan-out.
 const NodeLevelCalculator* GetDefaultNodeLevelCalculator();
 
+// Returns the algorithm computing the node level of a tree with an expected
+// node size of |2^fanout_bits - 1|. |fanout_bits| must be in
+// [kMinFanoutBits, kMaxFanoutBits].
+const NodeLevelCalculator* GetNodeLevelCalculator(uint8_t fanout_bits);
+
+// Value of |fanout_bits| for |ApplyChangesWithDeletedRanges| keeping the
+// fan-out of the existing tree.
+constexpr uint8_t kKeepFanout = 0;
+
 // Applies changes provided by |changes| to the BTree starting at |root_id|.
 // |changes| must provide |EntryChange| objects sorted by their key. The
 // callback will provide the status of the operation, the id of the new root
-// and the list of ids of all new nodes created after the changes.
+// and the list of ids of all new nodes created after the changes. New nodes
+// keep the fan-out of the tree at |root_id|. If |node_level_calculator| is
+// null, the algorithm matching this fan-out is used.
 void ApplyChanges(
     coroutine::CoroutineService* coroutine_service,
     PageStorage* page_storage,
@@ -36,8 +52,72 @@ void ApplyChanges(
     std::unique_ptr<Iterator<const EntryChange>> changes,
     std::function<void(Status, ObjectId, std::unordered_set<ObjectId>)>
         callback,
-    const NodeLevelCalculator* node_level_calculator =
-        GetDefaultNodeLevelCalculator());
+    const NodeLevelCalculator* node_level_calculator = nullptr);
+
+// Same as |ApplyChanges|, but the resulting tree has the given |fanout_bits|.
+// If the tree at |root_id| has a different fan-out, a new tree holding its
+// entries with |changes| applied is built entirely.
+void ApplyChangesWithFanout(
+    coroutine::CoroutineService* coroutine_service,
+    PageStorage* page_storage,
+    ObjectIdView root_id,
+    uint8_t fanout_bits,
+    std::unique_ptr<Iterator<const EntryChange>> changes,
+    std::function<void(Status, ObjectId, std::unordered_set<ObjectId>)>
+        callback);
+
+// Same as |ApplyChangesWithFanout|, but all entries of the tree at |root_id|
+// in |deleted_ranges| are deleted before |changes| are applied. Subtrees fully
+// contained in a deleted range are dropped without being read. If
+// |fanout_bits| is |kKeepFanout|, the fan-out of the tree is kept.
+void ApplyChangesWithDeletedRanges(
+    coroutine::CoroutineService* coroutine_service,
+    PageStorage* page_storage,
+    ObjectIdView root_id,
+    uint8_t fanout_bits,
+    std::vector<KeyRange> deleted_ranges,
+    std::unique_ptr<Iterator<const EntryChange>> changes,
+    std::function<void(Status, ObjectId, std::unordered_set<ObjectId>)>
+        callback);
+
+// Applies changes to a tree as they are provided, instead of waiting for all
+// of them to be known. Changes are applied in coroutines, reading the nodes
+// they touch from storage as they arrive, so that building the resulting tree
+// only requires to write the new nodes.
+class IncrementalBuilder {
+ public:
+  // |get_root_id| is called once, before the first change is applied, to
+  // retrieve the id of the root of the tree to modify. New nodes keep the
+  // fan-out of this tree.
+  IncrementalBuilder(
+      coroutine::CoroutineService* coroutine_service,
+      PageStorage* page_storage,
+      std::function<void(std::function<void(Status, ObjectId)>)> get_root_id);
+  ~IncrementalBuilder();
+
+  // Applies |change| to the tree. Changes are applied in the order of the
+  // calls to this method, and do not need to be sorted by key.
+  void Apply(EntryChange change);
+
+  // Builds the tree once all changes are applied. The callback will provide
+  // the status of the operation, the id of the new root and the list of ids of
+  // all new nodes. No change can be applied after this call.
+  void Finish(
+      std::function<void(Status, ObjectId, std::unordered_set<ObjectId>)>
+          callback);
+
+ private:
+  struct State;
+
+  // Starts a coroutine applying the pending changes, unless one is already
+  // running.
+  void Run();
+
+  coroutine::CoroutineService* const coroutine_service_;
+  std::shared_ptr<State> state_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(IncrementalBuilder);
+};
 
 }  // namespace btree
 }  // namespace storage
@@ -4,9 +4,13 @@
 
 #include "apps/ledger/src/storage/impl/btree/diff.h"
 
+#include <algorithm>
+#include <memory>
+
 #include "apps/ledger/src/storage/impl/btree/internal_helper.h"
 #include "apps/ledger/src/storage/impl/btree/iterator.h"
 #include "apps/ledger/src/storage/impl/btree/synchronous_storage.h"
+#include "lib/ftl/arraysize.h"
 
 namespace storage {
 namespace btree {
@@ -292,6 +296,105 @@ Status ForEachDiffInternal(SynchronousStorage* storage,
   return Status::OK;
 }
 
+// Returns whether the 3 iterators are all about to explore the same child. This
+// allows to skip the parts of the trees that are identical in all 3 of them.
+bool HaveSameNextChild(const BTreeIterator (&iterators)[3]) {
+  for (const auto& iterator : iterators) {
+    if (iterator.Finished() || iterator.HasValue()) {
+      return false;
+    }
+  }
+  ftl::StringView next_child = iterators[0].GetNextChild();
+  return !next_child.empty() && iterators[1].GetNextChild() == next_child &&
+         iterators[2].GetNextChild() == next_child;
+}
+
+Status ForEachThreeWayDiffInternal(
+    SynchronousStorage* storage,
+    ObjectIdView base_node_id,
+    ObjectIdView left_node_id,
+    ObjectIdView right_node_id,
+    std::string min_key,
+    const std::function<bool(ThreeWayChange)>& on_next) {
+  if (base_node_id == left_node_id && base_node_id == right_node_id) {
+    return Status::OK;
+  }
+
+  BTreeIterator iterators[] = {BTreeIterator(storage), BTreeIterator(storage),
+                               BTreeIterator(storage)};
+  ObjectIdView node_ids[] = {base_node_id, left_node_id, right_node_id};
+  for (size_t i = 0; i < arraysize(iterators); ++i) {
+    RETURN_ON_ERROR(iterators[i].Init(node_ids[i]));
+    if (!min_key.empty()) {
+      RETURN_ON_ERROR(iterators[i].SkipTo(min_key));
+    }
+  }
+
+  for (;;) {
+    if (HaveSameNextChild(iterators)) {
+      for (auto& iterator : iterators) {
+        iterator.SkipNextSubTree();
+      }
+      continue;
+    }
+
+    // Values can only be compared once no iterator is before a child, as the
+    // child might contain keys smaller than the current value of the other
+    // iterators. Iterators in the highest nodes are advanced first, so that
+    // identical subtrees at different depths can still be skipped.
+    int max_level = -1;
+    for (const auto& iterator : iterators) {
+      if (!iterator.Finished() && !iterator.HasValue()) {
+        max_level = std::max(max_level, static_cast<int>(iterator.GetLevel()));
+      }
+    }
+    if (max_level >= 0) {
+      for (auto& iterator : iterators) {
+        if (!iterator.Finished() && !iterator.HasValue() &&
+            iterator.GetLevel() == max_level) {
+          RETURN_ON_ERROR(iterator.Advance());
+        }
+      }
+      continue;
+    }
+
+    // All iterators are either finished or on a value.
+    const std::string* key = nullptr;
+    for (const auto& iterator : iterators) {
+      if (iterator.HasValue() && (!key || iterator.CurrentEntry().key < *key)) {
+        key = &iterator.CurrentEntry().key;
+      }
+    }
+    if (!key) {
+      return Status::OK;
+    }
+
+    ThreeWayChange change;
+    std::unique_ptr<Entry>* entries[] = {&change.base, &change.left,
+                                         &change.right};
+    bool on_key[arraysize(iterators)];
+    for (size_t i = 0; i < arraysize(iterators); ++i) {
+      on_key[i] =
+          iterators[i].HasValue() && iterators[i].CurrentEntry().key == *key;
+      if (on_key[i]) {
+        *entries[i] = std::make_unique<Entry>(iterators[i].CurrentEntry());
+      }
+    }
+    for (size_t i = 0; i < arraysize(iterators); ++i) {
+      if (on_key[i]) {
+        RETURN_ON_ERROR(iterators[i].Advance());
+      }
+    }
+
+    bool same_entries = on_key[0] && on_key[1] && on_key[2] &&
+                        *change.base == *change.left &&
+                        *change.base == *change.right;
+    if (!same_entries && !on_next(std::move(change))) {
+      return Status::OK;
+    }
+  }
+}
+
 }  // namespace
 
 void ForEachDiff(coroutine::CoroutineService* coroutine_service,
@@ -312,5 +415,26 @@ void ForEachDiff(coroutine::CoroutineService* coroutine_service,
   });
 }
 
+void ForEachThreeWayDiff(coroutine::CoroutineService* coroutine_service,
+                         PageStorage* page_storage,
+                         ObjectIdView base_root_id,
+                         ObjectIdView left_root_id,
+                         ObjectIdView right_root_id,
+                         std::string min_key,
+                         std::function<bool(ThreeWayChange)> on_next,
+                         std::function<void(Status)> on_done) {
+  coroutine_service->StartCoroutine([
+    page_storage, base_root_id, left_root_id, right_root_id,
+    min_key = std::move(min_key), on_next = std::move(on_next),
+    on_done = std::move(on_done)
+  ](coroutine::CoroutineHandler * handler) {
+    SynchronousStorage storage(page_storage, handler);
+
+    on_done(ForEachThreeWayDiffInternal(&storage, base_root_id, left_root_id,
+                                        right_root_id, std::move(min_key),
+                                        on_next));
+  });
+}
+
 }  // namespace btree
 }  // namespace storage
@@ -27,6 +27,20 @@ void ForEachDiff(coroutine::CoroutineService* coroutine_service,
                  std::function<bool(EntryChange)> on_next,
                  std::function<void(Status)> on_done);
 
+// Iterates through the differences between three trees given their root ids:
+// |base_root_id| and the roots of two trees derived from it, |left_root_id| and
+// |right_root_id|. |on_next| is called, in key order, once for each key whose
+// entry is not the same in all three trees. Subtrees shared by the three trees
+// are skipped. |on_next| and |on_done| behave as in |ForEachDiff|.
+void ForEachThreeWayDiff(coroutine::CoroutineService* coroutine_service,
+                         PageStorage* page_storage,
+                         ObjectIdView base_root_id,
+                         ObjectIdView left_root_id,
+                         ObjectIdView right_root_id,
+                         std::string min_key,
+                         std::function<bool(ThreeWayChange)> on_next,
+                         std::function<void(Status)> on_done);
+
 }  // namespace btree
 }  // namespace storage
 
@@ -65,6 +65,18 @@ bool CheckValidTreeNodeSerialization(ftl::StringView data) {
     return false;
   }
 
+  if (tree_node->fanout_bits() < kMinFanoutBits ||
+      tree_node->fanout_bits() > kMaxFanoutBits) {
+    return false;
+  }
+
+  // Check that the optional statistics have the expected sizes.
+  size_t children_size = tree_node->entries()->size() + 1;
+  if (tree_node->children_entry_counts() &&
+      tree_node->children_entry_counts()->size() != children_size) {
+    return false;
+  }
+
   // Check that keys are in order.
   auto it = std::adjacent_find(
       tree_node->entries()->begin(), tree_node->entries()->end(),
@@ -81,7 +93,13 @@ bool CheckValidTreeNodeSerialization(ftl::StringView data) {
 
 std::string EncodeNode(uint8_t level,
                        const std::vector<Entry>& entries,
-                       const std::vector<ObjectId>& children) {
+                       const std::vector<ObjectId>& children,
+                       const NodeStats& stats,
+                       uint8_t fanout_bits) {
+  FTL_DCHECK(fanout_bits >= kMinFanoutBits && fanout_bits <= kMaxFanoutBits);
+  FTL_DCHECK(stats.children_entry_counts.empty() ||
+             stats.children_entry_counts.size() == children.size());
+
   flatbuffers::FlatBufferBuilder builder;
 
   auto entries_offsets = builder.CreateVector(
@@ -115,8 +133,16 @@ std::string EncodeNode(uint8_t level,
             ++current_index;
           }));
 
-  builder.Finish(
-      CreateTreeNodeStorage(builder, entries_offsets, children_offsets, level));
+  // Optional fields are left unset when empty, so that nodes without
+  // statistics keep the same serialization.
+  flatbuffers::Offset<flatbuffers::Vector<uint64_t>> children_entry_counts;
+  if (!stats.children_entry_counts.empty()) {
+    children_entry_counts = builder.CreateVector(stats.children_entry_counts);
+  }
+
+  builder.Finish(CreateTreeNodeStorage(
+      builder, entries_offsets, children_offsets, level, children_entry_counts,
+      fanout_bits));
 
   return std::string(reinterpret_cast<const char*>(builder.GetBufferPointer()),
                      builder.GetSize());
@@ -125,7 +151,9 @@ std::string EncodeNode(uint8_t level,
 bool DecodeNode(ftl::StringView data,
                 uint8_t* level,
                 std::vector<Entry>* res_entries,
-                std::vector<ObjectId>* res_children) {
+                std::vector<ObjectId>* res_children,
+                NodeStats* res_stats,
+                uint8_t* fanout_bits) {
   FTL_DCHECK(CheckValidTreeNodeSerialization(data));
 
   const TreeNodeStorage* tree_node =
@@ -145,6 +173,18 @@ bool DecodeNode(ftl::StringView data,
   }
   res_children->resize(tree_node->entries()->size() + 1);
 
+  if (res_stats) {
+    *res_stats = NodeStats();
+    if (tree_node->children_entry_counts()) {
+      res_stats->children_entry_counts.assign(
+          tree_node->children_entry_counts()->begin(),
+          tree_node->children_entry_counts()->end());
+    }
+  }
+  if (fanout_bits) {
+    *fanout_bits = tree_node->fanout_bits();
+  }
+
   return true;
 }
 }  // namespace storage
@@ -6,22 +6,37 @@
 #define APPS_LEDGER_SRC_STORAGE_IMPL_BTREE_ENCODING_H_
 
 #include <string>
+#include <vector>
 
+#include "apps/ledger/src/storage/public/constants.h"
 #include "apps/ledger/src/storage/public/types.h"
 #include "lib/ftl/strings/string_view.h"
 
 namespace storage {
 
+// Optional statistics stored with a tree node. |children_entry_counts| is
+// either empty, meaning that the information is not available, or has one
+// element per child. Only statistics that depend on the content of the tree
+// alone are stored, so that all devices build the same nodes for the same
+// content.
+struct NodeStats {
+  std::vector<uint64_t> children_entry_counts;
+};
+
 bool CheckValidTreeNodeSerialization(ftl::StringView data);
 
 std::string EncodeNode(uint8_t level,
                        const std::vector<Entry>& entries,
-                       const std::vector<ObjectId>& children);
+                       const std::vector<ObjectId>& children,
+                       const NodeStats& stats = NodeStats(),
+                       uint8_t fanout_bits = kDefaultFanoutBits);
 
 bool DecodeNode(ftl::StringView data,
                 uint8_t* level,
                 std::vector<Entry>* entries,
-                std::vector<ObjectId>* children);
+                std::vector<ObjectId>* children,
+                NodeStats* stats = nullptr,
+                uint8_t* fanout_bits = nullptr);
 
 }  // namespace storage
 
@@ -75,6 +75,65 @@ TEST(EncodingTest, MoreEntries) {
   EXPECT_EQ(children, res_children);
 }
 
+TEST(EncodingTest, Stats) {
+  uint8_t level = 1u;
+  std::vector<Entry> entries = {
+      {"key1", MakeObjectId("abc"), KeyPriority::EAGER},
+      {"key2", MakeObjectId("def"), KeyPriority::LAZY}};
+  std::vector<ObjectId> children = {MakeObjectId("child_1"), "",
+                                    MakeObjectId("child_3")};
+  NodeStats stats;
+  stats.children_entry_counts = {3u, 0u, 12u};
+
+  std::string bytes = EncodeNode(level, entries, children, stats);
+
+  uint8_t res_level;
+  std::vector<Entry> res_entries;
+  std::vector<ObjectId> res_children;
+  NodeStats res_stats;
+  EXPECT_TRUE(DecodeNode(bytes, &res_level, &res_entries, &res_children,
+                         &res_stats));
+  EXPECT_EQ(level, res_level);
+  EXPECT_EQ(entries, res_entries);
+  EXPECT_EQ(children, res_children);
+  EXPECT_EQ(stats.children_entry_counts, res_stats.children_entry_counts);
+
+  // Entry counts are optional.
+  bytes = EncodeNode(level, entries, children);
+  EXPECT_TRUE(DecodeNode(bytes, &res_level, &res_entries, &res_children,
+                         &res_stats));
+  EXPECT_TRUE(res_stats.children_entry_counts.empty());
+}
+
+TEST(EncodingTest, Fanout) {
+  uint8_t level = 1u;
+  std::vector<Entry> entries = {
+      {"key1", MakeObjectId("abc"), KeyPriority::EAGER}};
+  std::vector<ObjectId> children = {MakeObjectId("child_1"), ""};
+
+  // The default fan-out is not serialized.
+  std::string default_bytes = EncodeNode(level, entries, children);
+  std::string bytes =
+      EncodeNode(level, entries, children, NodeStats(), kDefaultFanoutBits);
+  EXPECT_EQ(default_bytes, bytes);
+
+  bytes = EncodeNode(level, entries, children, NodeStats(), 4u);
+  EXPECT_NE(default_bytes, bytes);
+  EXPECT_TRUE(CheckValidTreeNodeSerialization(bytes));
+
+  uint8_t res_level;
+  std::vector<Entry> res_entries;
+  std::vector<ObjectId> res_children;
+  NodeStats res_stats;
+  uint8_t res_fanout_bits;
+  EXPECT_TRUE(DecodeNode(bytes, &res_level, &res_entries, &res_children,
+                         &res_stats, &res_fanout_bits));
+  EXPECT_EQ(4u, res_fanout_bits);
+  EXPECT_TRUE(DecodeNode(default_bytes, &res_level, &res_entries,
+                         &res_children, &res_stats, &res_fanout_bits));
+  EXPECT_EQ(kDefaultFanoutBits, res_fanout_bits);
+}
+
 TEST(EncodingTest, ZeroByte) {
   uint8_t level = 13;
   std::vector<Entry> entries = {
@@ -6,6 +6,7 @@
 
 #include "apps/ledger/src/callback/waiter.h"
 #include "apps/ledger/src/storage/impl/btree/internal_helper.h"
+#include "apps/ledger/src/storage/impl/btree/stats.h"
 #include "lib/ftl/functional/make_copyable.h"
 
 namespace storage {
@@ -13,6 +14,32 @@ namespace btree {
 
 namespace {
 
+// Advances |iterator| to its next value, then skips |count| values.
+Status SkipValues(BTreeIterator* iterator, uint64_t count) {
+  RETURN_ON_ERROR(iterator->AdvanceToValue());
+  for (; count > 0 && !iterator->Finished(); --count) {
+    RETURN_ON_ERROR(iterator->Advance());
+    RETURN_ON_ERROR(iterator->AdvanceToValue());
+  }
+  return Status::OK;
+}
+
+// Calls |on_next| on the entries of |iterator| until |on_next| returns false
+// or the iteration finishes.
+Status IterateEntries(BTreeIterator* iterator,
+                      const std::function<bool(EntryAndNodeId)>& on_next) {
+  while (!iterator->Finished()) {
+    RETURN_ON_ERROR(iterator->AdvanceToValue());
+    if (iterator->HasValue()) {
+      if (!on_next({iterator->CurrentEntry(), iterator->GetNodeId()})) {
+        return Status::OK;
+      }
+      RETURN_ON_ERROR(iterator->Advance());
+    }
+  }
+  return Status::OK;
+}
+
 Status ForEachEntryInternal(
     SynchronousStorage* storage,
     ObjectIdView root_id,
@@ -21,10 +48,86 @@ Status ForEachEntryInternal(
   BTreeIterator iterator(storage);
   RETURN_ON_ERROR(iterator.Init(root_id));
   RETURN_ON_ERROR(iterator.SkipTo(min_key));
+  return IterateEntries(&iterator, on_next);
+}
+
+Status ForEachEntryFromOffsetInternal(
+    SynchronousStorage* storage,
+    ObjectIdView root_id,
+    ftl::StringView min_key,
+    uint64_t offset,
+    const std::function<bool(EntryAndNodeId)>& on_next) {
+  BTreeIterator iterator(storage);
+  RETURN_ON_ERROR(iterator.Init(root_id));
+
+  bool has_stats;
+  uint64_t before;
+  RETURN_ON_ERROR(
+      GetCountBefore(storage, root_id, min_key, &has_stats, &before));
+  if (has_stats) {
+    RETURN_ON_ERROR(iterator.SkipToOffset(before + offset));
+  } else {
+    RETURN_ON_ERROR(iterator.SkipTo(min_key));
+    RETURN_ON_ERROR(SkipValues(&iterator, offset));
+  }
+  return IterateEntries(&iterator, on_next);
+}
+
+Status ForEachEntryInRangeInternal(
+    SynchronousStorage* storage,
+    ObjectIdView root_id,
+    ftl::StringView min_key,
+    ftl::StringView max_key,
+    const std::function<bool(EntryAndNodeId)>& on_next) {
+  BTreeIterator iterator(storage);
+  RETURN_ON_ERROR(iterator.Init(root_id));
+  RETURN_ON_ERROR(iterator.SkipTo(min_key));
+  if (max_key.empty()) {
+    return IterateEntries(&iterator, on_next);
+  }
+  return IterateEntries(&iterator, [&max_key, &on_next](EntryAndNodeId e) {
+    return e.entry.key < max_key && on_next(e);
+  });
+}
+
+// Iterates over the entries of |iterator| with a key lower than |max_key|. If
+// the iteration is not interrupted by |on_next|, |iterator| is reset.
+// Otherwise, it is detached from |storage| so that it can be resumed later.
+Status ResumeForEachEntryInternal(
+    SynchronousStorage* storage,
+    std::unique_ptr<BTreeIterator>* iterator,
+    ftl::StringView max_key,
+    const std::function<bool(EntryAndNodeId)>& on_next) {
+  (*iterator)->SetStorage(storage);
+  RETURN_ON_ERROR(IterateEntries(
+      iterator->get(), [&max_key, &on_next](EntryAndNodeId e) {
+        return (max_key.empty() || e.entry.key < max_key) && on_next(e);
+      }));
+  if ((*iterator)->Finished() ||
+      (!max_key.empty() && (*iterator)->CurrentEntry().key >= max_key)) {
+    iterator->reset();
+    return Status::OK;
+  }
+  (*iterator)->SetStorage(nullptr);
+  return Status::OK;
+}
+
+Status ReverseForEachEntryInRangeInternal(
+    SynchronousStorage* storage,
+    ObjectIdView root_id,
+    ftl::StringView min_key,
+    ftl::StringView max_key,
+    const std::function<bool(EntryAndNodeId)>& on_next) {
+  ReverseBTreeIterator iterator(storage);
+  RETURN_ON_ERROR(iterator.Init(root_id));
+  if (!max_key.empty()) {
+    RETURN_ON_ERROR(iterator.SkipTo(max_key));
+  }
   while (!iterator.Finished()) {
     RETURN_ON_ERROR(iterator.AdvanceToValue());
     if (iterator.HasValue()) {
-      if (!on_next({iterator.CurrentEntry(), iterator.GetNodeId()})) {
+      if (iterator.CurrentEntry().key < min_key ||
+          !on_next({iterator.CurrentEntry(), iterator.GetNodeId()})) {
         return Status::OK;
       }
       RETURN_ON_ERROR(iterator.Advance());
@@ -45,6 +148,10 @@ Status BTreeIterator::Init(ObjectIdView node_id) {
   return Descend(node_id);
 }
 
+void BTreeIterator::SetStorage(SynchronousStorage* storage) {
+  storage_ = storage;
+}
+
 Status BTreeIterator::SkipTo(ftl::StringView min_key) {
   descending_ = true;
   for (;;) {
@@ -59,9 +166,44 @@ Status BTreeIterator::SkipTo(ftl::StringView min_key) {
   }
 }
 
+Status BTreeIterator::SkipToOffset(uint64_t offset) {
+  FTL_DCHECK(stack_.size() == 1u && descending_ && CurrentIndex() == 0u);
+  while (!Finished()) {
+    const TreeNode& node = CurrentNode();
+    if (!node.HasEntryCounts()) {
+      // Visit the entries of this subtree one by one.
+      return SkipValues(this, offset);
+    }
+    const auto& counts = node.stats().children_entry_counts;
+    size_t index = 0;
+    for (; index < node.entries().size(); ++index) {
+      if (offset < counts[index]) {
+        break;
+      }
+      offset -= counts[index];
+      if (offset == 0) {
+        CurrentIndex() = index;
+        descending_ = false;
+        return Status::OK;
+      }
+      --offset;
+    }
+    if (offset >= counts[index]) {
+      // |offset| is past the last entry of the tree.
+      FTL_DCHECK(stack_.size() == 1u);
+      stack_.clear();
+      return Status::OK;
+    }
+    CurrentIndex() = index;
+    descending_ = true;
+    RETURN_ON_ERROR(Descend(GetNextChild()));
+  }
+  return Status::OK;
+}
+
 bool BTreeIterator::SkipToIndex(ftl::StringView key) {
   auto& entries = CurrentNode().entries();
-  size_t skip_count = GetEntryOrChildIndex(entries, key);
+  size_t skip_count = CurrentNode().GetEntryOrChildIndex(key);
   if (skip_count < CurrentIndex()) {
     return true;
   }
@@ -163,6 +305,100 @@ Status BTreeIterator::Descend(ftl::StringView node_id) {
   return Status::OK;
 }
 
+ReverseBTreeIterator::ReverseBTreeIterator(SynchronousStorage* storage)
+    : storage_(storage) {}
+
+ReverseBTreeIterator::ReverseBTreeIterator(ReverseBTreeIterator&&) = default;
+
+ReverseBTreeIterator& ReverseBTreeIterator::operator=(ReverseBTreeIterator&&) =
+    default;
+
+Status ReverseBTreeIterator::Init(ObjectIdView node_id) {
+  return Descend(node_id);
+}
+
+Status ReverseBTreeIterator::SkipTo(ftl::StringView max_key) {
+  FTL_DCHECK(stack_.size() == 1u && descending_);
+  while (descending_) {
+    auto& entries = CurrentNode().entries();
+    size_t index = CurrentNode().GetEntryOrChildIndex(max_key);
+    CurrentIndex() = index;
+    if (index < entries.size() && entries[index].key == max_key) {
+      // All entries of the child at |index| are lower than |max_key|.
+      return Status::OK;
+    }
+    RETURN_ON_ERROR(Descend(CurrentNode().children_ids()[index]));
+  }
+  return Status::OK;
+}
+
+bool ReverseBTreeIterator::HasValue() const {
+  return !stack_.empty() && !descending_ && CurrentIndex() > 0;
+}
+
+bool ReverseBTreeIterator::Finished() const {
+  return stack_.empty();
+}
+
+const Entry& ReverseBTreeIterator::CurrentEntry() const {
+  FTL_DCHECK(HasValue());
+  return CurrentNode().entries()[CurrentIndex() - 1];
+}
+
+const std::string& ReverseBTreeIterator::GetNodeId() const {
+  return CurrentNode().GetId();
+}
+
+Status ReverseBTreeIterator::Advance() {
+  if (descending_) {
+    return Descend(CurrentNode().children_ids()[CurrentIndex()]);
+  }
+
+  auto& index = CurrentIndex();
+  if (index == 0) {
+    // The node is done. The current entry of the parent, if any, is the one
+    // preceding this node.
+    stack_.pop_back();
+    return Status::OK;
+  }
+  --index;
+  descending_ = true;
+  return Status::OK;
+}
+
+Status ReverseBTreeIterator::AdvanceToValue() {
+  while (!Finished() && !HasValue()) {
+    RETURN_ON_ERROR(Advance());
+  }
+  return Status::OK;
+}
+
+size_t& ReverseBTreeIterator::CurrentIndex() {
+  return stack_.back().second;
+}
+
+size_t ReverseBTreeIterator::CurrentIndex() const {
+  return stack_.back().second;
+}
+
+const TreeNode& ReverseBTreeIterator::CurrentNode() const {
+  return *stack_.back().first;
+}
+
+Status ReverseBTreeIterator::Descend(ftl::StringView node_id) {
+  FTL_DCHECK(descending_);
+  if (node_id.empty()) {
+    descending_ = false;
+    return Status::OK;
+  }
+
+  std::unique_ptr<const TreeNode> node;
+  RETURN_ON_ERROR(storage_->TreeNodeFromId(node_id, &node));
+  size_t last_child_index = node->children_ids().size() - 1;
+  stack_.emplace_back(std::move(node), last_child_index);
+  return Status::OK;
+}
+
 void GetObjectIds(coroutine::CoroutineService* coroutine_service,
                   PageStorage* page_storage,
                   ObjectIdView root_id,
@@ -234,5 +470,107 @@ void ForEachEntry(coroutine::CoroutineService* coroutine_service,
   });
 }
 
+void ForEachEntryFromOffset(coroutine::CoroutineService* coroutine_service,
+                            PageStorage* page_storage,
+                            ObjectIdView root_id,
+                            std::string min_key,
+                            uint64_t offset,
+                            std::function<bool(EntryAndNodeId)> on_next,
+                            std::function<void(Status)> on_done) {
+  FTL_DCHECK(!root_id.empty());
+  coroutine_service->StartCoroutine([
+    page_storage, root_id = root_id.ToString(), min_key = std::move(min_key),
+    offset, on_next = std::move(on_next), on_done = std::move(on_done)
+  ](coroutine::CoroutineHandler * handler) {
+    SynchronousStorage storage(page_storage, handler);
+
+    on_done(ForEachEntryFromOffsetInternal(&storage, root_id, min_key, offset,
+                                           on_next));
+  });
+}
+
+void ForEachEntryInRange(coroutine::CoroutineService* coroutine_service,
+                         PageStorage* page_storage,
+                         ObjectIdView root_id,
+                         std::string min_key,
+                         std::string max_key,
+                         bool reverse,
+                         std::function<bool(EntryAndNodeId)> on_next,
+                         std::function<void(Status)> on_done) {
+  FTL_DCHECK(!root_id.empty());
+  coroutine_service->StartCoroutine([
+    page_storage, root_id = root_id.ToString(), min_key = std::move(min_key),
+    max_key = std::move(max_key), reverse, on_next = std::move(on_next),
+    on_done = std::move(on_done)
+  ](coroutine::CoroutineHandler * handler) {
+    SynchronousStorage storage(page_storage, handler);
+
+    if (reverse) {
+      on_done(ReverseForEachEntryInRangeInternal(&storage, root_id, min_key,
+                                                 max_key, on_next));
+    } else {
+      on_done(ForEachEntryInRangeInternal(&storage, root_id, min_key, max_key,
+                                          on_next));
+    }
+  });
+}
+
+void ForEachEntryWithIterator(
+    coroutine::CoroutineService* coroutine_service,
+    PageStorage* page_storage,
+    ObjectIdView root_id,
+    std::string min_key,
+    std::string max_key,
+    std::function<bool(EntryAndNodeId)> on_next,
+    std::function<void(Status, std::unique_ptr<BTreeIterator>)> on_done) {
+  FTL_DCHECK(!root_id.empty());
+  coroutine_service->StartCoroutine([
+    page_storage, root_id = root_id.ToString(), min_key = std::move(min_key),
+    max_key = std::move(max_key), on_next = std::move(on_next),
+    on_done = std::move(on_done)
+  ](coroutine::CoroutineHandler * handler) {
+    SynchronousStorage storage(page_storage, handler);
+
+    auto iterator = std::make_unique<BTreeIterator>(&storage);
+    Status status = iterator->Init(root_id);
+    if (status == Status::OK) {
+      status = iterator->SkipTo(min_key);
+    }
+    if (status == Status::OK) {
+      status =
+          ResumeForEachEntryInternal(&storage, &iterator, max_key, on_next);
+    }
+    if (status != Status::OK) {
+      on_done(status, nullptr);
+      return;
+    }
+    on_done(Status::OK, std::move(iterator));
+  });
+}
+
+void ResumeForEachEntry(
+    coroutine::CoroutineService* coroutine_service,
+    PageStorage* page_storage,
+    std::unique_ptr<BTreeIterator> iterator,
+    std::string max_key,
+    std::function<bool(EntryAndNodeId)> on_next,
+    std::function<void(Status, std::unique_ptr<BTreeIterator>)> on_done) {
+  FTL_DCHECK(iterator);
+  coroutine_service->StartCoroutine(ftl::MakeCopyable([
+    page_storage, iterator = std::move(iterator), max_key = std::move(max_key),
+    on_next = std::move(on_next), on_done = std::move(on_done)
+  ](coroutine::CoroutineHandler * handler) mutable {
+    SynchronousStorage storage(page_storage, handler);
+
+    Status status =
+        ResumeForEachEntryInternal(&storage, &iterator, max_key, on_next);
+    if (status != Status::OK) {
+      on_done(status, nullptr);
+      return;
+    }
+    on_done(Status::OK, std::move(iterator));
+  }));
+}
+
 }  // namespace btree
 }  // namespace storage
@@ -38,10 +38,21 @@ class BTreeIterator {
   // Initialize the iterator with the root node of the tree.
   Status Init(ObjectIdView node_id);
 
+  // Sets the storage from which the nodes are read. The nodes already on the
+  // stack are kept: an iterator interrupted in a coroutine can be resumed in
+  // another one by setting the storage of the new coroutine.
+  void SetStorage(SynchronousStorage* storage);
+
   // Skip the iteration until the first key that is greater or equals to
   // |min_key|.
   Status SkipTo(ftl::StringView min_key);
 
+  // Skip the iteration to the entry preceded by |offset| entries in the tree.
+  // This must be called on a newly initialized iterator. Nodes holding entry
+  // counts are skipped over entirely; the iteration falls back to visiting
+  // each entry on nodes without them.
+  Status SkipToOffset(uint64_t offset);
+
   // Skips to the index where key could be found, within the current node. The
   // current index will only be updated if the new index is after the current
   // one. Returns true if either the key was found in this node, or if it is
@@ -94,6 +105,59 @@ class BTreeIterator {
   FTL_DISALLOW_COPY_AND_ASSIGN(BTreeIterator);
 };
 
+// Iterator over a BTree in descending key order.
+class ReverseBTreeIterator {
+ public:
+  ReverseBTreeIterator(SynchronousStorage* storage);
+
+  ReverseBTreeIterator(ReverseBTreeIterator&&);
+  ReverseBTreeIterator& operator=(ReverseBTreeIterator&&);
+
+  // Initialize the iterator with the root node of the tree.
+  Status Init(ObjectIdView node_id);
+
+  // Skip the iteration until the first key that is strictly less than
+  // |max_key|. This must be called on a newly initialized iterator.
+  Status SkipTo(ftl::StringView max_key);
+
+  // Returns whether the iterator is currently on a value. The method
+  // |CurrentEntry| is only valid when |HasValue| is true.
+  bool HasValue() const;
+
+  // Returns whether the iteration is finished.
+  bool Finished() const;
+
+  // Returns the current value of the iterator. It is only valid when
+  // |HasValue| is true.
+  const Entry& CurrentEntry() const;
+
+  // Returns the identifier of the node at the top of the stack.
+  const std::string& GetNodeId() const;
+
+  // Advances the iterator by a single step.
+  Status Advance();
+
+  // Advances the iterator until it has a value or it finishes.
+  Status AdvanceToValue();
+
+ private:
+  size_t& CurrentIndex();
+  size_t CurrentIndex() const;
+  const TreeNode& CurrentNode() const;
+  Status Descend(ftl::StringView node_id);
+
+  SynchronousStorage* storage_;
+  // Stack representing the current iteration state. Each level represents the
+  // current node in the B-Tree, and an index in this node. If |descending_| is
+  // |true|, the index is the child index to explore next, otherwise the entry
+  // at the previous index is the current value, and the node is done if the
+  // index is 0.
+  std::vector<std::pair<std::unique_ptr<const TreeNode>, size_t>> stack_;
+  bool descending_ = true;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ReverseBTreeIterator);
+};
+
 // Retrieves the ids of all objects in the BTree, i.e tree nodes and values of
 // entries in the tree. After a successfull call, |callback| will be called
 // with the set of results.
@@ -124,6 +188,55 @@ void ForEachEntry(coroutine::CoroutineService* coroutine_service,
                   std::function<bool(EntryAndNodeId)> on_next,
                   std::function<void(Status)> on_done);
 
+// Same as |ForEachEntry|, but skips the first |offset| entries with a key
+// equal to or greater than |min_key|.
+void ForEachEntryFromOffset(coroutine::CoroutineService* coroutine_service,
+                            PageStorage* page_storage,
+                            ObjectIdView root_id,
+                            std::string min_key,
+                            uint64_t offset,
+                            std::function<bool(EntryAndNodeId)> on_next,
+                            std::function<void(Status)> on_done);
+
+// Iterates through the entries of the tree with the given root with a key in
+// [|min_key|, |max_key|), in ascending key order, or descending key order if
+// |reverse| is true. An empty |max_key| leaves the range unbounded above.
+// |on_next| and |on_done| behave as in |ForEachEntry|.
+void ForEachEntryInRange(coroutine::CoroutineService* coroutine_service,
+                         PageStorage* page_storage,
+                         ObjectIdView root_id,
+                         std::string min_key,
+                         std::string max_key,
+                         bool reverse,
+                         std::function<bool(EntryAndNodeId)> on_next,
+                         std::function<void(Status)> on_done);
+
+// Same as |ForEachEntryInRange| in ascending key order, but the iteration can
+// be resumed after being interrupted: if |on_next| returns false, |on_done| is
+// called with the iterator positioned on the entry on which it returned false.
+// Otherwise, |on_done| is called with null.
+void ForEachEntryWithIterator(
+    coroutine::CoroutineService* coroutine_service,
+    PageStorage* page_storage,
+    ObjectIdView root_id,
+    std::string min_key,
+    std::string max_key,
+    std::function<bool(EntryAndNodeId)> on_next,
+    std::function<void(Status, std::unique_ptr<BTreeIterator>)> on_done);
+
+// Resumes the iteration of |iterator|, returned by |ForEachEntryWithIterator|
+// or a previous call to this function, on the entries with a key lower than
+// |max_key|, starting at the entry on which it was interrupted. The nodes on
+// the path to that entry are not read again. |on_next| and |on_done| behave as
+// in |ForEachEntryWithIterator|.
+void ResumeForEachEntry(
+    coroutine::CoroutineService* coroutine_service,
+    PageStorage* page_storage,
+    std::unique_ptr<BTreeIterator> iterator,
+    std::string max_key,
+    std::function<bool(EntryAndNodeId)> on_next,
+    std::function<void(Status, std::unique_ptr<BTreeIterator>)> on_done);
+
 }  // namespace btree
 }  // namespace storage
 
@@ -0,0 +1,74 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/storage/impl/btree/key_index.h"
+
+#include <algorithm>
+
+#include "lib/ftl/logging.h"
+
+namespace storage {
+namespace btree {
+namespace {
+
+// Nodes with at most this number of entries are searched with a linear scan
+// over the prefixes. The scan has no data-dependent branches and is
+// vectorized by the compiler, which makes it faster than a binary search on
+// small arrays.
+constexpr size_t kMaxLinearScanSize = 64;
+
+}  // namespace
+
+KeyIndex::KeyIndex(const std::vector<Entry>& entries) {
+  prefixes_.reserve(entries.size());
+  for (const auto& entry : entries) {
+    prefixes_.push_back(GetPrefix(entry.key));
+  }
+}
+
+KeyIndex::~KeyIndex() {}
+
+size_t KeyIndex::LowerBound(const std::vector<Entry>& entries,
+                            ftl::StringView key) const {
+  FTL_DCHECK(entries.size() == prefixes_.size());
+  uint64_t prefix = GetPrefix(key);
+
+  // Entries in [begin, end) have the same prefix as |key|. Entries before
+  // |begin| have a smaller key, entries after |end| a greater one.
+  size_t begin = 0;
+  size_t end = 0;
+  if (prefixes_.size() <= kMaxLinearScanSize) {
+    for (uint64_t entry_prefix : prefixes_) {
+      begin += entry_prefix < prefix;
+      end += entry_prefix <= prefix;
+    }
+  } else {
+    auto lower = std::lower_bound(prefixes_.begin(), prefixes_.end(), prefix);
+    auto upper = std::upper_bound(lower, prefixes_.end(), prefix);
+    begin = lower - prefixes_.begin();
+    end = upper - prefixes_.begin();
+  }
+  if (begin == end) {
+    return begin;
+  }
+
+  auto lower = std::lower_bound(
+      entries.begin() + begin, entries.begin() + end, key,
+      [](const Entry& entry, ftl::StringView key) { return entry.key < key; });
+  return lower - entries.begin();
+}
+
+uint64_t KeyIndex::GetPrefix(ftl::StringView key) {
+  uint64_t prefix = 0;
+  for (size_t i = 0; i < sizeof(prefix); ++i) {
+    prefix <<= 8;
+    if (i < key.size()) {
+      prefix |= static_cast<uint8_t>(key[i]);
+    }
+  }
+  return prefix;
+}
+
+}  // namespace btree
+}  // namespace storage
@@ -0,0 +1,48 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_STORAGE_IMPL_BTREE_KEY_INDEX_H_
+#define APPS_LEDGER_SRC_STORAGE_IMPL_BTREE_KEY_INDEX_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "apps/ledger/src/storage/public/types.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/strings/string_view.h"
+
+namespace storage {
+namespace btree {
+
+// Search structure over the sorted keys of a tree node. The first 8 bytes of
+// each key are stored as a big-endian integer in a contiguous array, so that
+// searching a node mostly compares integers instead of following pointers to
+// the keys' data. Full keys are only compared among the entries sharing the
+// prefix of the searched key.
+class KeyIndex {
+ public:
+  explicit KeyIndex(const std::vector<Entry>& entries);
+  ~KeyIndex();
+
+  // Returns the index of the first entry of |entries| with a key greater than
+  // or equal to |key|. |entries| must be the entries this index was built
+  // from.
+  size_t LowerBound(const std::vector<Entry>& entries,
+                    ftl::StringView key) const;
+
+  // Returns the prefix of |key| stored in the index. Prefixes preserve the
+  // order of keys: if key1 < key2 then GetPrefix(key1) <= GetPrefix(key2).
+  static uint64_t GetPrefix(ftl::StringView key);
+
+ private:
+  std::vector<uint64_t> prefixes_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(KeyIndex);
+};
+
+}  // namespace btree
+}  // namespace storage
+
+#endif  // APPS_LEDGER_SRC_STORAGE_IMPL_BTREE_KEY_INDEX_H_
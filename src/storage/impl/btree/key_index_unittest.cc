@@ -0,0 +1,76 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/storage/impl/btree/key_index.h"
+
+#include <algorithm>
+
+#include "apps/ledger/src/storage/impl/btree/internal_helper.h"
+#include "gtest/gtest.h"
+#include "lib/ftl/strings/string_printf.h"
+
+namespace storage {
+namespace btree {
+namespace {
+
+// Allows to create correct std::strings with \0 bytes inside from C-style
+// string constants.
+std::string operator"" _s(const char* str, size_t size) {
+  return std::string(str, size);
+}
+
+std::vector<Entry> CreateEntries(std::vector<std::string> keys) {
+  std::sort(keys.begin(), keys.end());
+  std::vector<Entry> entries;
+  for (auto& key : keys) {
+    entries.push_back(Entry{std::move(key), "", KeyPriority::EAGER});
+  }
+  return entries;
+}
+
+TEST(KeyIndexTest, GetPrefix) {
+  EXPECT_EQ(0u, KeyIndex::GetPrefix(""));
+  EXPECT_EQ(0x6100000000000000u, KeyIndex::GetPrefix("a"));
+  EXPECT_EQ(KeyIndex::GetPrefix("a"), KeyIndex::GetPrefix("a\0"_s));
+  EXPECT_EQ(KeyIndex::GetPrefix("01234567"), KeyIndex::GetPrefix("012345678"));
+  EXPECT_LT(KeyIndex::GetPrefix("0123456"), KeyIndex::GetPrefix("01234567"));
+  EXPECT_LT(KeyIndex::GetPrefix("\x7f"), KeyIndex::GetPrefix("\x80"));
+}
+
+TEST(KeyIndexTest, LowerBound) {
+  // Keys sharing their first 8 bytes, or only differing by trailing 0 bytes,
+  // have the same prefix and require comparing full keys.
+  std::vector<std::string> shared_prefix_keys = {
+      "",         "a",         "a\0"_s,       "a\0\0"_s, "ab",
+      "01234567", "012345670", "012345678",   "\xff",    "\xff\xff",
+      "abcdefgh", "abcdefghi", "abcdefghij"};
+  std::vector<std::string> searched_keys = shared_prefix_keys;
+  searched_keys.push_back("0");
+  searched_keys.push_back("0123456789");
+  searched_keys.push_back("a\0\0\0"_s);
+  searched_keys.push_back("abcdefgha");
+  searched_keys.push_back("z");
+
+  // Test both small nodes and nodes large enough to be searched with a binary
+  // search.
+  for (size_t extra_keys : {0u, 100u}) {
+    std::vector<std::string> keys = shared_prefix_keys;
+    for (size_t i = 0; i < extra_keys; ++i) {
+      keys.push_back(ftl::StringPrintf("key%03zu", i));
+      searched_keys.push_back(ftl::StringPrintf("key%03zu", i));
+      searched_keys.push_back(ftl::StringPrintf("key%03zu0", i));
+    }
+    std::vector<Entry> entries = CreateEntries(keys);
+    KeyIndex index(entries);
+    for (const auto& key : searched_keys) {
+      EXPECT_EQ(GetEntryOrChildIndex(entries, key),
+                index.LowerBound(entries, key))
+          << "key: " << key;
+    }
+  }
+}
+
+}  // namespace
+}  // namespace btree
+}  // namespace storage
@@ -0,0 +1,181 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/storage/impl/btree/stats.h"
+
+#include "apps/ledger/src/storage/impl/btree/internal_helper.h"
+#include "apps/ledger/src/storage/impl/btree/iterator.h"
+
+namespace storage {
+namespace btree {
+namespace {
+
+// Computes the number of entries of the whole tree with the given root. See
+// |GetCountBefore|.
+Status GetTotalCount(SynchronousStorage* storage,
+                     ObjectIdView root_id,
+                     bool* has_stats,
+                     uint64_t* result) {
+  std::unique_ptr<const TreeNode> root;
+  RETURN_ON_ERROR(storage->TreeNodeFromId(root_id, &root));
+  *has_stats = root->HasEntryCounts();
+  if (!*has_stats) {
+    return Status::OK;
+  }
+  *result = root->GetSubtreeEntryCount();
+  return Status::OK;
+}
+
+// Computes the size of the range by visiting all its entries.
+Status IterateRangeSize(SynchronousStorage* storage,
+                        ObjectIdView root_id,
+                        ftl::StringView min_key,
+                        ftl::StringView max_key,
+                        bool with_value_bytes,
+                        ContentsSize* result) {
+  ContentsSize size;
+  BTreeIterator iterator(storage);
+  RETURN_ON_ERROR(iterator.Init(root_id));
+  RETURN_ON_ERROR(iterator.SkipTo(min_key));
+  while (!iterator.Finished()) {
+    RETURN_ON_ERROR(iterator.AdvanceToValue());
+    if (!iterator.HasValue()) {
+      continue;
+    }
+    const Entry& entry = iterator.CurrentEntry();
+    if (!max_key.empty() && entry.key >= max_key) {
+      break;
+    }
+    ++size.entry_count;
+    if (with_value_bytes) {
+      uint64_t value_size;
+      Status status = storage->GetValueSize(entry.object_id, &value_size);
+      if (status == Status::OK) {
+        size.value_bytes += value_size;
+      } else if (status != Status::NOT_FOUND) {
+        return status;
+      }
+    }
+    RETURN_ON_ERROR(iterator.Advance());
+  }
+  *result = size;
+  return Status::OK;
+}
+
+Status CountEntriesInternal(SynchronousStorage* storage,
+                            ObjectIdView root_id,
+                            ftl::StringView min_key,
+                            ftl::StringView max_key,
+                            uint64_t* result) {
+  if (!max_key.empty() && max_key <= min_key) {
+    *result = 0u;
+    return Status::OK;
+  }
+
+  bool has_stats;
+  uint64_t before_min;
+  RETURN_ON_ERROR(
+      GetCountBefore(storage, root_id, min_key, &has_stats, &before_min));
+  uint64_t before_max;
+  if (has_stats) {
+    if (max_key.empty()) {
+      RETURN_ON_ERROR(
+          GetTotalCount(storage, root_id, &has_stats, &before_max));
+    } else {
+      RETURN_ON_ERROR(
+          GetCountBefore(storage, root_id, max_key, &has_stats, &before_max));
+    }
+  }
+  if (!has_stats) {
+    ContentsSize size;
+    RETURN_ON_ERROR(
+        IterateRangeSize(storage, root_id, min_key, max_key, false, &size));
+    *result = size.entry_count;
+    return Status::OK;
+  }
+
+  FTL_DCHECK(before_max >= before_min);
+  *result = before_max - before_min;
+  return Status::OK;
+}
+
+}  // namespace
+
+Status GetCountBefore(SynchronousStorage* storage,
+                      ObjectIdView root_id,
+                      ftl::StringView key,
+                      bool* has_stats,
+                      uint64_t* result) {
+  uint64_t count = 0u;
+  ObjectId node_id = root_id.ToString();
+  while (!key.empty() && !node_id.empty()) {
+    std::unique_ptr<const TreeNode> node;
+    RETURN_ON_ERROR(storage->TreeNodeFromId(node_id, &node));
+    if (!node->HasEntryCounts()) {
+      *has_stats = false;
+      return Status::OK;
+    }
+
+    const NodeStats& stats = node->stats();
+    const std::vector<Entry>& entries = node->entries();
+    size_t index = node->GetEntryOrChildIndex(key);
+    for (size_t i = 0; i < index; ++i) {
+      count += stats.children_entry_counts[i] + 1;
+    }
+
+    if (index < entries.size() && entries[index].key == key) {
+      // All entries of the child preceding |key| are smaller than |key|.
+      count += stats.children_entry_counts[index];
+      break;
+    }
+    node_id = node->GetChildId(index).ToString();
+  }
+
+  *has_stats = true;
+  *result = count;
+  return Status::OK;
+}
+
+void CountEntries(coroutine::CoroutineService* coroutine_service,
+                  PageStorage* page_storage,
+                  ObjectIdView root_id,
+                  std::string min_key,
+                  std::string max_key,
+                  std::function<void(Status, uint64_t)> callback) {
+  FTL_DCHECK(!root_id.empty());
+  coroutine_service->StartCoroutine([
+    page_storage, root_id = root_id.ToString(), min_key = std::move(min_key),
+    max_key = std::move(max_key), callback = std::move(callback)
+  ](coroutine::CoroutineHandler * handler) {
+    SynchronousStorage storage(page_storage, handler);
+
+    uint64_t count = 0u;
+    Status status =
+        CountEntriesInternal(&storage, root_id, min_key, max_key, &count);
+    callback(status, count);
+  });
+}
+
+void GetRangeSize(coroutine::CoroutineService* coroutine_service,
+                  PageStorage* page_storage,
+                  ObjectIdView root_id,
+                  std::string min_key,
+                  std::string max_key,
+                  std::function<void(Status, ContentsSize)> callback) {
+  FTL_DCHECK(!root_id.empty());
+  coroutine_service->StartCoroutine([
+    page_storage, root_id = root_id.ToString(), min_key = std::move(min_key),
+    max_key = std::move(max_key), callback = std::move(callback)
+  ](coroutine::CoroutineHandler * handler) {
+    SynchronousStorage storage(page_storage, handler);
+
+    ContentsSize size;
+    Status status =
+        IterateRangeSize(&storage, root_id, min_key, max_key, true, &size);
+    callback(status, size);
+  });
+}
+
+}  // namespace btree
+}  // namespace storage
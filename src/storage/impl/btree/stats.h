@@ -0,0 +1,57 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_STORAGE_IMPL_BTREE_STATS_H_
+#define APPS_LEDGER_SRC_STORAGE_IMPL_BTREE_STATS_H_
+
+#include <functional>
+#include <string>
+
+#include "apps/ledger/src/coroutine/coroutine.h"
+#include "apps/ledger/src/storage/impl/btree/synchronous_storage.h"
+#include "apps/ledger/src/storage/public/page_storage.h"
+#include "apps/ledger/src/storage/public/types.h"
+
+namespace storage {
+namespace btree {
+
+// Computes the number of entries with a key strictly smaller than |key| in the
+// tree with the given root. The computation only reads the nodes on the path
+// to |key|. If one of them does not hold entry counts, |has_stats| is set to
+// false and |result| is not updated.
+Status GetCountBefore(SynchronousStorage* storage,
+                      ObjectIdView root_id,
+                      ftl::StringView key,
+                      bool* has_stats,
+                      uint64_t* result);
+
+// Counts the entries of the tree with the given root whose key is in
+// [|min_key|, |max_key|) and calls |callback| with the result. An empty
+// |max_key| leaves the range unbounded above. This reads O(log n) nodes if the
+// tree nodes hold entry counts, and falls back to iterating over the range
+// otherwise.
+void CountEntries(coroutine::CoroutineService* coroutine_service,
+                  PageStorage* page_storage,
+                  ObjectIdView root_id,
+                  std::string min_key,
+                  std::string max_key,
+                  std::function<void(Status, uint64_t)> callback);
+
+// Computes the number of entries of the tree with the given root whose key is
+// in [|min_key|, |max_key|), and the total size of their values. An empty
+// |max_key| leaves the range unbounded above. Value sizes are not stored in the
+// tree nodes: this iterates over the range and reads the size of each value
+// without reading its data. Values that are not available locally are not
+// accounted for: the result is then an estimate.
+void GetRangeSize(coroutine::CoroutineService* coroutine_service,
+                  PageStorage* page_storage,
+                  ObjectIdView root_id,
+                  std::string min_key,
+                  std::string max_key,
+                  std::function<void(Status, ContentsSize)> callback);
+
+}  // namespace btree
+}  // namespace storage
+
+#endif  // APPS_LEDGER_SRC_STORAGE_IMPL_BTREE_STATS_H_
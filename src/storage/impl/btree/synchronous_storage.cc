@@ -4,6 +4,8 @@
 
 #include "apps/ledger/src/storage/impl/btree/synchronous_storage.h"
 
+#include "apps/ledger/src/storage/impl/btree/internal_helper.h"
+
 namespace storage {
 namespace btree {
 
@@ -53,16 +55,32 @@ Status SynchronousStorage::TreeNodeFromEntries(
     uint8_t level,
     const std::vector<Entry>& entries,
     const std::vector<ObjectId>& children,
-    ObjectId* result) {
+    ObjectId* result,
+    const NodeStats& stats,
+    uint8_t fanout_bits) {
+  Status status;
+  if (coroutine::SyncCall(
+          handler_,
+          [this, level, &entries, &children, &stats,
+           fanout_bits](std::function<void(Status, ObjectId)> callback) {
+            TreeNode::FromEntries(page_storage_, level, entries, children,
+                                  std::move(callback), stats, fanout_bits);
+          },
+          &status, result)) {
+    return Status::ILLEGAL_STATE;
+  }
+  return status;
+}
+
+Status SynchronousStorage::GetValueSize(ObjectIdView object_id,
+                                        uint64_t* size) {
   Status status;
-  if (coroutine::SyncCall(handler_,
-                          [this, level, &entries, &children](
-                              std::function<void(Status, ObjectId)> callback) {
-                            TreeNode::FromEntries(page_storage_, level, entries,
-                                                  children,
-                                                  std::move(callback));
-                          },
-                          &status, result)) {
+  if (coroutine::SyncCall(
+          handler_,
+          [this, &object_id](std::function<void(Status, uint64_t)> callback) {
+            page_storage_->GetObjectSize(object_id, std::move(callback));
+          },
+          &status, size)) {
     return Status::ILLEGAL_STATE;
   }
   return status;
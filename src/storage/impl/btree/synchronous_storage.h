@@ -36,7 +36,13 @@ class SynchronousStorage {
   Status TreeNodeFromEntries(uint8_t level,
                              const std::vector<Entry>& entries,
                              const std::vector<ObjectId>& children,
-                             ObjectId* result);
+                             ObjectId* result,
+                             const NodeStats& stats = NodeStats(),
+                             uint8_t fanout_bits = kDefaultFanoutBits);
+
+  // Retrieves the size of the value with the given |object_id|, without
+  // reading its data. See |PageStorage::GetObjectSize|.
+  Status GetValueSize(ObjectIdView object_id, uint64_t* size);
 
  private:
   PageStorage* page_storage_;
@@ -5,6 +5,7 @@
 #include "apps/ledger/src/storage/impl/btree/tree_node.h"
 
 #include <algorithm>
+#include <numeric>
 
 #include "apps/ledger/src/callback/waiter.h"
 #include "apps/ledger/src/convert/convert.h"
@@ -22,12 +23,17 @@ TreeNode::TreeNode(PageStorage* page_storage,
                    std::string id,
                    uint8_t level,
                    std::vector<Entry> entries,
-                   std::vector<ObjectId> children)
+                   std::vector<ObjectId> children,
+                   NodeStats stats,
+                   uint8_t fanout_bits)
     : page_storage_(page_storage),
       id_(std::move(id)),
       level_(level),
-      entries_(entries),
-      children_(children) {
+      entries_(std::move(entries)),
+      key_index_(entries_),
+      children_(std::move(children)),
+      stats_(std::move(stats)),
+      fanout_bits_(fanout_bits) {
   FTL_DCHECK(entries_.size() + 1 == children_.size());
 }
 
@@ -52,18 +58,24 @@ void TreeNode::FromId(
 }
 
 void TreeNode::Empty(PageStorage* page_storage,
-                     std::function<void(Status, ObjectId)> callback) {
+                     std::function<void(Status, ObjectId)> callback,
+                     uint8_t fanout_bits) {
+  NodeStats stats;
+  stats.children_entry_counts.push_back(0u);
   FromEntries(page_storage, 0u, std::vector<Entry>(), std::vector<ObjectId>(1),
-              std::move(callback));
+              std::move(callback), stats, fanout_bits);
 }
 
 void TreeNode::FromEntries(PageStorage* page_storage,
                            uint8_t level,
                            const std::vector<Entry>& entries,
                            const std::vector<ObjectId>& children,
-                           std::function<void(Status, ObjectId)> callback) {
+                           std::function<void(Status, ObjectId)> callback,
+                           const NodeStats& stats,
+                           uint8_t fanout_bits) {
   FTL_DCHECK(entries.size() + 1 == children.size());
-  std::string encoding = storage::EncodeNode(level, entries, children);
+  std::string encoding =
+      storage::EncodeNode(level, entries, children, stats, fanout_bits);
   page_storage->AddObjectFromLocal(mtl::WriteStringToSocket(encoding),
                                    encoding.length(), std::move(callback));
 }
@@ -97,31 +109,29 @@ ObjectIdView TreeNode::GetChildId(int index) const {
 
 Status TreeNode::FindKeyOrChild(convert::ExtendedStringView key,
                                 int* index) const {
-  if (key.empty()) {
-    *index = 0;
-    return !entries_.empty() && entries_[0].key.empty() ? Status::OK
-                                                        : Status::NOT_FOUND;
-  }
-  auto it =
-      std::lower_bound(entries_.begin(), entries_.end(), key,
-                       [](const Entry& entry, convert::ExtendedStringView key) {
-                         return entry.key < key;
-                       });
-  if (it == entries_.end()) {
-    *index = entries_.size();
-    return Status::NOT_FOUND;
-  }
-  *index = it - entries_.begin();
-  if (it->key == key) {
+  size_t lower = GetEntryOrChildIndex(key);
+  *index = lower;
+  if (lower < entries_.size() && entries_[lower].key == key) {
     return Status::OK;
   }
   return Status::NOT_FOUND;
 }
 
+size_t TreeNode::GetEntryOrChildIndex(ftl::StringView key) const {
+  return key_index_.LowerBound(entries_, key);
+}
+
 const ObjectId& TreeNode::GetId() const {
   return id_;
 }
 
+uint64_t TreeNode::GetSubtreeEntryCount() const {
+  FTL_DCHECK(HasEntryCounts());
+  return std::accumulate(stats_.children_entry_counts.begin(),
+                         stats_.children_entry_counts.end(),
+                         static_cast<uint64_t>(entries_.size()));
+}
+
 Status TreeNode::FromObject(PageStorage* page_storage,
                             std::unique_ptr<const Object> object,
                             std::unique_ptr<const TreeNode>* node) {
@@ -133,11 +143,14 @@ Status TreeNode::FromObject(PageStorage* page_storage,
   uint8_t level;
   std::vector<Entry> entries;
   std::vector<ObjectId> children;
-  if (!DecodeNode(json, &level, &entries, &children)) {
+  NodeStats stats;
+  uint8_t fanout_bits;
+  if (!DecodeNode(json, &level, &entries, &children, &stats, &fanout_bits)) {
     return Status::FORMAT_ERROR;
   }
   node->reset(new TreeNode(page_storage, object->GetId(), level,
-                           std::move(entries), std::move(children)));
+                           std::move(entries), std::move(children),
+                           std::move(stats), fanout_bits));
   return Status::OK;
 }
 
@@ -10,6 +10,8 @@
 #include <vector>
 
 #include "apps/ledger/src/convert/convert.h"
+#include "apps/ledger/src/storage/impl/btree/encoding.h"
+#include "apps/ledger/src/storage/impl/btree/key_index.h"
 #include "apps/ledger/src/storage/public/object.h"
 #include "apps/ledger/src/storage/public/page_storage.h"
 #include "apps/ledger/src/storage/public/types.h"
@@ -32,16 +34,21 @@ class TreeNode {
   // id in the children's vector indicates that there is no child in that
   // index. The |callback| will be called with the success or error status and
   // the id of the new node. It is expected that |children| = |entries| + 1.
+  // |stats|, if not empty, are stored with the node; see |NodeStats|.
+  // |fanout_bits| is the fan-out of the tree the node belongs to.
   static void FromEntries(PageStorage* page_storage,
                           uint8_t level,
                           const std::vector<Entry>& entries,
                           const std::vector<ObjectId>& children,
-                          std::function<void(Status, ObjectId)> callback);
+                          std::function<void(Status, ObjectId)> callback,
+                          const NodeStats& stats = NodeStats(),
+                          uint8_t fanout_bits = kDefaultFanoutBits);
 
   // Creates an empty node, i.e. a TreeNode with no entries and an empty child
   // at index 0 and calls the callback with the result.
   static void Empty(PageStorage* page_storage,
-                    std::function<void(Status, ObjectId)> callback);
+                    std::function<void(Status, ObjectId)> callback,
+                    uint8_t fanout_bits = kDefaultFanoutBits);
 
   // Returns the number of entries stored in this tree node.
   int GetKeyCount() const;
@@ -69,20 +76,43 @@ class TreeNode {
   // might be found.
   Status FindKeyOrChild(convert::ExtendedStringView key, int* index) const;
 
+  // Returns the index of the entry that contains |key|, or of the first entry
+  // with a key greater than |key|. In the second case, the key, if present,
+  // will be found in the child at the returned index.
+  size_t GetEntryOrChildIndex(ftl::StringView key) const;
+
   const ObjectId& GetId() const;
 
+  // Returns whether this node holds the number of entries of its children's
+  // subtrees.
+  bool HasEntryCounts() const {
+    return !stats_.children_entry_counts.empty();
+  }
+
+  // Returns the number of entries in the subtree rooted at this node. Only
+  // valid if |HasEntryCounts| is true.
+  uint64_t GetSubtreeEntryCount() const;
+
   uint8_t level() const { return level_; }
 
+  // Returns the fan-out of the tree this node belongs to. See
+  // |kDefaultFanoutBits|.
+  uint8_t fanout_bits() const { return fanout_bits_; }
+
   const std::vector<Entry>& entries() const { return entries_; }
 
   const std::vector<ObjectId>& children_ids() const { return children_; }
 
+  const NodeStats& stats() const { return stats_; }
+
  private:
   TreeNode(PageStorage* page_storage,
            std::string id,
            uint8_t level,
            std::vector<Entry> entries,
-           std::vector<ObjectId> children);
+           std::vector<ObjectId> children,
+           NodeStats stats,
+           uint8_t fanout_bits);
 
   // Creates a |TreeNode| object for an existing |object| and stores it in the
   // given |node|.
@@ -94,7 +124,10 @@ class TreeNode {
   ObjectId id_;
   const uint8_t level_;
   const std::vector<Entry> entries_;
+  const KeyIndex key_index_;
   const std::vector<ObjectId> children_;
+  const NodeStats stats_;
+  const uint8_t fanout_bits_;
 };
 
 }  // namespace storage
@@ -0,0 +1,68 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/storage/impl/chunker.h"
+
+#include "lib/ftl/logging.h"
+
+namespace storage {
+namespace {
+
+// Returns the table of random values of the Gear hash. The values are
+// generated by splitmix64 from a fixed seed, so that they are the same on all
+// devices.
+const uint64_t* GetGearTable() {
+  static const uint64_t* table = [] {
+    static uint64_t values[256];
+    uint64_t state = 0x4c6564676572ull;
+    for (uint64_t& value : values) {
+      state += 0x9e3779b97f4a7c15ull;
+      uint64_t z = state;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      value = z ^ (z >> 31);
+    }
+    return values;
+  }();
+  return table;
+}
+
+// Returns a mask of the log2(|average_size|) most significant bits. The most
+// significant bits of the Gear hash depend on the last 64 bytes.
+uint64_t GetMask(size_t average_size) {
+  FTL_DCHECK(average_size > 1u && (average_size & (average_size - 1)) == 0u);
+  size_t bits = 0u;
+  while ((static_cast<size_t>(1) << bits) < average_size) {
+    ++bits;
+  }
+  return ~0ull << (64 - bits);
+}
+
+}  // namespace
+
+Chunker::Chunker(size_t min_size, size_t average_size, size_t max_size)
+    : min_size_(min_size), max_size_(max_size), mask_(GetMask(average_size)) {
+  FTL_DCHECK(0u < min_size_ && min_size_ <= average_size &&
+             average_size <= max_size_);
+}
+
+Chunker::~Chunker() {}
+
+bool Chunker::FindBoundary(ftl::StringView data, size_t* length) {
+  const uint64_t* gear = GetGearTable();
+  for (size_t i = 0; i < data.size(); ++i) {
+    hash_ = (hash_ << 1) + gear[static_cast<uint8_t>(data[i])];
+    ++size_;
+    if ((size_ >= min_size_ && (hash_ & mask_) == 0u) || size_ == max_size_) {
+      *length = i + 1;
+      size_ = 0u;
+      hash_ = 0u;
+      return true;
+    }
+  }
+  *length = data.size();
+  return false;
+}
+
+}  // namespace storage
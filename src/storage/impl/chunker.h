@@ -0,0 +1,56 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_STORAGE_IMPL_CHUNKER_H_
+#define APPS_LEDGER_SRC_STORAGE_IMPL_CHUNKER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lib/ftl/macros.h"
+#include "lib/ftl/strings/string_view.h"
+
+namespace storage {
+
+// Default bounds of the size of the chunks of large objects.
+constexpr size_t kMinChunkSize = 16 * 1024;
+constexpr size_t kAverageChunkSize = 64 * 1024;
+constexpr size_t kMaxChunkSize = 256 * 1024;
+
+// Content-defined chunker: splits a stream of data into chunks whose
+// boundaries only depend on the content around them, using a rolling Gear
+// hash. Inserting or removing data only changes the chunks around the
+// modification, so that the other chunks of a modified object are shared with
+// the original one.
+//
+// Chunks are at least |min_size| bytes long, except for the last one, and at
+// most |max_size| bytes long. The boundaries must be the same on all devices:
+// the chunking parameters of stored objects must never change.
+class Chunker {
+ public:
+  // |average_size| must be a power of 2.
+  Chunker(size_t min_size = kMinChunkSize,
+          size_t average_size = kAverageChunkSize,
+          size_t max_size = kMaxChunkSize);
+  ~Chunker();
+
+  // Scans |data|, the continuation of the current chunk. If the current chunk
+  // ends within |data|, sets |length| to the number of bytes of |data| that
+  // belong to it, starts a new chunk and returns true. Otherwise, sets
+  // |length| to the size of |data| and returns false.
+  bool FindBoundary(ftl::StringView data, size_t* length);
+
+ private:
+  const size_t min_size_;
+  const size_t max_size_;
+  const uint64_t mask_;
+  size_t size_ = 0u;
+  uint64_t hash_ = 0u;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(Chunker);
+};
+
+}  // namespace storage
+
+#endif  // APPS_LEDGER_SRC_STORAGE_IMPL_CHUNKER_H_
@@ -0,0 +1,89 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/storage/impl/chunker.h"
+
+#include <string>
+#include <vector>
+
+#include "apps/ledger/src/glue/crypto/rand.h"
+#include "gtest/gtest.h"
+
+namespace storage {
+namespace {
+
+std::string RandomData(size_t size) {
+  std::string data(size, '\0');
+  glue::RandBytes(&data[0], size);
+  return data;
+}
+
+// Splits |data| in chunks, feeding the chunker with blocks of |block_size|
+// bytes.
+std::vector<std::string> Split(const std::string& data, size_t block_size) {
+  Chunker chunker(64, 256, 1024);
+  std::vector<std::string> chunks(1);
+  for (size_t start = 0; start < data.size(); start += block_size) {
+    ftl::StringView block = ftl::StringView(data).substr(start, block_size);
+    while (!block.empty()) {
+      size_t length;
+      bool boundary = chunker.FindBoundary(block, &length);
+      chunks.back().append(block.data(), length);
+      if (boundary) {
+        chunks.emplace_back();
+      }
+      block = block.substr(length);
+    }
+  }
+  if (chunks.back().empty()) {
+    chunks.pop_back();
+  }
+  return chunks;
+}
+
+TEST(ChunkerTest, ChunkSizes) {
+  std::string data = RandomData(100000);
+  std::vector<std::string> chunks = Split(data, data.size());
+  EXPECT_LT(10u, chunks.size());
+  std::string joined;
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    if (i + 1 < chunks.size()) {
+      EXPECT_LE(64u, chunks[i].size());
+    }
+    EXPECT_GE(1024u, chunks[i].size());
+    joined += chunks[i];
+  }
+  EXPECT_EQ(data, joined);
+}
+
+TEST(ChunkerTest, IndependentOfBlockSize) {
+  std::string data = RandomData(100000);
+  std::vector<std::string> chunks = Split(data, data.size());
+  EXPECT_EQ(chunks, Split(data, 1));
+  EXPECT_EQ(chunks, Split(data, 1000));
+}
+
+TEST(ChunkerTest, LocalModification) {
+  std::string data = RandomData(100000);
+  std::vector<std::string> chunks = Split(data, data.size());
+  std::string modified_data = data;
+  modified_data.insert(data.size() / 2, "inserted");
+  std::vector<std::string> modified_chunks =
+      Split(modified_data, modified_data.size());
+
+  // Only the chunks around the modification differ.
+  size_t common_prefix = 0u;
+  while (chunks[common_prefix] == modified_chunks[common_prefix]) {
+    ++common_prefix;
+  }
+  size_t common_suffix = 0u;
+  while (chunks[chunks.size() - common_suffix - 1] ==
+         modified_chunks[modified_chunks.size() - common_suffix - 1]) {
+    ++common_suffix;
+  }
+  EXPECT_GE(4u, chunks.size() - common_prefix - common_suffix);
+}
+
+}  // namespace
+}  // namespace storage
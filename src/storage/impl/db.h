@@ -120,6 +120,29 @@ class DB {
   virtual Status RemoveJournalEntry(const JournalId& journal_id,
                                     convert::ExtendedStringView key) = 0;
 
+  // Deletes all the keys in [|min_key|, |max_key|) from the journal with the
+  // given |journal_id|, including the ones in the base commit of the journal.
+  // An empty |max_key| extends the range to the end of the key space. Entries
+  // of the journal in the range are removed.
+  virtual Status AddJournalDeletedRange(const JournalId& journal_id,
+                                        ftl::StringView min_key,
+                                        ftl::StringView max_key) = 0;
+
+  // Finds the ranges of keys deleted in the journal with the given
+  // |journal_id| and replaces the contents of |ranges| with them.
+  virtual Status GetJournalDeletedRanges(const JournalId& journal_id,
+                                         std::vector<KeyRange>* ranges) = 0;
+
+  // Sets the fan-out of the tree built when the journal with the given
+  // |journal_id| is committed.
+  virtual Status SetJournalFanout(const JournalId& journal_id,
+                                  uint8_t fanout_bits) = 0;
+
+  // Finds the fan-out set on the journal with the given |journal_id|. Sets
+  // |fanout_bits| to 0 if no fan-out was set.
+  virtual Status GetJournalFanout(const JournalId& journal_id,
+                                  uint8_t* fanout_bits) = 0;
+
   // Journal value counters can be used to keep track of how many times a given
   // value is referenced in a journal.
   // Returns the number of times the given value is refererenced.
@@ -164,7 +187,8 @@ class DB {
   // with their ids. |object_ids| will be lexicographically sorted.
   virtual Status GetUnsyncedObjectIds(std::vector<ObjectId>* object_ids) = 0;
 
-  // Marks the given |object_id| as synced.
+  // Marks the given |object_id| as synced, and records that it is stored in
+  // the cloud.
   virtual Status MarkObjectIdSynced(ObjectIdView object_id) = 0;
 
   // Marks the given |object_id| as unsynced.
@@ -173,6 +197,12 @@ class DB {
   // Checks if the object with the given |object_id| is synced.
   virtual Status IsObjectSynced(ObjectIdView object_id, bool* is_synced) = 0;
 
+  // Checks if the object with the given |object_id| is known to be stored in
+  // the cloud, i.e. was marked as synced and is not marked as unsynced. Unlike
+  // |IsObjectSynced|, this is false for objects never marked either way.
+  virtual Status IsObjectKnownSynced(ObjectIdView object_id,
+                                     bool* is_synced) = 0;
+
   // Sets the opaque sync metadata associated with this page.
   virtual Status SetSyncMetadata(ftl::StringView sync_state) = 0;
 
@@ -74,6 +74,23 @@ Status DbEmptyImpl::RemoveJournalEntry(const JournalId& journal_id,
                                        convert::ExtendedStringView key) {
   return Status::NOT_IMPLEMENTED;
 }
+Status DbEmptyImpl::AddJournalDeletedRange(const JournalId& journal_id,
+                                           ftl::StringView min_key,
+                                           ftl::StringView max_key) {
+  return Status::NOT_IMPLEMENTED;
+}
+Status DbEmptyImpl::GetJournalDeletedRanges(const JournalId& journal_id,
+                                            std::vector<KeyRange>* ranges) {
+  return Status::NOT_IMPLEMENTED;
+}
+Status DbEmptyImpl::SetJournalFanout(const JournalId& journal_id,
+                                     uint8_t fanout_bits) {
+  return Status::NOT_IMPLEMENTED;
+}
+Status DbEmptyImpl::GetJournalFanout(const JournalId& journal_id,
+                                     uint8_t* fanout_bits) {
+  return Status::NOT_IMPLEMENTED;
+}
 Status DbEmptyImpl::GetJournalEntries(
     const JournalId& journal_id,
     std::unique_ptr<Iterator<const EntryChange>>* entries) {
@@ -118,6 +135,10 @@ Status DbEmptyImpl::MarkObjectIdUnsynced(ObjectIdView object_id) {
 Status DbEmptyImpl::IsObjectSynced(ObjectIdView object_id, bool* is_synced) {
   return Status::NOT_IMPLEMENTED;
 }
+Status DbEmptyImpl::IsObjectKnownSynced(ObjectIdView object_id,
+                                        bool* is_synced) {
+  return Status::NOT_IMPLEMENTED;
+}
 Status DbEmptyImpl::SetSyncMetadata(ftl::StringView sync_state) {
   return Status::NOT_IMPLEMENTED;
 }
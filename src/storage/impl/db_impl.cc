@@ -28,6 +28,8 @@ constexpr ftl::StringView kJournalPrefix = "journals/";
 constexpr ftl::StringView kImplicitJournalMetaPrefix = "journals/implicit/";
 constexpr ftl::StringView kJournalEntry = "entry/";
 constexpr ftl::StringView kJournalCounter = "counter/";
+constexpr ftl::StringView kJournalRange = "range/";
+constexpr ftl::StringView kJournalFanout = "fanout";
 const char kImplicitJournalIdPrefix = 'I';
 const char kExplicitJournalIdPrefix = 'E';
 const size_t kJournalEntryPrefixSize =
@@ -41,6 +43,7 @@ const size_t kJournalEntryAddPrefixSize = 2;
 
 constexpr ftl::StringView kUnsyncedCommitPrefix = "unsynced/commits/";
 constexpr ftl::StringView kUnsyncedObjectPrefix = "unsynced/objects/";
+constexpr ftl::StringView kSyncedObjectPrefix = "synced/objects/";
 
 constexpr ftl::StringView kSyncMetadata = "sync-metadata";
 
@@ -60,6 +63,10 @@ std::string GetUnsyncedObjectKeyFor(ObjectIdView object_id) {
   return ftl::Concatenate({kUnsyncedObjectPrefix, object_id});
 }
 
+std::string GetSyncedObjectKeyFor(ObjectIdView object_id) {
+  return ftl::Concatenate({kSyncedObjectPrefix, object_id});
+}
+
 std::string GetImplicitJournalMetaKeyFor(const JournalId& journal_id) {
   return ftl::Concatenate({kImplicitJournalMetaPrefix, journal_id});
 }
@@ -96,6 +103,19 @@ std::string GetJournalCounterKeyFor(const JournalId& id,
   return ftl::Concatenate({GetJournalCounterPrefixFor(id), value});
 }
 
+std::string GetJournalRangePrefixFor(const JournalId& id) {
+  return ftl::Concatenate({kJournalPrefix, id, "/", kJournalRange});
+}
+
+std::string GetJournalRangeKeyFor(const JournalId& id,
+                                  ftl::StringView min_key) {
+  return ftl::Concatenate({GetJournalRangePrefixFor(id), min_key});
+}
+
+std::string GetJournalFanoutKeyFor(const JournalId& id) {
+  return ftl::Concatenate({kJournalPrefix, id, "/", kJournalFanout});
+}
+
 std::string NewJournalId(JournalType journal_type) {
   std::string id;
   id.resize(kJournalIdSize);
@@ -281,8 +301,11 @@ Status DbImpl::CreateJournal(JournalType journal_type,
                              const CommitId& base,
                              std::unique_ptr<Journal>* journal) {
   JournalId id = NewJournalId(journal_type);
+  // Explicit journals hold the changes of a transaction: build their tree
+  // while the transaction is open rather than all at once on commit.
   *journal = JournalDBImpl::Simple(journal_type, coroutine_service_,
-                                   page_storage_, this, id, base);
+                                   page_storage_, this, id, base,
+                                   journal_type == JournalType::EXPLICIT);
   if (journal_type == JournalType::IMPLICIT) {
     return Put(GetImplicitJournalMetaKeyFor(id), base);
   }
@@ -328,6 +351,14 @@ Status DbImpl::RemoveJournal(const JournalId& journal_id) {
       return s;
     }
   }
+  Status s = Delete(GetJournalFanoutKeyFor(journal_id));
+  if (s != Status::OK) {
+    return s;
+  }
+  s = DeleteByPrefix(GetJournalRangePrefixFor(journal_id));
+  if (s != Status::OK) {
+    return s;
+  }
   return DeleteByPrefix(GetJournalEntryPrefixFor(journal_id));
 }
 
@@ -344,6 +375,81 @@ Status DbImpl::RemoveJournalEntry(const JournalId& journal_id,
   return Put(GetJournalEntryKeyFor(journal_id, key), kJournalEntryDelete);
 }
 
+Status DbImpl::AddJournalDeletedRange(const JournalId& journal_id,
+                                      ftl::StringView min_key,
+                                      ftl::StringView max_key) {
+  // Deleted ranges are applied on the base commit, before the entries of the
+  // journal: the entries in the range must be removed.
+  std::string entry_prefix = GetJournalEntryPrefixFor(journal_id);
+  std::string entry_end = GetJournalEntryKeyFor(journal_id, max_key);
+  std::unique_ptr<leveldb::Iterator> it(db_->NewIterator(read_options_));
+  for (it->Seek(GetJournalEntryKeyFor(journal_id, min_key));
+       it->Valid() && it->key().starts_with(entry_prefix) &&
+       (max_key.empty() || it->key().compare(entry_end) < 0);
+       it->Next()) {
+    Status s = Delete(it->key());
+    if (s != Status::OK) {
+      return s;
+    }
+  }
+  if (!it->status().ok()) {
+    return ConvertStatus(it->status());
+  }
+
+  // Ranges are keyed by their start. Keep the widest one.
+  std::string range_key = GetJournalRangeKeyFor(journal_id, min_key);
+  std::string previous_max_key;
+  Status s = Get(range_key, &previous_max_key);
+  if (s == Status::OK &&
+      (previous_max_key.empty() ||
+       (!max_key.empty() && max_key <= ftl::StringView(previous_max_key)))) {
+    return Status::OK;
+  }
+  if (s != Status::OK && s != Status::NOT_FOUND) {
+    return s;
+  }
+  return Put(range_key, max_key);
+}
+
+Status DbImpl::GetJournalDeletedRanges(const JournalId& journal_id,
+                                       std::vector<KeyRange>* ranges) {
+  std::vector<std::pair<std::string, std::string>> entries;
+  Status s = GetEntriesByPrefix(GetJournalRangePrefixFor(journal_id), &entries);
+  if (s != Status::OK) {
+    return s;
+  }
+  std::vector<KeyRange> result;
+  for (auto& entry : entries) {
+    result.push_back(KeyRange{std::move(entry.first), std::move(entry.second)});
+  }
+  ranges->swap(result);
+  return Status::OK;
+}
+
+Status DbImpl::SetJournalFanout(const JournalId& journal_id,
+                                uint8_t fanout_bits) {
+  return Put(GetJournalFanoutKeyFor(journal_id),
+             ftl::StringView(reinterpret_cast<const char*>(&fanout_bits), 1));
+}
+
+Status DbImpl::GetJournalFanout(const JournalId& journal_id,
+                                uint8_t* fanout_bits) {
+  std::string value;
+  Status s = Get(GetJournalFanoutKeyFor(journal_id), &value);
+  if (s == Status::NOT_FOUND) {
+    *fanout_bits = 0;
+    return Status::OK;
+  }
+  if (s != Status::OK) {
+    return s;
+  }
+  if (value.size() != 1) {
+    return Status::FORMAT_ERROR;
+  }
+  *fanout_bits = static_cast<uint8_t>(value[0]);
+  return Status::OK;
+}
+
 Status DbImpl::GetJournalValue(const JournalId& journal_id,
                                ftl::StringView key,
                                std::string* value) {
@@ -443,6 +549,13 @@ Status DbImpl::GetUnsyncedObjectIds(std::vector<ObjectId>* object_ids) {
 }
 
 Status DbImpl::MarkObjectIdSynced(ObjectIdView object_id) {
+  // The object is recorded as stored in the cloud before being removed from
+  // the unsynced objects, so that it is never seen as synced if this is
+  // interrupted.
+  Status s = Put(GetSyncedObjectKeyFor(object_id), "");
+  if (s != Status::OK) {
+    return s;
+  }
   return Delete(GetUnsyncedObjectKeyFor(object_id));
 }
 
@@ -460,6 +573,20 @@ Status DbImpl::IsObjectSynced(ObjectIdView object_id, bool* is_synced) {
   return Status::OK;
 }
 
+Status DbImpl::IsObjectKnownSynced(ObjectIdView object_id, bool* is_synced) {
+  Status s = IsObjectSynced(object_id, is_synced);
+  if (s != Status::OK || !*is_synced) {
+    return s;
+  }
+  std::string value;
+  s = Get(GetSyncedObjectKeyFor(object_id), &value);
+  if (s == Status::INTERNAL_IO_ERROR) {
+    return s;
+  }
+  *is_synced = (s == Status::OK);
+  return Status::OK;
+}
+
 Status DbImpl::SetSyncMetadata(ftl::StringView sync_state) {
   return Put(kSyncMetadata, sync_state);
 }
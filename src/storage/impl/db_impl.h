@@ -55,6 +55,15 @@ class DbImpl : public DB {
                          std::string* value) override;
   Status RemoveJournalEntry(const JournalId& journal_id,
                             convert::ExtendedStringView key) override;
+  Status AddJournalDeletedRange(const JournalId& journal_id,
+                                ftl::StringView min_key,
+                                ftl::StringView max_key) override;
+  Status GetJournalDeletedRanges(const JournalId& journal_id,
+                                 std::vector<KeyRange>* ranges) override;
+  Status SetJournalFanout(const JournalId& journal_id,
+                          uint8_t fanout_bits) override;
+  Status GetJournalFanout(const JournalId& journal_id,
+                          uint8_t* fanout_bits) override;
   Status GetJournalValueCounter(const JournalId& journal_id,
                                 ftl::StringView value,
                                 int* counter) override;
@@ -75,6 +84,7 @@ class DbImpl : public DB {
   Status MarkObjectIdSynced(ObjectIdView object_id) override;
   Status MarkObjectIdUnsynced(ObjectIdView object_id) override;
   Status IsObjectSynced(ObjectIdView object_id, bool* is_synced) override;
+  Status IsObjectKnownSynced(ObjectIdView object_id, bool* is_synced) override;
   Status SetSyncMetadata(ftl::StringView sync_state) override;
   Status GetSyncMetadata(std::string* sync_state) override;
 
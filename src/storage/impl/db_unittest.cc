@@ -167,6 +167,37 @@ TEST_F(DBTest, JournalEntries) {
   EXPECT_EQ(Status::OK, implicit_journal->Rollback());
 }
 
+TEST_F(DBTest, JournalFanout) {
+  CommitId commit_id = RandomId(kCommitIdSize);
+
+  std::unique_ptr<Journal> implicit_journal;
+  EXPECT_EQ(Status::OK, db_.CreateJournal(JournalType::IMPLICIT, commit_id,
+                                          &implicit_journal));
+  const JournalId& journal_id =
+      static_cast<JournalDBImpl*>(implicit_journal.get())->GetId();
+
+  uint8_t fanout_bits;
+  EXPECT_EQ(Status::OK, db_.GetJournalFanout(journal_id, &fanout_bits));
+  EXPECT_EQ(0u, fanout_bits);
+
+  EXPECT_EQ(Status::OK, implicit_journal->SetFanout(kMinFanoutBits));
+  EXPECT_EQ(Status::OK, db_.GetJournalFanout(journal_id, &fanout_bits));
+  EXPECT_EQ(kMinFanoutBits, fanout_bits);
+
+  // The fan-out is kept when the journal is reloaded.
+  std::unique_ptr<Journal> found_journal;
+  EXPECT_EQ(Status::OK, db_.GetImplicitJournal(journal_id, &found_journal));
+  EXPECT_EQ(Status::OK, db_.GetJournalFanout(journal_id, &fanout_bits));
+  EXPECT_EQ(kMinFanoutBits, fanout_bits);
+
+  EXPECT_EQ(Status::OK, db_.RemoveJournal(journal_id));
+  EXPECT_EQ(Status::OK, db_.GetJournalFanout(journal_id, &fanout_bits));
+  EXPECT_EQ(0u, fanout_bits);
+
+  EXPECT_EQ(Status::OK, found_journal->Rollback());
+  EXPECT_EQ(Status::OK, implicit_journal->Rollback());
+}
+
 TEST_F(DBTest, UnsyncedCommits) {
   CommitId commit_id = RandomId(kCommitIdSize);
   std::vector<CommitId> commit_ids;
@@ -218,12 +249,23 @@ TEST_F(DBTest, UnsyncedObjects) {
   bool is_synced;
   EXPECT_EQ(Status::OK, db_.IsObjectSynced(object_id, &is_synced));
   EXPECT_FALSE(is_synced);
+  EXPECT_EQ(Status::OK, db_.IsObjectKnownSynced(object_id, &is_synced));
+  EXPECT_FALSE(is_synced);
 
   EXPECT_EQ(Status::OK, db_.MarkObjectIdSynced(object_id));
   EXPECT_EQ(Status::OK, db_.GetUnsyncedObjectIds(&object_ids));
   EXPECT_TRUE(object_ids.empty());
   EXPECT_EQ(Status::OK, db_.IsObjectSynced(object_id, &is_synced));
   EXPECT_TRUE(is_synced);
+  EXPECT_EQ(Status::OK, db_.IsObjectKnownSynced(object_id, &is_synced));
+  EXPECT_TRUE(is_synced);
+
+  // Objects never marked are not known to be synced.
+  ObjectId other_object_id = RandomId(kObjectIdSize);
+  EXPECT_EQ(Status::OK, db_.IsObjectSynced(other_object_id, &is_synced));
+  EXPECT_TRUE(is_synced);
+  EXPECT_EQ(Status::OK, db_.IsObjectKnownSynced(other_object_id, &is_synced));
+  EXPECT_FALSE(is_synced);
 }
 
 TEST_F(DBTest, Batch) {
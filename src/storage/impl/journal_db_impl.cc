@@ -12,6 +12,7 @@
 #include "apps/ledger/src/storage/impl/commit_impl.h"
 #include "apps/ledger/src/storage/impl/db.h"
 #include "apps/ledger/src/storage/public/commit.h"
+#include "apps/ledger/src/storage/public/constants.h"
 #include "lib/ftl/functional/make_copyable.h"
 
 namespace storage {
@@ -44,9 +45,12 @@ std::unique_ptr<Journal> JournalDBImpl::Simple(
     PageStorageImpl* page_storage,
     DB* db,
     const JournalId& id,
-    const CommitId& base) {
-  return std::unique_ptr<Journal>(
-      new JournalDBImpl(type, coroutine_service, page_storage, db, id, base));
+    const CommitId& base,
+    bool build_incrementally) {
+  JournalDBImpl* db_journal =
+      new JournalDBImpl(type, coroutine_service, page_storage, db, id, base);
+  db_journal->build_incrementally_ = build_incrementally;
+  return std::unique_ptr<Journal>(db_journal);
 }
 
 std::unique_ptr<Journal> JournalDBImpl::Merge(
@@ -67,6 +71,35 @@ const JournalId& JournalDBImpl::GetId() const {
   return id_;
 }
 
+void JournalDBImpl::ApplyToBuilder(EntryChange change) {
+  if (!build_incrementally_) {
+    return;
+  }
+  if (!builder_) {
+    builder_ = std::make_unique<btree::IncrementalBuilder>(
+        coroutine_service_, page_storage_, [
+          page_storage = page_storage_, base = base_
+        ](std::function<void(Status, ObjectId)> callback) {
+          page_storage->GetCommit(
+              base, [callback = std::move(callback)](
+                        Status status,
+                        std::unique_ptr<const storage::Commit> commit) {
+                if (status != Status::OK) {
+                  callback(status, "");
+                  return;
+                }
+                callback(Status::OK, commit->GetRootId().ToString());
+              });
+        });
+  }
+  builder_->Apply(std::move(change));
+}
+
+void JournalDBImpl::DiscardBuilder() {
+  build_incrementally_ = false;
+  builder_.reset();
+}
+
 Status JournalDBImpl::UpdateValueCounter(
     ObjectIdView object_id,
     const std::function<int(int)>& operation) {
@@ -106,7 +139,13 @@ Status JournalDBImpl::Put(convert::ExtendedStringView key,
       UpdateValueCounter(prev_id, [](int counter) { return counter - 1; });
     }
   }
-  return batch->Execute();
+  s = batch->Execute();
+  if (s == Status::OK) {
+    ApplyToBuilder(
+        EntryChange{Entry{key.ToString(), object_id.ToString(), priority},
+                    false});
+  }
+  return s;
 }
 
 Status JournalDBImpl::Delete(convert::ExtendedStringView key) {
@@ -126,9 +165,95 @@ Status JournalDBImpl::Delete(convert::ExtendedStringView key) {
   if (prev_entry_status == Status::OK) {
     UpdateValueCounter(prev_id, [](int counter) { return counter - 1; });
   }
+  s = batch->Execute();
+  if (s == Status::OK) {
+    ApplyToBuilder(EntryChange{
+        Entry{key.ToString(), "", KeyPriority::EAGER}, true});
+  }
+  return s;
+}
+
+Status JournalDBImpl::DeleteRange(convert::ExtendedStringView min_key,
+                                  convert::ExtendedStringView max_key) {
+  if (!valid_ || (type_ == JournalType::EXPLICIT && failed_operation_)) {
+    return Status::ILLEGAL_STATE;
+  }
+  KeyRange range{min_key.ToString(), max_key.ToString()};
+
+  // Find the values referenced by the entries that are about to be removed.
+  std::vector<ObjectId> removed_values;
+  std::unique_ptr<Iterator<const EntryChange>> entries;
+  Status s = db_->GetJournalEntries(id_, &entries);
+  if (s != Status::OK) {
+    failed_operation_ = true;
+    return s;
+  }
+  for (; entries->Valid(); entries->Next()) {
+    const EntryChange& change = **entries;
+    if (!change.deleted && KeyRangeContains(range, change.entry.key)) {
+      removed_values.push_back(change.entry.object_id);
+    }
+  }
+  if (entries->GetStatus() != Status::OK) {
+    failed_operation_ = true;
+    return entries->GetStatus();
+  }
+
+  // Range deletions are applied on the base tree before the entries of the
+  // journal: the tree cannot be built incrementally anymore.
+  DiscardBuilder();
+
+  std::unique_ptr<DB::Batch> batch = db_->StartBatch();
+  s = db_->AddJournalDeletedRange(id_, range.min_key, range.max_key);
+  if (s != Status::OK) {
+    failed_operation_ = true;
+    return s;
+  }
+  for (const ObjectId& object_id : removed_values) {
+    UpdateValueCounter(object_id, [](int counter) { return counter - 1; });
+  }
   return batch->Execute();
 }
 
+Status JournalDBImpl::SetFanout(uint8_t fanout_bits) {
+  if (!valid_ || (type_ == JournalType::EXPLICIT && failed_operation_)) {
+    return Status::ILLEGAL_STATE;
+  }
+  if (fanout_bits < kMinFanoutBits || fanout_bits > kMaxFanoutBits) {
+    return Status::ILLEGAL_STATE;
+  }
+  // The fan-out is stored with the journal, so that it is kept when an
+  // IMPLICIT journal is committed after a restart.
+  Status s = db_->SetJournalFanout(id_, fanout_bits);
+  if (s != Status::OK) {
+    failed_operation_ = true;
+    return s;
+  }
+  // The tree may have to be rebuilt with the new fan-out.
+  DiscardBuilder();
+  return Status::OK;
+}
+
+Status JournalDBImpl::GetContents(std::vector<EntryChange>* changes,
+                                  std::vector<KeyRange>* deleted_ranges) {
+  if (!valid_) {
+    return Status::ILLEGAL_STATE;
+  }
+  std::unique_ptr<Iterator<const EntryChange>> entries;
+  Status s = db_->GetJournalEntries(id_, &entries);
+  if (s != Status::OK) {
+    return s;
+  }
+  changes->clear();
+  for (; entries->Valid(); entries->Next()) {
+    changes->push_back(**entries);
+  }
+  if (entries->GetStatus() != Status::OK) {
+    return entries->GetStatus();
+  }
+  return db_->GetJournalDeletedRanges(id_, deleted_ranges);
+}
+
 void JournalDBImpl::GetParents(
     std::function<void(Status,
                        std::vector<std::unique_ptr<const storage::Commit>>)>
@@ -158,11 +283,33 @@ Status JournalDBImpl::ClearCommittedJournal(
       return status;
     }
   }
+  std::vector<ObjectId> chunk_ids;
   for (const ObjectId& object_id : objects_to_sync) {
     status = db_->MarkObjectIdUnsynced(object_id);
     if (status != Status::OK) {
       return status;
     }
+    // The chunks of an object are uploaded with it, unless they are already
+    // stored in the cloud. They are marked in the same batch as the object, so
+    // that none can be left out if the commit is interrupted.
+    status = page_storage_->GetObjectChunkIds(object_id, &chunk_ids);
+    if (status != Status::OK) {
+      return status;
+    }
+    for (const ObjectId& chunk_id : chunk_ids) {
+      bool is_synced;
+      status = db_->IsObjectKnownSynced(chunk_id, &is_synced);
+      if (status != Status::OK) {
+        return status;
+      }
+      if (is_synced) {
+        continue;
+      }
+      status = db_->MarkObjectIdUnsynced(chunk_id);
+      if (status != Status::OK) {
+        return status;
+      }
+    }
   }
   status = batch->Execute();
   if (status != Status::OK) {
@@ -191,51 +338,80 @@ void JournalDBImpl::Commit(
       callback(status, nullptr);
       return;
     }
+    // In a merge, the tree keeps the fan-out of the left parent, unless
+    // explicitly set.
+    ObjectId root_id = parents[0]->GetRootId().ToString();
+    auto on_done = ftl::MakeCopyable([
+      this, parents = std::move(parents), callback = std::move(callback)
+    ](Status status, ObjectId object_id,
+      std::unordered_set<ObjectId> new_nodes) mutable {
+      if (status != Status::OK) {
+        callback(status, nullptr);
+        return;
+      }
+      // If the commit is a no-op, returns early.
+      if (parents.size() == 1 && parents.front()->GetRootId() == object_id) {
+        FTL_DCHECK(new_nodes.empty());
+        callback(Rollback(), std::move(parents.front()));
+        return;
+      }
+      std::unique_ptr<storage::Commit> commit =
+          CommitImpl::FromContentAndParents(page_storage_, object_id,
+                                            std::move(parents));
+      page_storage_->AddCommitFromLocal(
+          commit->Clone(), ftl::MakeCopyable([
+            this, commit = std::move(commit),
+            new_nodes = std::move(new_nodes), callback
+          ](Status status) mutable {
+            valid_ = false;
+            if (status != Status::OK) {
+              callback(status, nullptr);
+              return;
+            }
+            status = ClearCommittedJournal(std::move(new_nodes));
+            if (status != Status::OK) {
+              callback(status, nullptr);
+            } else {
+              callback(Status::OK, std::move(commit));
+            }
+          }));
+    });
+    if (builder_) {
+      // The changes of the journal have already been applied to the tree.
+      builder_->Finish(std::move(on_done));
+      return;
+    }
     std::unique_ptr<Iterator<const EntryChange>> entries;
     status = db_->GetJournalEntries(id_, &entries);
     if (status != Status::OK) {
-      callback(status, nullptr);
+      on_done(status, "", {});
       return;
     }
-    btree::ApplyChanges(
-        coroutine_service_, page_storage_, parents[0]->GetRootId(),
-        std::move(entries),
-        ftl::MakeCopyable([
-          this, parents = std::move(parents), callback = std::move(callback)
-        ](Status status, ObjectId object_id,
-          std::unordered_set<ObjectId> new_nodes) mutable {
-          if (status != Status::OK) {
-            callback(status, nullptr);
-            return;
-          }
-          // If the commit is a no-op, returns early.
-          if (parents.size() == 1 &&
-              parents.front()->GetRootId() == object_id) {
-            FTL_DCHECK(new_nodes.empty());
-            callback(Rollback(), std::move(parents.front()));
-            return;
-          }
-          std::unique_ptr<storage::Commit> commit =
-              CommitImpl::FromContentAndParents(page_storage_, object_id,
-                                                std::move(parents));
-          page_storage_->AddCommitFromLocal(
-              commit->Clone(), ftl::MakeCopyable([
-                this, commit = std::move(commit),
-                new_nodes = std::move(new_nodes), callback
-              ](Status status) mutable {
-                valid_ = false;
-                if (status != Status::OK) {
-                  callback(status, nullptr);
-                  return;
-                }
-                status = ClearCommittedJournal(std::move(new_nodes));
-                if (status != Status::OK) {
-                  callback(status, nullptr);
-                } else {
-                  callback(Status::OK, std::move(commit));
-                }
-              }));
-        }));
+    std::vector<KeyRange> deleted_ranges;
+    status = db_->GetJournalDeletedRanges(id_, &deleted_ranges);
+    if (status != Status::OK) {
+      on_done(status, "", {});
+      return;
+    }
+    uint8_t fanout_bits;
+    status = db_->GetJournalFanout(id_, &fanout_bits);
+    if (status != Status::OK) {
+      on_done(status, "", {});
+      return;
+    }
+    if (!deleted_ranges.empty()) {
+      // |fanout_bits| is |btree::kKeepFanout| unless explicitly set.
+      btree::ApplyChangesWithDeletedRanges(
+          coroutine_service_, page_storage_, root_id, fanout_bits,
+          std::move(deleted_ranges), std::move(entries), std::move(on_done));
+    } else if (fanout_bits) {
+      btree::ApplyChangesWithFanout(coroutine_service_, page_storage_, root_id,
+                                    fanout_bits, std::move(entries),
+                                    std::move(on_done));
+    } else {
+      btree::ApplyChanges(coroutine_service_, page_storage_, root_id,
+                          std::move(entries), std::move(on_done));
+    }
   });
 }
 
@@ -243,6 +419,7 @@ Status JournalDBImpl::Rollback() {
   if (!valid_) {
     return Status::ILLEGAL_STATE;
   }
+  builder_.reset();
   Status s = db_->RemoveJournal(id_);
   if (s == Status::OK) {
     valid_ = false;
@@ -13,6 +13,7 @@
 #include <unordered_set>
 
 #include "apps/ledger/src/coroutine/coroutine.h"
+#include "apps/ledger/src/storage/impl/btree/builder.h"
 #include "apps/ledger/src/storage/impl/db.h"
 #include "apps/ledger/src/storage/impl/page_storage_impl.h"
 #include "apps/ledger/src/storage/public/commit.h"
@@ -26,14 +27,17 @@ class JournalDBImpl : public Journal {
  public:
   ~JournalDBImpl() override;
 
-  // Creates a new Journal for a simple commit.
+  // Creates a new Journal for a simple commit. If |build_incrementally| is
+  // true, changes are applied to the tree of |base| as they are added to the
+  // journal, so that committing only requires to write the new tree nodes.
   static std::unique_ptr<Journal> Simple(
       JournalType type,
       coroutine::CoroutineService* coroutine_service,
       PageStorageImpl* page_storage,
       DB* db,
       const JournalId& id,
-      const CommitId& base);
+      const CommitId& base,
+      bool build_incrementally = false);
 
   // Creates a new Journal for a merge commit.
   static std::unique_ptr<Journal> Merge(
@@ -52,6 +56,11 @@ class JournalDBImpl : public Journal {
              ObjectIdView object_id,
              KeyPriority priority) override;
   Status Delete(convert::ExtendedStringView key) override;
+  Status DeleteRange(convert::ExtendedStringView min_key,
+                     convert::ExtendedStringView max_key) override;
+  Status SetFanout(uint8_t fanout_bits) override;
+  Status GetContents(std::vector<EntryChange>* changes,
+                     std::vector<KeyRange>* deleted_ranges) override;
   void Commit(
       std::function<void(Status, std::unique_ptr<const storage::Commit>)>
           callback) override;
@@ -65,6 +74,13 @@ class JournalDBImpl : public Journal {
                 const JournalId& id,
                 const CommitId& base);
 
+  // Applies |change| to |builder_| if the tree is built incrementally.
+  void ApplyToBuilder(EntryChange change);
+
+  // Stops building the tree incrementally: the tree is built from the content
+  // of the journal on commit.
+  void DiscardBuilder();
+
   Status UpdateValueCounter(ObjectIdView object_id,
                             const std::function<int(int)>& operation);
 
@@ -90,6 +106,9 @@ class JournalDBImpl : public Journal {
   // other than rolling back will fail. IMPLICIT journals can still be commited
   // even if some operations have failed.
   bool failed_operation_;
+  // Whether the tree of the new commit is built while changes are added.
+  bool build_incrementally_ = false;
+  std::unique_ptr<btree::IncrementalBuilder> builder_;
 };
 
 }  // namespace storage
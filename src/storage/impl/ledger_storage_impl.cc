@@ -4,6 +4,8 @@
 
 #include "apps/ledger/src/storage/impl/ledger_storage_impl.h"
 
+#include <stdio.h>
+
 #include <algorithm>
 #include <iterator>
 
@@ -11,15 +13,24 @@
 #include "apps/ledger/src/storage/impl/page_storage_impl.h"
 #include "apps/ledger/src/storage/public/constants.h"
 #include "lib/ftl/files/directory.h"
+#include "lib/ftl/files/file.h"
 #include "lib/ftl/files/path.h"
 #include "lib/ftl/functional/make_copyable.h"
 #include "lib/ftl/logging.h"
 #include "lib/ftl/strings/concatenate.h"
+#include "lib/ftl/time/time_delta.h"
 
 namespace storage {
 
 namespace {
 
+// Name of the file holding the access counts of the pages, in the storage
+// directory of the ledger.
+constexpr ftl::StringView kPageUsageFile = "page_usage";
+
+// Delay after which recorded page accesses are written to disk.
+constexpr ftl::TimeDelta kPageUsageWriteDelay = ftl::TimeDelta::FromSeconds(1);
+
 // Encodes opaque bytes in a way that is usable as a directory name.
 std::string GetDirectoryName(ftl::StringView bytes) {
   // TODO(ppi): switch to a method that needs only one pass.
@@ -37,6 +48,25 @@ std::string GetDirectoryName(ftl::StringView bytes) {
   }
   return encoded;
 }
+
+// Writes |data| to the file at |path|, through a temporary file so that the
+// previous contents are kept if the write fails.
+void WriteFileAtomically(const std::string& path, const std::string& data) {
+  std::string directory = files::GetDirectoryName(path);
+  if (!files::IsDirectory(directory) && !files::CreateDirectory(directory)) {
+    FTL_LOG(ERROR) << "Failed to create directory " << directory;
+    return;
+  }
+  std::string temp_path = path + ".tmp";
+  if (!files::WriteFile(temp_path, data.data(), data.size())) {
+    FTL_LOG(ERROR) << "Failed to write " << temp_path;
+    return;
+  }
+  if (rename(temp_path.c_str(), path.c_str()) != 0) {
+    FTL_LOG(ERROR) << "Failed to rename " << temp_path << " to " << path;
+  }
+}
+
 }  // namespace
 
 LedgerStorageImpl::LedgerStorageImpl(
@@ -47,12 +77,17 @@ LedgerStorageImpl::LedgerStorageImpl(
     const std::string& ledger_name)
     : main_runner_(std::move(main_runner)),
       io_runner_(std::move(io_runner)),
-      coroutine_service_(coroutine_service) {
+      coroutine_service_(coroutine_service),
+      weak_factory_(this) {
   storage_dir_ = ftl::Concatenate({base_storage_dir, "/", kSerializationVersion,
                                    "/", GetDirectoryName(ledger_name)});
 }
 
-LedgerStorageImpl::~LedgerStorageImpl() {}
+LedgerStorageImpl::~LedgerStorageImpl() {
+  if (page_usage_write_pending_) {
+    WritePageUsage();
+  }
+}
 
 void LedgerStorageImpl::CreatePageStorage(
     PageId page_id,
@@ -102,6 +137,8 @@ void LedgerStorageImpl::GetPageStorage(
 
 bool LedgerStorageImpl::DeletePageStorage(PageIdView page_id) {
   // TODO(nellyv): We need to synchronize the page deletion with the cloud.
+  GetPageUsage()->Remove(page_id);
+  SchedulePageUsageWrite();
   std::string path = GetPathFor(page_id);
   if (!files::IsDirectory(path)) {
     return false;
@@ -113,9 +150,54 @@ bool LedgerStorageImpl::DeletePageStorage(PageIdView page_id) {
   return true;
 }
 
+void LedgerStorageImpl::RecordPageAccess(PageIdView page_id) {
+  GetPageUsage()->RecordAccess(page_id);
+  SchedulePageUsageWrite();
+}
+
+std::vector<PageId> LedgerStorageImpl::GetMostAccessedPages(size_t max_count) {
+  return GetPageUsage()->GetMostAccessedPages(max_count);
+}
+
 std::string LedgerStorageImpl::GetPathFor(PageIdView page_id) {
   FTL_DCHECK(!page_id.empty());
   return ftl::Concatenate({storage_dir_, "/", GetDirectoryName(page_id)});
 }
 
+PageUsage* LedgerStorageImpl::GetPageUsage() {
+  if (page_usage_) {
+    return page_usage_.get();
+  }
+  page_usage_ = std::make_unique<PageUsage>();
+  std::string path = ftl::Concatenate({storage_dir_, "/", kPageUsageFile});
+  std::string data;
+  if (files::ReadFileToString(path, &data) && !page_usage_->Decode(data)) {
+    FTL_LOG(WARNING) << "Ignoring invalid page usage file " << path;
+  }
+  return page_usage_.get();
+}
+
+void LedgerStorageImpl::SchedulePageUsageWrite() {
+  if (page_usage_write_pending_) {
+    return;
+  }
+  page_usage_write_pending_ = true;
+  main_runner_->PostDelayedTask(
+      [weak_this = weak_factory_.GetWeakPtr()] {
+        if (weak_this) {
+          weak_this->WritePageUsage();
+        }
+      },
+      kPageUsageWriteDelay);
+}
+
+void LedgerStorageImpl::WritePageUsage() {
+  FTL_DCHECK(page_usage_);
+  page_usage_write_pending_ = false;
+  io_runner_->PostTask([
+    path = ftl::Concatenate({storage_dir_, "/", kPageUsageFile}),
+    data = page_usage_->Encode()
+  ] { WriteFileAtomically(path, data); });
+}
+
 }  // namespace storage
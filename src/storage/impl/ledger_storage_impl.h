@@ -5,10 +5,14 @@
 #ifndef APPS_LEDGER_SRC_STORAGE_IMPL_LEDGER_STORAGE_IMPL_H_
 #define APPS_LEDGER_SRC_STORAGE_IMPL_LEDGER_STORAGE_IMPL_H_
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "apps/ledger/src/coroutine/coroutine.h"
+#include "apps/ledger/src/storage/impl/page_usage.h"
 #include "apps/ledger/src/storage/public/ledger_storage.h"
+#include "lib/ftl/memory/weak_ptr.h"
 #include "lib/ftl/tasks/task_runner.h"
 
 namespace storage {
@@ -34,13 +38,33 @@ class LedgerStorageImpl : public LedgerStorage {
 
   bool DeletePageStorage(PageIdView page_id) override;
 
+  void RecordPageAccess(PageIdView page_id) override;
+
+  std::vector<PageId> GetMostAccessedPages(size_t max_count) override;
+
  private:
   std::string GetPathFor(PageIdView page_id);
 
+  // Returns the access counts of the pages, reading them from disk on first
+  // use.
+  PageUsage* GetPageUsage();
+
+  // Writes the access counts of the pages after a delay, so that consecutive
+  // accesses are written at once.
+  void SchedulePageUsageWrite();
+
+  // Writes the access counts of the pages on the I/O thread.
+  void WritePageUsage();
+
   ftl::RefPtr<ftl::TaskRunner> main_runner_;
   ftl::RefPtr<ftl::TaskRunner> io_runner_;
   coroutine::CoroutineService* const coroutine_service_;
   std::string storage_dir_;
+  std::unique_ptr<PageUsage> page_usage_;
+  bool page_usage_write_pending_ = false;
+
+  // Must be the last member field.
+  ftl::WeakPtrFactory<LedgerStorageImpl> weak_factory_;
 };
 
 }  // namespace storage
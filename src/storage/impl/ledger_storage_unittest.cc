@@ -5,6 +5,7 @@
 #include "apps/ledger/src/storage/impl/ledger_storage_impl.h"
 
 #include <memory>
+#include <vector>
 
 #include "apps/ledger/src/callback/capture.h"
 #include "apps/ledger/src/coroutine/coroutine_impl.h"
@@ -28,11 +29,9 @@ class LedgerStorageTest : public test::TestWithMessageLoop {
 
   ~LedgerStorageTest() override {}
 
- private:
+ protected:
   files::ScopedTempDir tmp_dir_;
   coroutine::CoroutineServiceImpl coroutine_service_;
-
- protected:
   LedgerStorageImpl storage_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(LedgerStorageTest);
@@ -99,5 +98,37 @@ TEST_F(LedgerStorageTest, CreateDeletePageStorage) {
   EXPECT_FALSE(RunLoopWithTimeout());
 }
 
+TEST_F(LedgerStorageTest, PageUsage) {
+  storage_.RecordPageAccess("page1");
+  storage_.RecordPageAccess("page2");
+  storage_.RecordPageAccess("page2");
+  storage_.RecordPageAccess("page3");
+  EXPECT_EQ(std::vector<PageId>({"page2", "page1"}),
+            storage_.GetMostAccessedPages(2));
+
+  // Deleting a page forgets its accesses.
+  storage_.DeletePageStorage("page2");
+  EXPECT_EQ(std::vector<PageId>({"page1"}), storage_.GetMostAccessedPages(1));
+}
+
+TEST_F(LedgerStorageTest, PageUsagePersisted) {
+  {
+    LedgerStorageImpl storage(message_loop_.task_runner(),
+                              message_loop_.task_runner(), &coroutine_service_,
+                              tmp_dir_.path(), "other_app");
+    storage.RecordPageAccess("page1");
+    storage.RecordPageAccess("page2");
+    storage.RecordPageAccess("page2");
+  }
+  // Let the access counts be written.
+  EXPECT_TRUE(RunLoopWithTimeout(ftl::TimeDelta::FromMilliseconds(20)));
+
+  LedgerStorageImpl storage(message_loop_.task_runner(),
+                            message_loop_.task_runner(), &coroutine_service_,
+                            tmp_dir_.path(), "other_app");
+  EXPECT_EQ(std::vector<PageId>({"page2", "page1"}),
+            storage.GetMostAccessedPages(5));
+}
+
 }  // namespace
 }  // namespace storage
@@ -6,17 +6,53 @@
 
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <utility>
 #include <vector>
 
+#include "lib/ftl/files/eintr_wrapper.h"
 #include "lib/ftl/files/file.h"
+#include "lib/ftl/files/unique_fd.h"
 #include "lib/ftl/logging.h"
 
 namespace storage {
+namespace {
 
-ObjectImpl::ObjectImpl(ObjectId id, std::string file_path)
-    : id_(id), file_path_(file_path) {}
+// Appends the |length| bytes of the file at |file_path| starting at |offset|
+// to |data|.
+Status ReadFilePart(const std::string& file_path,
+                    uint64_t offset,
+                    uint64_t length,
+                    std::string* data) {
+  ftl::UniqueFD fd(HANDLE_EINTR(open(file_path.c_str(), O_RDONLY)));
+  if (!fd.is_valid()) {
+    return Status::INTERNAL_IO_ERROR;
+  }
+  size_t data_size = data->size();
+  data->resize(data_size + length);
+  size_t read = 0;
+  while (read < length) {
+    ssize_t count = HANDLE_EINTR(pread(fd.get(), &(*data)[data_size + read],
+                                       length - read, offset + read));
+    if (count <= 0) {
+      return Status::INTERNAL_IO_ERROR;
+    }
+    read += count;
+  }
+  return Status::OK;
+}
+
+}  // namespace
+
+ObjectImpl::ObjectImpl(ObjectId id,
+                       std::string file_path,
+                       std::vector<Chunk> chunks)
+    : id_(std::move(id)),
+      file_path_(std::move(file_path)),
+      chunks_(std::move(chunks)) {}
 
 ObjectImpl::~ObjectImpl() {}
 
@@ -25,15 +61,108 @@ ObjectId ObjectImpl::GetId() const {
 }
 
 Status ObjectImpl::GetData(ftl::StringView* data) const {
+  if (chunks_.empty()) {
+    return GetStorageBytes(data);
+  }
   if (data_.empty()) {
+    std::string res;
+    for (const auto& chunk : chunks_) {
+      Status status = ReadFilePart(chunk.file_path, 0u, chunk.size, &res);
+      if (status != Status::OK) {
+        return status;
+      }
+    }
+    data_.swap(res);
+  }
+  *data = data_;
+  return Status::OK;
+}
+
+Status ObjectImpl::GetSize(uint64_t* size) const {
+  if (!chunks_.empty()) {
+    *size = 0u;
+    for (const auto& chunk : chunks_) {
+      *size += chunk.size;
+    }
+    return Status::OK;
+  }
+  if (!storage_bytes_.empty()) {
+    *size = storage_bytes_.size();
+    return Status::OK;
+  }
+  struct stat file_stat;
+  if (stat(file_path_.c_str(), &file_stat) != 0) {
+    return Status::INTERNAL_IO_ERROR;
+  }
+  *size = file_stat.st_size;
+  return Status::OK;
+}
+
+Status ObjectImpl::ReadData(int64_t offset,
+                            int64_t max_size,
+                            std::string* data) const {
+  uint64_t start;
+  uint64_t length;
+  const std::string& cached_data = chunks_.empty() ? storage_bytes_ : data_;
+  if (!cached_data.empty()) {
+    GetDataPart(cached_data.size(), offset, max_size, &start, &length);
+    *data = cached_data.substr(start, length);
+    return Status::OK;
+  }
+
+  std::string result;
+  if (chunks_.empty()) {
+    struct stat file_stat;
+    if (stat(file_path_.c_str(), &file_stat) != 0) {
+      return Status::INTERNAL_IO_ERROR;
+    }
+    GetDataPart(file_stat.st_size, offset, max_size, &start, &length);
+    Status status = ReadFilePart(file_path_, start, length, &result);
+    if (status != Status::OK) {
+      return status;
+    }
+    data->swap(result);
+    return Status::OK;
+  }
+
+  // Only read the chunks overlapping the requested part.
+  uint64_t size = 0u;
+  for (const auto& chunk : chunks_) {
+    size += chunk.size;
+  }
+  GetDataPart(size, offset, max_size, &start, &length);
+  uint64_t chunk_start = 0u;
+  for (const auto& chunk : chunks_) {
+    if (result.size() == length) {
+      break;
+    }
+    uint64_t chunk_end = chunk_start + chunk.size;
+    if (chunk_end > start) {
+      uint64_t part_start = std::max(start, chunk_start) - chunk_start;
+      uint64_t part_length =
+          std::min(chunk.size - part_start, length - result.size());
+      Status status =
+          ReadFilePart(chunk.file_path, part_start, part_length, &result);
+      if (status != Status::OK) {
+        return status;
+      }
+    }
+    chunk_start = chunk_end;
+  }
+  data->swap(result);
+  return Status::OK;
+}
+
+Status ObjectImpl::GetStorageBytes(ftl::StringView* data) const {
+  if (storage_bytes_.empty()) {
     std::string res;
     // TODO(nellyv): Replace with mmap when supported.
     if (!files::ReadFileToString(file_path_.data(), &res)) {
       return Status::INTERNAL_IO_ERROR;
     }
-    data_.swap(res);
+    storage_bytes_.swap(res);
   }
-  *data = data_;
+  *data = storage_bytes_;
   return Status::OK;
 }
 
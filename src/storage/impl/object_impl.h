@@ -7,24 +7,43 @@
 
 #include "apps/ledger/src/storage/public/object.h"
 
+#include <string>
 #include <vector>
 
 namespace storage {
 
 class ObjectImpl : public Object {
  public:
-  ObjectImpl(ObjectId id, std::string file_path);
+  // A chunk of the data of a chunked object.
+  struct Chunk {
+    std::string file_path;
+    uint64_t size;
+  };
+
+  // Creates an object stored in the file at |file_path|. If |chunks| is not
+  // empty, the file holds the index of the object, whose data is the
+  // concatenation of |chunks|.
+  ObjectImpl(ObjectId id,
+             std::string file_path,
+             std::vector<Chunk> chunks = std::vector<Chunk>());
   ~ObjectImpl() override;
 
   // Object:
   ObjectId GetId() const override;
   Status GetData(ftl::StringView* data) const override;
+  Status GetSize(uint64_t* size) const override;
+  Status ReadData(int64_t offset,
+                  int64_t max_size,
+                  std::string* data) const override;
+  Status GetStorageBytes(ftl::StringView* data) const override;
 
  private:
   const ObjectId id_;
   const std::string file_path_;
+  const std::vector<Chunk> chunks_;
 
   mutable std::string data_;
+  mutable std::string storage_bytes_;
 };
 
 }  // namespace storage
@@ -6,6 +6,8 @@
 
 #include <algorithm>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "apps/ledger/src/glue/crypto/base64.h"
 #include "apps/ledger/src/glue/crypto/rand.h"
@@ -69,5 +71,71 @@ TEST_F(ObjectTest, Object) {
   EXPECT_EQ(0, memcmp(data.data(), found_data.data(), kFileSize));
 }
 
+TEST_F(ObjectTest, ReadData) {
+  std::string data = RandomString(kFileSize);
+  EXPECT_TRUE(files::WriteFile(object_file_path_, data.data(), kFileSize));
+
+  ObjectImpl object((std::string(object_id_)), std::string(object_file_path_));
+  std::string part;
+  EXPECT_EQ(Status::OK, object.ReadData(10, 20, &part));
+  EXPECT_EQ(data.substr(10, 20), part);
+  EXPECT_EQ(Status::OK, object.ReadData(-10, -1, &part));
+  EXPECT_EQ(data.substr(kFileSize - 10), part);
+  EXPECT_EQ(Status::OK, object.ReadData(-10, 5, &part));
+  EXPECT_EQ(data.substr(kFileSize - 10, 5), part);
+  EXPECT_EQ(Status::OK, object.ReadData(kFileSize - 5, 20, &part));
+  EXPECT_EQ(data.substr(kFileSize - 5), part);
+  EXPECT_EQ(Status::OK, object.ReadData(kFileSize, -1, &part));
+  EXPECT_EQ("", part);
+  EXPECT_EQ(Status::OK, object.ReadData(0, -1, &part));
+  EXPECT_EQ(data, part);
+
+  // Reading the whole data first doesn't change the result.
+  ftl::StringView found_data;
+  EXPECT_EQ(Status::OK, object.GetData(&found_data));
+  EXPECT_EQ(Status::OK, object.ReadData(10, 20, &part));
+  EXPECT_EQ(data.substr(10, 20), part);
+}
+
+TEST_F(ObjectTest, ChunkedObject) {
+  std::string index = RandomString(64);
+  EXPECT_TRUE(files::WriteFile(object_file_path_, index.data(), index.size()));
+  std::vector<std::string> chunks_data;
+  std::vector<ObjectImpl::Chunk> chunks;
+  for (size_t i = 0; i < 3; ++i) {
+    chunks_data.push_back(RandomString(kFileSize));
+    std::string path = object_file_path_ + std::to_string(i);
+    EXPECT_TRUE(files::WriteFile(path, chunks_data[i].data(), kFileSize));
+    chunks.push_back(ObjectImpl::Chunk{path, kFileSize});
+  }
+  std::string data = chunks_data[0] + chunks_data[1] + chunks_data[2];
+
+  ObjectImpl object((std::string(object_id_)), std::string(object_file_path_),
+                    chunks);
+  std::string part;
+  EXPECT_EQ(Status::OK, object.ReadData(kFileSize - 10, 20, &part));
+  EXPECT_EQ(data.substr(kFileSize - 10, 20), part);
+  EXPECT_EQ(Status::OK, object.ReadData(kFileSize + 10, 2 * kFileSize, &part));
+  EXPECT_EQ(data.substr(kFileSize + 10, 2 * kFileSize), part);
+  EXPECT_EQ(Status::OK, object.ReadData(-10, -1, &part));
+  EXPECT_EQ(data.substr(data.size() - 10), part);
+
+  // Only the chunks overlapping the requested part are read.
+  ObjectImpl partial_object(
+      (std::string(object_id_)), std::string(object_file_path_),
+      {chunks[0], ObjectImpl::Chunk{object_file_path_ + "missing", kFileSize},
+       chunks[2]});
+  EXPECT_EQ(Status::OK, partial_object.ReadData(10, 20, &part));
+  EXPECT_EQ(data.substr(10, 20), part);
+  EXPECT_EQ(Status::INTERNAL_IO_ERROR,
+            partial_object.ReadData(kFileSize - 10, 20, &part));
+
+  ftl::StringView found_data;
+  EXPECT_EQ(Status::OK, object.GetData(&found_data));
+  EXPECT_EQ(data, found_data.ToString());
+  EXPECT_EQ(Status::OK, object.GetStorageBytes(&found_data));
+  EXPECT_EQ(index, found_data.ToString());
+}
+
 }  // namespace
 }  // namespace storage
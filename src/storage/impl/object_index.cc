@@ -0,0 +1,96 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/storage/impl/object_index.h"
+
+#include "apps/ledger/src/convert/convert.h"
+#include "apps/ledger/src/storage/impl/object_impl.h"
+#include "apps/ledger/src/storage/impl/object_index_generated.h"
+#include "lib/ftl/files/file.h"
+
+namespace storage {
+namespace {
+
+// Starts with a null byte so that no text data is mistaken for an index.
+constexpr char kObjectIndexPrefixArray[] = {'\0', 'l', 'e', 'd',
+                                            'g', 'i', 'd', 'x'};
+static_assert(sizeof(kObjectIndexPrefixArray) == kObjectIndexPrefixSize,
+              "Unexpected prefix size");
+constexpr ftl::StringView kObjectIndexPrefix(kObjectIndexPrefixArray,
+                                             kObjectIndexPrefixSize);
+
+}  // namespace
+
+bool HasObjectIndexPrefix(ftl::StringView data) {
+  return data.substr(0, kObjectIndexPrefix.size()) == kObjectIndexPrefix;
+}
+
+std::string EncodeObjectIndex(const std::vector<ObjectChunk>& chunks) {
+  flatbuffers::FlatBufferBuilder builder;
+
+  auto chunks_offsets = builder.CreateVectorOfStructs(
+      chunks.size(), static_cast<std::function<void(size_t, ChunkStorage*)>>(
+                         [&chunks](size_t i, ChunkStorage* chunk_storage) {
+                           chunk_storage->mutable_object_id() =
+                               *convert::ToIdStorage(chunks[i].id);
+                           chunk_storage->mutate_size(chunks[i].size);
+                         }));
+  builder.Finish(CreateObjectIndexStorage(builder, chunks_offsets));
+
+  std::string result = kObjectIndexPrefix.ToString();
+  result.append(reinterpret_cast<const char*>(builder.GetBufferPointer()),
+                builder.GetSize());
+  return result;
+}
+
+bool DecodeObjectIndex(ftl::StringView data, std::vector<ObjectChunk>* chunks) {
+  if (!HasObjectIndexPrefix(data)) {
+    return false;
+  }
+  data = data.substr(kObjectIndexPrefix.size());
+  flatbuffers::Verifier verifier(
+      reinterpret_cast<const unsigned char*>(data.data()), data.size());
+  if (!VerifyObjectIndexStorageBuffer(verifier)) {
+    return false;
+  }
+
+  const ObjectIndexStorage* index = GetObjectIndexStorage(
+      reinterpret_cast<const unsigned char*>(data.data()));
+  if (!index->chunks() || index->chunks()->size() == 0) {
+    return false;
+  }
+  chunks->clear();
+  chunks->reserve(index->chunks()->size());
+  for (const auto* chunk_storage : *(index->chunks())) {
+    chunks->push_back(ObjectChunk{
+        convert::ToString(&chunk_storage->object_id()), chunk_storage->size()});
+  }
+  return true;
+}
+
+Status ReadObjectIndex(const std::string& file_path,
+                       std::vector<ObjectChunk>* chunks) {
+  chunks->clear();
+  if (!files::IsFile(file_path)) {
+    return Status::NOT_FOUND;
+  }
+  ObjectImpl object("", file_path);
+  std::string prefix;
+  Status status = object.ReadData(0, kObjectIndexPrefix.size(), &prefix);
+  if (status != Status::OK || !HasObjectIndexPrefix(prefix)) {
+    return status;
+  }
+  std::string data;
+  if (!files::ReadFileToString(file_path, &data)) {
+    return Status::INTERNAL_IO_ERROR;
+  }
+  if (!DecodeObjectIndex(data, chunks)) {
+    // Objects with the prefix of indexes that are not indexes are chunks of
+    // larger objects: they are read as they are.
+    chunks->clear();
+  }
+  return Status::OK;
+}
+
+}  // namespace storage
@@ -0,0 +1,49 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_STORAGE_IMPL_OBJECT_INDEX_H_
+#define APPS_LEDGER_SRC_STORAGE_IMPL_OBJECT_INDEX_H_
+
+#include <string>
+#include <vector>
+
+#include "apps/ledger/src/storage/public/types.h"
+#include "lib/ftl/strings/string_view.h"
+
+namespace storage {
+
+// An object is stored either as its data or, if its data is larger than a
+// chunk, as an index listing the chunks of its data, themselves stored as
+// objects. The id of a chunked object is the id of its index.
+//
+// Indexes start with a prefix that no other stored object starts with: data
+// starting with this prefix is always stored as an index, even if it fits in
+// a single chunk.
+
+// The size of the prefix of indexes.
+constexpr size_t kObjectIndexPrefixSize = 8;
+
+// A chunk of the data of an object.
+struct ObjectChunk {
+  ObjectId id;
+  uint64_t size;
+};
+
+// Returns whether |data| starts with the prefix of indexes.
+bool HasObjectIndexPrefix(ftl::StringView data);
+
+std::string EncodeObjectIndex(const std::vector<ObjectChunk>& chunks);
+
+// Returns false if |data| is not a valid index.
+bool DecodeObjectIndex(ftl::StringView data, std::vector<ObjectChunk>* chunks);
+
+// Reads the object stored in the file at |file_path| and, if it is an index,
+// fills |chunks| with the chunks it lists. |chunks| is left empty otherwise.
+// Returns |NOT_FOUND| if the file does not exist.
+Status ReadObjectIndex(const std::string& file_path,
+                       std::vector<ObjectChunk>* chunks);
+
+}  // namespace storage
+
+#endif  // APPS_LEDGER_SRC_STORAGE_IMPL_OBJECT_INDEX_H_
@@ -0,0 +1,58 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/storage/impl/object_index.h"
+
+#include "apps/ledger/src/storage/public/constants.h"
+#include "apps/ledger/src/storage/test/storage_test_utils.h"
+#include "gtest/gtest.h"
+#include "lib/ftl/files/file.h"
+#include "lib/ftl/files/scoped_temp_dir.h"
+
+namespace storage {
+namespace {
+
+TEST(ObjectIndexTest, EncodeDecode) {
+  std::vector<ObjectChunk> chunks = {
+      ObjectChunk{RandomId(kObjectIdSize), 1000u},
+      ObjectChunk{RandomId(kObjectIdSize), 42u}};
+  std::string index = EncodeObjectIndex(chunks);
+  EXPECT_TRUE(HasObjectIndexPrefix(index));
+
+  std::vector<ObjectChunk> decoded_chunks;
+  ASSERT_TRUE(DecodeObjectIndex(index, &decoded_chunks));
+  ASSERT_EQ(chunks.size(), decoded_chunks.size());
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    EXPECT_EQ(chunks[i].id, decoded_chunks[i].id);
+    EXPECT_EQ(chunks[i].size, decoded_chunks[i].size);
+  }
+
+  EXPECT_FALSE(DecodeObjectIndex("some data", &decoded_chunks));
+  EXPECT_FALSE(DecodeObjectIndex(index.substr(0, kObjectIndexPrefixSize + 4),
+                                 &decoded_chunks));
+}
+
+TEST(ObjectIndexTest, ReadObjectIndex) {
+  files::ScopedTempDir temp_dir;
+  std::string index_path = temp_dir.path() + "/index";
+  std::string data_path = temp_dir.path() + "/data";
+  std::vector<ObjectChunk> chunks = {
+      ObjectChunk{RandomId(kObjectIdSize), 1000u}};
+  std::string index = EncodeObjectIndex(chunks);
+  ASSERT_TRUE(files::WriteFile(index_path, index.data(), index.size()));
+  ASSERT_TRUE(files::WriteFile(data_path, "data", 4));
+
+  std::vector<ObjectChunk> read_chunks;
+  EXPECT_EQ(Status::OK, ReadObjectIndex(index_path, &read_chunks));
+  ASSERT_EQ(1u, read_chunks.size());
+  EXPECT_EQ(chunks[0].id, read_chunks[0].id);
+
+  EXPECT_EQ(Status::OK, ReadObjectIndex(data_path, &read_chunks));
+  EXPECT_TRUE(read_chunks.empty());
+  EXPECT_EQ(Status::NOT_FOUND,
+            ReadObjectIndex(temp_dir.path() + "/missing", &read_chunks));
+}
+
+}  // namespace
+}  // namespace storage
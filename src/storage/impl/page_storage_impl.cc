@@ -21,8 +21,11 @@
 #include "apps/ledger/src/glue/crypto/hash.h"
 #include "apps/ledger/src/storage/impl/btree/diff.h"
 #include "apps/ledger/src/storage/impl/btree/iterator.h"
+#include "apps/ledger/src/storage/impl/btree/stats.h"
+#include "apps/ledger/src/storage/impl/chunker.h"
 #include "apps/ledger/src/storage/impl/commit_impl.h"
 #include "apps/ledger/src/storage/impl/object_impl.h"
+#include "apps/ledger/src/storage/impl/object_index.h"
 #include "apps/ledger/src/storage/public/constants.h"
 #include "apps/tracing/lib/trace/event.h"
 #include "lib/ftl/arraysize.h"
@@ -63,6 +66,37 @@ struct StringPointerComparator {
   }
 };
 
+// Cursor of an interrupted iteration over the entries of a tree with a key
+// lower than |max_key|.
+class ContentsCursorImpl : public PageStorage::ContentsCursor {
+ public:
+  ContentsCursorImpl(std::unique_ptr<btree::BTreeIterator> iterator,
+                     std::string max_key)
+      : iterator(std::move(iterator)), max_key(std::move(max_key)) {}
+  ~ContentsCursorImpl() override {}
+
+  std::unique_ptr<btree::BTreeIterator> iterator;
+  const std::string max_key;
+};
+
+// Returns the callback to pass to the btree iteration of the contents of a
+// commit to call |on_done| with a cursor on the interrupted iteration, if any.
+std::function<void(Status, std::unique_ptr<btree::BTreeIterator>)>
+MakeCursorCallback(
+    std::string max_key,
+    std::function<void(Status, std::unique_ptr<PageStorage::ContentsCursor>)>
+        on_done) {
+  return [ max_key = std::move(max_key), on_done = std::move(on_done) ](
+      Status status, std::unique_ptr<btree::BTreeIterator> iterator) {
+    if (status != Status::OK || !iterator) {
+      on_done(status, nullptr);
+      return;
+    }
+    on_done(Status::OK,
+            std::make_unique<ContentsCursorImpl>(std::move(iterator), max_key));
+  };
+}
+
 std::string ToHex(convert::ExtendedStringView string) {
   std::string result;
   result.reserve(string.size() * 2);
@@ -122,12 +156,21 @@ Status StagingToDestination(size_t expected_size,
   return Status::OK;
 }
 
+// Called with the id of the written object. Its chunks, if any, are marked as
+// unsynced when a journal referencing the object is committed.
+using FileWriterCallback = std::function<void(Status, ObjectId)>;
+
+// Writes an object to disk. If |split_in_chunks| is true, large objects are
+// split in chunks, stored as separate objects, and an index of the chunks is
+// stored as the object. Otherwise, the object is stored as it is.
 class FileWriterOnIOThread : public mtl::SocketDrainer::Client {
  public:
   FileWriterOnIOThread(const std::string& staging_dir,
-                       const std::string& object_dir)
+                       const std::string& object_dir,
+                       bool split_in_chunks)
       : staging_dir_(staging_dir),
         object_dir_(object_dir),
+        split_in_chunks_(split_in_chunks),
         drainer_(this),
         expected_size_(0),
         size_(0u) {}
@@ -142,16 +185,10 @@ class FileWriterOnIOThread : public mtl::SocketDrainer::Client {
 
   void Start(mx::socket source,
              uint64_t expected_size,
-             std::function<void(Status, ObjectId)> callback) {
+             FileWriterCallback callback) {
     expected_size_ = expected_size;
     callback_ = std::move(callback);
-    // Using mkstemp to create an unique file. XXXXXX will be replaced.
-    file_path_ = staging_dir_ + "/XXXXXX";
-    fd_.reset(mkstemp(&file_path_[0]));
-    if (!fd_.is_valid()) {
-      FTL_LOG(ERROR) << "Unable to create file in staging directory ("
-                     << staging_dir_ << ")";
-      callback_(Status::INTERNAL_IO_ERROR, "");
+    if (!StartChunk()) {
       return;
     }
     drainer_.Start(std::move(source));
@@ -160,54 +197,142 @@ class FileWriterOnIOThread : public mtl::SocketDrainer::Client {
  private:
   // mtl::SocketDrainer::Client
   void OnDataAvailable(const void* data, size_t num_bytes) override {
-    size_ += num_bytes;
-    hash_.Update(data, num_bytes);
-    if (!ftl::WriteFileDescriptor(fd_.get(), static_cast<const char*>(data),
-                                  num_bytes)) {
-      FTL_LOG(ERROR) << "Error writing data to disk: " << strerror(errno);
-      callback_(Status::INTERNAL_IO_ERROR, "");
+    if (failed_) {
       return;
     }
+    size_ += num_bytes;
+    ftl::StringView view(static_cast<const char*>(data), num_bytes);
+    if (first_bytes_.size() < kObjectIndexPrefixSize) {
+      first_bytes_.append(
+          view.substr(0, kObjectIndexPrefixSize - first_bytes_.size())
+              .ToString());
+    }
+    while (!view.empty()) {
+      size_t length = view.size();
+      bool boundary = split_in_chunks_ && chunker_.FindBoundary(view, &length);
+      if (!fd_.is_valid() && !StartChunk()) {
+        return;
+      }
+      if (!ftl::WriteFileDescriptor(fd_.get(), view.data(), length)) {
+        FTL_LOG(ERROR) << "Error writing data to disk: " << strerror(errno);
+        Fail(Status::INTERNAL_IO_ERROR);
+        return;
+      }
+      hash_->Update(view.data(), length);
+      chunk_size_ += length;
+      view = view.substr(length);
+      if (boundary && !FinishChunk()) {
+        return;
+      }
+    }
   }
 
   // mtl::SocketDrainer::Client
   void OnDataComplete() override {
-    if (fsync(fd_.get()) != 0) {
-      FTL_LOG(ERROR) << "Unable to save to disk.";
-      callback_(Status::INTERNAL_IO_ERROR, "");
+    if (failed_) {
+      return;
+    }
+    if (fd_.is_valid() && !FinishChunk()) {
       return;
     }
-    fd_.reset();
     if (size_ != expected_size_) {
       FTL_LOG(ERROR) << "Received incorrect number of bytes. Expected: "
                      << expected_size_ << ", but received: " << size_;
-      callback_(Status::IO_ERROR, "");
+      Fail(Status::IO_ERROR);
+      return;
+    }
+
+    FTL_DCHECK(!chunks_.empty());
+    if (chunks_.size() == 1 &&
+        (!split_in_chunks_ || !HasObjectIndexPrefix(first_bytes_))) {
+      callback_(Status::OK, std::move(chunks_.front().id));
       return;
     }
 
-    std::string object_id;
-    hash_.Finish(&object_id);
+    // Store the index of the chunks as the object.
+    std::string index = EncodeObjectIndex(chunks_);
+    std::string object_id = glue::SHA256Hash(index.data(), index.size());
+    if (!StartChunk() ||
+        !ftl::WriteFileDescriptor(fd_.get(), index.data(), index.size())) {
+      Fail(Status::INTERNAL_IO_ERROR);
+      return;
+    }
+    chunk_size_ = index.size();
+    if (!StoreChunk(object_id)) {
+      return;
+    }
+    callback_(Status::OK, std::move(object_id));
+  }
+
+  // Creates the staging file of a new chunk.
+  bool StartChunk() {
+    // Using mkstemp to create an unique file. XXXXXX will be replaced.
+    file_path_ = staging_dir_ + "/XXXXXX";
+    fd_.reset(mkstemp(&file_path_[0]));
+    if (!fd_.is_valid()) {
+      FTL_LOG(ERROR) << "Unable to create file in staging directory ("
+                     << staging_dir_ << ")";
+      file_path_.clear();
+      Fail(Status::INTERNAL_IO_ERROR);
+      return false;
+    }
+    hash_ = std::make_unique<glue::SHA256StreamingHash>();
+    chunk_size_ = 0u;
+    return true;
+  }
+
+  // Moves the current chunk to its final location and adds it to the chunks of
+  // the object.
+  bool FinishChunk() {
+    std::string chunk_id;
+    hash_->Finish(&chunk_id);
+    if (!StoreChunk(chunk_id)) {
+      return false;
+    }
+    chunks_.push_back(ObjectChunk{std::move(chunk_id), chunk_size_});
+    return true;
+  }
+
+  // Moves the staging file to the final location of the object |object_id|.
+  bool StoreChunk(const ObjectId& object_id) {
+    if (fsync(fd_.get()) != 0) {
+      FTL_LOG(ERROR) << "Unable to save to disk.";
+      Fail(Status::INTERNAL_IO_ERROR);
+      return false;
+    }
+    fd_.reset();
 
     std::string final_path = storage::GetFilePath(object_dir_, object_id);
     Status status =
-        StagingToDestination(size_, file_path_, std::move(final_path));
+        StagingToDestination(chunk_size_, file_path_, std::move(final_path));
+    file_path_.clear();
     if (status != Status::OK) {
-      callback_(Status::INTERNAL_IO_ERROR, "");
-      return;
+      Fail(Status::INTERNAL_IO_ERROR);
+      return false;
     }
+    return true;
+  }
 
-    callback_(Status::OK, std::move(object_id));
+  void Fail(Status status) {
+    failed_ = true;
+    callback_(status, "");
   }
 
   const std::string& staging_dir_;
   const std::string& object_dir_;
-  std::function<void(Status, ObjectId)> callback_;
+  const bool split_in_chunks_;
+  FileWriterCallback callback_;
   mtl::SocketDrainer drainer_;
   std::string file_path_;
   ftl::UniqueFD fd_;
-  glue::SHA256StreamingHash hash_;
+  std::unique_ptr<glue::SHA256StreamingHash> hash_;
+  Chunker chunker_;
+  std::string first_bytes_;
+  std::vector<ObjectChunk> chunks_;
+  uint64_t chunk_size_ = 0u;
   uint64_t expected_size_;
   uint64_t size_;
+  bool failed_ = false;
 };
 
 class FileWriter {
@@ -215,11 +340,12 @@ class FileWriter {
   FileWriter(ftl::RefPtr<ftl::TaskRunner> main_runner,
              ftl::RefPtr<ftl::TaskRunner> io_runner,
              const std::string& staging_dir,
-             const std::string& object_dir)
+             const std::string& object_dir,
+             bool split_in_chunks)
       : main_runner_(std::move(main_runner)),
         io_runner_(std::move(io_runner)),
-        file_writer_on_io_thread_(
-            std::make_unique<FileWriterOnIOThread>(staging_dir, object_dir)),
+        file_writer_on_io_thread_(std::make_unique<FileWriterOnIOThread>(
+            staging_dir, object_dir, split_in_chunks)),
         weak_ptr_factory_(this) {
     FTL_DCHECK(main_runner_->RunsTasksOnCurrentThread());
   }
@@ -238,7 +364,7 @@ class FileWriter {
 
   void Start(mx::socket source,
              uint64_t expected_size,
-             std::function<void(Status, ObjectId)> callback) {
+             FileWriterCallback callback) {
     FTL_DCHECK(main_runner_->RunsTasksOnCurrentThread());
 
     if (io_runner_->RunsTasksOnCurrentThread()) {
@@ -278,7 +404,7 @@ class FileWriter {
   ftl::RefPtr<ftl::TaskRunner> main_runner_;
   ftl::RefPtr<ftl::TaskRunner> io_runner_;
 
-  std::function<void(Status, ObjectId)> callback_;
+  FileWriterCallback callback_;
 
   std::unique_ptr<FileWriterOnIOThread> file_writer_on_io_thread_;
 
@@ -558,6 +684,26 @@ void PageStorageImpl::GetUnsyncedObjectIds(
       std::set_intersection(commit_objects.begin(), commit_objects.end(),
                             unsynced_objects.begin(), unsynced_objects.end(),
                             std::back_inserter(object_ids));
+
+      // The unsynced chunks of chunked objects are uploaded with them.
+      std::set<ObjectId> chunk_ids;
+      for (const auto& object_id : object_ids) {
+        std::vector<ObjectChunk> chunks;
+        s = ReadObjectIndex(GetFilePath(object_id), &chunks);
+        if (s != Status::OK) {
+          callback(s, {});
+          return;
+        }
+        for (const auto& chunk : chunks) {
+          if (std::binary_search(unsynced_objects.begin(),
+                                 unsynced_objects.end(), chunk.id) &&
+              !std::binary_search(object_ids.begin(), object_ids.end(),
+                                  chunk.id)) {
+            chunk_ids.insert(chunk.id);
+          }
+        }
+      }
+      object_ids.insert(object_ids.end(), chunk_ids.begin(), chunk_ids.end());
       callback(Status::OK, std::move(object_ids));
     });
   });
@@ -572,7 +718,7 @@ void PageStorageImpl::AddObjectFromSync(
     mx::socket data,
     size_t size,
     const std::function<void(Status)>& callback) {
-  AddObject(std::move(data), size, [
+  AddObject(std::move(data), size, false, [
     this, object_id = object_id.ToString(), callback
   ](Status status, ObjectId found_id) {
     if (status != Status::OK) {
@@ -583,7 +729,9 @@ void PageStorageImpl::AddObjectFromSync(
       files::DeletePath(GetFilePath(found_id), false);
       callback(Status::OBJECT_ID_MISMATCH);
     } else {
-      callback(Status::OK);
+      // Objects received from the cloud are stored there: the chunks of local
+      // objects that are shared with them do not need to be uploaded.
+      callback(db_.MarkObjectIdSynced(object_id));
     }
   });
 }
@@ -592,12 +740,12 @@ void PageStorageImpl::AddObjectFromLocal(
     mx::socket data,
     uint64_t size,
     const std::function<void(Status, ObjectId)>& callback) {
-  AddObject(std::move(data), size,
-            [ this, callback = std::move(callback) ](Status status,
-                                                     ObjectId object_id) {
-              untracked_objects_.insert(object_id);
-              callback(status, std::move(object_id));
-            });
+  AddObject(std::move(data), size, true, [
+    this, callback = std::move(callback)
+  ](Status status, ObjectId object_id) {
+    untracked_objects_.insert(object_id);
+    callback(status, std::move(object_id));
+  });
 }
 
 void PageStorageImpl::GetObject(
@@ -605,17 +753,42 @@ void PageStorageImpl::GetObject(
     Location location,
     const std::function<void(Status, std::unique_ptr<const Object>)>&
         callback) {
-  std::string file_path = GetFilePath(object_id);
-  if (!files::IsFile(file_path)) {
-    if (location == Location::NETWORK) {
-      GetObjectFromSync(object_id, callback);
-    } else {
-      callback(Status::NOT_FOUND, nullptr);
+  GetObjectWithPart(object_id, 0, -1, location, callback);
+}
+
+void PageStorageImpl::GetObjectPart(
+    ObjectIdView object_id,
+    int64_t offset,
+    int64_t max_size,
+    Location location,
+    const std::function<void(Status, std::string)>& callback) {
+  GetObjectWithPart(object_id, offset, max_size, location, [
+    offset, max_size, callback = std::move(callback)
+  ](Status status, std::unique_ptr<const Object> object) {
+    if (status != Status::OK) {
+      callback(status, "");
+      return;
     }
-    return;
-  }
-  callback(Status::OK, std::make_unique<ObjectImpl>(object_id.ToString(),
-                                                    std::move(file_path)));
+    std::string data;
+    status = object->ReadData(offset, max_size, &data);
+    callback(status, std::move(data));
+  });
+}
+
+void PageStorageImpl::GetObjectSize(
+    ObjectIdView object_id,
+    const std::function<void(Status, uint64_t)>& callback) {
+  // An empty part does not need any chunk: only the index is read.
+  GetObjectWithPart(object_id, 0, 0, Location::LOCAL, [callback](
+      Status status, std::unique_ptr<const Object> object) {
+    if (status != Status::OK) {
+      callback(status, 0u);
+      return;
+    }
+    uint64_t size;
+    status = object->GetSize(&size);
+    callback(status, status == Status::OK ? size : 0u);
+  });
 }
 
 Status PageStorageImpl::SetSyncMetadata(ftl::StringView sync_state) {
@@ -638,6 +811,93 @@ void PageStorageImpl::GetCommitContents(const Commit& commit,
       std::move(on_done));
 }
 
+void PageStorageImpl::GetCommitContentsFromOffset(
+    const Commit& commit,
+    std::string min_key,
+    uint64_t offset,
+    std::function<bool(Entry)> on_next,
+    std::function<void(Status)> on_done) {
+  btree::ForEachEntryFromOffset(
+      coroutine_service_, this, commit.GetRootId(), std::move(min_key), offset,
+      [on_next = std::move(on_next)](btree::EntryAndNodeId next) {
+        return on_next(next.entry);
+      },
+      std::move(on_done));
+}
+
+void PageStorageImpl::GetCommitContentsInRange(
+    const Commit& commit,
+    std::string min_key,
+    std::string max_key,
+    uint64_t max_count,
+    bool reverse,
+    std::function<bool(Entry)> on_next,
+    std::function<void(Status)> on_done) {
+  btree::ForEachEntryInRange(
+      coroutine_service_, this, commit.GetRootId(), std::move(min_key),
+      std::move(max_key), reverse,
+      [ on_next = std::move(on_next), max_count,
+        count = static_cast<uint64_t>(0) ](btree::EntryAndNodeId next) mutable {
+        if (max_count && count == max_count) {
+          return false;
+        }
+        ++count;
+        return on_next(next.entry);
+      },
+      std::move(on_done));
+}
+
+void PageStorageImpl::GetCommitContentsWithCursor(
+    const Commit& commit,
+    std::string min_key,
+    std::string max_key,
+    std::function<bool(Entry)> on_next,
+    std::function<void(Status, std::unique_ptr<ContentsCursor>)> on_done) {
+  std::string cursor_max_key = max_key;
+  btree::ForEachEntryWithIterator(
+      coroutine_service_, this, commit.GetRootId(), std::move(min_key),
+      std::move(max_key),
+      [on_next = std::move(on_next)](btree::EntryAndNodeId next) {
+        return on_next(next.entry);
+      },
+      MakeCursorCallback(std::move(cursor_max_key), std::move(on_done)));
+}
+
+void PageStorageImpl::ResumeCommitContents(
+    std::unique_ptr<ContentsCursor> cursor,
+    std::function<bool(Entry)> on_next,
+    std::function<void(Status, std::unique_ptr<ContentsCursor>)> on_done) {
+  // All cursors given by this class are |ContentsCursorImpl|s.
+  auto cursor_impl = static_cast<ContentsCursorImpl*>(cursor.get());
+  btree::ResumeForEachEntry(
+      coroutine_service_, this, std::move(cursor_impl->iterator),
+      cursor_impl->max_key,
+      [on_next = std::move(on_next)](btree::EntryAndNodeId next) {
+        return on_next(next.entry);
+      },
+      MakeCursorCallback(cursor_impl->max_key, std::move(on_done)));
+}
+
+void PageStorageImpl::CountCommitContents(
+    const Commit& commit,
+    std::string min_key,
+    std::string max_key,
+    std::function<void(Status, uint64_t)> callback) {
+  btree::CountEntries(coroutine_service_, this, commit.GetRootId(),
+                      std::move(min_key), std::move(max_key),
+                      std::move(callback));
+}
+
+void PageStorageImpl::GetCommitContentsSize(
+    const Commit& commit,
+    std::string min_key,
+    std::string max_key,
+    std::function<void(Status, ContentsSize)> callback) {
+  btree::GetRangeSize(coroutine_service_, this, commit.GetRootId(),
+                      std::move(min_key), std::move(max_key),
+                      std::move(callback));
+}
+
 void PageStorageImpl::GetEntryFromCommit(
     const Commit& commit,
     std::string key,
@@ -679,6 +939,19 @@ void PageStorageImpl::GetCommitContentsDiff(
                      std::move(on_next_diff), std::move(on_done));
 }
 
+void PageStorageImpl::GetThreeWayContentsDiff(
+    const Commit& base_commit,
+    const Commit& left_commit,
+    const Commit& right_commit,
+    std::string min_key,
+    std::function<bool(ThreeWayChange)> on_next_diff,
+    std::function<void(Status)> on_done) {
+  btree::ForEachThreeWayDiff(
+      coroutine_service_, this, base_commit.GetRootId(),
+      left_commit.GetRootId(), right_commit.GetRootId(), std::move(min_key),
+      std::move(on_next_diff), std::move(on_done));
+}
+
 void PageStorageImpl::NotifyWatchers() {
   while (!commits_to_send_.empty()) {
     auto to_send = std::move(commits_to_send_.front());
@@ -769,12 +1042,13 @@ bool PageStorageImpl::IsFirstCommit(CommitIdView id) {
 void PageStorageImpl::AddObject(
     mx::socket data,
     uint64_t size,
+    bool split_in_chunks,
     const std::function<void(Status, ObjectId)>& callback) {
   auto traced_callback =
       TRACE_CALLBACK(std::move(callback), "ledger", "page_storage_add_object");
-  auto file_writer =
-      pending_operation_manager_.Manage(std::make_unique<FileWriter>(
-          main_runner_, io_runner_, staging_dir_, objects_dir_));
+  auto file_writer = pending_operation_manager_.Manage(
+      std::make_unique<FileWriter>(main_runner_, io_runner_, staging_dir_,
+                                   objects_dir_, split_in_chunks));
 
   (*file_writer.first)->Start(std::move(data), size, [
     cleanup = std::move(file_writer.second), callback = std::move(traced_callback)
@@ -784,33 +1058,113 @@ void PageStorageImpl::AddObject(
   });
 }
 
-void PageStorageImpl::GetObjectFromSync(
+void PageStorageImpl::GetObjectWithPart(
     ObjectIdView object_id,
-    const std::function<void(Status, std::unique_ptr<const Object>)>&
-        callback) {
+    int64_t offset,
+    int64_t max_size,
+    Location location,
+    std::function<void(Status, std::unique_ptr<const Object>)> callback) {
+  std::vector<ObjectChunk> chunks;
+  Status status = ReadObjectIndex(GetFilePath(object_id), &chunks);
+  if (status == Status::NOT_FOUND && location == Location::NETWORK) {
+    DownloadObject(object_id, [
+      this, object_id = object_id.ToString(), offset, max_size,
+      callback = std::move(callback)
+    ](Status status) {
+      if (status != Status::OK) {
+        callback(status, nullptr);
+        return;
+      }
+      GetObjectWithPart(object_id, offset, max_size, Location::NETWORK,
+                        std::move(callback));
+    });
+    return;
+  }
+  if (status != Status::OK) {
+    callback(status, nullptr);
+    return;
+  }
+
+  std::vector<ObjectChunk> missing_chunks =
+      GetMissingChunks(chunks, offset, max_size);
+  if (missing_chunks.empty()) {
+    callback(Status::OK, MakeObject(object_id, chunks));
+    return;
+  }
+  if (location != Location::NETWORK) {
+    callback(Status::NOT_FOUND, nullptr);
+    return;
+  }
+  auto waiter = callback::StatusWaiter<Status>::Create(Status::OK);
+  for (const auto& chunk : missing_chunks) {
+    DownloadObject(chunk.id, waiter->NewCallback());
+  }
+  waiter->Finalize([
+    this, object_id = object_id.ToString(), chunks = std::move(chunks),
+    callback = std::move(callback)
+  ](Status status) {
+    if (status != Status::OK) {
+      callback(status, nullptr);
+      return;
+    }
+    callback(Status::OK, MakeObject(object_id, chunks));
+  });
+}
+
+std::vector<ObjectChunk> PageStorageImpl::GetMissingChunks(
+    const std::vector<ObjectChunk>& chunks,
+    int64_t offset,
+    int64_t max_size) {
+  uint64_t size = 0u;
+  for (const auto& chunk : chunks) {
+    size += chunk.size;
+  }
+  uint64_t start;
+  uint64_t length;
+  GetDataPart(size, offset, max_size, &start, &length);
+
+  std::vector<ObjectChunk> missing_chunks;
+  std::set<ObjectIdView> missing_ids;
+  uint64_t chunk_start = 0u;
+  for (const auto& chunk : chunks) {
+    uint64_t chunk_end = chunk_start + chunk.size;
+    if (chunk_start < start + length && chunk_end > start &&
+        missing_ids.find(chunk.id) == missing_ids.end() &&
+        !files::IsFile(GetFilePath(chunk.id))) {
+      missing_ids.insert(chunk.id);
+      missing_chunks.push_back(chunk);
+    }
+    chunk_start = chunk_end;
+  }
+  return missing_chunks;
+}
+
+std::unique_ptr<const Object> PageStorageImpl::MakeObject(
+    ObjectIdView object_id,
+    const std::vector<ObjectChunk>& chunks) {
+  std::vector<ObjectImpl::Chunk> chunk_files;
+  chunk_files.reserve(chunks.size());
+  for (const auto& chunk : chunks) {
+    chunk_files.push_back(ObjectImpl::Chunk{GetFilePath(chunk.id), chunk.size});
+  }
+  return std::make_unique<ObjectImpl>(
+      object_id.ToString(), GetFilePath(object_id), std::move(chunk_files));
+}
+
+void PageStorageImpl::DownloadObject(ObjectIdView object_id,
+                                     std::function<void(Status)> callback) {
   if (!page_sync_) {
-    callback(Status::NOT_CONNECTED_ERROR, nullptr);
+    callback(Status::NOT_CONNECTED_ERROR);
     return;
   }
   page_sync_->GetObject(object_id, [
     this, callback = std::move(callback), object_id = object_id.ToString()
   ](Status status, uint64_t size, mx::socket data) {
     if (status != Status::OK) {
-      callback(status, nullptr);
+      callback(status);
       return;
     }
-    AddObjectFromSync(object_id, std::move(data), size, [
-      this, callback = std::move(callback), object_id
-    ](Status status) mutable {
-      if (status != Status::OK) {
-        callback(status, nullptr);
-        return;
-      }
-      std::string file_path = GetFilePath(object_id);
-      FTL_DCHECK(files::IsFile(file_path));
-      callback(Status::OK, std::make_unique<ObjectImpl>(std::move(object_id),
-                                                        std::move(file_path)));
-    });
+    AddObjectFromSync(object_id, std::move(data), size, std::move(callback));
   });
 }
 
@@ -829,4 +1183,18 @@ void PageStorageImpl::MarkObjectTracked(ObjectIdView object_id) {
   }
 }
 
+Status PageStorageImpl::GetObjectChunkIds(ObjectIdView object_id,
+                                          std::vector<ObjectId>* chunk_ids) {
+  std::vector<ObjectChunk> chunks;
+  Status status = ReadObjectIndex(GetFilePath(object_id), &chunks);
+  if (status != Status::OK) {
+    return status;
+  }
+  chunk_ids->clear();
+  for (auto& chunk : chunks) {
+    chunk_ids->push_back(std::move(chunk.id));
+  }
+  return Status::OK;
+}
+
 }  // namespace storage
@@ -9,11 +9,13 @@
 
 #include <queue>
 #include <set>
+#include <vector>
 
 #include "apps/ledger/src/callback/pending_operation.h"
 #include "apps/ledger/src/convert/convert.h"
 #include "apps/ledger/src/coroutine/coroutine.h"
 #include "apps/ledger/src/storage/impl/db_impl.h"
+#include "apps/ledger/src/storage/impl/object_index.h"
 #include "apps/ledger/src/storage/public/page_sync_delegate.h"
 #include "lib/ftl/memory/ref_ptr.h"
 #include "lib/ftl/strings/string_view.h"
@@ -47,6 +49,11 @@ class PageStorageImpl : public PageStorage {
   // Marks the given object as tracked.
   void MarkObjectTracked(ObjectIdView object_id);
 
+  // Replaces the contents of |chunk_ids| with the ids of the chunks of the
+  // object |object_id| if it is split in chunks, and clears it otherwise.
+  Status GetObjectChunkIds(ObjectIdView object_id,
+                           std::vector<ObjectId>* chunk_ids);
+
   // PageStorage:
   PageId GetId() override;
   void SetSyncDelegate(PageSyncDelegate* page_sync) override;
@@ -87,6 +94,15 @@ class PageStorageImpl : public PageStorage {
       Location location,
       const std::function<void(Status, std::unique_ptr<const Object>)>&
           callback) override;
+  void GetObjectPart(
+      ObjectIdView object_id,
+      int64_t offset,
+      int64_t max_size,
+      Location location,
+      const std::function<void(Status, std::string)>& callback) override;
+  void GetObjectSize(
+      ObjectIdView object_id,
+      const std::function<void(Status, uint64_t)>& callback) override;
   Status SetSyncMetadata(ftl::StringView sync_state) override;
   Status GetSyncMetadata(std::string* sync_state) override;
 
@@ -95,6 +111,41 @@ class PageStorageImpl : public PageStorage {
                          std::string min_key,
                          std::function<bool(Entry)> on_next,
                          std::function<void(Status)> on_done) override;
+  void GetCommitContentsFromOffset(
+      const Commit& commit,
+      std::string min_key,
+      uint64_t offset,
+      std::function<bool(Entry)> on_next,
+      std::function<void(Status)> on_done) override;
+  void GetCommitContentsInRange(const Commit& commit,
+                                std::string min_key,
+                                std::string max_key,
+                                uint64_t max_count,
+                                bool reverse,
+                                std::function<bool(Entry)> on_next,
+                                std::function<void(Status)> on_done) override;
+  void GetCommitContentsWithCursor(
+      const Commit& commit,
+      std::string min_key,
+      std::string max_key,
+      std::function<bool(Entry)> on_next,
+      std::function<void(Status, std::unique_ptr<ContentsCursor>)> on_done)
+      override;
+  void ResumeCommitContents(
+      std::unique_ptr<ContentsCursor> cursor,
+      std::function<bool(Entry)> on_next,
+      std::function<void(Status, std::unique_ptr<ContentsCursor>)> on_done)
+      override;
+  void CountCommitContents(
+      const Commit& commit,
+      std::string min_key,
+      std::string max_key,
+      std::function<void(Status, uint64_t)> callback) override;
+  void GetCommitContentsSize(
+      const Commit& commit,
+      std::string min_key,
+      std::string max_key,
+      std::function<void(Status, ContentsSize)> callback) override;
   void GetEntryFromCommit(const Commit& commit,
                           std::string key,
                           std::function<void(Status, Entry)> callback) override;
@@ -103,6 +154,12 @@ class PageStorageImpl : public PageStorage {
                              std::string min_key,
                              std::function<bool(EntryChange)> on_next_diff,
                              std::function<void(Status)> on_done) override;
+  void GetThreeWayContentsDiff(const Commit& base_commit,
+                               const Commit& left_commit,
+                               const Commit& right_commit,
+                               std::string min_key,
+                               std::function<bool(ThreeWayChange)> on_next_diff,
+                               std::function<void(Status)> on_done) override;
 
  private:
   friend class PageStorageImplAccessorForTest;
@@ -112,13 +169,34 @@ class PageStorageImpl : public PageStorage {
                   std::function<void(Status)> callback);
   Status ContainsCommit(CommitIdView id);
   bool IsFirstCommit(CommitIdView id);
+  // Adds the object read from |data| and calls |callback| with its id. If
+  // |split_in_chunks| is true, large objects are split in chunks. The chunks
+  // are marked as unsynced when a journal referencing the object is committed.
   void AddObject(mx::socket data,
                  uint64_t size,
+                 bool split_in_chunks,
                  const std::function<void(Status, ObjectId)>& callback);
-  void GetObjectFromSync(
+  // Returns the object |object_id| once the part of its data designated by
+  // |offset| and |max_size| is stored locally. If |location| is NETWORK, the
+  // object and the chunks of this part are downloaded if needed.
+  void GetObjectWithPart(
       ObjectIdView object_id,
-      const std::function<void(Status, std::unique_ptr<const Object>)>&
-          callback);
+      int64_t offset,
+      int64_t max_size,
+      Location location,
+      std::function<void(Status, std::unique_ptr<const Object>)> callback);
+  // Returns the chunks of |chunks| overlapping the part designated by |offset|
+  // and |max_size| that are not stored locally.
+  std::vector<ObjectChunk> GetMissingChunks(
+      const std::vector<ObjectChunk>& chunks,
+      int64_t offset,
+      int64_t max_size);
+  std::unique_ptr<const Object> MakeObject(
+      ObjectIdView object_id,
+      const std::vector<ObjectChunk>& chunks);
+  // Downloads the object |object_id| and stores it as it is.
+  void DownloadObject(ObjectIdView object_id,
+                      std::function<void(Status)> callback);
   std::string GetFilePath(ObjectIdView object_id) const;
 
   // Notifies the registered watchers with the |commits| in commit_to_send_.
@@ -16,9 +16,11 @@
 #include "apps/ledger/src/glue/crypto/hash.h"
 #include "apps/ledger/src/glue/crypto/rand.h"
 #include "apps/ledger/src/storage/impl/btree/tree_node.h"
+#include "apps/ledger/src/storage/impl/chunker.h"
 #include "apps/ledger/src/storage/impl/commit_impl.h"
 #include "apps/ledger/src/storage/impl/db_empty_impl.h"
 #include "apps/ledger/src/storage/impl/journal_db_impl.h"
+#include "apps/ledger/src/storage/impl/object_index.h"
 #include "apps/ledger/src/storage/public/commit_watcher.h"
 #include "apps/ledger/src/storage/public/constants.h"
 #include "apps/ledger/src/storage/test/commit_random_impl.h"
@@ -163,6 +165,36 @@ class ObjectData {
   const std::string object_id;
 };
 
+// A value large enough to be split in chunks, with its chunks and index.
+class ChunkedObjectData {
+ public:
+  explicit ChunkedObjectData(const std::string& value) : value(value) {
+    Chunker chunker;
+    std::vector<ObjectChunk> index_chunks;
+    ftl::StringView remaining = value;
+    while (!remaining.empty()) {
+      size_t length;
+      chunker.FindBoundary(remaining, &length);
+      chunks.emplace_back(remaining.substr(0, length).ToString());
+      index_chunks.push_back(
+          ObjectChunk{chunks.back().object_id, chunks.back().size});
+      remaining = remaining.substr(length);
+    }
+    index = EncodeObjectIndex(index_chunks);
+    object_id = glue::SHA256Hash(index.data(), index.size());
+  }
+  const std::string value;
+  std::vector<ObjectData> chunks;
+  std::string index;
+  std::string object_id;
+};
+
+std::string RandomValue(size_t size) {
+  std::string value(size, '\0');
+  glue::RandBytes(&value[0], size);
+  return value;
+}
+
 class PageStorageTest : public StorageTest {
  public:
   PageStorageTest() {}
@@ -313,6 +345,22 @@ class PageStorageTest : public StorageTest {
     return object;
   }
 
+  std::string TryGetObjectPart(const ObjectId& object_id,
+                               int64_t offset,
+                               int64_t max_size,
+                               PageStorage::Location location,
+                               Status expected_status = Status::OK) {
+    Status status;
+    std::string data;
+    storage_->GetObjectPart(
+        object_id, offset, max_size, location,
+        callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                          &data));
+    EXPECT_FALSE(RunLoopWithTimeout());
+    EXPECT_EQ(expected_status, status);
+    return data;
+  }
+
   std::vector<Entry> GetCommitContents(const Commit& commit) {
     Status status;
     std::vector<Entry> result;
@@ -682,6 +730,149 @@ TEST_F(PageStorageTest, GetObjectFromSync) {
                Status::NOT_CONNECTED_ERROR);
 }
 
+TEST_F(PageStorageTest, GetObjectPart) {
+  ObjectData data("Some data");
+  TryAddFromLocal(data.value, data.object_id);
+
+  EXPECT_EQ("data", TryGetObjectPart(data.object_id, 5, -1,
+                                     PageStorage::Location::LOCAL));
+  EXPECT_EQ("me", TryGetObjectPart(data.object_id, 2, 2,
+                                   PageStorage::Location::LOCAL));
+  EXPECT_EQ("at", TryGetObjectPart(data.object_id, -3, 2,
+                                   PageStorage::Location::LOCAL));
+  EXPECT_EQ("", TryGetObjectPart(data.object_id, 20, -1,
+                                 PageStorage::Location::LOCAL));
+}
+
+TEST_F(PageStorageTest, GetObjectPartFromSync) {
+  ObjectData data("Some data");
+  FakeSyncDelegate sync;
+  sync.AddObject(data.object_id, data.value);
+  storage_->SetSyncDelegate(&sync);
+
+  EXPECT_EQ("me", TryGetObjectPart(data.object_id, 2, 2,
+                                   PageStorage::Location::NETWORK));
+  EXPECT_EQ(1u, sync.object_requests.size());
+  EXPECT_EQ("data", TryGetObjectPart(data.object_id, 5, -1,
+                                     PageStorage::Location::LOCAL));
+
+  storage_->SetSyncDelegate(nullptr);
+  TryGetObjectPart(RandomId(kObjectIdSize), 2, 2,
+                   PageStorage::Location::NETWORK,
+                   Status::NOT_CONNECTED_ERROR);
+}
+
+TEST_F(PageStorageTest, AddChunkedObjectFromLocal) {
+  ChunkedObjectData data(RandomValue(4 * kMaxChunkSize));
+  ASSERT_LT(1u, data.chunks.size());
+  TryAddFromLocal(data.value, data.object_id);
+
+  std::unique_ptr<const Object> object =
+      TryGetObject(data.object_id, PageStorage::Location::LOCAL);
+  ftl::StringView object_data;
+  ASSERT_EQ(Status::OK, object->GetData(&object_data));
+  EXPECT_EQ(data.value, convert::ToString(object_data));
+  ASSERT_EQ(Status::OK, object->GetStorageBytes(&object_data));
+  EXPECT_EQ(data.index, convert::ToString(object_data));
+  for (const auto& chunk : data.chunks) {
+    std::string file_content;
+    EXPECT_TRUE(files::ReadFileToString(GetFilePath(chunk.object_id),
+                                        &file_content));
+    EXPECT_EQ(chunk.value, file_content);
+  }
+
+  uint64_t offset = data.chunks[0].size - 10;
+  EXPECT_EQ(data.value.substr(offset, 20),
+            TryGetObjectPart(data.object_id, offset, 20,
+                             PageStorage::Location::LOCAL));
+
+  // Modifying the middle of the value only changes the chunks around the
+  // modification.
+  std::string modified_value = data.value;
+  modified_value[modified_value.size() / 2] ^= 1;
+  ChunkedObjectData modified_data(modified_value);
+  TryAddFromLocal(modified_data.value, modified_data.object_id);
+  size_t shared_chunks = 0u;
+  for (const auto& chunk : modified_data.chunks) {
+    for (const auto& original_chunk : data.chunks) {
+      if (chunk.object_id == original_chunk.object_id) {
+        ++shared_chunks;
+        break;
+      }
+    }
+  }
+  EXPECT_LE(data.chunks.size() - 2, shared_chunks);
+}
+
+TEST_F(PageStorageTest, GetChunkedObjectSize) {
+  ChunkedObjectData data(RandomValue(4 * kMaxChunkSize));
+  TryAddFromLocal(data.value, data.object_id);
+
+  // The size is read from the index, even if the chunks are not local.
+  EXPECT_TRUE(files::DeletePath(GetFilePath(data.chunks[0].object_id), false));
+  Status status;
+  uint64_t size;
+  storage_->GetObjectSize(
+      data.object_id,
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &size));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_EQ(data.value.size(), size);
+
+  storage_->GetObjectSize(
+      RandomId(kObjectIdSize),
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &size));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::NOT_FOUND, status);
+}
+
+TEST_F(PageStorageTest, AddObjectWithIndexPrefixFromLocal) {
+  // Data looking like an index is stored as an index, even if small.
+  ChunkedObjectData chunked_data(RandomValue(2 * kMaxChunkSize));
+  ChunkedObjectData data(chunked_data.index);
+  ASSERT_EQ(1u, data.chunks.size());
+  TryAddFromLocal(data.value, data.object_id);
+
+  std::unique_ptr<const Object> object =
+      TryGetObject(data.object_id, PageStorage::Location::LOCAL);
+  ftl::StringView object_data;
+  ASSERT_EQ(Status::OK, object->GetData(&object_data));
+  EXPECT_EQ(chunked_data.index, convert::ToString(object_data));
+}
+
+TEST_F(PageStorageTest, GetChunkedObjectFromSync) {
+  ChunkedObjectData data(RandomValue(4 * kMaxChunkSize));
+  ASSERT_LT(2u, data.chunks.size());
+  FakeSyncDelegate sync;
+  sync.AddObject(data.object_id, data.index);
+  for (const auto& chunk : data.chunks) {
+    sync.AddObject(chunk.object_id, chunk.value);
+  }
+  storage_->SetSyncDelegate(&sync);
+
+  // Only the chunks of the requested part are downloaded.
+  uint64_t offset = data.chunks[0].size + 10;
+  EXPECT_EQ(data.value.substr(offset, 20),
+            TryGetObjectPart(data.object_id, offset, 20,
+                             PageStorage::Location::NETWORK));
+  EXPECT_EQ(2u, sync.object_requests.size());
+  EXPECT_EQ(1u, sync.object_requests.count(data.object_id));
+  EXPECT_EQ(1u, sync.object_requests.count(data.chunks[1].object_id));
+  EXPECT_EQ(data.value.substr(offset, 20),
+            TryGetObjectPart(data.object_id, offset, 20,
+                             PageStorage::Location::LOCAL));
+  TryGetObject(data.object_id, PageStorage::Location::LOCAL,
+               Status::NOT_FOUND);
+
+  std::unique_ptr<const Object> object =
+      TryGetObject(data.object_id, PageStorage::Location::NETWORK);
+  ftl::StringView object_data;
+  ASSERT_EQ(Status::OK, object->GetData(&object_data));
+  EXPECT_EQ(data.value, convert::ToString(object_data));
+}
+
 TEST_F(PageStorageTest, UnsyncedObjects) {
   int size = 3;
   ObjectData data[] = {
@@ -749,6 +940,86 @@ TEST_F(PageStorageTest, UnsyncedObjects) {
               objects.end());
 }
 
+TEST_F(PageStorageTest, UnsyncedChunks) {
+  ChunkedObjectData data(RandomValue(4 * kMaxChunkSize));
+  TryAddFromLocal(data.value, data.object_id);
+  for (const auto& chunk : data.chunks) {
+    EXPECT_EQ(Status::OK, storage_->MarkObjectSynced(chunk.object_id));
+  }
+  std::string modified_value = data.value;
+  modified_value[modified_value.size() / 2] ^= 1;
+  ChunkedObjectData modified_data(modified_value);
+  TryAddFromLocal(modified_data.value, modified_data.object_id);
+
+  std::unique_ptr<Journal> journal;
+  EXPECT_EQ(Status::OK, storage_->StartCommit(GetFirstHead()->GetId(),
+                                              JournalType::IMPLICIT, &journal));
+  EXPECT_EQ(Status::OK, journal->Put("key", modified_data.object_id,
+                                     KeyPriority::LAZY));
+  TryCommitJournal(&journal, Status::OK);
+
+  // Only the chunks that were not synced are uploaded with the index.
+  std::set<ObjectId> expected_objects = {GetFirstHead()->GetRootId(),
+                                         modified_data.object_id};
+  for (const auto& chunk : modified_data.chunks) {
+    bool synced = false;
+    for (const auto& original_chunk : data.chunks) {
+      synced |= chunk.object_id == original_chunk.object_id;
+    }
+    if (!synced) {
+      expected_objects.insert(chunk.object_id);
+    }
+  }
+  EXPECT_GT(modified_data.chunks.size() + 2, expected_objects.size());
+
+  Status status;
+  std::vector<ObjectId> objects;
+  storage_->GetUnsyncedObjectIds(
+      GetFirstHead()->GetId(),
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &objects));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_EQ(expected_objects,
+            std::set<ObjectId>(objects.begin(), objects.end()));
+}
+
+TEST_F(PageStorageTest, UnsyncedChunksOfUncommittedObjects) {
+  ChunkedObjectData data(RandomValue(4 * kMaxChunkSize));
+  TryAddFromLocal(data.value, data.object_id);
+
+  // The chunks stored for an object that is not committed are uploaded with
+  // the objects committed later that share them.
+  std::string modified_value = data.value;
+  modified_value[modified_value.size() / 2] ^= 1;
+  ChunkedObjectData modified_data(modified_value);
+  TryAddFromLocal(modified_data.value, modified_data.object_id);
+
+  std::unique_ptr<Journal> journal;
+  EXPECT_EQ(Status::OK, storage_->StartCommit(GetFirstHead()->GetId(),
+                                              JournalType::IMPLICIT, &journal));
+  EXPECT_EQ(Status::OK, journal->Put("key", modified_data.object_id,
+                                     KeyPriority::LAZY));
+  TryCommitJournal(&journal, Status::OK);
+
+  std::set<ObjectId> expected_objects = {GetFirstHead()->GetRootId(),
+                                         modified_data.object_id};
+  for (const auto& chunk : modified_data.chunks) {
+    expected_objects.insert(chunk.object_id);
+  }
+
+  Status status;
+  std::vector<ObjectId> objects;
+  storage_->GetUnsyncedObjectIds(
+      GetFirstHead()->GetId(),
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &objects));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_EQ(expected_objects,
+            std::set<ObjectId>(objects.begin(), objects.end()));
+}
+
 TEST_F(PageStorageTest, UntrackedObjectsSimple) {
   ObjectData data("Some data");
 
@@ -813,6 +1084,49 @@ TEST_F(PageStorageTest, UntrackedObjectsComplex) {
   EXPECT_FALSE(storage_->ObjectIsUntracked(data[2].object_id));
 }
 
+TEST_F(PageStorageTest, DeleteRangeInJournal) {
+  ObjectData data[] = {
+      ObjectData("Some data"), ObjectData("Some more data"),
+      ObjectData("Even more data"),
+  };
+  for (int i = 0; i < 3; ++i) {
+    TryAddFromLocal(data[i].value, data[i].object_id);
+  }
+
+  std::unique_ptr<Journal> journal;
+  EXPECT_EQ(Status::OK, storage_->StartCommit(GetFirstHead()->GetId(),
+                                              JournalType::IMPLICIT, &journal));
+  for (const auto& key : {"key0", "key1", "key3", "key4"}) {
+    EXPECT_EQ(Status::OK,
+              journal->Put(key, data[0].object_id, KeyPriority::EAGER));
+  }
+  TryCommitJournal(&journal, Status::OK);
+
+  // The range deletion removes the keys of the base commit and the previous
+  // changes of the journal in the range, but not the following ones.
+  journal.reset();
+  EXPECT_EQ(Status::OK, storage_->StartCommit(GetFirstHead()->GetId(),
+                                              JournalType::IMPLICIT, &journal));
+  EXPECT_EQ(Status::OK,
+            journal->Put("key2", data[1].object_id, KeyPriority::EAGER));
+  EXPECT_EQ(Status::OK, journal->DeleteRange("key1", "key4"));
+  EXPECT_EQ(Status::OK,
+            journal->Put("key3", data[2].object_id, KeyPriority::EAGER));
+  std::unique_ptr<const Commit> commit = TryCommitJournal(&journal, Status::OK);
+  ASSERT_TRUE(commit);
+
+  // |data[1]| is no longer part of the commit.
+  EXPECT_TRUE(storage_->ObjectIsUntracked(data[1].object_id));
+  EXPECT_FALSE(storage_->ObjectIsUntracked(data[2].object_id));
+
+  std::vector<Entry> entries = GetCommitContents(*commit);
+  ASSERT_EQ(3u, entries.size());
+  EXPECT_EQ("key0", entries[0].key);
+  EXPECT_EQ("key3", entries[1].key);
+  EXPECT_EQ(data[2].object_id, entries[1].object_id);
+  EXPECT_EQ("key4", entries[2].key);
+}
+
 TEST_F(PageStorageTest, CommitWatchers) {
   FakeCommitWatcher watcher;
   storage_->AddCommitWatcher(&watcher);
@@ -0,0 +1,105 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/storage/impl/page_usage.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "apps/ledger/src/storage/impl/page_usage_generated.h"
+
+namespace storage {
+
+PageUsage::PageUsage() {}
+
+PageUsage::~PageUsage() {}
+
+void PageUsage::RecordAccess(PageIdView page_id) {
+  auto it = access_counts_.find(page_id);
+  if (it == access_counts_.end()) {
+    if (access_counts_.size() == kMaxTrackedPages) {
+      auto least_accessed = std::min_element(
+          access_counts_.begin(), access_counts_.end(),
+          [](const std::pair<const PageId, uint64_t>& a,
+             const std::pair<const PageId, uint64_t>& b) {
+            return a.second < b.second;
+          });
+      access_counts_.erase(least_accessed);
+    }
+    it = access_counts_.emplace(page_id.ToString(), 0u).first;
+  }
+  if (++it->second < kMaxPageAccessCount) {
+    return;
+  }
+  for (auto& access_count : access_counts_) {
+    access_count.second /= 2;
+  }
+}
+
+void PageUsage::Remove(PageIdView page_id) {
+  auto it = access_counts_.find(page_id);
+  if (it != access_counts_.end()) {
+    access_counts_.erase(it);
+  }
+}
+
+std::vector<PageId> PageUsage::GetMostAccessedPages(size_t max_count) const {
+  std::vector<std::pair<uint64_t, PageId>> pages;
+  pages.reserve(access_counts_.size());
+  for (const auto& access_count : access_counts_) {
+    pages.emplace_back(access_count.second, access_count.first);
+  }
+  max_count = std::min(max_count, pages.size());
+  std::partial_sort(pages.begin(), pages.begin() + max_count, pages.end(),
+                    [](const std::pair<uint64_t, PageId>& a,
+                       const std::pair<uint64_t, PageId>& b) {
+                      return a.first > b.first;
+                    });
+
+  std::vector<PageId> result;
+  result.reserve(max_count);
+  for (size_t i = 0; i < max_count; ++i) {
+    result.push_back(std::move(pages[i].second));
+  }
+  return result;
+}
+
+std::string PageUsage::Encode() const {
+  flatbuffers::FlatBufferBuilder builder;
+
+  std::vector<flatbuffers::Offset<PageAccessStorage>> pages;
+  pages.reserve(access_counts_.size());
+  for (const auto& access_count : access_counts_) {
+    pages.push_back(CreatePageAccessStorage(
+        builder, convert::ToFlatBufferVector(&builder, access_count.first),
+        access_count.second));
+  }
+  builder.Finish(CreatePageUsageStorage(builder, builder.CreateVector(pages)));
+  return std::string(reinterpret_cast<const char*>(builder.GetBufferPointer()),
+                     builder.GetSize());
+}
+
+bool PageUsage::Decode(ftl::StringView data) {
+  flatbuffers::Verifier verifier(
+      reinterpret_cast<const unsigned char*>(data.data()), data.size());
+  if (!VerifyPageUsageStorageBuffer(verifier)) {
+    return false;
+  }
+
+  const PageUsageStorage* usage = GetPageUsageStorage(
+      reinterpret_cast<const unsigned char*>(data.data()));
+  access_counts_.clear();
+  if (!usage->pages()) {
+    return true;
+  }
+  for (const PageAccessStorage* page : *usage->pages()) {
+    if (!page->page_id() || access_counts_.size() == kMaxTrackedPages) {
+      continue;
+    }
+    access_counts_[convert::ToString(page->page_id())] = page->access_count();
+  }
+  return true;
+}
+
+}  // namespace storage
@@ -0,0 +1,60 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_STORAGE_IMPL_PAGE_USAGE_H_
+#define APPS_LEDGER_SRC_STORAGE_IMPL_PAGE_USAGE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "apps/ledger/src/convert/convert.h"
+#include "apps/ledger/src/storage/public/types.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/strings/string_view.h"
+
+namespace storage {
+
+// Maximum number of pages whose accesses are counted.
+constexpr size_t kMaxTrackedPages = 64;
+// When an access count reaches this value, all the counts are halved, so that
+// recent accesses weigh more than old ones.
+constexpr uint64_t kMaxPageAccessCount = 1024;
+
+// Access counts of the pages of a ledger.
+class PageUsage {
+ public:
+  PageUsage();
+  ~PageUsage();
+
+  // Counts an access to the page |page_id|. If |kMaxTrackedPages| pages are
+  // already tracked, the least accessed one is forgotten.
+  void RecordAccess(PageIdView page_id);
+
+  // Forgets the accesses to the page |page_id|.
+  void Remove(PageIdView page_id);
+
+  // Returns the ids of the at most |max_count| most accessed pages, from the
+  // most to the least accessed.
+  std::vector<PageId> GetMostAccessedPages(size_t max_count) const;
+
+  // Serializes the access counts.
+  std::string Encode() const;
+
+  // Replaces the access counts with the ones serialized in |data|. Returns
+  // false if |data| is not a valid serialization.
+  bool Decode(ftl::StringView data);
+
+ private:
+  std::map<PageId, uint64_t, convert::StringViewComparator> access_counts_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(PageUsage);
+};
+
+}  // namespace storage
+
+#endif  // APPS_LEDGER_SRC_STORAGE_IMPL_PAGE_USAGE_H_
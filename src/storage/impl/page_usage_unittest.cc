@@ -0,0 +1,78 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/storage/impl/page_usage.h"
+
+#include "gtest/gtest.h"
+#include "lib/ftl/strings/string_printf.h"
+
+namespace storage {
+namespace {
+
+TEST(PageUsageTest, GetMostAccessedPages) {
+  PageUsage usage;
+  EXPECT_TRUE(usage.GetMostAccessedPages(3).empty());
+
+  for (int i = 0; i < 3; ++i) {
+    usage.RecordAccess("page1");
+  }
+  usage.RecordAccess("page2");
+  for (int i = 0; i < 2; ++i) {
+    usage.RecordAccess("page3");
+  }
+  EXPECT_EQ(std::vector<PageId>({"page1", "page3"}),
+            usage.GetMostAccessedPages(2));
+  EXPECT_EQ(std::vector<PageId>({"page1", "page3", "page2"}),
+            usage.GetMostAccessedPages(5));
+
+  usage.Remove("page1");
+  EXPECT_EQ(std::vector<PageId>({"page3", "page2"}),
+            usage.GetMostAccessedPages(5));
+}
+
+TEST(PageUsageTest, RecentAccessesWeighMore) {
+  PageUsage usage;
+  // Reaching the maximum count halves all counts: the new page catches up
+  // with half as many accesses.
+  for (uint64_t i = 0; i < kMaxPageAccessCount; ++i) {
+    usage.RecordAccess("old_page");
+  }
+  for (uint64_t i = 0; i < kMaxPageAccessCount / 2 + 1; ++i) {
+    usage.RecordAccess("new_page");
+  }
+  EXPECT_EQ(std::vector<PageId>({"new_page"}), usage.GetMostAccessedPages(1));
+}
+
+TEST(PageUsageTest, MaxTrackedPages) {
+  PageUsage usage;
+  for (size_t i = 0; i < kMaxTrackedPages; ++i) {
+    usage.RecordAccess(ftl::StringPrintf("page%03zu", i));
+    usage.RecordAccess(ftl::StringPrintf("page%03zu", i));
+  }
+  usage.RecordAccess("page000");
+  usage.RecordAccess("new_page");
+
+  // A new page replaces one of the least accessed pages.
+  std::vector<PageId> pages = usage.GetMostAccessedPages(kMaxTrackedPages + 1);
+  EXPECT_EQ(kMaxTrackedPages, pages.size());
+  EXPECT_EQ("page000", pages.front());
+  EXPECT_EQ("new_page", pages.back());
+}
+
+TEST(PageUsageTest, EncodeDecode) {
+  PageUsage usage;
+  usage.RecordAccess("page1");
+  usage.RecordAccess("page2");
+  usage.RecordAccess("page2");
+
+  PageUsage decoded_usage;
+  ASSERT_TRUE(decoded_usage.Decode(usage.Encode()));
+  EXPECT_EQ(std::vector<PageId>({"page2", "page1"}),
+            decoded_usage.GetMostAccessedPages(5));
+
+  EXPECT_FALSE(decoded_usage.Decode("invalid"));
+}
+
+}  // namespace
+}  // namespace storage
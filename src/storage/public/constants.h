@@ -5,6 +5,8 @@
 #ifndef APPS_LEDGER_SRC_STORAGE_PUBLIC_CONSTANTS_H_
 #define APPS_LEDGER_SRC_STORAGE_PUBLIC_CONSTANTS_H_
 
+#include <stdint.h>
+
 #include "lib/ftl/strings/string_view.h"
 
 namespace storage {
@@ -20,8 +22,16 @@ constexpr char kFirstPageCommitIdArray[kCommitIdSize] = {0};
 constexpr const ftl::StringView kFirstPageCommitId(kFirstPageCommitIdArray,
                                                    kCommitIdSize);
 
+// The fan-out of the commit trees, expressed as the base 2 logarithm of the
+// expected number of entries in a tree node. All the nodes of a tree share the
+// same fan-out, which is stored in each node so that the tree shape is the
+// same on all devices.
+constexpr uint8_t kDefaultFanoutBits = 8;
+constexpr uint8_t kMinFanoutBits = 2;
+constexpr uint8_t kMaxFanoutBits = 16;
+
 // The serialization version of the ledger.
-constexpr const ftl::StringView kSerializationVersion = "6";
+constexpr const ftl::StringView kSerializationVersion = "9";
 
 }  // namespace storage
 
@@ -5,6 +5,8 @@
 #ifndef APPS_LEDGER_SRC_STORAGE_PUBLIC_JOURNAL_H_
 #define APPS_LEDGER_SRC_STORAGE_PUBLIC_JOURNAL_H_
 
+#include <vector>
+
 #include "apps/ledger/src/convert/convert.h"
 #include "apps/ledger/src/storage/public/commit.h"
 #include "apps/ledger/src/storage/public/types.h"
@@ -29,6 +31,28 @@ class Journal {
   // on success or the error code otherwise.
   virtual Status Delete(convert::ExtendedStringView key) = 0;
 
+  // Deletes all the entries with a key in [|min_key|, |max_key|) from this
+  // |Journal|, including the ones of the base commit. An empty |max_key|
+  // extends the range to the end of the key space. On commit, subtrees of the
+  // base commit whose keys are all in the range are dropped without being
+  // read. Returns |OK| on success or the error code otherwise.
+  virtual Status DeleteRange(convert::ExtendedStringView min_key,
+                             convert::ExtendedStringView max_key) = 0;
+
+  // Sets the fan-out of the tree of the commit created by this |Journal|. See
+  // |kDefaultFanoutBits|. If it differs from the fan-out of the base commit,
+  // the whole tree is rebuilt on commit. |fanout_bits| must be in
+  // [kMinFanoutBits, kMaxFanoutBits]. Returns |OK| on success or the error code
+  // otherwise.
+  virtual Status SetFanout(uint8_t fanout_bits) = 0;
+
+  // Retrieves the changes added to this |Journal| so far, sorted by key, and
+  // the ranges deleted through |DeleteRange|. An entry of the base commit in a
+  // deleted range is removed, unless |changes| has an entry for its key.
+  // Returns |OK| on success or the error code otherwise.
+  virtual Status GetContents(std::vector<EntryChange>* changes,
+                             std::vector<KeyRange>* deleted_ranges) = 0;
+
   // Commits the changes of this |Journal|. Trying to update entries or rollback
   // will fail after a successful commit. The callback will be called with the
   // returned status and the new commit.
@@ -6,6 +6,7 @@
 #define APPS_LEDGER_SRC_STORAGE_PUBLIC_LEDGER_STORAGE_H_
 
 #include <memory>
+#include <vector>
 
 #include "apps/ledger/src/storage/public/page_storage.h"
 #include "apps/ledger/src/storage/public/types.h"
@@ -36,6 +37,14 @@ class LedgerStorage {
   // commits, tree nodes and objects.
   virtual bool DeletePageStorage(PageIdView page_id) = 0;
 
+  // Records an access to the page with |page_id|. The access counts of the
+  // pages are persisted, and used by |GetMostAccessedPages|.
+  virtual void RecordPageAccess(PageIdView page_id) = 0;
+
+  // Returns the ids of the at most |max_count| most accessed pages, from the
+  // most to the least accessed.
+  virtual std::vector<PageId> GetMostAccessedPages(size_t max_count) = 0;
+
  private:
   FTL_DISALLOW_COPY_AND_ASSIGN(LedgerStorage);
 };
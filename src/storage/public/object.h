@@ -5,6 +5,7 @@
 #ifndef APPS_LEDGER_SRC_STORAGE_PUBLIC_OBJECT_H_
 #define APPS_LEDGER_SRC_STORAGE_PUBLIC_OBJECT_H_
 
+#include <string>
 #include <vector>
 
 #include "apps/ledger/src/storage/public/types.h"
@@ -24,6 +25,21 @@ class Object {
   // Returns the data of this object.
   virtual Status GetData(ftl::StringView* data) const = 0;
 
+  // Returns the size of the data of this object, without reading the data.
+  virtual Status GetSize(uint64_t* size) const = 0;
+
+  // Reads the part of the data of this object designated by |offset| and
+  // |max_size| into |data|. See |GetDataPart|. Unlike |GetData|, only the
+  // requested part is read.
+  virtual Status ReadData(int64_t offset,
+                          int64_t max_size,
+                          std::string* data) const = 0;
+
+  // Returns the bytes of this object as stored and synced. This is the data of
+  // the object, unless it is split in chunks, in which case this is the index
+  // of its chunks.
+  virtual Status GetStorageBytes(ftl::StringView* data) const = 0;
+
  private:
   FTL_DISALLOW_COPY_AND_ASSIGN(Object);
 };
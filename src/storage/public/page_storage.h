@@ -38,6 +38,17 @@ class PageStorage {
     FTL_DISALLOW_COPY_AND_ASSIGN(CommitIdAndBytes);
   };
 
+  // Position of an interrupted iteration over the contents of a commit, from
+  // which the iteration can be resumed. See |GetCommitContentsWithCursor|.
+  class ContentsCursor {
+   public:
+    ContentsCursor() {}
+    virtual ~ContentsCursor() {}
+
+   private:
+    FTL_DISALLOW_COPY_AND_ASSIGN(ContentsCursor);
+  };
+
   // Location where to search an object. See |GetObject| call for usage.
   enum Location { LOCAL, NETWORK };
 
@@ -119,6 +130,8 @@ class PageStorage {
       size_t size,
       const std::function<void(Status)>& callback) = 0;
   // Adds the given local object and passes the new object's id to the callback.
+  // Large objects are split in content-defined chunks, shared with the other
+  // objects containing the same data.
   // If |size| is not negative, the content size must be equal to |size|,
   // otherwise the call will fail and return |IO_ERROR| in the callback. If
   // |size| is negative, no validation is done.
@@ -136,6 +149,24 @@ class PageStorage {
       Location location,
       const std::function<void(Status, std::unique_ptr<const Object>)>&
           callback) = 0;
+  // Reads the part of the object with the given |object_id| designated by
+  // |offset| and |max_size| (see |GetDataPart|) and passes it to |callback|.
+  // |location| is interpreted as in |GetObject|. If the object is split in
+  // chunks, only the chunks holding the requested part are read, or
+  // downloaded if they are not local.
+  virtual void GetObjectPart(
+      ObjectIdView object_id,
+      int64_t offset,
+      int64_t max_size,
+      Location location,
+      const std::function<void(Status, std::string)>& callback) = 0;
+  // Finds the size of the data of the object with the given |object_id| and
+  // passes it to |callback|, without reading the data. The size of an object
+  // split in chunks is read from its index, so it is known even if its chunks
+  // are not local. Returns |NOT_FOUND| if the object is not available locally.
+  virtual void GetObjectSize(
+      ObjectIdView object_id,
+      const std::function<void(Status, uint64_t)>& callback) = 0;
 
   // Sets the opaque sync metadata associated with this page. This state is
   // persisted through restarts and can be retrieved using |GetSyncMetadata()|.
@@ -156,6 +187,72 @@ class PageStorage {
                                  std::function<bool(Entry)> on_next,
                                  std::function<void(Status)> on_done) = 0;
 
+  // Same as |GetCommitContents|, but skips the first |offset| entries with a
+  // key equal to or greater than |min_key|.
+  virtual void GetCommitContentsFromOffset(
+      const Commit& commit,
+      std::string min_key,
+      uint64_t offset,
+      std::function<bool(Entry)> on_next,
+      std::function<void(Status)> on_done) = 0;
+
+  // Iterates over the entries of the given |commit| with a key in [|min_key|,
+  // |max_key|), in ascending key order, or in descending key order if
+  // |reverse| is true, and calls |on_next| on found entries. An empty
+  // |max_key| leaves the range unbounded above. If |max_count| is not 0, the
+  // iteration stops after |max_count| entries. |on_next| and |on_done| behave
+  // as in |GetCommitContents|.
+  virtual void GetCommitContentsInRange(
+      const Commit& commit,
+      std::string min_key,
+      std::string max_key,
+      uint64_t max_count,
+      bool reverse,
+      std::function<bool(Entry)> on_next,
+      std::function<void(Status)> on_done) = 0;
+
+  // Same as |GetCommitContentsInRange| in ascending key order and without
+  // maximum count, but the iteration can be resumed after |on_next| returns
+  // false: |on_done| is then called with a cursor on the entry on which
+  // |on_next| returned false. Otherwise, |on_done| is called with null.
+  virtual void GetCommitContentsWithCursor(
+      const Commit& commit,
+      std::string min_key,
+      std::string max_key,
+      std::function<bool(Entry)> on_next,
+      std::function<void(Status, std::unique_ptr<ContentsCursor>)>
+          on_done) = 0;
+
+  // Resumes the iteration of |cursor|, returned by this storage, starting at
+  // the entry on which it was interrupted. Resuming an iteration does not look
+  // up its first entry from the root of the tree again. |on_next| and
+  // |on_done| behave as in |GetCommitContentsWithCursor|.
+  virtual void ResumeCommitContents(
+      std::unique_ptr<ContentsCursor> cursor,
+      std::function<bool(Entry)> on_next,
+      std::function<void(Status, std::unique_ptr<ContentsCursor>)>
+          on_done) = 0;
+
+  // Counts the entries of |commit| with a key in [|min_key|, |max_key|) and
+  // calls |callback| with the result. An empty |max_key| leaves the range
+  // unbounded above.
+  virtual void CountCommitContents(
+      const Commit& commit,
+      std::string min_key,
+      std::string max_key,
+      std::function<void(Status, uint64_t)> callback) = 0;
+
+  // Computes the number of entries of |commit| with a key in [|min_key|,
+  // |max_key|) and the total size of their values, and calls |callback| with
+  // the result. An empty |max_key| leaves the range unbounded above. The size
+  // of values that are not available locally might not be accounted for, in
+  // which case the result is an estimate.
+  virtual void GetCommitContentsSize(
+      const Commit& commit,
+      std::string min_key,
+      std::string max_key,
+      std::function<void(Status, ContentsSize)> callback) = 0;
+
   // Retrieves the entry with the given |key| and calls |on_done| with the
   // result. The status of |on_done| will be |OK| on success, |NOT_FOUND| if
   // there is no such key in the given commit or an error status on failure.
@@ -176,6 +273,21 @@ class PageStorage {
       std::function<bool(EntryChange)> on_next_diff,
       std::function<void(Status)> on_done) = 0;
 
+  // Iterates over the differences between the contents of |base_commit| and
+  // of two commits derived from it, |left_commit| and |right_commit|, in a
+  // single pass over the three trees. |on_next_diff| is called, in key order,
+  // for each key whose entry is not the same in all three commits. Returning
+  // false from |on_next_diff| will immediately stop the iteration. |on_done| is
+  // called once, upon successfull completion, i.e. when there are no more
+  // differences or iteration was interrupted, or if an error occurs.
+  virtual void GetThreeWayContentsDiff(
+      const Commit& base_commit,
+      const Commit& left_commit,
+      const Commit& right_commit,
+      std::string min_key,
+      std::function<bool(ThreeWayChange)> on_next_diff,
+      std::function<void(Status)> on_done) = 0;
+
  private:
   FTL_DISALLOW_COPY_AND_ASSIGN(PageStorage);
 };
@@ -25,6 +25,54 @@ bool operator!=(const EntryChange& lhs, const EntryChange& rhs) {
   return !(lhs == rhs);
 }
 
+bool EntriesEqual(const std::unique_ptr<Entry>& lhs,
+                  const std::unique_ptr<Entry>& rhs) {
+  if (!lhs || !rhs) {
+    return !lhs && !rhs;
+  }
+  return *lhs == *rhs;
+}
+
+bool operator==(const ThreeWayChange& lhs, const ThreeWayChange& rhs) {
+  return EntriesEqual(lhs.base, rhs.base) && EntriesEqual(lhs.left, rhs.left) &&
+         EntriesEqual(lhs.right, rhs.right);
+}
+
+bool operator!=(const ThreeWayChange& lhs, const ThreeWayChange& rhs) {
+  return !(lhs == rhs);
+}
+
+bool KeyRangeContains(const KeyRange& range, ftl::StringView key) {
+  return ftl::StringView(range.min_key) <= key &&
+         (range.max_key.empty() || key < ftl::StringView(range.max_key));
+}
+
+bool operator==(const KeyRange& lhs, const KeyRange& rhs) {
+  return lhs.min_key == rhs.min_key && lhs.max_key == rhs.max_key;
+}
+
+bool operator!=(const KeyRange& lhs, const KeyRange& rhs) {
+  return !(lhs == rhs);
+}
+
+void GetDataPart(uint64_t size,
+                 int64_t offset,
+                 int64_t max_size,
+                 uint64_t* start,
+                 uint64_t* length) {
+  *start = size;
+  // Valid offsets are between -size and size-1.
+  if (offset >= 0 && static_cast<uint64_t>(offset) < size) {
+    *start = offset;
+  } else if (offset < 0 && static_cast<uint64_t>(-(offset + 1)) < size) {
+    *start = size + offset;
+  }
+  *length = size - *start;
+  if (max_size >= 0 && static_cast<uint64_t>(max_size) < *length) {
+    *length = max_size;
+  }
+}
+
 ftl::StringView StatusToString(Status status) {
   switch (status) {
     case Status::OK:
@@ -5,6 +5,7 @@
 #ifndef APPS_LEDGER_SRC_STORAGE_PUBLIC_TYPES_H_
 #define APPS_LEDGER_SRC_STORAGE_PUBLIC_TYPES_H_
 
+#include <memory>
 #include <ostream>
 #include <string>
 
@@ -47,6 +48,52 @@ struct EntryChange {
 bool operator==(const EntryChange& lhs, const EntryChange& rhs);
 bool operator!=(const EntryChange& lhs, const EntryChange& rhs);
 
+// A change between the contents of a common ancestor, |base|, and two commits
+// derived from it, |left| and |right|. Each entry is null if the key is absent
+// from the corresponding commit.
+struct ThreeWayChange {
+  std::unique_ptr<Entry> base;
+  std::unique_ptr<Entry> left;
+  std::unique_ptr<Entry> right;
+};
+
+// Returns whether |lhs| and |rhs| are both null or point to equal entries.
+bool EntriesEqual(const std::unique_ptr<Entry>& lhs,
+                  const std::unique_ptr<Entry>& rhs);
+
+bool operator==(const ThreeWayChange& lhs, const ThreeWayChange& rhs);
+bool operator!=(const ThreeWayChange& lhs, const ThreeWayChange& rhs);
+
+// A range of keys, from |min_key| included to |max_key| excluded. An empty
+// |max_key| extends the range to the end of the key space.
+struct KeyRange {
+  std::string min_key;
+  std::string max_key;
+};
+
+// Returns whether |key| is in |range|.
+bool KeyRangeContains(const KeyRange& range, ftl::StringView key);
+
+bool operator==(const KeyRange& lhs, const KeyRange& rhs);
+bool operator!=(const KeyRange& lhs, const KeyRange& rhs);
+
+// Computes the part of data of |size| bytes starting at |offset|, or at
+// |-offset| bytes from the end if |offset| is negative, and of at most
+// |max_size| bytes, or up to the end if |max_size| is negative. The part is
+// [|*start|, |*start| + |*length|), and is empty if |offset| is out of range.
+void GetDataPart(uint64_t size,
+                 int64_t offset,
+                 int64_t max_size,
+                 uint64_t* start,
+                 uint64_t* length);
+
+// The number of entries in a part of a commit's contents, and the total size
+// of their values in bytes.
+struct ContentsSize {
+  uint64_t entry_count = 0;
+  uint64_t value_bytes = 0;
+};
+
 enum class ChangeSource { LOCAL, SYNC };
 
 enum class JournalType { IMPLICIT, EXPLICIT };
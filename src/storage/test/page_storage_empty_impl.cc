@@ -119,6 +119,23 @@ void PageStorageEmptyImpl::GetObject(
   callback(Status::NOT_IMPLEMENTED, nullptr);
 }
 
+void PageStorageEmptyImpl::GetObjectPart(
+    ObjectIdView object_id,
+    int64_t offset,
+    int64_t max_size,
+    Location location,
+    const std::function<void(Status, std::string)>& callback) {
+  FTL_NOTIMPLEMENTED();
+  callback(Status::NOT_IMPLEMENTED, "");
+}
+
+void PageStorageEmptyImpl::GetObjectSize(
+    ObjectIdView object_id,
+    const std::function<void(Status, uint64_t)>& callback) {
+  FTL_NOTIMPLEMENTED();
+  callback(Status::NOT_IMPLEMENTED, 0u);
+}
+
 Status PageStorageEmptyImpl::SetSyncMetadata(ftl::StringView sync_state) {
   FTL_NOTIMPLEMENTED();
   return Status::NOT_IMPLEMENTED;
@@ -138,6 +155,64 @@ void PageStorageEmptyImpl::GetCommitContents(
   on_done(Status::NOT_IMPLEMENTED);
 }
 
+void PageStorageEmptyImpl::GetCommitContentsFromOffset(
+    const Commit& commit,
+    std::string min_key,
+    uint64_t offset,
+    std::function<bool(Entry)> on_next,
+    std::function<void(Status)> on_done) {
+  FTL_NOTIMPLEMENTED();
+  on_done(Status::NOT_IMPLEMENTED);
+}
+
+void PageStorageEmptyImpl::GetCommitContentsInRange(
+    const Commit& commit,
+    std::string min_key,
+    std::string max_key,
+    uint64_t max_count,
+    bool reverse,
+    std::function<bool(Entry)> on_next,
+    std::function<void(Status)> on_done) {
+  FTL_NOTIMPLEMENTED();
+  on_done(Status::NOT_IMPLEMENTED);
+}
+
+void PageStorageEmptyImpl::GetCommitContentsWithCursor(
+    const Commit& commit,
+    std::string min_key,
+    std::string max_key,
+    std::function<bool(Entry)> on_next,
+    std::function<void(Status, std::unique_ptr<ContentsCursor>)> on_done) {
+  FTL_NOTIMPLEMENTED();
+  on_done(Status::NOT_IMPLEMENTED, nullptr);
+}
+
+void PageStorageEmptyImpl::ResumeCommitContents(
+    std::unique_ptr<ContentsCursor> cursor,
+    std::function<bool(Entry)> on_next,
+    std::function<void(Status, std::unique_ptr<ContentsCursor>)> on_done) {
+  FTL_NOTIMPLEMENTED();
+  on_done(Status::NOT_IMPLEMENTED, nullptr);
+}
+
+void PageStorageEmptyImpl::CountCommitContents(
+    const Commit& commit,
+    std::string min_key,
+    std::string max_key,
+    std::function<void(Status, uint64_t)> callback) {
+  FTL_NOTIMPLEMENTED();
+  callback(Status::NOT_IMPLEMENTED, 0u);
+}
+
+void PageStorageEmptyImpl::GetCommitContentsSize(
+    const Commit& commit,
+    std::string min_key,
+    std::string max_key,
+    std::function<void(Status, ContentsSize)> callback) {
+  FTL_NOTIMPLEMENTED();
+  callback(Status::NOT_IMPLEMENTED, ContentsSize());
+}
+
 void PageStorageEmptyImpl::GetEntryFromCommit(
     const Commit& commit,
     std::string key,
@@ -156,5 +231,16 @@ void PageStorageEmptyImpl::GetCommitContentsDiff(
   on_done(Status::NOT_IMPLEMENTED);
 }
 
+void PageStorageEmptyImpl::GetThreeWayContentsDiff(
+    const Commit& base_commit,
+    const Commit& left_commit,
+    const Commit& right_commit,
+    std::string min_key,
+    std::function<bool(ThreeWayChange)> on_next_diff,
+    std::function<void(Status)> on_done) {
+  FTL_NOTIMPLEMENTED();
+  on_done(Status::NOT_IMPLEMENTED);
+}
+
 }  // namespace test
 }  // namespace storage
@@ -78,6 +78,16 @@ class PageStorageEmptyImpl : public PageStorage {
       const std::function<void(Status, std::unique_ptr<const Object>)>&
           callback) override;
 
+  void GetObjectPart(
+      ObjectIdView object_id,
+      int64_t offset,
+      int64_t max_size,
+      Location location,
+      const std::function<void(Status, std::string)>& callback) override;
+  void GetObjectSize(
+      ObjectIdView object_id,
+      const std::function<void(Status, uint64_t)>& callback) override;
+
   Status SetSyncMetadata(ftl::StringView sync_state) override;
 
   Status GetSyncMetadata(std::string* sync_state) override;
@@ -87,6 +97,47 @@ class PageStorageEmptyImpl : public PageStorage {
                          std::function<bool(Entry)> on_next,
                          std::function<void(Status)> on_done) override;
 
+  void GetCommitContentsFromOffset(
+      const Commit& commit,
+      std::string min_key,
+      uint64_t offset,
+      std::function<bool(Entry)> on_next,
+      std::function<void(Status)> on_done) override;
+
+  void GetCommitContentsInRange(const Commit& commit,
+                                std::string min_key,
+                                std::string max_key,
+                                uint64_t max_count,
+                                bool reverse,
+                                std::function<bool(Entry)> on_next,
+                                std::function<void(Status)> on_done) override;
+
+  void GetCommitContentsWithCursor(
+      const Commit& commit,
+      std::string min_key,
+      std::string max_key,
+      std::function<bool(Entry)> on_next,
+      std::function<void(Status, std::unique_ptr<ContentsCursor>)> on_done)
+      override;
+
+  void ResumeCommitContents(
+      std::unique_ptr<ContentsCursor> cursor,
+      std::function<bool(Entry)> on_next,
+      std::function<void(Status, std::unique_ptr<ContentsCursor>)> on_done)
+      override;
+
+  void CountCommitContents(
+      const Commit& commit,
+      std::string min_key,
+      std::string max_key,
+      std::function<void(Status, uint64_t)> callback) override;
+
+  void GetCommitContentsSize(
+      const Commit& commit,
+      std::string min_key,
+      std::string max_key,
+      std::function<void(Status, ContentsSize)> callback) override;
+
   void GetEntryFromCommit(const Commit& commit,
                           std::string key,
                           std::function<void(Status, Entry)> callback) override;
@@ -96,6 +147,13 @@ class PageStorageEmptyImpl : public PageStorage {
                              std::string min_key,
                              std::function<bool(EntryChange)> on_next_diff,
                              std::function<void(Status)> on_done) override;
+
+  void GetThreeWayContentsDiff(const Commit& base_commit,
+                               const Commit& left_commit,
+                               const Commit& right_commit,
+                               std::string min_key,
+                               std::function<bool(ThreeWayChange)> on_next_diff,
+                               std::function<void(Status)> on_done) override;
 };
 
 }  // namespace test